@@ -77,8 +77,8 @@ typedef union CSPYDR_FLAGS_STRUCT {
         bool require_entrypoint : 1;
         bool run_after_compile : 1;
         bool delete_executable : 1;
-
-        uint8_t __unused__ : 2;
+        bool external_assembler : 1;
+        bool lto : 1;
     };
     uint16_t flags;
 } CSPYDR_TYPE(Flags);
@@ -179,7 +179,8 @@ CSpydrToken_T* csp_new_token(CSpydrAllocator_T* alloc, CSpydrTokenType_T type, u
 CSpydrTokenType_T csp_token_get_type(CSpydrToken_T* tok);
 uint32_t csp_token_get_line(CSpydrToken_T* tok);
 uint32_t csp_token_get_position(CSpydrToken_T* tok);
-char* csp_token_get_value(CSpydrToken_T* tok);
+char* csp_token_get_value(CSpydrToken_T* tok); // string literals are not '\0'-terminated, see csp_token_get_length()
+uint32_t csp_token_get_length(CSpydrToken_T* tok);
 char* csp_token_get_file(CSpydrToken_T* tok);
 
 #ifdef __CSPYDR_INTERNAL_USE
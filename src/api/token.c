@@ -27,6 +27,11 @@ char* csp_token_get_value(CSpydrToken_T* tok)
     return tok ? tok->value : "(null)";
 }
 
+u32 csp_token_get_length(CSpydrToken_T* tok)
+{
+    return tok ? tok->length : 6;
+}
+
 char* csp_token_get_file(CSpydrToken_T* tok)
 {
     return tok ? 
@@ -6,6 +6,7 @@
 #include "stdbool.h"
 
 #include "list.h"
+#include "hashmap.h"
 #include "lexer/token.h"
 
 #define __CSPYDR_INTERNAL_USE
@@ -27,6 +28,7 @@ typedef struct AST_NODE_STRUCT         ASTNode_T;
 typedef struct AST_IDENTIFIER_STRUCT   ASTIdentifier_T;
 typedef struct AST_TYPE_STRUCT         ASTType_T;
 typedef struct AST_OBJ_STRUCT          ASTObj_T;
+typedef struct IR_FUNCTION_STRUCT      IRFunction_T;
 
 typedef enum UNPACK_MODE {
     UMODE_NONE = 0b00,
@@ -159,6 +161,9 @@ struct AST_NODE_STRUCT
     bool is_initializing : 1;
     bool result_ignored  : 1;
 
+    // return statement
+    bool tail_call : 1;
+
     // expression statement
     bool is_constant : 1;
     
@@ -168,7 +173,7 @@ struct AST_IDENTIFIER_STRUCT
 {
     Token_T* tok;
     ASTIdentifier_T* outer;
-    char* callee;
+    char* callee; // interned, compare by address
     bool global_scope;
 } __attribute__((packed));
 
@@ -211,6 +216,9 @@ struct AST_TYPE_STRUCT
     };
 
     u64 num_indices;
+
+    // enums: members by callee, built lazily by the validator
+    HashMap_T* member_index;
 } __attribute__((packed));
 
 struct AST_OBJ_STRUCT 
@@ -221,6 +229,7 @@ struct AST_OBJ_STRUCT
     ASTIdentifier_T* id;
     i32 offset;
     i32 stack_size;
+    u32 num_refs; // functions: number of references, counted by the inliner
 
     union {
         struct {
@@ -236,9 +245,15 @@ struct AST_OBJ_STRUCT
             bool after_main     : 1;
             bool before_main    : 1;
             bool constexpr      : 1;
-            u8 __unused__       : 4;
+            u8 asm_reg          : 3; // asm backend: 1-based variable register of locals, number of saved registers of functions
+            bool force_inline   : 1; // `[inline]`
+            bool no_inline      : 1; // `[no_inline]` or `[noinline]`
+            bool tail_call      : 1; // `[tailcall]`
+            u8 purity           : 2; // C backend: side effects of functions, see c_hints.h
+            bool no_alias       : 1; // C backend: pointer arguments of the function get `restrict`
+            u8 __unused__       : 3;
         };
-        u16 flags;
+        u32 flags;
     };
 
     ASTType_T* data_type;
@@ -246,6 +261,7 @@ struct AST_OBJ_STRUCT
     List_T* args;
     List_T* objs;
     List_T* deferred;
+    HashMap_T* member_index; // namespaces: `objs` by callee, built lazily by the validator
 
     // functions
     ASTType_T* return_type;
@@ -255,6 +271,7 @@ struct AST_OBJ_STRUCT
     ASTObj_T* va_area;
     ASTObj_T* return_ptr;
     const char* exported;
+    IRFunction_T* ir; // asm backend: set if the function got lowered to the IR
 } __attribute__((packed));
 
 typedef struct AST_EXIT_FN_HANDLE_STRUCT
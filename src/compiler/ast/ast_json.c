@@ -67,7 +67,7 @@ json_object* gen_tok(Token_T* tok)
         return json_object_new_null();
     json_object* obj = json_object_new_object();
 
-    if(strlen(tok->value)) json_object_object_add(obj, "value", gen_str(tok->value));
+    if(tok->length) json_object_object_add(obj, "value", json_object_new_string_len(tok->value, tok->length));
     if(tok->line) json_object_object_add(obj, "line", gen_i64(tok->line));
     if(tok->pos) json_object_object_add(obj, "pos", gen_i64(tok->pos));
     json_object_object_add(obj, "type", gen_i64(tok->type));
@@ -11,14 +11,19 @@
 #include "config.h"
 #include "list.h"
 #include "relocation.h"
+#include "assembler.h"
+#include "register_alloc.h"
+#include "vectorizer.h"
 #include "timer/timer.h"
 #include "linker.h"
+#include "thread_pool.h"
 #include "util.h"
 
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
 #include <libgen.h>
+#include <fcntl.h>
 
 #define CSPC_ASM_EXTERN_FN_POSTFIX "@GOTPCREL"
 
@@ -70,6 +75,12 @@ static const char* argreg64[] = {"%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9"};
 static const char call_reg[] = "%r10";
 static const char pipe_reg[] = "%r15";
 
+// callee-saved registers holding local variables, see register_alloc.h
+static const char* varreg8[ASM_NUM_VAR_REGS]  = {"%bl", "%r12b", "%r13b", "%r14b"};
+static const char* varreg16[ASM_NUM_VAR_REGS] = {"%bx", "%r12w", "%r13w", "%r14w"};
+static const char* varreg32[ASM_NUM_VAR_REGS] = {"%ebx", "%r12d", "%r13d", "%r14d"};
+static const char* varreg64[ASM_NUM_VAR_REGS] = {"%rbx", "%r12", "%r13", "%r14"};
+
 // The table for type casts
 static const char i32i8[]  = "movsbl %al, %eax";
 static const char i32u8[]  = "movzbl %al, %eax";
@@ -158,7 +169,7 @@ static void asm_gen_file_descriptors(ASMCodegenData_T* cg);
 static void asm_gen_entry_point(ASMCodegenData_T* cg);
 static void asm_gen_data(ASMCodegenData_T* cg, List_T* objs);
 static void asm_gen_text(ASMCodegenData_T* cg, List_T* objs);
-static void asm_gen_addr(ASMCodegenData_T* cg, ASTNode_T* node);
+static void asm_gen_pgo_dump(ASMCodegenData_T* cg);
 static void asm_assign_lvar_offsets(ASMCodegenData_T* cg, List_T* objs);
 static bool asm_has_flonum(ASTType_T* ty, i32 lo, i32 hi, i32 offset);
 static bool asm_has_flonum_1(ASTType_T* ty);
@@ -166,10 +177,10 @@ static bool asm_has_flonum_2(ASTType_T* ty);
 static void asm_store_fp(ASMCodegenData_T* cg, i32 r, i32 offset, i32 sz);
 static void asm_store_gp(ASMCodegenData_T* cg, i32 r, i32 offset, i32 sz);
 static void asm_gen_stmt(ASMCodegenData_T* cg, ASTNode_T* node);
-static void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node);
 static void asm_gen_lambda(ASMCodegenData_T* cg, ASTObj_T* lambda);
 static void asm_load(ASMCodegenData_T* cg, ASTType_T *ty);
 static void asm_gen_string_literals(ASMCodegenData_T* cg);
+static bool asm_escape_string(const char* str, char* buf);
 
 void init_asm_cg(ASMCodegenData_T* cg, Context_T* context, ASTProg_T* ast)
 {
@@ -180,12 +191,86 @@ void init_asm_cg(ASMCodegenData_T* cg, Context_T* context, ASTProg_T* ast)
     cg->embed_file_locations = context->flags.embed_debug_info;
     cg->code_buffer = open_memstream(&cg->buf, &cg->buf_len);
     cg->string_literals = init_list();
+    cg->string_labels = hashmap_init();
+    cg->raw_allocator = &context->raw_allocator;
+    cg->list_allocator = &context->list_allocator;
+
+    if(context->flags.optimize)
+    {
+        cg->peephole = malloc(sizeof(ASMPeephole_T));
+        init_asm_peephole(cg->peephole);
+    }
+
+    if(context->pgo_generate)
+        cg->pgo_counters = init_list();
+    else if(context->pgo_use)
+    {
+        cg->profile = malloc(sizeof(PGOProfile_T));
+        if(!pgo_load_profile(context, cg->profile))
+        {
+            context->emitted_warnings++;
+            LOG_WARN_F(COLOR_BOLD_YELLOW "[Warning]" COLOR_RESET COLOR_YELLOW " no profile of the assembly backend found in `%s`.\n", context->pgo_use);
+            free(cg->profile);
+            cg->profile = NULL;
+        }
+    }
 }
 
 void free_asm_cg(ASMCodegenData_T* cg)
 {
     free_list(cg->string_literals);
+    hashmap_free(cg->string_labels);
     free(cg->buf);
+
+    if(cg->peephole)
+    {
+        free_asm_peephole(cg->peephole);
+        free(cg->peephole);
+    }
+
+    if(cg->pgo_counters)
+        free_list(cg->pgo_counters);
+    if(cg->profile)
+    {
+        free_pgo_profile(cg->profile);
+        free(cg->profile);
+    }
+}
+
+static void asm_vprint(ASMCodegenData_T* cg, const char* fmt, va_list va, bool newline)
+{
+    if(!cg->peephole)
+    {
+        vfprintf(cg->code_buffer, fmt, va);
+        if(newline)
+            fputc('\n', cg->code_buffer);
+        return;
+    }
+
+    char buf[BUFSIZ];
+    va_list copy;
+    va_copy(copy, va);
+    i32 len = vsnprintf(buf, sizeof(buf) - 1, fmt, copy);
+    va_end(copy);
+
+    char* text = buf;
+    if((size_t) len >= sizeof(buf) - 1)
+    {
+        text = malloc(len + 2);
+        vsnprintf(text, len + 1, fmt, va);
+    }
+    if(newline)
+        strcpy(text + len, "\n");
+    asm_peephole_append(cg->peephole, text);
+    if(text != buf)
+        free(text);
+}
+
+// writes all code collected by the peephole optimizer
+static void asm_flush(ASMCodegenData_T* cg)
+{
+    if(cg->peephole)
+        asm_peephole_flush(cg->peephole, cg->code_buffer);
 }
 
 #ifdef __GNUC__
@@ -195,7 +280,7 @@ void asm_print(ASMCodegenData_T* cg, char* fmt, ...)
 {
     va_list va;
     va_start(va, fmt);
-    vfprintf(cg->code_buffer, fmt, va);
+    asm_vprint(cg, fmt, va, false);
     va_end(va);
 }
 
@@ -206,9 +291,8 @@ void asm_println(ASMCodegenData_T* cg, char* fmt, ...)
 {
     va_list va;
     va_start(va, fmt);
-    vfprintf(cg->code_buffer, fmt, va);
-    va_end(va);    
-    fputc('\n', cg->code_buffer);
+    asm_vprint(cg, fmt, va, true);
+    va_end(va);
 }
 
 static void write_code(ASMCodegenData_T* cg, const char* target, bool cachefile)
@@ -233,6 +317,7 @@ static void write_code(ASMCodegenData_T* cg, const char* target, bool cachefile)
     else
         sprintf(file_path, "%s.s", basename((char*) target));
 
+    asm_flush(cg);
     fclose(cg->code_buffer);
 
     FILE* out = open_file(file_path);
@@ -271,8 +356,12 @@ void asm_gen_code(ASMCodegenData_T* cg, const char* target)
     asm_gen_data(cg, cg->ast->objs);
     asm_gen_entry_point(cg);
     asm_gen_text(cg, cg->ast->objs);
+    if(cg->pgo_counters)
+        asm_gen_pgo_dump(cg);
     asm_gen_string_literals(cg);
     write_code(cg, target, cg->context->flags.do_assembling);
+    if(cg->pgo_counters)
+        pgo_write_names(cg->context, cg->pgo_counters);
 
     if(cg->print)
     {
@@ -297,7 +386,10 @@ void asm_gen_code(ASMCodegenData_T* cg, const char* target)
     else
         sprintf(obj_file, "%s.o", target);
 
-    // run the assembler
+    // the integrated assembler falls back to the external one for code it doesn't support,
+    // flags from --cc-flags are meant for the external assembler as well
+    bool integrated = !cg->context->flags.external_assembler && !cg->context->compiler_flags->size;
+    if(!integrated || !asm_assemble(cg->context, cg->buf, cg->buf_len, obj_file))
     {
         const char* args[] = {
             cg->context->as,
@@ -333,13 +425,32 @@ void asm_gen_code(ASMCodegenData_T* cg, const char* target)
         link_obj(cg->context, target, obj_file, cg->silent, cg->link_exec);
 }
 
-char* asm_gen_identifier(Context_T* context, ASTIdentifier_T* id)
+char* asm_gen_identifier(ASMCodegenData_T* cg, ASTIdentifier_T* id)
 {
     char* str = gen_identifier(id, ".", ".");
-    CONTEXT_ALLOC_REGISTER(context, (void*) str);
+    allocator_push(cg->raw_allocator, str);
     return str;
 }
 
+// returns the label id of the string. String literals are writable, only the ones
+// marked as constant by the typechecker may share their label.
+u64 asm_add_string_literal(ASMCodegenData_T* cg, ASTNode_T* str)
+{
+    ASMStringLiteral_T* literal = str->is_constant ? hashmap_get(cg->string_labels, str->str_val) : NULL;
+    if(literal)
+        return literal->label;
+
+    literal = allocator_malloc(cg->raw_allocator, sizeof(ASMStringLiteral_T));
+    literal->label = cg->max_count++;
+    literal->str = str->str_val;
+    literal->read_only = str->is_constant;
+    literal->next = NULL;
+    list_push(cg->string_literals, literal);
+    if(literal->read_only)
+        hashmap_put(cg->string_labels, str->str_val, literal);
+    return literal->label;
+}
+
 static void asm_gen_file_descriptors(ASMCodegenData_T* cg)
 {
     for(size_t i = 0; i < cg->ast->files->size; i++)
@@ -349,18 +460,27 @@ static void asm_gen_file_descriptors(ASMCodegenData_T* cg)
     }
 }
 
-static void asm_push(ASMCodegenData_T* cg) 
+void asm_push(ASMCodegenData_T* cg) 
 {
     asm_println(cg, "  push %%rax");
     cg->depth++;
 }
 
-static void asm_pop(ASMCodegenData_T* cg, const char* arg) 
+void asm_pop(ASMCodegenData_T* cg, const char* arg) 
 {
     asm_println(cg, "  pop %s", arg);
     cg->depth--;
 }
 
+// with --lto, every function and global gets a section of its own, which the linker drops if unused
+static void asm_gen_section(ASMCodegenData_T* cg, const char* section, const char* name)
+{
+    if(cg->context->flags.lto)
+        asm_println(cg, "  .section %s%s%s", section, *name == '.' ? "" : ".", name);
+    else
+        asm_println(cg, "  .section %s", section);
+}
+
 static void asm_gen_entry_point(ASMCodegenData_T* cg)
 {
     if(!cg->ast->entry_point)
@@ -374,7 +494,7 @@ static void asm_gen_entry_point(ASMCodegenData_T* cg)
     {
         for(size_t i = 0; i < cg->ast->before_main->size; i++)
         {
-            char* const id = asm_gen_identifier(cg->context, ((ASTObj_T*) cg->ast->before_main->items[i])->id);
+            char* const id = asm_gen_identifier(cg, ((ASTObj_T*) cg->ast->before_main->items[i])->id);
             asm_println(cg, "  call %s", id);
         }
     }
@@ -387,7 +507,7 @@ static void asm_gen_entry_point(ASMCodegenData_T* cg)
         for(size_t i = 0; i < cg->ast->after_main->size; i++)
         {
             const ASTObj_T* fn = cg->ast->after_main->items[i];
-            const char* id = asm_gen_identifier(cg->context, fn->id);
+            const char* id = asm_gen_identifier(cg, fn->id);
 
             if(fn->args->size)
                 asm_println(cg, "  movq (%%rsp), %s", argreg64[0]);
@@ -398,6 +518,9 @@ static void asm_gen_entry_point(ASMCodegenData_T* cg)
     else
         asm_println(cg, "  movq %rax, %rdi");
 
+    if(cg->pgo_counters)
+        asm_println(cg, "  call .L.pgo.dump");
+
     asm_println(cg, "  movq $60, %rax");
     asm_println(cg, "  syscall");
 }
@@ -458,6 +581,8 @@ static void asm_assign_lvar_offsets(ASMCodegenData_T* cg, List_T* objs)
                 top += var->data_type->size;
             }
 
+            asm_alloc_registers(obj);
+
             // va_area
             if(is_variadic(obj->data_type))
             {
@@ -485,7 +610,7 @@ static void asm_assign_lvar_offsets(ASMCodegenData_T* cg, List_T* objs)
             {
                 ASTObj_T* var = obj->args->items[j];
                 ASTType_T* ty = unpack(var->data_type);
-                if(var->offset)
+                if(var->offset || var->asm_reg)
                     continue;
                 
                 // AMD64 System V ABI has a special alignment rule for an array of
@@ -504,12 +629,16 @@ static void asm_assign_lvar_offsets(ASMCodegenData_T* cg, List_T* objs)
                 for(size_t j = 0; j < obj->objs->size; j++)
                 {
                     ASTObj_T* var = obj->objs->items[j];
+                    if(var->asm_reg)
+                        continue;
                     i32 align = (var->data_type->kind == TY_C_ARRAY || var->data_type->kind == TY_ARRAY) && var->data_type->size >= 16 ? MAX(16, var->data_type->align) : var->data_type->align;
                     bottom += var->data_type->size;
                     bottom = align_to(bottom, align);
                     var->offset = -bottom;
                 }
 
+            // saved registers are placed at the bottom of the frame
+            bottom += obj->asm_reg * 8;
             obj->stack_size = align_to(bottom, 16);
         } break;
 
@@ -548,9 +677,9 @@ static void asm_gen_data(ASMCodegenData_T* cg, List_T* objs)
                         ASTObj_T* member = ty->members->items[i];
                         if(!should_emit(cg->context, member))
                             continue;
-                        char* id = asm_gen_identifier(cg->context, member->id);
+                        char* id = asm_gen_identifier(cg, member->id);
                         asm_println(cg, "  .globl %s", id);
-                        asm_println(cg, "  .section .rodata");
+                        asm_gen_section(cg, ".rodata", id);
                         asm_println(cg, "  .type %s, @object", id);
                         asm_println(cg, "  .size %s, 4", id);
                         asm_println(cg, "  .align 4");
@@ -564,14 +693,14 @@ static void asm_gen_data(ASMCodegenData_T* cg, List_T* objs)
                 if(obj->is_extern || !should_emit(cg->context, obj))
                     continue;
                 {
-                    char* id = asm_gen_identifier(cg->context, obj->id);
+                    char* id = asm_gen_identifier(cg, obj->id);
                     asm_println(cg, "  .globl %s", id);
 
                     i32 align = (obj->data_type->kind == TY_C_ARRAY || obj->data_type->kind == TY_ARRAY) && obj->data_type->size >= 16 ? MAX(16, obj->data_type->align) : obj->data_type->align;
 
                     if(obj->value)
                     {
-                        asm_println(cg, "  .section %s", obj->data_type->is_constant ? ".rodata" : ".data");
+                        asm_gen_section(cg, obj->data_type->is_constant ? ".rodata" : ".data", id);
                         asm_println(cg, "  .type %s, @object", id);
                         asm_println(cg, "  .size %s, %d", id, obj->data_type->size);
                         asm_println(cg, "  .align %d", align);
@@ -583,7 +712,7 @@ static void asm_gen_data(ASMCodegenData_T* cg, List_T* objs)
                     }
                     else if(unpack(obj->data_type)->kind == TY_ARRAY)
                     {
-                        asm_println(cg, "  .section %s", obj->data_type->is_constant ? ".rodata" : ".data");
+                        asm_gen_section(cg, obj->data_type->is_constant ? ".rodata" : ".data", id);
                         asm_println(cg, "  .type %s, @object", id);
                         asm_println(cg, "  .size %s, %d", id, obj->data_type->size);
                         asm_println(cg, "  .align %d", align);
@@ -598,7 +727,7 @@ static void asm_gen_data(ASMCodegenData_T* cg, List_T* objs)
                     }
                     else
                     {
-                        asm_println(cg, "  .section .bss");    
+                        asm_gen_section(cg, ".bss", id);
                         asm_println(cg, "  .align %d", align);
                         asm_println(cg, "%s:", id);
                         asm_println(cg, "  .zero %d", obj->data_type->size);
@@ -624,28 +753,111 @@ static void asm_gen_defer(ASMCodegenData_T* cg, List_T* deferred)
     asm_pop(cg, "%rax");
 }
 
+// restores the registers and stack frame of the caller of `obj`
+static void asm_gen_leave(ASMCodegenData_T* cg, ASTObj_T* obj)
+{
+    for(i32 i = 0; i < obj->asm_reg; i++)
+        asm_println(cg, "  mov %d(%%rbp), %s", -obj->stack_size + i * 8, varreg64[i]);
+    asm_println(cg, "  mov %%rbp, %%rsp");
+    asm_println(cg, "  pop %%rbp");
+}
+
+// counts how often the current instruction runs with --pgo-generate
+static void asm_pgo_count(ASMCodegenData_T* cg, const char* name)
+{
+    char* counter = allocator_push(cg->raw_allocator, strdup(name));
+    list_push(cg->pgo_counters, counter);
+    asm_println(cg, "  incq .L.pgo.%s(%%rip)", counter);
+}
+
+static void asm_pgo_enter(ASMCodegenData_T* cg, const char* fn_name)
+{
+    cg->pgo_fn = cg->pgo_counters || cg->profile ? fn_name : NULL;
+    cg->pgo_branch = 0;
+    if(cg->pgo_counters)
+        asm_pgo_count(cg, fn_name);
+}
+
+// names the counter of a branch of the `if` statement `id` in the current function
+static char* asm_pgo_branch(ASMCodegenData_T* cg, char name[BUFSIZ], u32 id, const char* branch)
+{
+    snprintf(name, BUFSIZ, "%s.if%u.%s", cg->pgo_fn, id, branch);
+    return name;
+}
+
+static void asm_pgo_count_branch(ASMCodegenData_T* cg, u32 id, const char* branch)
+{
+    char name[BUFSIZ];
+    if(cg->pgo_counters && cg->pgo_fn)
+        asm_pgo_count(cg, asm_pgo_branch(cg, name, id, branch));
+}
+
+// generates a branch into `cold_code`, which gets placed after the end of the function
+static void asm_gen_cold_branch(ASMCodegenData_T* cg, ASTNode_T* stmt, const char* label, u64 id)
+{
+    if(!cg->cold_code)
+        cg->cold_code = open_memstream(&cg->cold_buf, &cg->cold_len);
+
+    ASMPeephole_T* peephole = cg->peephole;
+    FILE* code_buffer = cg->code_buffer;
+    cg->peephole = NULL;
+    cg->code_buffer = cg->cold_code;
+
+    asm_println(cg, ".L.%s.%lu:", label, id);
+    asm_gen_stmt(cg, stmt);
+    asm_println(cg, "  jmp .L.end.%lu", id);
+
+    cg->peephole = peephole;
+    cg->code_buffer = code_buffer;
+}
+
+static void asm_gen_cold_code(ASMCodegenData_T* cg)
+{
+    if(!cg->cold_code)
+        return;
+
+    fclose(cg->cold_code);
+    cg->cold_code = NULL;
+
+    char* line = cg->cold_buf;
+    for(char* end; (end = strchr(line, '\n')); line = end + 1)
+        asm_println(cg, "%.*s", (int) (end - line), line);
+
+    free(cg->cold_buf);
+    cg->cold_buf = NULL;
+}
+
 static void asm_gen_function_signature(ASMCodegenData_T* cg, const char* fn_name)
 {
     asm_println(cg, "  .globl %s", fn_name);
-    asm_println(cg, "  .section .text");
     asm_println(cg, "  .type %s, @function", fn_name);
     asm_println(cg, "%s:", fn_name);
 }
 
 static void asm_gen_function(ASMCodegenData_T* cg, ASTObj_T* obj)
 {
-    char* fn_name = asm_gen_identifier(cg->context, obj->id);
+    char* fn_name = asm_gen_identifier(cg, obj->id);
+    asm_gen_section(cg, ".text", fn_name);
     asm_gen_function_signature(cg, fn_name);
     if(obj->exported)
         asm_gen_function_signature(cg, obj->exported);
 
     cg->current_fn = obj;
+    asm_pgo_enter(cg, fn_name);
+
+    if(obj->ir)
+    {
+        asm_gen_ir_function(cg, obj, fn_name);
+        return;
+    }
 
     // prologue
     asm_println(cg, "  push %%rbp");
     asm_println(cg, "  mov %%rsp, %%rbp");
     asm_println(cg, "  sub $%d, %%rsp", obj->stack_size);
     asm_println(cg, "  mov %%rsp, %d(%%rbp)", obj->alloca_bottom->offset);
+    for(i32 i = 0; i < obj->asm_reg; i++)
+        asm_println(cg, "  mov %s, %d(%%rbp)", varreg64[i], -obj->stack_size + i * 8);
 
     if(cg->embed_file_locations)
         asm_println(cg, "  .loc %d %d", obj->tok->source->file_no + 1, obj->tok->line + 1);
@@ -728,7 +940,10 @@ static void asm_gen_function(ASMCodegenData_T* cg, ASTObj_T* obj)
                 asm_store_fp(cg, fp++, arg->offset, ty->size);
                 break;
             default:
-                asm_store_gp(cg, gp++, arg->offset, ty->size);
+                if(arg->asm_reg)
+                    asm_println(cg, "  mov %s, %s", argreg64[gp++], varreg64[arg->asm_reg - 1]);
+                else
+                    asm_store_gp(cg, gp++, arg->offset, ty->size);
         }
     }
 
@@ -737,19 +952,36 @@ static void asm_gen_function(ASMCodegenData_T* cg, ASTObj_T* obj)
     asm_gen_stmt(cg, obj->body);
     if(cg->depth != 0) {
         cg->depth = 0;
-        throw_error(cg->context, ERR_CODEGEN_WARN, obj->tok, "cg->depth is not 0");
+        asm_error(cg, ERR_CODEGEN_WARN, obj->tok, "cg->depth is not 0");
     }
     cg->current_fn_name = NULL;
 
     // epilogue
     asm_println(cg, ".L.return.%s:", fn_name);
     asm_gen_defer(cg, obj->deferred);
-    asm_println(cg, "  mov %%rbp, %%rsp");
-    asm_println(cg, "  pop %%rbp");
+    asm_gen_leave(cg, obj);
     asm_println(cg, "  ret");
+    asm_gen_cold_code(cg);
 }
 
-static void asm_gen_text(ASMCodegenData_T* cg, List_T* objs)
+// Every function gets generated into a buffer of its own with its own label namespace and string
+// literals, so functions can be generated in parallel. The buffers get concatenated in declaration
+// order, which makes the output independent of the number of threads.
+typedef struct ASM_FUNCTION_JOB_STRUCT
+{
+    ASMCodegenData_T cg;
+    ASTObj_T* obj;
+    u64 label_ns;
+
+    ThreadPoolJob_T job;
+    Allocator_T raw_allocator;
+    Allocator_T list_allocator;
+    bool failed;
+} ASMFunctionJob_T;
+
+#define ASM_LABEL_NS_SHIFT 32
+
+static void collect_functions(ASMCodegenData_T* cg, List_T* objs, List_T* functions)
 {
     for(size_t i = 0; i < objs->size; i++)
     {
@@ -757,17 +989,16 @@ static void asm_gen_text(ASMCodegenData_T* cg, List_T* objs)
         switch(obj->kind)
         {
             case OBJ_NAMESPACE:
-                asm_gen_text(cg, obj->objs);
+                collect_functions(cg, obj->objs, functions);
                 break;
 
             case OBJ_FUNCTION:
-                if(obj->is_extern || !should_emit(cg->context, obj)) 
-                    continue;
-                asm_gen_function(cg, obj);
+                if(!obj->is_extern && should_emit(cg->context, obj))
+                    list_push(functions, obj);
                 break;
-            
+
             case OBJ_LAMBDA:
-                asm_gen_lambda(cg, obj);
+                list_push(functions, obj);
                 break;
 
             default:
@@ -776,6 +1007,301 @@ static void asm_gen_text(ASMCodegenData_T* cg, List_T* objs)
     }
 }
 
+static void init_function_job(ASMFunctionJob_T* job, ASMCodegenData_T* parent)
+{
+    ASMCodegenData_T* cg = &job->cg;
+    memset(cg, 0, sizeof(ASMCodegenData_T));
+    cg->context = parent->context;
+    cg->ast = parent->ast;
+    cg->silent = parent->silent;
+    cg->print = parent->print;
+    cg->embed_file_locations = parent->embed_file_locations;
+    cg->link_exec = parent->link_exec;
+
+    cg->code_buffer = open_memstream(&cg->buf, &cg->buf_len);
+    cg->string_literals = init_list();
+    cg->string_labels = hashmap_init();
+    cg->lambdas = init_list();
+    cg->max_count = job->label_ns << ASM_LABEL_NS_SHIFT;
+
+    // most functions allocate only a few bytes, so a region would waste a whole chunk
+    init_allocator(&job->raw_allocator, free);
+    init_allocator(&job->list_allocator, (void (*)(void*)) free_list);
+    cg->raw_allocator = &job->raw_allocator;
+    cg->list_allocator = &job->list_allocator;
+
+    if(parent->peephole)
+    {
+        cg->peephole = malloc(sizeof(ASMPeephole_T));
+        init_asm_peephole(cg->peephole);
+    }
+
+    cg->profile = parent->profile;
+    if(parent->pgo_counters)
+        cg->pgo_counters = init_list();
+
+    job->failed = false;
+}
+
+static void free_function_job(ASMFunctionJob_T* job, ASMCodegenData_T* parent)
+{
+    ASMCodegenData_T* cg = &job->cg;
+    if(cg->code_buffer)
+        fclose(cg->code_buffer);
+    free(cg->buf);
+    free_list(cg->string_literals);
+    hashmap_free(cg->string_labels);
+    free_list(cg->lambdas);
+    if(cg->peephole)
+    {
+        free_asm_peephole(cg->peephole);
+        free(cg->peephole);
+    }
+    if(cg->pgo_counters)
+        free_list(cg->pgo_counters);
+    if(cg->cold_code)
+        fclose(cg->cold_code);
+    free(cg->cold_buf);
+
+    allocator_adopt(parent->raw_allocator, &job->raw_allocator);
+    allocator_adopt(parent->list_allocator, &job->list_allocator);
+    free_allocator(&job->raw_allocator);
+    free_allocator(&job->list_allocator);
+}
+
+static void gen_function_job(ASMFunctionJob_T* job)
+{
+    ASMCodegenData_T* cg = &job->cg;
+    if(job->obj->kind == OBJ_LAMBDA)
+        asm_gen_lambda(cg, job->obj);
+    else
+        asm_gen_function(cg, job->obj);
+    asm_flush(cg);
+
+    fclose(cg->code_buffer);
+    cg->code_buffer = NULL;
+}
+
+// runs on a worker thread
+static void run_function_job(void* arg)
+{
+    ASMFunctionJob_T* job = arg;
+    Exception_T bail;
+    job->cg.detached = &bail;
+
+    try(bail)
+        gen_function_job(job);
+    catch
+        job->failed = true;
+
+    job->cg.detached = NULL;
+}
+
+// adds the code of a finished job to the output
+static void finish_function_job(ASMCodegenData_T* cg, ASMFunctionJob_T* job, List_T* lambdas)
+{
+    if(job->failed)
+    {
+        // generate the function again on the main thread, which reports the errors
+        free_function_job(job, cg);
+        job->obj->deferred = NULL;
+        init_function_job(job, cg);
+        gen_function_job(job);
+    }
+
+    asm_flush(cg);
+    fwrite(job->cg.buf, 1, job->cg.buf_len, cg->code_buffer);
+
+    for(size_t i = 0; i < job->cg.string_literals->size; i++)
+        list_push(cg->string_literals, job->cg.string_literals->items[i]);
+
+    if(cg->pgo_counters)
+        for(size_t i = 0; i < job->cg.pgo_counters->size; i++)
+            list_push(cg->pgo_counters, job->cg.pgo_counters->items[i]);
+
+    for(size_t i = 0; i < job->cg.lambdas->size; i++)
+    {
+        list_push(cg->ast->objs, job->cg.lambdas->items[i]);
+        list_push(lambdas, job->cg.lambdas->items[i]);
+    }
+
+    free_function_job(job, cg);
+}
+
+typedef struct ASM_FUNCTION_ORDER_STRUCT
+{
+    ASTObj_T* obj;
+    u64 count;
+    size_t index;
+} ASMFunctionOrder_T;
+
+static int compare_function_order(const void* a, const void* b)
+{
+    const ASMFunctionOrder_T* fa = a, *fb = b;
+    if(fa->count != fb->count)
+        return fa->count < fb->count ? 1 : -1;
+    return fa->index < fb->index ? -1 : fa->index > fb->index;
+}
+
+// places frequently called functions next to each other and the ones that never ran last,
+// functions unknown to the profile count as called once
+static void asm_pgo_order_functions(ASMCodegenData_T* cg, List_T* functions)
+{
+    ASMFunctionOrder_T* order = malloc(functions->size * sizeof(ASMFunctionOrder_T));
+    for(size_t i = 0; i < functions->size; i++)
+    {
+        ASTObj_T* obj = functions->items[i];
+        order[i] = (ASMFunctionOrder_T){.obj = obj, .count = 1, .index = i};
+        if(obj->kind == OBJ_FUNCTION)
+            pgo_count(cg->profile, asm_gen_identifier(cg, obj->id), &order[i].count);
+    }
+
+    qsort(order, functions->size, sizeof(ASMFunctionOrder_T), compare_function_order);
+    for(size_t i = 0; i < functions->size; i++)
+        functions->items[i] = order[i].obj;
+    free(order);
+}
+
+// adds the counters to the profile when `main` returns or the program calls `exit()`
+static void asm_gen_pgo_dump(ASMCodegenData_T* cg)
+{
+    char dir[BUFSIZ];
+    char path[BUFSIZ * 2];
+    snprintf(path, sizeof(path), "%s" DIRECTORY_DELIMS PGO_COUNTS_FILE, pgo_profile_dir(cg->context, dir));
+    char* escaped = malloc(strlen(path) * 4 + 1);
+    asm_escape_string(path, escaped);
+    size_t size = cg->pgo_counters->size * sizeof(u64);
+
+    asm_println(cg, "  .section .text");
+    asm_println(cg, ".L.pgo.dump:");
+    asm_println(cg, "  cmpb $0, .L.pgo.dumped(%%rip)"); // both `_start` and the `.fini_array` call the dump
+    asm_println(cg, "  jne .L.pgo.done");
+    asm_println(cg, "  movb $1, .L.pgo.dumped(%%rip)");
+    asm_println(cg, "  push %%rdi");
+    asm_println(cg, "  mov $2, %%eax"); // open
+    asm_println(cg, "  lea .L.pgo.path(%%rip), %%rdi");
+    asm_println(cg, "  mov $%d, %%esi", O_RDWR | O_CREAT);
+    asm_println(cg, "  mov $%d, %%edx", 0644);
+    asm_println(cg, "  syscall");
+    asm_println(cg, "  test %%rax, %%rax");
+    asm_println(cg, "  js .L.pgo.failed");
+    asm_println(cg, "  mov %%rax, %%rdi");
+    // adds the counts of previous runs, unless the profile belongs to a different build
+    asm_println(cg, "  mov $0, %%eax"); // read
+    asm_println(cg, "  lea .L.pgo.previous(%%rip), %%rsi");
+    asm_println(cg, "  mov $%zu, %%edx", size + sizeof(u64));
+    asm_println(cg, "  syscall");
+    if(size)
+    {
+        asm_println(cg, "  cmp $%zu, %%rax", size);
+        asm_println(cg, "  jne .L.pgo.write");
+        asm_println(cg, "  lea .L.pgo.counters(%%rip), %%rsi");
+        asm_println(cg, "  lea .L.pgo.previous(%%rip), %%rdx");
+        asm_println(cg, "  mov $%zu, %%ecx", cg->pgo_counters->size);
+        asm_println(cg, ".L.pgo.add:");
+        asm_println(cg, "  mov (%%rdx), %%rax");
+        asm_println(cg, "  add %%rax, (%%rsi)");
+        asm_println(cg, "  add $8, %%rsi");
+        asm_println(cg, "  add $8, %%rdx");
+        asm_println(cg, "  dec %%ecx");
+        asm_println(cg, "  jnz .L.pgo.add");
+    }
+    asm_println(cg, ".L.pgo.write:");
+    asm_println(cg, "  mov $77, %%eax"); // ftruncate
+    asm_println(cg, "  mov $%zu, %%esi", size);
+    asm_println(cg, "  syscall");
+    asm_println(cg, "  mov $18, %%eax"); // pwrite64
+    asm_println(cg, "  lea .L.pgo.counters(%%rip), %%rsi");
+    asm_println(cg, "  mov $%zu, %%edx", size);
+    asm_println(cg, "  xor %%r10d, %%r10d");
+    asm_println(cg, "  syscall");
+    asm_println(cg, "  mov $3, %%eax"); // close
+    asm_println(cg, "  syscall");
+    asm_println(cg, ".L.pgo.failed:");
+    asm_println(cg, "  pop %%rdi");
+    asm_println(cg, ".L.pgo.done:");
+    asm_println(cg, "  ret");
+
+    // run by libc's `exit()` and by `std::process::exit()`
+    asm_println(cg, "  .section .fini_array,\"aw\"");
+    asm_println(cg, "  .align 8");
+    asm_println(cg, "  .quad .L.pgo.dump");
+
+    asm_println(cg, "  .section .rodata");
+    asm_println(cg, ".L.pgo.path:");
+    asm_println(cg, "  .string \"%s\"", escaped);
+    free(escaped);
+
+    asm_println(cg, "  .section .bss");
+    asm_println(cg, "  .align 8");
+    asm_println(cg, ".L.pgo.counters:");
+    for(size_t i = 0; i < cg->pgo_counters->size; i++)
+    {
+        asm_println(cg, ".L.pgo.%s:", (char*) cg->pgo_counters->items[i]);
+        asm_println(cg, "  .zero 8");
+    }
+    asm_println(cg, ".L.pgo.previous:");
+    asm_println(cg, "  .zero %zu", size + sizeof(u64));
+    asm_println(cg, ".L.pgo.dumped:");
+    asm_println(cg, "  .zero 1");
+}
+
+static void asm_gen_text(ASMCodegenData_T* cg, List_T* objs)
+{
+    ThreadPool_T* pool = NULL;
+    if(cg->context->num_threads > 1)
+    {
+        pool = malloc(sizeof(ThreadPool_T));
+        init_thread_pool(pool, cg->context->num_threads);
+    }
+
+    List_T* functions = init_list();
+    collect_functions(cg, objs, functions);
+    if(cg->profile)
+        asm_pgo_order_functions(cg, functions);
+    u64 label_ns = 0;
+
+    // lambdas found in one round get generated in the next one, after all other functions
+    while(functions->size)
+    {
+        ASMFunctionJob_T* jobs = calloc(functions->size, sizeof(ASMFunctionJob_T));
+        for(size_t i = 0; i < functions->size; i++)
+        {
+            ASMFunctionJob_T* job = &jobs[i];
+            job->obj = functions->items[i];
+            job->label_ns = ++label_ns;
+            init_function_job(job, cg);
+
+            if(pool)
+            {
+                init_thread_pool_job(&job->job, run_function_job, job);
+                thread_pool_submit(pool, &job->job);
+            }
+        }
+
+        List_T* lambdas = init_list();
+        for(size_t i = 0; i < functions->size; i++)
+        {
+            if(pool)
+                thread_pool_await(pool, &jobs[i].job);
+            else
+                gen_function_job(&jobs[i]);
+            finish_function_job(cg, &jobs[i], lambdas);
+        }
+
+        free(jobs);
+        free_list(functions);
+        functions = lambdas;
+    }
+
+    free_list(functions);
+    if(pool)
+    {
+        free_thread_pool(pool);
+        free(pool);
+    }
+}
+
 static i32 get_type_id(ASTType_T *ty) {
     switch (unpack(ty)->kind) {
         case TY_I8:
@@ -820,23 +1346,146 @@ static void asm_popf(ASMCodegenData_T* cg, i32 reg)
     cg->depth--;
 }
 
+// Locals, which can be accessed directly without computing their address first
+static bool asm_is_direct_var(ASTNode_T* node)
+{
+    if(node->kind != ND_ID || !node->referenced_obj)
+        return false;
+    if(node->referenced_obj->kind != OBJ_LOCAL && node->referenced_obj->kind != OBJ_FN_ARG)
+        return false;
+
+    ASTType_T* ty = unpack(EITHER(node->data_type, node->referenced_obj->data_type));
+    return is_integer(ty) || ty->kind == TY_PTR || ty->kind == TY_F32 || ty->kind == TY_F64;
+}
+
+// Operands, which get evaluated to %rax without touching any other register
+static bool asm_is_leaf(ASTNode_T* node)
+{
+    switch(node->kind)
+    {
+        case ND_INT:
+        case ND_LONG:
+        case ND_ULONG:
+        case ND_CHAR:
+        case ND_BOOL:
+        case ND_NIL:
+            return true;
+        case ND_ID:
+            return asm_is_direct_var(node) && !is_flonum(unpack(EITHER(node->data_type, node->referenced_obj->data_type)));
+        default:
+            return false;
+    }
+}
+
+static void asm_var_operand(char* buffer, ASTObj_T* var, i32 size)
+{
+    if(!var->asm_reg)
+    {
+        sprintf(buffer, "%d(%%rbp)", var->offset);
+        return;
+    }
+
+    i32 reg = var->asm_reg - 1;
+    strcpy(buffer, size == 1 ? varreg8[reg] : size == 2 ? varreg16[reg] : size == 4 ? varreg32[reg] : varreg64[reg]);
+}
+
+// Load a local variable to %rax like `asm_load()`
+static void asm_load_var(ASMCodegenData_T* cg, ASTObj_T* var, ASTType_T* ty)
+{
+    char src[32];
+    ty = unpack(ty);
+    asm_var_operand(src, var, ty->size);
+
+    switch(ty->kind)
+    {
+        case TY_F32:
+            asm_println(cg, "  movss %s, %%xmm0", src);
+            return;
+        case TY_F64:
+            asm_println(cg, "  movsd %s, %%xmm0", src);
+            return;
+        default:
+            break;
+    }
+
+    char *insn = is_unsigned(ty) ? "movz" : "movs";
+
+    if (ty->size == 1)
+        asm_println(cg, "  %sbl %s, %%eax", insn, src);
+    else if (ty->size == 2)
+        asm_println(cg, "  %swl %s, %%eax", insn, src);
+    else if (ty->size == 4)
+        asm_println(cg, "  movsxd %s, %%rax", src);
+    else
+        asm_println(cg, "  mov %s, %%rax", src);
+}
+
+// Store %rax to a local variable like `asm_store()`
+void asm_store_var(ASMCodegenData_T* cg, ASTObj_T* var, ASTType_T* ty)
+{
+    ty = unpack(ty);
+    if(var->asm_reg)
+    {
+        asm_println(cg, "  mov %%rax, %s", varreg64[var->asm_reg - 1]);
+        return;
+    }
+
+    switch(ty->kind)
+    {
+        case TY_F32:
+            asm_println(cg, "  movss %%xmm0, %d(%%rbp)", var->offset);
+            return;
+        case TY_F64:
+            asm_println(cg, "  movsd %%xmm0, %d(%%rbp)", var->offset);
+            return;
+        default:
+            break;
+    }
+
+    if(ty->size == 1)
+        asm_println(cg, "  mov %%al, %d(%%rbp)", var->offset);
+    else if(ty->size == 2)
+        asm_println(cg, "  mov %%ax, %d(%%rbp)", var->offset);
+    else if(ty->size == 4)
+        asm_println(cg, "  mov %%eax, %d(%%rbp)", var->offset);
+    else
+        asm_println(cg, "  mov %%rax, %d(%%rbp)", var->offset);
+}
+
+// Save the first operand of a binary operation to %rdi. It only has to go
+// through the stack, if evaluating the second one uses other registers.
+static void asm_push_operand(ASMCodegenData_T* cg, bool leaf)
+{
+    if(leaf)
+        asm_println(cg, "  mov %%rax, %%rdi");
+    else
+        asm_push(cg);
+}
+
+static void asm_pop_operand(ASMCodegenData_T* cg, bool leaf)
+{
+    if(!leaf)
+        asm_pop(cg, "%rdi");
+}
+
 static void asm_gen_index(ASMCodegenData_T* cg, ASTNode_T* index, bool gen_address)
 {
+    bool leaf = !index->from_back && asm_is_leaf(index->expr);
     asm_gen_expr(cg, index->left);
-    asm_push(cg);
+    asm_push_operand(cg, leaf);
 
     switch(unpack(index->left->data_type)->kind)
     {
         case TY_PTR:
         case TY_FN:
             asm_gen_expr(cg, index->expr);
-            asm_pop(cg, "%rdi");
+            asm_pop_operand(cg, leaf);
             asm_println(cg, "  imul $%d, %%rax", index->data_type->size);
             break;
 
         case TY_C_ARRAY:
             asm_gen_expr(cg, index->expr);
-            asm_pop(cg, "%rdi");
+            asm_pop_operand(cg, leaf);
             if(index->from_back)
             {
                 asm_println(cg, "  imul $%d, %%rax", -index->data_type->size);
@@ -863,14 +1512,14 @@ static void asm_gen_index(ASMCodegenData_T* cg, ASTNode_T* index, bool gen_addre
             else
             {
                 asm_gen_expr(cg, index->expr);
-                asm_pop(cg, "%rdi");
+                asm_pop_operand(cg, leaf);
                 asm_println(cg, "  imul $%d, %%rax", index->data_type->size);
             }
             asm_println(cg, "  add $8, %%rax");
             break;
 
         default:
-            throw_error(cg->context, ERR_CODEGEN, index->tok, "wrong index type");
+            asm_error(cg, ERR_CODEGEN, index->tok, "wrong index type");
     }
 
     asm_println(cg, "  add %%rdi, %%rax");
@@ -879,7 +1528,7 @@ static void asm_gen_index(ASMCodegenData_T* cg, ASTNode_T* index, bool gen_addre
         asm_load(cg, index->data_type);
 }
 
-static void asm_gen_addr(ASMCodegenData_T* cg, ASTNode_T* node)
+void asm_gen_addr(ASMCodegenData_T* cg, ASTNode_T* node)
 {
     switch(node->kind)
     {
@@ -906,7 +1555,7 @@ static void asm_gen_addr(ASMCodegenData_T* cg, ASTNode_T* node)
 
                 case OBJ_GLOBAL:
                 case OBJ_ENUM_MEMBER:
-                    asm_println(cg, "  %s %s(%%rip), %%rax", node->call ? "movq" : "lea", node->referenced_obj->is_extern_c ? node->id->callee : asm_gen_identifier(cg->context, node->id));
+                    asm_println(cg, "  %s %s(%%rip), %%rax", node->call ? "movq" : "lea", node->referenced_obj->is_extern_c ? node->id->callee : asm_gen_identifier(cg, node->id));
                     return;
                 
                 case OBJ_FUNCTION:
@@ -916,25 +1565,25 @@ static void asm_gen_addr(ASMCodegenData_T* cg, ASTNode_T* node)
                         if(obj->is_extern_c)
                             asm_println(cg, "  mov %s" CSPC_ASM_EXTERN_FN_POSTFIX "(%%rip), %%rax", EITHER(obj->exported, node->id->callee));
                         else if(obj->is_extern)
-                            asm_println(cg, "  mov %s" CSPC_ASM_EXTERN_FN_POSTFIX "(%%rip), %%rax", EITHER(obj->exported, asm_gen_identifier(cg->context, node->id)));
+                            asm_println(cg, "  mov %s" CSPC_ASM_EXTERN_FN_POSTFIX "(%%rip), %%rax", EITHER(obj->exported, asm_gen_identifier(cg, node->id)));
                         else if(obj->kind != OBJ_FUNCTION)
                         {
                             asm_println(cg, "  lea %d(%%rbp), %%rax", node->referenced_obj->offset);
                             asm_println(cg, "  mov (%%rax), %%rax");
                         }
                         else
-                            asm_println(cg, "  lea %s(%%rip), %%rax", asm_gen_identifier(cg->context, node->id));
+                            asm_println(cg, "  lea %s(%%rip), %%rax", asm_gen_identifier(cg, node->id));
                     }
                     else if(node->referenced_obj->is_extern_c)
                         asm_println(cg, "  mov %s" CSPC_ASM_EXTERN_FN_POSTFIX "(%%rip), %%rax", EITHER(node->referenced_obj->exported, node->id->callee));
                     else if(node->referenced_obj->is_extern)
-                        asm_println(cg, "  mov %s" CSPC_ASM_EXTERN_FN_POSTFIX "(%%rip), %%rax", EITHER(node->referenced_obj->exported, asm_gen_identifier(cg->context, node->id)));
+                        asm_println(cg, "  mov %s" CSPC_ASM_EXTERN_FN_POSTFIX "(%%rip), %%rax", EITHER(node->referenced_obj->exported, asm_gen_identifier(cg, node->id)));
                     else
-                        asm_println(cg, "  lea %s(%%rip), %%rax", asm_gen_identifier(cg->context, node->id));
+                        asm_println(cg, "  lea %s(%%rip), %%rax", asm_gen_identifier(cg, node->id));
                     return;
                 
                 default:
-                    throw_error(cg->context, ERR_CODEGEN, node->tok, "`%s` reference object of unexpected kind", node->id->callee);
+                    asm_error(cg, ERR_CODEGEN, node->tok, "`%s` reference object of unexpected kind", node->id->callee);
             }
             return;
         
@@ -975,7 +1624,7 @@ static void asm_gen_addr(ASMCodegenData_T* cg, ASTNode_T* node)
             asm_gen_addr(cg, node->left);
             return;
         default:
-            throw_error(cg->context, ERR_CODEGEN, node->tok, "cannot generate address from node of kind %d", node->kind);
+            asm_error(cg, ERR_CODEGEN, node->tok, "cannot generate address from node of kind %d", node->kind);
             break;
     }
 }
@@ -1183,6 +1832,10 @@ static void asm_cast(ASMCodegenData_T* cg, ASTType_T* from, ASTType_T* to)
     i32 t1 = get_type_id(from);
     i32 t2 = get_type_id(to);
 
+    // arithmetic on narrow integers leaves the upper bits set, casting truncates them again
+    if(t1 == t2 && t1 < F32)
+        t1 = I64;
+
     if(cast_table[t1][t2])
         asm_println(cg, "  %s", cast_table[t1][t2]);
 }
@@ -1262,11 +1915,11 @@ static void asm_load(ASMCodegenData_T* cg, ASTType_T *ty) {
 
 static ASTNode_T* make_index_expr(ASMCodegenData_T* cg, ASTNode_T* left, size_t index)
 {
-    ASTNode_T* index_expr = init_ast_node(&cg->context->raw_allocator, ND_LONG, left->tok);
+    ASTNode_T* index_expr = init_ast_node(cg->raw_allocator, ND_LONG, left->tok);
     index_expr->data_type = (ASTType_T*) primitives[TY_U64];
     index_expr->long_val = index;
 
-    ASTNode_T* expr = init_ast_node(&cg->context->raw_allocator, ND_INDEX, left->tok);
+    ASTNode_T* expr = init_ast_node(cg->raw_allocator, ND_INDEX, left->tok);
     expr->data_type = unpack(left->data_type)->base;
     expr->left = left;
     expr->expr = index_expr;
@@ -1276,10 +1929,10 @@ static ASTNode_T* make_index_expr(ASMCodegenData_T* cg, ASTNode_T* left, size_t
 
 static ASTNode_T* make_member_expr(ASMCodegenData_T* cg, ASTNode_T* left, ASTNode_T* struct_member)
 {
-    ASTNode_T* right = init_ast_node(&cg->context->raw_allocator, ND_ID, left->tok);
+    ASTNode_T* right = init_ast_node(cg->raw_allocator, ND_ID, left->tok);
     right->data_type = struct_member->data_type;
 
-    ASTNode_T* expr = init_ast_node(&cg->context->raw_allocator, ND_MEMBER, left->tok);
+    ASTNode_T* expr = init_ast_node(cg->raw_allocator, ND_MEMBER, left->tok);
     expr->data_type = struct_member->data_type;
     expr->left = left;
     expr->right = right;
@@ -1510,6 +2163,34 @@ static i32 asm_pop_args(ASMCodegenData_T* cg, ASTNode_T* node)
     return fp;
 }
 
+// if we add or subtract a number to/from a pointer, multiply the second argument with the base type size
+// a + b -> a + (i64) b * sizeof *a, the number gets extended first, so negative offsets stay negative
+static void asm_gen_ptr_offset(ASMCodegenData_T* cg, ASTNode_T* node)
+{
+    i64 size = unpack(node->left->data_type)->base->size;
+    ASTNode_T wide = {
+        .kind = ND_CAST,
+        .data_type = (ASTType_T*) primitives[TY_I64],
+        .left = node->right
+    };
+    ASTNode_T new_right = {
+        .kind = ND_MUL,
+        .data_type = (ASTType_T*) primitives[TY_I64],
+        .left = &wide,
+        .right = &(ASTNode_T) {
+            .kind = ND_LONG,
+            .data_type = (ASTType_T*) primitives[TY_I64],
+            .long_val = size
+        }
+    };
+
+    // generate a scaled copy, functions may get generated more than once
+    ASTNode_T scaled = *node;
+    scaled.right = size > 1 ? &new_right : &wide;
+    scaled.bool_val = true;
+    asm_gen_expr(cg, &scaled);
+}
+
 static void asm_gen_inc(ASMCodegenData_T* cg, ASTNode_T* node)
 {
     // convert x++ to (x = x + 1) - 1
@@ -1550,15 +2231,15 @@ static void asm_gen_id_ptr(ASMCodegenData_T* cg, ASTNode_T* id)
             break;
         case OBJ_GLOBAL:
         case OBJ_ENUM_MEMBER:
-            asm_print(cg, "%s(%%rip)", asm_gen_identifier(cg->context, id->id));
+            asm_print(cg, "%s(%%rip)", asm_gen_identifier(cg, id->id));
             break;
         case OBJ_FUNCTION:
             if(id->referenced_obj->is_extern_c)
                 asm_print(cg, "%s" CSPC_ASM_EXTERN_FN_POSTFIX "(%%rip)", EITHER(id->referenced_obj->exported, id->id->callee));
             else if(id->referenced_obj->is_extern)
-                asm_print(cg, "%s" CSPC_ASM_EXTERN_FN_POSTFIX "(%%rip)", EITHER(id->referenced_obj->exported, asm_gen_identifier(cg->context, id->id)));
+                asm_print(cg, "%s" CSPC_ASM_EXTERN_FN_POSTFIX "(%%rip)", EITHER(id->referenced_obj->exported, asm_gen_identifier(cg, id->id)));
             else
-                asm_print(cg, "%s(%%rip)", asm_gen_identifier(cg->context, id->id));
+                asm_print(cg, "%s(%%rip)", asm_gen_identifier(cg, id->id));
             break;
         default:
             unreachable();
@@ -1598,7 +2279,74 @@ static void asm_gen_inline_strlen(ASMCodegenData_T* cg)
     asm_println(cg, "  mov %%rcx, %%rax");
 }
 
-static void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node)
+// `tail` calls jump to the function after leaving the current stack frame, see tail_calls.c
+static void asm_gen_call(ASMCodegenData_T* cg, ASTNode_T* node, bool tail)
+{
+    List_T* packed_args = node->args;
+    node->args = unpack_call_args(cg, node);
+    i32 stack_args = asm_push_args(cg, node);
+    asm_gen_addr(cg, node->expr);
+
+    if(!node->called_obj || node->called_obj->kind == OBJ_LOCAL || node->called_obj->kind == OBJ_FN_ARG)
+        asm_println(cg, "  mov (%%rax), %%rax");
+
+    i32 fp = asm_pop_args(cg, node);
+
+    asm_println(cg, "  mov %%rax, %s", call_reg);
+    asm_println(cg, "  mov $%d, %%rax", fp);
+
+    // the result of the called function becomes the result of the current one
+    if(tail)
+    {
+        asm_gen_leave(cg, cg->current_fn);
+        asm_println(cg, "  jmp *%s", call_reg);
+        return;
+    }
+
+    asm_println(cg, "  call *%s", call_reg);
+    asm_println(cg, "  add $%d, %%rsp", stack_args * 8);
+
+    cg->depth -= stack_args;
+
+    if(node->args != packed_args) {
+        free_list(node->args);
+        node->args = packed_args;
+    }
+
+    // It looks like the most significant 48 or 56 bits in RAX may
+    // contain garbage if a function return type is short or bool/char,
+    // respectively. We clear the upper bits here.
+    switch(node->data_type->kind)
+    {
+        case TY_BOOL:
+            asm_println(cg, "  movzx %%al, %%eax");
+            return;
+        case TY_CHAR:
+        case TY_I8:
+            asm_println(cg, "  movsbl %%al, %%eax");
+            return;
+        case TY_U8:
+            asm_println(cg, "  movzbl %%al, %%eax");
+            return;
+        case TY_I16:
+            asm_println(cg, "  movswl %%ax, %%eax");
+            return;
+        case TY_U16:
+            asm_println(cg, "  movzwl %%ax, %%eax");
+            return;
+        default:
+            break;
+    }
+
+    // If the return type is a small struct, a value is returned
+    // using up to two registers.
+    if(node->return_buffer && node->data_type->size <= 16) {
+        asm_copy_ret_buffer(cg, node->return_buffer);
+        asm_println(cg, "  lea %d(%%rbp), %%rax", node->return_buffer->offset);
+    }
+}
+
+void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node)
 {
     if(node->tok && cg->embed_file_locations)
         asm_println(cg, "  .loc %d %d", node->tok->source->file_no + 1, node->tok->line);
@@ -1656,8 +2404,7 @@ static void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node)
             asm_println(cg, "  xor %%rax, %%rax");
             return;
         case ND_STR:
-            asm_println(cg, "  lea .L.string.%lu, %%rax", cg->string_literals->size);
-            list_push(cg->string_literals, node->str_val);
+            asm_println(cg, "  lea .L.string.%lu, %%rax", asm_add_string_literal(cg, node));
             return;
         
         case ND_SIZEOF:
@@ -1700,7 +2447,7 @@ static void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node)
                         // fall through
 
                     default:
-                        throw_error(cg->context, ERR_CODEGEN, node->tok, "`len` operator not implemented for this data type");
+                        asm_error(cg, ERR_CODEGEN, node->tok, "`len` operator not implemented for this data type");
                 }
             } return;
         
@@ -1750,58 +2497,31 @@ static void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node)
 
         case ND_ADD:
             if(unpack(node->left->data_type)->base && unpack(node->right->data_type)->base)
-                throw_error(cg->context, ERR_SYNTAX_ERROR, node->tok, "cannot add two pointer types together");
-            if(ptr_type(node->left->data_type) && unpack(node->left->data_type)->base->size > 1)
+                asm_error(cg, ERR_SYNTAX_ERROR, node->tok, "cannot add two pointer types together");
+            if(ptr_type(node->left->data_type) && !node->bool_val)
             {
-                // if we add a number to a pointer, multiply the second argument with the base type size
-                // a + b -> a + b * sizeof *a
-                ASTNode_T new_right = {
-                    .kind = ND_MUL,
-                    .data_type = node->right->data_type,
-                    .left = node->right,
-                    .right = &(ASTNode_T) {
-                        .kind = ND_LONG,
-                        .data_type = (ASTType_T*) primitives[TY_U64],
-                        .long_val = unpack(node->left->data_type)->base->size
-                    }
-                };
-
-                node->right = &new_right;
+                asm_gen_ptr_offset(cg, node);
+                return;
             }
             break;
         
         case ND_SUB:
-            if(ptr_type(node->left->data_type) && is_integer(node->right->data_type))
+            if(ptr_type(node->left->data_type) && is_integer(node->right->data_type) && !node->bool_val)
             {
-                // if we subtract a number from a pointer, multiply the second argument with the base type size
-                // a - b -> a - b * sizeof *a
-
-                node->bool_val = true;
-
-                ASTNode_T new_right = {
-                    .kind = ND_MUL,
-                    .data_type = node->right->data_type,
-                    .left = node->right,
-                    .right = &(ASTNode_T) {
-                        .kind = ND_LONG,
-                        .data_type = (ASTType_T*) primitives[TY_U64],
-                        .long_val = unpack(node->left->data_type)->size
-                    }
-                };
-
-                node->right = &new_right;
+                asm_gen_ptr_offset(cg, node);
+                return;
             }
             else if(ptr_type(node->left->data_type) && ptr_type(node->left->data_type) && !node->bool_val)
             {
                 // if both subtraction arguments are pointers, return the number of elements in between
                 // a - b -> (a - b) / sizeof *a
-
-                node->bool_val = true;
+                ASTNode_T difference = *node;
+                difference.bool_val = true;
 
                 ASTNode_T converted = {
                     .kind = ND_DIV,
                     .data_type = (ASTType_T*) primitives[TY_I64],
-                    .left = node,
+                    .left = &difference,
                     .right = &(ASTNode_T) {
                         .kind = ND_LONG,
                         .data_type = (ASTType_T*) primitives[TY_I64],
@@ -1815,6 +2535,14 @@ static void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node)
             break;
         
         case ND_ID:
+            if(asm_is_direct_var(node))
+            {
+                if(!node->data_type)
+                    node->data_type = node->referenced_obj->data_type;
+                asm_load_var(cg, node->referenced_obj, node->data_type);
+                return;
+            }
+
             asm_gen_addr(cg, node);
             asm_load(cg, node->data_type);
 
@@ -1942,6 +2670,13 @@ static void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node)
                 asm_pop(cg, "%rax");
                 return;
             default:
+                if(asm_is_direct_var(node->left))
+                {
+                    asm_gen_expr(cg, node->right);
+                    asm_store_var(cg, node->left->referenced_obj, EITHER(node->left->data_type, node->left->referenced_obj->data_type));
+                    return;
+                }
+
                 asm_gen_addr(cg, node->left);
                 asm_push(cg);
                 asm_gen_expr(cg, node->right);
@@ -1955,9 +2690,9 @@ static void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node)
                 asm_println(cg, "  mov %%rbp, " LAMBDA_STACKPTR_FMT, node->long_val);
                 asm_println(cg, "  lea lambda.%ld(%%rip), %%rax", node->long_val);
 
-                ASTObj_T* impl = init_ast_obj(&cg->context->raw_allocator, OBJ_LAMBDA, node->tok);
+                ASTObj_T* impl = init_ast_obj(cg->raw_allocator, OBJ_LAMBDA, node->tok);
                 impl->body = node;
-                list_push(cg->ast->objs, impl);
+                list_push(cg->lambdas, impl);
             } return;
 
         case ND_CAST:
@@ -2047,61 +2782,8 @@ static void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node)
         } return;
 
         case ND_CALL:
-        {
-            List_T* packed_args = node->args;
-            node->args = unpack_call_args(cg, node);
-            i32 stack_args = asm_push_args(cg, node);
-            asm_gen_addr(cg, node->expr);
-
-            if(!node->called_obj || node->called_obj->kind == OBJ_LOCAL || node->called_obj->kind == OBJ_FN_ARG)
-                asm_println(cg, "  mov (%%rax), %%rax");
-
-            i32 fp = asm_pop_args(cg, node);
-
-            asm_println(cg, "  mov %%rax, %s", call_reg);
-            asm_println(cg, "  mov $%d, %%rax", fp);
-            asm_println(cg, "  call *%s", call_reg);
-            asm_println(cg, "  add $%d, %%rsp", stack_args * 8);
-
-            cg->depth -= stack_args;
-
-            // It looks like the most significant 48 or 56 bits in RAX may
-		    // contain garbage if a function return type is short or bool/char,
-		    // respectively. We clear the upper bits here.
-            switch(node->data_type->kind)
-            {
-                case TY_BOOL:
-                    asm_println(cg, "  movzx %%al, %%eax");
-                    return;
-                case TY_CHAR:
-                case TY_I8:
-                    asm_println(cg, "  movsbl %%al, %%eax");
-                    return;
-                case TY_U8:
-                    asm_println(cg, "  movzbl %%al, %%eax");
-                    return;
-                case TY_I16:
-                    asm_println(cg, "  movswl %%ax, %%eax");
-                    return;
-                case TY_U16:
-                    asm_println(cg, "  movzwl %%ax, %%eax");
-                    return;
-                default:
-                    break;
-            }
-
-            // If the return type is a small struct, a value is returned
-		    // using up to two registers.
-            if(node->return_buffer && node->data_type->size <= 16) {
-                asm_copy_ret_buffer(cg, node->return_buffer);
-                asm_println(cg, "  lea %d(%%rbp), %%rax", node->return_buffer->offset);
-            }
-
-            if(node->args != packed_args) {
-                free_list(node->args);
-                node->args = packed_args;
-            }
-        } return;
+            asm_gen_call(cg, node, false);
+            return;
         
         default:
             break;
@@ -2241,10 +2923,12 @@ static void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node)
             break;
     }
 
+    ASTNode_T* second = node->kind == ND_GE || node->kind == ND_GT ? node->right : node->left;
+    bool leaf = asm_is_leaf(second);
     asm_gen_expr(cg, node->kind == ND_GE || node->kind == ND_GT ? node->left : node->right);
-    asm_push(cg);
-    asm_gen_expr(cg, node->kind == ND_GE || node->kind == ND_GT ? node->right : node->left);
-    asm_pop(cg, "%rdi");
+    asm_push_operand(cg, leaf);
+    asm_gen_expr(cg, second);
+    asm_pop_operand(cg, leaf);
 
     char* ax, * di, * dx;
 
@@ -2344,6 +3028,12 @@ static void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node)
 
 static void asm_init_zero(ASMCodegenData_T* cg, ASTObj_T* var)
 {
+    if(var->asm_reg)
+    {
+        asm_println(cg, "  xor %s, %s", varreg32[var->asm_reg - 1], varreg32[var->asm_reg - 1]);
+        return;
+    }
+
     asm_println(cg, "  mov $%d, %%rcx", var->data_type->size);
     asm_println(cg, "  lea %d(%%rbp), %%rdi", var->offset);
     asm_println(cg, "  xor %%al, %%al");
@@ -2396,12 +3086,38 @@ static void asm_gen_stmt(ASMCodegenData_T* cg, ASTNode_T* node)
             
             asm_gen_expr(cg, node->condition);
             asm_cmp_zero(cg, node->condition->data_type);
-            asm_println(cg, "  je  .L.else.%lu", c);
-            asm_gen_stmt(cg, node->if_branch);
-            asm_println(cg, "  jmp .L.end.%lu", c);
-            asm_println(cg, ".L.else.%lu:", c);
-            if(node->else_branch)
-                asm_gen_stmt(cg, node->else_branch);
+
+            // with a profile, the branch which ran less often moves behind the function
+            u32 branch = cg->pgo_branch++;
+            char name[BUFSIZ];
+            u64 then_count, else_count;
+            bool profiled = cg->profile && cg->pgo_fn && cg->code_buffer != cg->cold_code
+                && pgo_count(cg->profile, asm_pgo_branch(cg, name, branch, "then"), &then_count)
+                && pgo_count(cg->profile, asm_pgo_branch(cg, name, branch, "else"), &else_count);
+            if(profiled && then_count < else_count)
+            {
+                asm_println(cg, "  jne .L.then.%lu", c);
+                asm_gen_cold_branch(cg, node->if_branch, "then", c);
+                if(node->else_branch)
+                    asm_gen_stmt(cg, node->else_branch);
+            }
+            else if(profiled && else_count < then_count && node->else_branch)
+            {
+                asm_println(cg, "  je  .L.else.%lu", c);
+                asm_gen_stmt(cg, node->if_branch);
+                asm_gen_cold_branch(cg, node->else_branch, "else", c);
+            }
+            else
+            {
+                asm_println(cg, "  je  .L.else.%lu", c);
+                asm_pgo_count_branch(cg, branch, "then");
+                asm_gen_stmt(cg, node->if_branch);
+                asm_println(cg, "  jmp .L.end.%lu", c);
+                asm_println(cg, ".L.else.%lu:", c);
+                asm_pgo_count_branch(cg, branch, "else");
+                if(node->else_branch)
+                    asm_gen_stmt(cg, node->else_branch);
+            }
             asm_println(cg, ".L.end.%lu:", c);
 
             cg->cur_count = pc;
@@ -2456,6 +3172,7 @@ static void asm_gen_stmt(ASMCodegenData_T* cg, ASTNode_T* node)
             
             if(node->init_stmt)
                 asm_gen_stmt(cg, node->init_stmt);
+            asm_gen_vector_loop(cg, node);
             asm_println(cg, ".L.begin.%lu:", c);
             if(node->condition) {
                 asm_gen_expr(cg, node->condition);
@@ -2653,6 +3370,11 @@ static void asm_gen_stmt(ASMCodegenData_T* cg, ASTNode_T* node)
             return;
         
         case ND_RETURN:
+            if(node->tail_call)
+            {
+                asm_gen_call(cg, node->return_val, true);
+                return;
+            }
             if(node->return_val)
             {
                 asm_gen_expr(cg, node->return_val);
@@ -2690,7 +3412,7 @@ static void asm_gen_stmt(ASMCodegenData_T* cg, ASTNode_T* node)
         case ND_DEFER:
             if(!cg->current_fn->deferred) {
                 cg->current_fn->deferred = init_list(); 
-                CONTEXT_ALLOC_REGISTER(cg->context, cg->current_fn->deferred);
+                allocator_push(cg->list_allocator, cg->current_fn->deferred);
             }
             list_push(cg->current_fn->deferred, node->body);
             return;
@@ -2703,7 +3425,7 @@ static void asm_gen_stmt(ASMCodegenData_T* cg, ASTNode_T* node)
             break;
     }
 
-    throw_error(cg->context, ERR_CODEGEN, node->tok, "unexpected statement");
+    asm_error(cg, ERR_CODEGEN, node->tok, "unexpected statement");
 }
 
 static void asm_store_fp(ASMCodegenData_T* cg, i32 r, i32 offset, i32 sz)
@@ -2755,12 +3477,18 @@ static void asm_gen_lambda(ASMCodegenData_T* cg, ASTObj_T* lambda_obj)
     cg->current_fn_name = &(lambda_name[0]);
 
     asm_println(cg, "  .globl %s", lambda_name);
-    asm_println(cg, "  .section .text");
+    asm_gen_section(cg, ".text", lambda_name);
     asm_println(cg, "  .type %s, @function", lambda_name);
     asm_println(cg, "%s:", lambda_name);
     asm_println(cg, "  push %%rbp");
     asm_println(cg, "  mov " LAMBDA_STACKPTR_FMT ", %%rbp", lambda->long_val);
 
+    // lambdas have no frame of their own, inline assembly might clobber the registers of the caller
+    bool save_regs = asm_has_inline_asm(lambda->body);
+    if(save_regs)
+        for(i32 i = 0; i < ASM_NUM_VAR_REGS; i++)
+            asm_println(cg, "  push %s", varreg64[i]);
+
     // save passed-by-register arguments to the stack
     i32 gp = 0, fp = 0;
 
@@ -2808,25 +3536,72 @@ static void asm_gen_lambda(ASMCodegenData_T* cg, ASTObj_T* lambda_obj)
 
     asm_println(cg, ".L.return.%s:", lambda_name);
     asm_gen_defer(cg, lambda_obj->deferred);
+    if(save_regs)
+        for(i32 i = ASM_NUM_VAR_REGS - 1; i >= 0; i--)
+            asm_println(cg, "  pop %s", varreg64[i]);
     asm_println(cg, "  pop %%rbp");
     asm_println(cg, "  ret");
 
     cg->current_fn_name = prev_fn_name;
 }
 
+// writes the bytes of a string literal as a gas string, returns false if it contains a null byte
+static bool asm_escape_string(const char* str, char* buf)
+{
+    bool has_null = false;
+    for(size_t i = 0; str[i]; i++)
+    {
+        u8 c = str[i] == '\\' ? (i++, escape_sequence(str[i], &str[i], &i)) : str[i];
+        if(c >= ' ' && c < 0x7f && c != '"' && c != '\\')
+            *buf++ = c;
+        else
+            buf += sprintf(buf, "\\%03o", c);
+        has_null |= !c;
+    }
+    *buf = '\0';
+    return !has_null;
+}
+
 static void asm_gen_string_literals(ASMCodegenData_T* cg) 
 {
+    // functions get generated separately, so identical read-only literals of different functions get chained together
+    HashMap_T* unique = hashmap_init();
+    for(size_t i = 0; i < cg->string_literals->size; i++)
+    {
+        ASMStringLiteral_T* literal = cg->string_literals->items[i];
+        if(!literal->read_only)
+            continue;
+
+        ASMStringLiteral_T* first = hashmap_get(unique, literal->str);
+        if(first)
+        {
+            literal->next = first->next;
+            first->next = literal;
+        }
+        else
+            hashmap_put(unique, (char*) literal->str, literal);
+    }
+
+    // read-only strings go into a mergeable section, so the linker can deduplicate them across object
+    // files. Strings containing null bytes would get split up there and go into `.rodata` instead.
+    const char* section = NULL;
     for(size_t i = 0; i < cg->string_literals->size; i++)
     {
-        const char* str = cg->string_literals->items[i];
-        size_t size = (strlen(str) + 1) * CHAR_S;
+        ASMStringLiteral_T* literal = cg->string_literals->items[i];
+        if(literal->read_only && hashmap_get(unique, literal->str) != literal)
+            continue;
 
-        asm_println(cg, "  .data");    
-        asm_println(cg, "  .align 1");
-        asm_println(cg, "  .size .L.string.%d, %d", i, size);
-        asm_println(cg, ".L.string.%d:", i);
-        
-        for(size_t i = 0; i < size; i++)
-            asm_println(cg, "  .byte %u", str[i] == '\\' ? (i++, escape_sequence(str[i], &str[i], &i)) : str[i]);
+        char* escaped = malloc(strlen(literal->str) * 4 + 1);
+        bool mergeable = asm_escape_string(literal->str, escaped);
+        const char* literal_section = !literal->read_only ? ".data" : mergeable ? ".rodata.str1.1,\"aMS\",@progbits,1" : ".rodata";
+        if(section != literal_section)
+            asm_println(cg, "  .section %s", section = literal_section);
+
+        for(ASMStringLiteral_T* label = literal; label; label = label->next)
+            asm_println(cg, ".L.string.%lu:", label->label);
+        asm_println(cg, "  .string \"%s\"", escaped);
+        free(escaped);
     }
+
+    hashmap_free(unique);
 }
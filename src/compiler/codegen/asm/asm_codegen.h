@@ -5,6 +5,11 @@
 
 #include "ast/ast.h"
 #include "config.h"
+#include "peephole.h"
+#include "error/exception.h"
+#include "memory/allocator.h"
+#include "hashmap.h"
+#include "codegen/pgo.h"
 
 typedef struct ASM_CODEGEN_DATA_STRUCT
 {
@@ -18,12 +23,29 @@ typedef struct ASM_CODEGEN_DATA_STRUCT
     char* buf;
     size_t buf_len;
     FILE* code_buffer;
+    ASMPeephole_T* peephole; // set when optimizing
+
+    // functions get generated as jobs, possibly on worker threads, which must not touch shared state
+    Allocator_T* raw_allocator;  // the context's allocators or the ones of the current job
+    Allocator_T* list_allocator;
+    Exception_T* detached;       // set on worker threads, errors bail out to it
+    List_T* lambdas;             // lambdas found in the current function
 
     ASTObj_T* current_fn;
     char* current_fn_name;
     u64 depth;
 
-    List_T* string_literals;
+    List_T* string_literals;  // list of ASMStringLiteral_Ts
+    HashMap_T* string_labels; // string contents -> ASMStringLiteral_T, interns read-only literals
+
+    // profile-guided optimization
+    PGOProfile_T* profile; // counts read with --pgo-use, NULL otherwise
+    List_T* pgo_counters;  // names of the counters of --pgo-generate, NULL otherwise
+    const char* pgo_fn;    // name of the current function, NULL if its branches don't get counted
+    u32 pgo_branch;        // id of the next `if` statement of the current function
+    FILE* cold_code;       // branches, which rarely run, get emitted after the function
+    char* cold_buf;
+    size_t cold_len;
 
     u64 max_count;  // current maximum label id
     u64 cur_count;  // current label id
@@ -31,13 +53,38 @@ typedef struct ASM_CODEGEN_DATA_STRUCT
     u64 cur_cnt_id; // current statement id, which supports continue; statements
 } ASMCodegenData_T;
 
+typedef struct ASM_STRING_LITERAL_STRUCT
+{
+    u64 label;
+    const char* str;
+    bool read_only;
+    struct ASM_STRING_LITERAL_STRUCT* next; // read-only literals of other functions with the same contents
+} ASMStringLiteral_T;
+
+// worker threads must not report errors themselves, so they bail out
+// and leave it to the main thread to generate the function again
+#define asm_error(cg, ...) do {                    \
+        if((cg)->detached)                         \
+            throw(*(cg)->detached);                \
+        throw_error((cg)->context, __VA_ARGS__);   \
+    } while(0)
+
 i32 asm_codegen_pass(Context_T* context, ASTProg_T* ast);
 
 void init_asm_cg(ASMCodegenData_T* cg, Context_T* context, ASTProg_T* ast);
 void free_asm_cg(ASMCodegenData_T* cg);
 void asm_gen_code(ASMCodegenData_T* cg, const char* target);
 
-char* asm_gen_identifier(Context_T* context, ASTIdentifier_T* id);
+char* asm_gen_identifier(ASMCodegenData_T* cg, ASTIdentifier_T* id);
+u64 asm_add_string_literal(ASMCodegenData_T* cg, ASTNode_T* str);
+void asm_gen_addr(ASMCodegenData_T* cg, ASTNode_T* node);
+void asm_gen_expr(ASMCodegenData_T* cg, ASTNode_T* node);
+void asm_store_var(ASMCodegenData_T* cg, ASTObj_T* var, ASTType_T* ty);
+void asm_push(ASMCodegenData_T* cg);
+void asm_pop(ASMCodegenData_T* cg, const char* arg);
+
+// asm_ir.c
+void asm_gen_ir_function(ASMCodegenData_T* cg, ASTObj_T* obj, const char* fn_name);
 
 #ifdef __GNUC__
 __attribute((format(printf, 2, 3)))
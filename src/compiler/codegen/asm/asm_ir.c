@@ -0,0 +1,1023 @@
+#include "asm_codegen.h"
+#include "ir/ir.h"
+#include "list.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Emits functions, which were lowered to the IR (see ir/ir.h). After leaving
+// SSA form, every virtual register gets a liveness interval spanning all of its
+// live ranges, which a linear scan assigns to a register or a stack slot.
+// Values living across calls only ever get callee-saved registers.
+//
+// %rax, %rcx, %rdx, %rdi and %r10 are never allocated and serve as scratch
+// registers for the instructions.
+
+#define NUM_REGS 9
+#define FIRST_CALLEE_SAVED 4
+#define NO_REG -1
+
+typedef struct IR_REGISTER_STRUCT {
+    const char* r64;
+    const char* r32;
+    const char* r16;
+    const char* r8;
+} IRRegister_T;
+
+static const IRRegister_T regs[NUM_REGS] = {
+    {"%rsi", "%esi",  "%si",   "%sil"},
+    {"%r8",  "%r8d",  "%r8w",  "%r8b"},
+    {"%r9",  "%r9d",  "%r9w",  "%r9b"},
+    {"%r11", "%r11d", "%r11w", "%r11b"},
+    {"%rbx", "%ebx",  "%bx",   "%bl"},
+    {"%r12", "%r12d", "%r12w", "%r12b"},
+    {"%r13", "%r13d", "%r13w", "%r13b"},
+    {"%r14", "%r14d", "%r14w", "%r14b"},
+    {"%r15", "%r15d", "%r15w", "%r15b"},
+};
+
+static const IRRegister_T rax = {"%rax", "%eax", "%ax", "%al"};
+
+static const char* argregs[] = {"%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9"};
+
+typedef struct IR_EMITTER_STRUCT {
+    ASMCodegenData_T* cg;
+    IRFunction_T* fn;
+    const char* fn_name;
+    u64 label;
+
+    u32 num_values;
+    IRInstr_T** defs;
+    u32* uses;
+    bool* immediate; // constants, which never need a register
+
+    u32* start;
+    u32* end;
+    bool* crossing;  // live across a call
+    u32* num_defs;
+    u32* def_pos;
+    i32* reg;
+    i32* spill;      // 1-based spill slot, if there's no register
+
+    u32 num_spills;
+    i32 saved[NUM_REGS]; // frame offsets of the saved callee-saved registers, 0 if unused
+    i32 frame_size;
+
+    i32 last_line;
+    const char* fused_cc; // condition code of a comparison fused with the following branch
+} IREmitter_T;
+
+static bool fits_i32(i64 value)
+{
+    return value == (i32) value;
+}
+
+static bool takes_immediate(IRInstr_T* instr, IRValue_T* operand)
+{
+    switch(instr->op)
+    {
+        case IR_COPY:
+        case IR_RET:
+        case IR_CALL:
+            return true;
+        case IR_STORE:
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_AND:
+        case IR_OR:
+        case IR_XOR:
+        case IR_SHL:
+        case IR_SHR:
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_LE:
+            return operand == &instr->b;
+        default:
+            return false;
+    }
+}
+
+static bool needs_home(IREmitter_T* e, IRValue_T value)
+{
+    return value && !e->immediate[value];
+}
+
+// operands
+
+static const char* sized(const IRRegister_T* reg, u8 size)
+{
+    switch(size)
+    {
+        case 1: return reg->r8;
+        case 2: return reg->r16;
+        case 4: return reg->r32;
+        default: return reg->r64;
+    }
+}
+
+static const IRRegister_T* reg_of(IREmitter_T* e, IRValue_T value)
+{
+    return value && !e->immediate[value] && e->reg[value] != NO_REG ? &regs[e->reg[value]] : NULL;
+}
+
+static i32 spill_offset(IREmitter_T* e, IRValue_T value)
+{
+    return -e->frame_size + (e->spill[value] - 1) * 8;
+}
+
+static const char* operand(IREmitter_T* e, IRValue_T value, u8 size, char* buf)
+{
+    if(e->immediate[value])
+    {
+        i64 imm = e->defs[value]->imm;
+        sprintf(buf, "$%ld", (long) (size == 1 ? (i8) imm : size == 2 ? (i16) imm : size == 4 ? (i32) imm : imm));
+        return buf;
+    }
+
+    const IRRegister_T* reg = reg_of(e, value);
+    if(reg)
+        return sized(reg, size);
+
+    sprintf(buf, "%d(%%rbp)", spill_offset(e, value));
+    return buf;
+}
+
+static const char* size_suffix(u8 size)
+{
+    switch(size)
+    {
+        case 1: return "b";
+        case 2: return "w";
+        case 4: return "l";
+        default: return "q";
+    }
+}
+
+static void emit_mov(IREmitter_T* e, IRValue_T dst, IRValue_T src)
+{
+    char dst_buf[32], src_buf[32];
+    const char* to = operand(e, dst, 8, dst_buf);
+    const char* from = operand(e, src, 8, src_buf);
+    if(!strcmp(to, from))
+        return;
+
+    if(!reg_of(e, dst) && !reg_of(e, src) && !e->immediate[src])
+    {
+        asm_println(e->cg, "  mov %s, %%rax", from);
+        from = "%rax";
+    }
+    asm_println(e->cg, "  mov%s %s, %s", e->immediate[src] ? "q" : "", from, to);
+}
+
+static void load_to(IREmitter_T* e, IRValue_T value, const IRRegister_T* reg)
+{
+    char buf[32];
+    const char* from = operand(e, value, 8, buf);
+    if(strcmp(from, reg->r64))
+        asm_println(e->cg, "  mov %s, %s", from, reg->r64);
+}
+
+static void store_from(IREmitter_T* e, const IRRegister_T* reg, IRValue_T value)
+{
+    char buf[32];
+    const char* to = operand(e, value, 8, buf);
+    if(strcmp(to, reg->r64))
+        asm_println(e->cg, "  mov %s, %s", reg->r64, to);
+}
+
+// the register an instruction computes its result in
+static const IRRegister_T* work_reg(IREmitter_T* e, IRInstr_T* instr)
+{
+    const IRRegister_T* reg = reg_of(e, instr->dst);
+    if(!reg || reg == reg_of(e, instr->b))
+        return &rax;
+    return reg;
+}
+
+// liveness
+
+typedef struct IR_LIVENESS_STRUCT {
+    u32 words;
+    u64* use;
+    u64* def;
+    u64* in;
+    u64* out;
+} IRLiveness_T;
+
+#define BIT_SET(set, bit) ((set)[(bit) / 64] |= 1ull << ((bit) % 64))
+#define BIT_TEST(set, bit) ((set)[(bit) / 64] & (1ull << ((bit) % 64)))
+
+static void extend_interval(IREmitter_T* e, IRValue_T value, u32 pos)
+{
+    e->start[value] = MIN(e->start[value], pos);
+    e->end[value] = MAX(e->end[value], pos);
+}
+
+typedef struct IR_OPERAND_VISIT_STRUCT {
+    IREmitter_T* e;
+    IRInstr_T* instr;
+    u64* use;
+    u64* def;
+    u32 pos;
+} IROperandVisit_T;
+
+static void count_use(IRValue_T* operand, void* data)
+{
+    IROperandVisit_T* visit = data;
+    visit->e->uses[*operand]++;
+    if(!takes_immediate(visit->instr, operand))
+        visit->e->immediate[*operand] = false;
+}
+
+static void collect_use(IRValue_T* operand, void* data)
+{
+    IROperandVisit_T* visit = data;
+    if(needs_home(visit->e, *operand) && !BIT_TEST(visit->def, *operand))
+        BIT_SET(visit->use, *operand);
+}
+
+static void extend_use(IRValue_T* operand, void* data)
+{
+    IROperandVisit_T* visit = data;
+    if(needs_home(visit->e, *operand))
+        extend_interval(visit->e, *operand, visit->pos);
+}
+
+static bool is_emitted(IREmitter_T* e, IRInstr_T* instr)
+{
+    return instr->op != IR_NOP && !(instr->op == IR_CONST && e->immediate[instr->dst]);
+}
+
+static void analyze_values(IREmitter_T* e)
+{
+    IRFunction_T* fn = e->fn;
+    for(size_t i = 0; i < fn->blocks->size; i++)
+    {
+        IRBlock_T* block = fn->blocks->items[i];
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IRInstr_T* instr = block->instrs->items[j];
+            if(instr->dst)
+            {
+                e->defs[instr->dst] = instr;
+                if(instr->op == IR_CONST && fits_i32(instr->imm))
+                    e->immediate[instr->dst] = true;
+            }
+        }
+    }
+
+    for(size_t i = 0; i < fn->blocks->size; i++)
+    {
+        IRBlock_T* block = fn->blocks->items[i];
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IROperandVisit_T visit = {.e = e, .instr = block->instrs->items[j]};
+            ir_foreach_operand(visit.instr, count_use, &visit);
+        }
+    }
+
+    // constants are only immediates if they're defined exactly once, which is not the case for shadows
+    for(size_t i = 0; i < fn->blocks->size; i++)
+    {
+        IRBlock_T* block = fn->blocks->items[i];
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IRInstr_T* instr = block->instrs->items[j];
+            if(instr->dst && e->defs[instr->dst] != instr)
+                e->immediate[instr->dst] = false;
+        }
+    }
+}
+
+static void compute_intervals(IREmitter_T* e)
+{
+    IRFunction_T* fn = e->fn;
+    size_t num_blocks = fn->blocks->size;
+    u32 words = e->num_values / 64 + 1;
+
+    u64* sets = calloc(num_blocks * words * 4, sizeof(u64));
+    IRLiveness_T live = {
+        .words = words,
+        .use = sets,
+        .def = sets + num_blocks * words,
+        .in = sets + num_blocks * words * 2,
+        .out = sets + num_blocks * words * 3
+    };
+
+    i32* index_of = malloc(fn->num_blocks * sizeof(i32));
+    u32* first_pos = malloc(num_blocks * sizeof(u32));
+    u32* last_pos = malloc(num_blocks * sizeof(u32));
+    u32 pos = 0;
+
+    for(size_t i = 0; i < num_blocks; i++)
+    {
+        IRBlock_T* block = fn->blocks->items[i];
+        index_of[block->id] = i;
+        first_pos[i] = pos;
+
+        IROperandVisit_T visit = {.e = e, .use = &live.use[i * words], .def = &live.def[i * words]};
+        for(size_t j = 0; j < block->instrs->size; j++, pos++)
+        {
+            visit.instr = block->instrs->items[j];
+            ir_foreach_operand(visit.instr, collect_use, &visit);
+            if(needs_home(e, visit.instr->dst))
+                BIT_SET(visit.def, visit.instr->dst);
+        }
+        last_pos[i] = pos - 1;
+    }
+
+    // iterate backwards until the live sets don't change anymore
+    bool changed;
+    do {
+        changed = false;
+        for(size_t i = num_blocks; i > 0; i--)
+        {
+            size_t b = i - 1;
+            u64* out = &live.out[b * words];
+            u64* in = &live.in[b * words];
+
+            IRBlock_T* succs[2];
+            u32 num_succs = ir_successors(fn->blocks->items[b], succs);
+            for(u32 s = 0; s < num_succs; s++)
+            {
+                u64* succ_in = &live.in[index_of[succs[s]->id] * words];
+                for(u32 w = 0; w < words; w++)
+                    out[w] |= succ_in[w];
+            }
+
+            for(u32 w = 0; w < words; w++)
+            {
+                u64 new_in = live.use[b * words + w] | (out[w] & ~live.def[b * words + w]);
+                if(new_in != in[w])
+                {
+                    in[w] = new_in;
+                    changed = true;
+                }
+            }
+        }
+    } while(changed);
+
+    for(u32 v = 0; v <= e->num_values; v++)
+    {
+        e->start[v] = UINT32_MAX;
+        e->end[v] = 0;
+    }
+
+    u32* calls_before = calloc(pos + 1, sizeof(u32));
+    u32 last_arg = 0;
+    pos = 0;
+    for(size_t i = 0; i < num_blocks; i++)
+    {
+        IRBlock_T* block = fn->blocks->items[i];
+        for(u32 v = 0; v <= e->num_values; v++)
+        {
+            if(BIT_TEST(&live.in[i * words], v))
+                extend_interval(e, v, first_pos[i]);
+            if(BIT_TEST(&live.out[i * words], v))
+                extend_interval(e, v, last_pos[i]);
+        }
+
+        for(size_t j = 0; j < block->instrs->size; j++, pos++)
+        {
+            IROperandVisit_T visit = {.e = e, .instr = block->instrs->items[j], .pos = pos};
+            ir_foreach_operand(visit.instr, extend_use, &visit);
+            if(needs_home(e, visit.instr->dst))
+            {
+                extend_interval(e, visit.instr->dst, pos);
+                e->num_defs[visit.instr->dst]++;
+                e->def_pos[visit.instr->dst] = pos;
+            }
+
+            // arguments get moved to their homes all at once
+            if(visit.instr->op == IR_ARG)
+                last_arg = pos;
+            calls_before[pos + 1] = calls_before[pos] + (visit.instr->op == IR_CALL);
+        }
+    }
+
+    IRBlock_T* entry = fn->blocks->items[0];
+    for(size_t i = 0; i < entry->instrs->size; i++)
+    {
+        IRInstr_T* instr = entry->instrs->items[i];
+        if(instr->op == IR_ARG)
+        {
+            extend_interval(e, instr->dst, 0);
+            extend_interval(e, instr->dst, last_arg);
+        }
+    }
+
+    // values live in between the definition and a use of something a call clobbers
+    for(u32 v = 1; v <= e->num_values; v++)
+    {
+        if(e->start[v] > e->end[v])
+            continue;
+        u32 calls = calls_before[e->end[v]] - calls_before[e->start[v]];
+        if(calls && e->defs[v] && e->defs[v]->op == IR_CALL && calls_before[e->start[v] + 1] > calls_before[e->start[v]])
+            calls--;
+        e->crossing[v] = calls > 0;
+    }
+
+    free(calls_before);
+    free(first_pos);
+    free(last_pos);
+    free(index_of);
+    free(sets);
+}
+
+// linear scan
+
+// values get sorted by `start << 32 | value`, so the comparison needs no access to the emitter
+static int compare_start(const void* a, const void* b)
+{
+    u64 ka = *(const u64*) a, kb = *(const u64*) b;
+    return ka < kb ? -1 : ka > kb;
+}
+
+static void allocate_registers(IREmitter_T* e)
+{
+    u64* order = malloc((e->num_values + 1) * sizeof(u64));
+    u32 num_order = 0;
+    for(u32 v = 1; v <= e->num_values; v++)
+    {
+        e->reg[v] = NO_REG;
+        if(e->start[v] <= e->end[v])
+            order[num_order++] = (u64) e->start[v] << 32 | v;
+    }
+
+    qsort(order, num_order, sizeof(u64), compare_start);
+
+    IRValue_T active[NUM_REGS] = {0}; // value occupying each register
+
+    for(u32 i = 0; i < num_order; i++)
+    {
+        IRValue_T v = (IRValue_T) order[i];
+        for(i32 r = 0; r < NUM_REGS; r++)
+            if(active[r] && e->end[active[r]] < e->start[v])
+                active[r] = 0;
+
+        i32 first = e->crossing[v] ? FIRST_CALLEE_SAVED : 0;
+        i32 chosen = NO_REG;
+
+        // reuse the register of an operand dying at the definition to save moves
+        IRInstr_T* def = e->defs[v];
+        if(e->num_defs[v] == 1 && e->def_pos[v] == e->start[v] && def->a && def->op != IR_CALL && needs_home(e, def->a))
+        {
+            i32 r = e->reg[def->a];
+            if(r >= first && active[r] == def->a && e->end[def->a] == e->start[v])
+            {
+                active[r] = 0;
+                chosen = r;
+            }
+        }
+
+        for(i32 r = first; r < NUM_REGS && chosen == NO_REG; r++)
+            if(!active[r])
+                chosen = r;
+
+        if(chosen == NO_REG)
+        {
+            // spill whichever value lives the longest
+            i32 victim = NO_REG;
+            for(i32 r = first; r < NUM_REGS; r++)
+                if(victim == NO_REG || e->end[active[r]] > e->end[active[victim]])
+                    victim = r;
+
+            if(victim != NO_REG && e->end[active[victim]] > e->end[v])
+            {
+                IRValue_T spilled = active[victim];
+                e->reg[spilled] = NO_REG;
+                e->spill[spilled] = ++e->num_spills;
+                chosen = victim;
+            }
+            else
+            {
+                e->spill[v] = ++e->num_spills;
+                continue;
+            }
+        }
+
+        e->reg[v] = chosen;
+        active[chosen] = v;
+    }
+
+    free(order);
+
+    // frame: spill slots at the bottom, saved registers above
+    i32 num_saved = 0;
+    bool used[NUM_REGS] = {0};
+    for(u32 v = 1; v <= e->num_values; v++)
+        if(e->start[v] <= e->end[v] && e->reg[v] != NO_REG)
+            used[e->reg[v]] = true;
+    for(i32 r = FIRST_CALLEE_SAVED; r < NUM_REGS; r++)
+        if(used[r])
+            e->saved[r] = -8 * ++num_saved;
+
+    e->frame_size = align_to((num_saved + e->num_spills) * 8, 16);
+}
+
+// instructions
+
+static void emit_location(IREmitter_T* e, Token_T* tok)
+{
+    if(!tok || !e->cg->embed_file_locations || (i32) tok->line == e->last_line)
+        return;
+    e->last_line = tok->line;
+    asm_println(e->cg, "  .loc %d %d", tok->source->file_no + 1, tok->line);
+}
+
+static const char* condition_code(IRInstr_T* instr)
+{
+    switch(instr->op)
+    {
+        case IR_EQ: return "e";
+        case IR_NE: return "ne";
+        case IR_LT: return instr->is_unsigned ? "b" : "l";
+        case IR_LE: return instr->is_unsigned ? "be" : "le";
+        default: return NULL;
+    }
+}
+
+static const char* negate_condition(const char* cc)
+{
+    static const char* pairs[][2] = {
+        {"e", "ne"}, {"ne", "e"}, {"l", "ge"}, {"le", "g"}, {"b", "ae"}, {"be", "a"}
+    };
+    for(size_t i = 0; i < sizeof(pairs) / sizeof(*pairs); i++)
+        if(!strcmp(pairs[i][0], cc))
+            return pairs[i][1];
+    return NULL;
+}
+
+// a comparison only used by the branch ending its block doesn't have to materialize its result
+static bool fuses_with_branch(IREmitter_T* e, IRBlock_T* block, size_t index)
+{
+    IRInstr_T* cmp = block->instrs->items[index];
+    if(e->uses[cmp->dst] != 1)
+        return false;
+
+    for(size_t i = index + 1; i < block->instrs->size; i++)
+    {
+        IRInstr_T* next = block->instrs->items[i];
+        if(next->op == IR_BR)
+            return next->a == cmp->dst;
+        if(next->op != IR_COPY)
+            return false;
+    }
+    return false;
+}
+
+static void emit_compare(IREmitter_T* e, IRInstr_T* instr, bool fused)
+{
+    char buf[32];
+    u8 size = instr->wide ? 8 : 4;
+    const IRRegister_T* a = reg_of(e, instr->a);
+    if(!a)
+    {
+        load_to(e, instr->a, &rax);
+        a = &rax;
+    }
+    asm_println(e->cg, "  cmp %s, %s", operand(e, instr->b, size, buf), sized(a, size));
+
+    if(fused)
+    {
+        e->fused_cc = condition_code(instr);
+        return;
+    }
+
+    const IRRegister_T* w = work_reg(e, instr);
+    asm_println(e->cg, "  set%s %%al", condition_code(instr));
+    asm_println(e->cg, "  movzbl %%al, %s", w->r32);
+    store_from(e, w, instr->dst);
+}
+
+static void emit_binary(IREmitter_T* e, IRInstr_T* instr)
+{
+    static const char* mnemonics[] = {
+        [IR_ADD] = "add",
+        [IR_SUB] = "sub",
+        [IR_MUL] = "imul",
+        [IR_AND] = "and",
+        [IR_OR] = "or",
+        [IR_XOR] = "xor",
+    };
+
+    char buf[32];
+    u8 size = instr->wide ? 8 : 4;
+    const IRRegister_T* w = work_reg(e, instr);
+    load_to(e, instr->a, w);
+
+    switch(instr->op)
+    {
+        case IR_SHL:
+        case IR_SHR:
+        {
+            const char* mnemonic = instr->op == IR_SHL ? "shl" : instr->is_unsigned ? "shr" : "sar";
+            if(e->immediate[instr->b])
+                asm_println(e->cg, "  %s $%ld, %s", mnemonic, (long) (e->defs[instr->b]->imm & (instr->wide ? 63 : 31)), sized(w, size));
+            else
+            {
+                load_to(e, instr->b, &(IRRegister_T){"%rcx", "%ecx", "%cx", "%cl"});
+                asm_println(e->cg, "  %s %%cl, %s", mnemonic, sized(w, size));
+            }
+        } break;
+
+        case IR_MUL:
+            if(e->immediate[instr->b])
+            {
+                asm_println(e->cg, "  imul %s, %s, %s", operand(e, instr->b, size, buf), sized(w, size), sized(w, size));
+                break;
+            }
+            // fall through
+        default:
+            asm_println(e->cg, "  %s %s, %s", mnemonics[instr->op], operand(e, instr->b, size, buf), sized(w, size));
+    }
+
+    store_from(e, w, instr->dst);
+}
+
+static void emit_div(IREmitter_T* e, IRInstr_T* instr)
+{
+    const char* di = instr->wide ? "%rdi" : "%edi";
+    load_to(e, instr->b, &(IRRegister_T){"%rdi", "%edi", "%di", "%dil"});
+    load_to(e, instr->a, &rax);
+
+    if(instr->is_unsigned)
+    {
+        asm_println(e->cg, "  xor %%edx, %%edx");
+        asm_println(e->cg, "  div %s", di);
+    }
+    else
+    {
+        asm_println(e->cg, "  %s", instr->size == 8 ? "cqo" : "cdq");
+        asm_println(e->cg, "  idiv %s", di);
+    }
+
+    store_from(e, instr->op == IR_MOD ? &(IRRegister_T){"%rdx", "%edx", "%dx", "%dl"} : &rax, instr->dst);
+}
+
+static void emit_ext(IREmitter_T* e, IRInstr_T* instr)
+{
+    char buf[32];
+    const IRRegister_T* w = work_reg(e, instr);
+    const char* src = operand(e, instr->a, instr->size, buf);
+
+    switch(instr->size)
+    {
+        case 1:
+            asm_println(e->cg, "  mov%sbl %s, %s", instr->is_unsigned ? "z" : "s", src, w->r32);
+            break;
+        case 2:
+            asm_println(e->cg, "  mov%swl %s, %s", instr->is_unsigned ? "z" : "s", src, w->r32);
+            break;
+        case 4:
+            if(instr->is_unsigned)
+                asm_println(e->cg, "  mov %s, %s", src, w->r32);
+            else
+                asm_println(e->cg, "  movslq %s, %s", src, w->r64);
+            break;
+        default:
+            load_to(e, instr->a, w);
+    }
+
+    store_from(e, w, instr->dst);
+}
+
+static const IRRegister_T* address_base(IREmitter_T* e, IRValue_T addr, const IRRegister_T* scratch)
+{
+    const IRRegister_T* base = reg_of(e, addr);
+    if(base)
+        return base;
+    load_to(e, addr, scratch);
+    return scratch;
+}
+
+static void emit_load(IREmitter_T* e, IRInstr_T* instr)
+{
+    const IRRegister_T* base = address_base(e, instr->a, &rax);
+    const IRRegister_T* w = work_reg(e, instr);
+    long offset = instr->imm;
+
+    switch(instr->size)
+    {
+        case 1:
+            asm_println(e->cg, "  mov%sbl %ld(%s), %s", instr->is_unsigned ? "z" : "s", offset, base->r64, w->r32);
+            break;
+        case 2:
+            asm_println(e->cg, "  mov%swl %ld(%s), %s", instr->is_unsigned ? "z" : "s", offset, base->r64, w->r32);
+            break;
+        case 4:
+            asm_println(e->cg, "  movslq %ld(%s), %s", offset, base->r64, w->r64);
+            break;
+        default:
+            asm_println(e->cg, "  mov %ld(%s), %s", offset, base->r64, w->r64);
+    }
+
+    store_from(e, w, instr->dst);
+}
+
+static void emit_store(IREmitter_T* e, IRInstr_T* instr)
+{
+    char buf[32];
+    const IRRegister_T* base = address_base(e, instr->a, &(IRRegister_T){"%rdi", "%edi", "%di", "%dil"});
+    const char* value;
+
+    if(e->immediate[instr->b] || reg_of(e, instr->b))
+        value = operand(e, instr->b, instr->size, buf);
+    else
+    {
+        load_to(e, instr->b, &rax);
+        value = sized(&rax, instr->size);
+    }
+
+    asm_println(e->cg, "  mov%s %s, %ld(%s)", size_suffix(instr->size), value, (long) instr->imm, base->r64);
+}
+
+static void emit_const(IREmitter_T* e, IRInstr_T* instr)
+{
+    const IRRegister_T* reg = reg_of(e, instr->dst);
+    const IRRegister_T* w = reg ? reg : &rax;
+    i64 imm = instr->imm;
+
+    if(imm == 0)
+        asm_println(e->cg, "  xor %s, %s", w->r32, w->r32);
+    else if((u64) imm <= UINT32_MAX)
+        asm_println(e->cg, "  mov $%lu, %s", (unsigned long) imm, w->r32);
+    else if(fits_i32(imm))
+        asm_println(e->cg, "  mov $%ld, %s", (long) imm, w->r64);
+    else
+        asm_println(e->cg, "  movabs $%ld, %s", (long) imm, w->r64);
+
+    store_from(e, w, instr->dst);
+}
+
+// restores the callee-saved registers and the stack frame of the caller
+static void emit_leave(IREmitter_T* e)
+{
+    for(i32 r = FIRST_CALLEE_SAVED; r < NUM_REGS; r++)
+        if(e->saved[r])
+            asm_println(e->cg, "  mov %d(%%rbp), %s", e->saved[r], regs[r].r64);
+    asm_println(e->cg, "  mov %%rbp, %%rsp");
+    asm_println(e->cg, "  pop %%rbp");
+}
+
+// calls returning their result right away jump to the function instead, see tail_calls.c
+static bool is_tail_call(IRBlock_T* block, size_t index)
+{
+    IRInstr_T* call = block->instrs->items[index];
+    if(call->op != IR_CALL || !call->tail || index + 2 != block->instrs->size)
+        return false;
+    IRInstr_T* ret = block->instrs->items[index + 1];
+    return ret->op == IR_RET && ret->a == call->dst;
+}
+
+static void emit_call(IREmitter_T* e, IRInstr_T* instr, bool tail)
+{
+    char buf[32];
+    for(u32 i = instr->num_args; i > 0; i--)
+    {
+        IRValue_T arg = instr->args[i - 1];
+        asm_println(e->cg, "  push%s %s", reg_of(e, arg) ? "" : "q", operand(e, arg, 8, buf));
+    }
+
+    asm_gen_addr(e->cg, instr->node->expr);
+    for(u32 i = 0; i < instr->num_args; i++)
+        asm_println(e->cg, "  pop %s", argregs[i]);
+
+    asm_println(e->cg, "  mov %%rax, %%r10");
+    asm_println(e->cg, "  mov $0, %%eax");
+    if(tail)
+    {
+        emit_leave(e);
+        asm_println(e->cg, "  jmp *%%r10");
+        return;
+    }
+    asm_println(e->cg, "  call *%%r10");
+    store_from(e, &rax, instr->dst);
+}
+
+static void emit_block_label(IREmitter_T* e, IRBlock_T* block)
+{
+    asm_println(e->cg, ".L.bb.%lu.%u:", (unsigned long) e->label, block->id);
+}
+
+static void emit_jump(IREmitter_T* e, const char* cc, IRBlock_T* target)
+{
+    asm_println(e->cg, "  j%s .L.bb.%lu.%u", cc, (unsigned long) e->label, target->id);
+}
+
+static void emit_branch(IREmitter_T* e, IRInstr_T* instr, IRBlock_T* next)
+{
+    const char* cc = e->fused_cc;
+    e->fused_cc = NULL;
+
+    if(!cc)
+    {
+        u8 size = instr->wide ? 8 : 4;
+        const IRRegister_T* reg = reg_of(e, instr->a);
+        if(reg)
+            asm_println(e->cg, "  test %s, %s", sized(reg, size), sized(reg, size));
+        else
+            asm_println(e->cg, "  cmp%s $0, %d(%%rbp)", size_suffix(size), spill_offset(e, instr->a));
+        cc = "ne";
+    }
+
+    if(instr->targets[1] == next)
+        emit_jump(e, cc, instr->targets[0]);
+    else if(instr->targets[0] == next)
+        emit_jump(e, negate_condition(cc), instr->targets[1]);
+    else
+    {
+        emit_jump(e, cc, instr->targets[0]);
+        emit_jump(e, "mp", instr->targets[1]);
+    }
+}
+
+static void emit_instr(IREmitter_T* e, IRBlock_T* block, size_t index, IRBlock_T* next)
+{
+    IRInstr_T* instr = block->instrs->items[index];
+    if(!is_emitted(e, instr) || instr->op == IR_ARG)
+        return;
+
+    emit_location(e, instr->tok);
+
+    char buf[32];
+    switch(instr->op)
+    {
+        case IR_CONST:
+            emit_const(e, instr);
+            break;
+        case IR_COPY:
+            emit_mov(e, instr->dst, instr->a);
+            break;
+        case IR_ADDR:
+            asm_gen_addr(e->cg, instr->node);
+            store_from(e, &rax, instr->dst);
+            break;
+        case IR_STRING:
+        {
+            const IRRegister_T* w = work_reg(e, instr);
+            asm_println(e->cg, "  lea .L.string.%lu(%%rip), %s", asm_add_string_literal(e->cg, instr->node), w->r64);
+            store_from(e, w, instr->dst);
+        } break;
+        case IR_LOAD:
+            emit_load(e, instr);
+            break;
+        case IR_STORE:
+            emit_store(e, instr);
+            break;
+        case IR_EXT:
+            emit_ext(e, instr);
+            break;
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_AND:
+        case IR_OR:
+        case IR_XOR:
+        case IR_SHL:
+        case IR_SHR:
+            emit_binary(e, instr);
+            break;
+        case IR_DIV:
+        case IR_MOD:
+            emit_div(e, instr);
+            break;
+        case IR_NEG:
+        case IR_NOT:
+        {
+            const IRRegister_T* w = work_reg(e, instr);
+            load_to(e, instr->a, w);
+            asm_println(e->cg, "  %s %s", instr->op == IR_NEG ? "neg" : "not", w->r64);
+            store_from(e, w, instr->dst);
+        } break;
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_LE:
+            emit_compare(e, instr, fuses_with_branch(e, block, index));
+            break;
+        case IR_CALL:
+            emit_call(e, instr, is_tail_call(block, index));
+            break;
+        case IR_JMP:
+            if(instr->targets[0] != next)
+                emit_jump(e, "mp", instr->targets[0]);
+            break;
+        case IR_BR:
+            emit_branch(e, instr, next);
+            break;
+        case IR_RET:
+            if(index && is_tail_call(block, index - 1))
+                break;
+            if(instr->a)
+                asm_println(e->cg, "  mov %s, %%rax", operand(e, instr->a, 8, buf));
+            if(next)
+                asm_println(e->cg, "  jmp .L.return.%s", e->fn_name);
+            break;
+        default:
+            break;
+    }
+}
+
+// arguments are moved to their homes before anything else happens
+static void emit_arguments(IREmitter_T* e)
+{
+    IRBlock_T* entry = e->fn->blocks->items[0];
+    IRInstr_T* args[6];
+    u32 num_args = 0;
+    bool clobbers = false;
+
+    for(size_t i = 0; i < entry->instrs->size; i++)
+    {
+        IRInstr_T* instr = entry->instrs->items[i];
+        if(instr->op != IR_ARG)
+            continue;
+        args[num_args++] = instr;
+
+        const IRRegister_T* reg = reg_of(e, instr->dst);
+        for(size_t j = 0; reg && j < sizeof(argregs) / sizeof(*argregs); j++)
+            clobbers |= !strcmp(reg->r64, argregs[j]);
+    }
+
+    char buf[32];
+    if(clobbers)
+    {
+        for(u32 i = 0; i < num_args; i++)
+            asm_println(e->cg, "  push %s", argregs[args[i]->imm]);
+        for(u32 i = num_args; i > 0; i--)
+            asm_println(e->cg, "  pop%s %s", reg_of(e, args[i - 1]->dst) ? "" : "q", operand(e, args[i - 1]->dst, 8, buf));
+    }
+    else
+        for(u32 i = 0; i < num_args; i++)
+            asm_println(e->cg, "  mov %s, %s", argregs[args[i]->imm], operand(e, args[i]->dst, 8, buf));
+}
+
+void asm_gen_ir_function(ASMCodegenData_T* cg, ASTObj_T* obj, const char* fn_name)
+{
+    IRFunction_T* fn = obj->ir;
+
+    u32 n = fn->num_values + 1;
+    IREmitter_T e = {
+        .cg = cg,
+        .fn = fn,
+        .fn_name = fn_name,
+        .label = cg->max_count++,
+        .num_values = fn->num_values,
+        .defs = calloc(n, sizeof(IRInstr_T*)),
+        .uses = calloc(n, sizeof(u32)),
+        .immediate = calloc(n, sizeof(bool)),
+        .start = calloc(n, sizeof(u32)),
+        .end = calloc(n, sizeof(u32)),
+        .crossing = calloc(n, sizeof(bool)),
+        .num_defs = calloc(n, sizeof(u32)),
+        .def_pos = calloc(n, sizeof(u32)),
+        .reg = calloc(n, sizeof(i32)),
+        .spill = calloc(n, sizeof(i32)),
+        .last_line = -1
+    };
+
+    analyze_values(&e);
+    compute_intervals(&e);
+    allocate_registers(&e);
+
+    // prologue
+    asm_println(cg, "  push %%rbp");
+    asm_println(cg, "  mov %%rsp, %%rbp");
+    if(e.frame_size)
+        asm_println(cg, "  sub $%d, %%rsp", e.frame_size);
+    for(i32 r = FIRST_CALLEE_SAVED; r < NUM_REGS; r++)
+        if(e.saved[r])
+            asm_println(cg, "  mov %s, %d(%%rbp)", regs[r].r64, e.saved[r]);
+
+    if(cg->embed_file_locations)
+        asm_println(cg, "  .loc %d %d", obj->tok->source->file_no + 1, obj->tok->line + 1);
+
+    emit_arguments(&e);
+
+    for(size_t i = 0; i < fn->blocks->size; i++)
+    {
+        IRBlock_T* block = fn->blocks->items[i];
+        IRBlock_T* next = i + 1 < fn->blocks->size ? fn->blocks->items[i + 1] : NULL;
+        emit_block_label(&e, block);
+        for(size_t j = 0; j < block->instrs->size; j++)
+            emit_instr(&e, block, j, next);
+    }
+
+    // epilogue
+    asm_println(cg, ".L.return.%s:", fn_name);
+    emit_leave(&e);
+    asm_println(cg, "  ret");
+
+    free(e.defs);
+    free(e.uses);
+    free(e.immediate);
+    free(e.start);
+    free(e.end);
+    free(e.crossing);
+    free(e.num_defs);
+    free(e.def_pos);
+    free(e.reg);
+    free(e.spill);
+}
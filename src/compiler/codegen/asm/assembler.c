@@ -0,0 +1,1611 @@
+#include "assembler.h"
+#include "version.h"
+
+#include <ctype.h>
+#include <elf.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// DWARF constants used by the line tables
+#define DW_TAG_compile_unit     0x11
+#define DW_CHILDREN_no          0x00
+#define DW_AT_name              0x03
+#define DW_AT_stmt_list         0x10
+#define DW_AT_low_pc            0x11
+#define DW_AT_high_pc           0x12
+#define DW_AT_language          0x13
+#define DW_AT_comp_dir          0x1b
+#define DW_AT_producer          0x25
+#define DW_AT_ranges            0x55
+#define DW_FORM_addr            0x01
+#define DW_FORM_data2           0x05
+#define DW_FORM_data8           0x07
+#define DW_FORM_string          0x08
+#define DW_FORM_sec_offset      0x17
+#define DW_LANG_Mips_Assembler  0x8001
+#define DW_LNS_copy             1
+#define DW_LNS_advance_pc       2
+#define DW_LNS_advance_line     3
+#define DW_LNS_set_file         4
+#define DW_LNE_end_sequence     1
+#define DW_LNE_set_address      2
+
+#define LINE_BASE   -5
+#define LINE_RANGE  14
+#define OPCODE_BASE 13
+
+typedef struct ASM_LOC_STRUCT {
+    ASMSection_T* section;
+    ASMFrag_T* frag;
+    size_t offset;
+    u32 file;
+    u32 line;
+} ASMLoc_T;
+
+typedef struct ASSEMBLER_STRUCT {
+    ASMObject_T obj;
+    ASMSection_T* section;
+    List_T* files; // names from `.file N`, at N - 1
+    List_T* locs;  // list of ASMLoc_Ts
+} Assembler_T;
+
+// buffers
+
+void asm_buffer_put(ASMBuffer_T* buf, const void* data, size_t size)
+{
+    if(buf->size + size > buf->allocated)
+    {
+        buf->allocated = MAX(buf->allocated * 2, buf->size + size + 64);
+        buf->data = realloc(buf->data, buf->allocated);
+    }
+    if(data)
+        memcpy(buf->data + buf->size, data, size);
+    else
+        memset(buf->data + buf->size, 0, size);
+    buf->size += size;
+}
+
+void asm_buffer_put_int(ASMBuffer_T* buf, u64 value, size_t size)
+{
+    u8 bytes[8];
+    for(size_t i = 0; i < size; i++)
+        bytes[i] = value >> (i * 8);
+    asm_buffer_put(buf, bytes, size);
+}
+
+void asm_buffer_put_uleb(ASMBuffer_T* buf, u64 value)
+{
+    do {
+        u8 byte = value & 0x7f;
+        value >>= 7;
+        if(value)
+            byte |= 0x80;
+        asm_buffer_put(buf, &byte, 1);
+    } while(value);
+}
+
+void asm_buffer_put_sleb(ASMBuffer_T* buf, i64 value)
+{
+    bool more;
+    do {
+        u8 byte = value & 0x7f;
+        value >>= 7;
+        more = !((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40)));
+        if(more)
+            byte |= 0x80;
+        asm_buffer_put(buf, &byte, 1);
+    } while(more);
+}
+
+// symbols and sections
+
+static ASMSymbol_T* new_symbol(Assembler_T* a, const char* name)
+{
+    ASMSymbol_T* sym = calloc(1, sizeof(ASMSymbol_T));
+    sym->name = strdup(name);
+    list_push(a->obj.symbols, sym);
+    return sym;
+}
+
+static ASMSymbol_T* get_symbol(Assembler_T* a, const char* name)
+{
+    ASMSymbol_T* sym = hashmap_get(a->obj.symbol_map, name);
+    if(!sym)
+    {
+        sym = new_symbol(a, name);
+        hashmap_put(a->obj.symbol_map, sym->name, sym);
+    }
+    return sym;
+}
+
+static bool is_local_label(ASMSymbol_T* sym)
+{
+    return strncmp(sym->name, ".L", 2) == 0;
+}
+
+u64 asm_symbol_address(ASMSymbol_T* sym)
+{
+    return sym->frag->address + sym->offset;
+}
+
+static ASMFrag_T* current_frag(ASMSection_T* section)
+{
+    return list_last(section->frags);
+}
+
+static void new_frag(ASMSection_T* section)
+{
+    ASMFrag_T* frag = calloc(1, sizeof(ASMFrag_T));
+    frag->kind = FRAG_FIXED;
+    frag->start = section->data.size;
+    list_push(section->frags, frag);
+}
+
+static ASMSection_T* get_section(Assembler_T* a, const char* name)
+{
+    for(size_t i = 0; i < a->obj.sections->size; i++)
+    {
+        ASMSection_T* section = a->obj.sections->items[i];
+        if(strcmp(section->name, name) == 0)
+            return section;
+    }
+
+    ASMSection_T* section = calloc(1, sizeof(ASMSection_T));
+    section->name = strdup(name);
+    section->type = SHT_PROGBITS;
+    section->align = 1;
+    section->frags = init_list();
+    section->fixups = init_list();
+    section->relocs = init_list();
+
+    if(strcmp(name, ".text") == 0 || str_starts_with(name, ".text."))
+        section->flags = SHF_ALLOC | SHF_EXECINSTR;
+    else if(strcmp(name, ".data") == 0 || str_starts_with(name, ".data."))
+        section->flags = SHF_ALLOC | SHF_WRITE;
+    else if(strcmp(name, ".bss") == 0 || str_starts_with(name, ".bss."))
+    {
+        section->type = SHT_NOBITS;
+        section->flags = SHF_ALLOC | SHF_WRITE;
+    }
+    else if(strcmp(name, ".rodata") == 0 || str_starts_with(name, ".rodata."))
+        section->flags = SHF_ALLOC;
+    else if(strcmp(name, ".init_array") == 0)
+    {
+        section->type = SHT_INIT_ARRAY;
+        section->flags = SHF_ALLOC | SHF_WRITE;
+    }
+    else if(strcmp(name, ".fini_array") == 0)
+    {
+        section->type = SHT_FINI_ARRAY;
+        section->flags = SHF_ALLOC | SHF_WRITE;
+    }
+
+    new_frag(section);
+
+    section->symbol = new_symbol(a, name);
+    section->symbol->type = STT_SECTION;
+    section->symbol->section = section;
+    section->symbol->frag = current_frag(section);
+
+    list_push(a->obj.sections, section);
+    return section;
+}
+
+static void emit(Assembler_T* a, const void* data, size_t size)
+{
+    asm_buffer_put(&a->section->data, data, size);
+    current_frag(a->section)->len += size;
+}
+
+static void add_fixup(Assembler_T* a, ASMFixup_T* fixup, size_t offset)
+{
+    ASMFrag_T* frag = current_frag(a->section);
+    ASMFixup_T* copy = malloc(sizeof(ASMFixup_T));
+    *copy = *fixup;
+    copy->frag = frag;
+    copy->offset = frag->len + offset;
+    list_push(a->section->fixups, copy);
+}
+
+// closes the current fragment with a variable part
+static ASMFrag_T* emit_variable(Assembler_T* a, ASMFragKind_T kind)
+{
+    ASMFrag_T* frag = current_frag(a->section);
+    frag->kind = kind;
+    new_frag(a->section);
+    return frag;
+}
+
+// parsing
+
+static char* skip_spaces(char* s)
+{
+    while(isspace(*s))
+        s++;
+    return s;
+}
+
+static bool is_symbol_start(char c)
+{
+    return isalpha(c) || c == '_' || c == '.';
+}
+
+static bool is_symbol_char(char c)
+{
+    return isalnum(c) || c == '_' || c == '.' || c == '$';
+}
+
+static char* parse_name(char** s)
+{
+    char* start = *s;
+    if(!is_symbol_start(*start))
+        return NULL;
+    char* end = start + 1;
+    while(is_symbol_char(*end))
+        end++;
+    *s = end;
+    return start;
+}
+
+static bool parse_expr(Assembler_T* a, char** s, ASMValue_T* value, bool parens);
+
+static bool parse_primary(Assembler_T* a, char** s, ASMValue_T* value, bool parens)
+{
+    char* p = skip_spaces(*s);
+    memset(value, 0, sizeof(ASMValue_T));
+
+    if(*p == '-' || *p == '~' || *p == '+')
+    {
+        char op = *p++;
+        if(!parse_primary(a, &p, value, parens) || (op != '+' && (value->sym || value->sub)))
+            return false;
+        value->addend = op == '-' ? -value->addend : op == '~' ? ~value->addend : value->addend;
+    }
+    else if(isdigit(*p))
+    {
+        if(p[0] == '0' && (p[1] == 'b' || p[1] == 'B'))
+            value->addend = strtoull(p + 2, &p, 2);
+        else
+            value->addend = strtoull(p, &p, 0);
+    }
+    else if(*p == '\'' && p[1] && p[1] != '\\')
+    {
+        value->addend = (u8) p[1];
+        p += p[2] == '\'' ? 3 : 2;
+    }
+    else if(*p == '(' && parens)
+    {
+        p++;
+        if(!parse_expr(a, &p, value, parens))
+            return false;
+        p = skip_spaces(p);
+        if(*p++ != ')')
+            return false;
+    }
+    else if(*p == '.' && !is_symbol_char(p[1]))
+    {
+        // the current location
+        ASMSymbol_T* here = new_symbol(a, ".L.here");
+        here->section = a->section;
+        here->frag = current_frag(a->section);
+        here->offset = here->frag->len;
+        value->sym = here;
+        p++;
+    }
+    else
+    {
+        char* name = parse_name(&p);
+        if(!name || *p == '@')
+            return false;
+        char c = *p;
+        *p = '\0';
+        value->sym = get_symbol(a, name);
+        *p = c;
+    }
+
+    *s = p;
+    return true;
+}
+
+static bool parse_expr(Assembler_T* a, char** s, ASMValue_T* value, bool parens)
+{
+    if(!parse_primary(a, s, value, parens))
+        return false;
+
+    for(;;)
+    {
+        char* p = skip_spaces(*s);
+        if(*p != '+' && *p != '-')
+            return true;
+
+        char op = *p++;
+        ASMValue_T rhs;
+        if(!parse_primary(a, &p, &rhs, parens) || rhs.sub)
+            return false;
+
+        if(op == '+')
+        {
+            if(rhs.sym && value->sym)
+                return false;
+            if(rhs.sym)
+                value->sym = rhs.sym;
+            value->addend += rhs.addend;
+        }
+        else
+        {
+            if(rhs.sym && value->sub)
+                return false;
+            if(rhs.sym)
+                value->sub = rhs.sym;
+            value->addend -= rhs.addend;
+        }
+        *s = p;
+    }
+}
+
+// parses the expression in `text` completely
+static bool parse_full_expr(Assembler_T* a, char* text, ASMValue_T* value)
+{
+    if(!parse_expr(a, &text, value, true))
+        return false;
+    return *skip_spaces(text) == '\0';
+}
+
+static bool parse_const(Assembler_T* a, char* text, i64* value)
+{
+    ASMValue_T v;
+    if(!parse_full_expr(a, text, &v) || v.sym || v.sub)
+        return false;
+    *value = v.addend;
+    return true;
+}
+
+// registers like `rax`, `r8d`, `sil` or `ah`
+static bool parse_gpr(const char* name, size_t len, ASMOperand_T* op)
+{
+    static const char* legacy[8] = {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di"};
+
+    op->cls = REG_GPR;
+    if(len >= 2 && name[0] == 'r' && isdigit(name[1]))
+    {
+        u8 num = name[1] - '0';
+        size_t i = 2;
+        if(len > 2 && isdigit(name[2]))
+            num = num * 10 + name[i++] - '0';
+        if(num < 8 || num > 15)
+            return false;
+
+        op->reg = num;
+        if(i == len)
+            op->size = 8;
+        else if(i + 1 == len && strchr("dwb", name[i]))
+            op->size = name[i] == 'd' ? 4 : name[i] == 'w' ? 2 : 1;
+        else
+            return false;
+        return true;
+    }
+
+    for(u8 r = 0; r < 8; r++)
+    {
+        const char* base = legacy[r];
+        op->reg = r;
+        if(len == 3 && (name[0] == 'r' || name[0] == 'e') && strncmp(name + 1, base, 2) == 0)
+            op->size = name[0] == 'r' ? 8 : 4;
+        else if(len == 2 && strncmp(name, base, 2) == 0)
+            op->size = 2;
+        else if(r < 4 && len == 2 && name[0] == base[0] && name[1] == 'l')
+            op->size = 1;
+        else if(r < 4 && len == 2 && name[0] == base[0] && name[1] == 'h')
+        {
+            op->size = 1;
+            op->reg = r + 4;
+            op->high_byte = true;
+        }
+        else if(r >= 4 && len == 3 && strncmp(name, base, 2) == 0 && name[2] == 'l')
+        {
+            op->size = 1;
+            op->byte_rex = true;
+        }
+        else
+            continue;
+        return true;
+    }
+    return false;
+}
+
+static bool parse_register(char** s, ASMOperand_T* op)
+{
+    char* name = *s;
+    size_t len = 0;
+    while(isalnum(name[len]))
+        len++;
+    *s = name + len;
+
+    op->kind = OPND_REG;
+    if(len > 3 && (strncmp(name, "xmm", 3) == 0 || strncmp(name, "ymm", 3) == 0))
+    {
+        char* end;
+        unsigned long num = strtoul(name + 3, &end, 10);
+        op->cls = name[0] == 'x' ? REG_XMM : REG_YMM;
+        op->reg = num;
+        op->size = name[0] == 'x' ? 16 : 32;
+        return end == name + len && num < 16;
+    }
+    if(len == 2 && strncmp(name, "st", 2) == 0)
+    {
+        op->cls = REG_ST;
+        op->reg = 0;
+        if(**s == '(')
+        {
+            if(!isdigit((*s)[1]) || (*s)[1] > '7' || (*s)[2] != ')')
+                return false;
+            op->reg = (*s)[1] - '0';
+            *s += 3;
+        }
+        return true;
+    }
+    return parse_gpr(name, len, op);
+}
+
+// `disp(base, index, scale)`, parts are optional
+static bool parse_memory(Assembler_T* a, char* text, ASMOperand_T* op)
+{
+    op->kind = OPND_MEM;
+    op->base = op->index = -1;
+    op->scale = 1;
+
+    char* p = skip_spaces(text);
+    if(*p != '(' && !parse_expr(a, &p, &op->value, false))
+        return false;
+    p = skip_spaces(p);
+    if(!*p)
+        return true;
+    if(*p++ != '(')
+        return false;
+
+    p = skip_spaces(p);
+    if(*p == '%')
+    {
+        p++;
+        if(strncmp(p, "rip", 3) == 0 && !isalnum(p[3]))
+        {
+            op->rip = true;
+            p += 3;
+        }
+        else
+        {
+            ASMOperand_T base = {0};
+            if(!parse_register(&p, &base) || base.cls != REG_GPR || base.size != 8)
+                return false;
+            op->base = base.reg;
+        }
+        p = skip_spaces(p);
+    }
+
+    if(*p == ',')
+    {
+        p = skip_spaces(p + 1);
+        ASMOperand_T index = {0};
+        if(*p++ != '%' || op->rip || !parse_register(&p, &index) || index.cls != REG_GPR || index.size != 8)
+            return false;
+        op->index = index.reg;
+        p = skip_spaces(p);
+        if(*p == ',')
+        {
+            p = skip_spaces(p + 1);
+            op->scale = strtoul(p, &p, 10);
+            p = skip_spaces(p);
+        }
+    }
+
+    if(*p++ != ')')
+        return false;
+    return *skip_spaces(p) == '\0';
+}
+
+static bool parse_operand(Assembler_T* a, char* text, ASMOperand_T* op)
+{
+    memset(op, 0, sizeof(ASMOperand_T));
+    char* p = skip_spaces(text);
+    if(*p == '*')
+    {
+        op->indirect = true;
+        p = skip_spaces(p + 1);
+    }
+
+    if(*p == '$')
+    {
+        op->kind = OPND_IMM;
+        return !op->indirect && parse_full_expr(a, p + 1, &op->value);
+    }
+
+    if(*p == '%')
+    {
+        p++;
+        if((p[0] == 'f' || p[0] == 'g') && p[1] == 's' && p[2] == ':')
+        {
+            u8 segment = p[0] == 'f' ? 0x64 : 0x65;
+            if(!parse_memory(a, p + 3, op))
+                return false;
+            op->segment = segment;
+            return true;
+        }
+        return parse_register(&p, op) && *skip_spaces(p) == '\0';
+    }
+
+    return parse_memory(a, p, op);
+}
+
+// splits `text` at commas outside of parentheses and strings
+static u32 split_args(char* text, char** args, u32 max)
+{
+    u32 count = 0;
+    i32 depth = 0;
+    bool in_string = false;
+
+    text = skip_spaces(text);
+    if(!*text)
+        return 0;
+
+    args[count++] = text;
+    for(char* p = text; *p; p++)
+    {
+        if(in_string)
+        {
+            if(*p == '\\' && p[1])
+                p++;
+            else if(*p == '"')
+                in_string = false;
+        }
+        else if(*p == '"')
+            in_string = true;
+        else if(*p == '(')
+            depth++;
+        else if(*p == ')')
+            depth--;
+        else if(*p == ',' && !depth)
+        {
+            if(count == max)
+                return max + 1;
+            *p = '\0';
+            args[count++] = skip_spaces(p + 1);
+        }
+    }
+    return count;
+}
+
+// parses a string literal with C-like escapes into `out`
+static bool parse_string(char** s, ASMBuffer_T* out)
+{
+    char* p = skip_spaces(*s);
+    if(*p++ != '"')
+        return false;
+
+    while(*p != '"')
+    {
+        u8 c = *p++;
+        if(!c)
+            return false;
+        if(c == '\\')
+        {
+            c = *p++;
+            switch(c)
+            {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'v': c = '\v'; break;
+                case 'a': c = '\a'; break;
+                case 'e': c = 0x1b; break;
+                case '\\':
+                case '"':
+                case '\'':
+                    break;
+                case 'x':
+                    if(!isxdigit(*p))
+                        return false;
+                    c = strtoul(p, &p, 16);
+                    break;
+                default:
+                    if(c < '0' || c > '7')
+                        return false;
+                    c -= '0';
+                    for(u8 i = 0; i < 2 && *p >= '0' && *p <= '7'; i++)
+                        c = c * 8 + *p++ - '0';
+                    break;
+            }
+        }
+        asm_buffer_put(out, &c, 1);
+    }
+
+    *s = p + 1;
+    return true;
+}
+
+// directives
+
+static bool emit_data(Assembler_T* a, char* args, u8 size)
+{
+    char* values[256];
+    u32 count = split_args(args, values, LEN(values));
+    if(count > LEN(values))
+        return false;
+
+    for(u32 i = 0; i < count; i++)
+    {
+        ASMValue_T value;
+        if(!parse_full_expr(a, values[i], &value))
+            return false;
+
+        if(value.sym || value.sub)
+        {
+            ASMFixup_T fixup = {
+                .size = size,
+                .reloc_type = size == 8 ? R_X86_64_64 : size == 4 ? R_X86_64_32 : size == 2 ? R_X86_64_16 : R_X86_64_8,
+                .value = value
+            };
+            add_fixup(a, &fixup, 0);
+            emit(a, NULL, size);
+        }
+        else
+        {
+            u8 bytes[8];
+            for(u8 j = 0; j < size; j++)
+                bytes[j] = value.addend >> (j * 8);
+            emit(a, bytes, size);
+        }
+    }
+    return true;
+}
+
+static bool emit_strings(Assembler_T* a, char* args, bool terminate)
+{
+    char* p = args;
+    for(;;)
+    {
+        ASMBuffer_T str = {0};
+        if(!parse_string(&p, &str))
+        {
+            free(str.data);
+            return false;
+        }
+        if(terminate)
+            asm_buffer_put(&str, NULL, 1);
+        emit(a, str.data, str.size);
+        free(str.data);
+
+        p = skip_spaces(p);
+        if(!*p)
+            return true;
+        if(*p++ != ',')
+            return false;
+    }
+}
+
+static bool emit_align(Assembler_T* a, char* args)
+{
+    char* values[3];
+    i64 align;
+    if(split_args(args, values, LEN(values)) != 1 || !parse_const(a, values[0], &align))
+        return false;
+    if(!align)
+        align = 1;
+    if(align < 0 || (align & (align - 1)))
+        return false;
+
+    a->section->align = MAX(a->section->align, (u64) align);
+    emit_variable(a, FRAG_ALIGN)->align = align;
+    return true;
+}
+
+static bool emit_zero(Assembler_T* a, char* args)
+{
+    char* values[3];
+    i64 size, fill = 0;
+    u32 count = split_args(args, values, LEN(values));
+    if(count < 1 || count > 2 || !parse_const(a, values[0], &size) || size < 0)
+        return false;
+    if(count == 2 && !parse_const(a, values[1], &fill))
+        return false;
+
+    u8* bytes = malloc(size + 1);
+    memset(bytes, fill, size);
+    emit(a, bytes, size);
+    free(bytes);
+    return true;
+}
+
+// `.section name[, "flags"[, @type[, entsize]]]`
+static bool switch_section(Assembler_T* a, char* args)
+{
+    char* values[4];
+    u32 count = split_args(args, values, LEN(values));
+    if(count < 1 || count > 4)
+        return false;
+
+    char* name = values[0];
+    char* end = name;
+    if(!parse_name(&end) || *skip_spaces(end))
+        return false;
+    *end = '\0';
+
+    bool is_new = true;
+    for(size_t i = 0; i < a->obj.sections->size && is_new; i++)
+        is_new = strcmp(((ASMSection_T*) a->obj.sections->items[i])->name, name) != 0;
+
+    a->section = get_section(a, name);
+    if(count == 1 || !is_new)
+        return true;
+
+    ASMBuffer_T flags = {0};
+    char* p = values[1];
+    bool ok = parse_string(&p, &flags) && !*skip_spaces(p);
+    a->section->flags = 0;
+    for(size_t i = 0; ok && i < flags.size; i++)
+    {
+        switch(flags.data[i])
+        {
+            case 'a': a->section->flags |= SHF_ALLOC; break;
+            case 'w': a->section->flags |= SHF_WRITE; break;
+            case 'x': a->section->flags |= SHF_EXECINSTR; break;
+            case 'M': a->section->flags |= SHF_MERGE; break;
+            case 'S': a->section->flags |= SHF_STRINGS; break;
+            default: ok = false;
+        }
+    }
+    free(flags.data);
+    if(!ok)
+        return false;
+
+    if(count >= 3)
+    {
+        char* type = skip_spaces(values[2]);
+        if(*type != '@' && *type != '%')
+            return false;
+        type++;
+        if(strcmp(type, "progbits") == 0)
+            a->section->type = SHT_PROGBITS;
+        else if(strcmp(type, "nobits") == 0)
+            a->section->type = SHT_NOBITS;
+        else if(strcmp(type, "note") == 0)
+            a->section->type = SHT_NOTE;
+        else if(strcmp(type, "init_array") == 0)
+            a->section->type = SHT_INIT_ARRAY;
+        else if(strcmp(type, "fini_array") == 0)
+            a->section->type = SHT_FINI_ARRAY;
+        else
+            return false;
+    }
+
+    if(count == 4)
+    {
+        i64 entsize;
+        if(!parse_const(a, values[3], &entsize) || entsize < 0)
+            return false;
+        a->section->entsize = entsize;
+    }
+    return !(a->section->flags & SHF_MERGE) || a->section->entsize;
+}
+
+static ASMSymbol_T* parse_symbol_arg(Assembler_T* a, char* text)
+{
+    char* p = skip_spaces(text);
+    char* name = parse_name(&p);
+    if(!name || *skip_spaces(p))
+        return NULL;
+    *p = '\0';
+    return get_symbol(a, name);
+}
+
+static bool set_symbol_type(Assembler_T* a, char* args)
+{
+    char* values[2];
+    ASMSymbol_T* sym;
+    if(split_args(args, values, LEN(values)) != 2 || !(sym = parse_symbol_arg(a, values[0])))
+        return false;
+
+    char* type = skip_spaces(values[1]);
+    if(*type != '@' && *type != '%')
+        return false;
+    type++;
+    if(strcmp(type, "function") == 0)
+        sym->type = STT_FUNC;
+    else if(strcmp(type, "object") == 0)
+        sym->type = STT_OBJECT;
+    else if(strcmp(type, "notype") == 0)
+        sym->type = STT_NOTYPE;
+    else
+        return false;
+    return true;
+}
+
+static bool set_symbol_size(Assembler_T* a, char* args)
+{
+    char* values[2];
+    ASMSymbol_T* sym;
+    if(split_args(args, values, LEN(values)) != 2 || !(sym = parse_symbol_arg(a, values[0])))
+        return false;
+    sym->has_size = true;
+    return parse_full_expr(a, values[1], &sym->size);
+}
+
+static bool set_globals(Assembler_T* a, char* args)
+{
+    char* names[64];
+    u32 count = split_args(args, names, LEN(names));
+    if(!count || count > LEN(names))
+        return false;
+
+    for(u32 i = 0; i < count; i++)
+    {
+        ASMSymbol_T* sym = parse_symbol_arg(a, names[i]);
+        if(!sym || is_local_label(sym))
+            return false;
+        sym->global = true;
+    }
+    return true;
+}
+
+// `.file "name"` or `.file N "path"`
+static bool add_file(Assembler_T* a, char* args)
+{
+    char* p = skip_spaces(args);
+    ASMBuffer_T name = {0};
+
+    if(!isdigit(*p))
+    {
+        if(!parse_string(&p, &name) || *skip_spaces(p))
+            return free(name.data), false;
+        asm_buffer_put(&name, NULL, 1);
+        free(a->obj.file_name);
+        a->obj.file_name = (char*) name.data;
+        return true;
+    }
+
+    size_t num = strtoul(p, &p, 10);
+    if(!num || !parse_string(&p, &name) || *skip_spaces(p))
+        return free(name.data), false;
+    asm_buffer_put(&name, NULL, 1);
+
+    while(a->files->size < num)
+        list_push(a->files, NULL);
+    free(a->files->items[num - 1]);
+    a->files->items[num - 1] = name.data;
+    return true;
+}
+
+// `.loc file line [column] [options]`
+static bool add_loc(Assembler_T* a, char* args)
+{
+    char* p = skip_spaces(args);
+    if(!isdigit(*p))
+        return false;
+
+    ASMLoc_T* loc = malloc(sizeof(ASMLoc_T));
+    loc->file = strtoul(p, &p, 10);
+    p = skip_spaces(p);
+    loc->line = strtoul(p, &p, 10);
+    loc->section = a->section;
+    loc->frag = current_frag(a->section);
+    loc->offset = loc->frag->len;
+    list_push(a->locs, loc);
+    return loc->file > 0;
+}
+
+static bool assemble_directive(Assembler_T* a, char* name, char* args)
+{
+    if(strcmp(name, ".text") == 0 || strcmp(name, ".data") == 0 || strcmp(name, ".bss") == 0)
+    {
+        a->section = get_section(a, name);
+        return !*args;
+    }
+    if(strcmp(name, ".section") == 0)
+        return switch_section(a, args);
+    if(strcmp(name, ".globl") == 0 || strcmp(name, ".global") == 0)
+        return set_globals(a, args);
+    if(strcmp(name, ".type") == 0)
+        return set_symbol_type(a, args);
+    if(strcmp(name, ".size") == 0)
+        return set_symbol_size(a, args);
+    if(strcmp(name, ".align") == 0 || strcmp(name, ".balign") == 0)
+        return emit_align(a, args);
+    if(strcmp(name, ".zero") == 0 || strcmp(name, ".skip") == 0 || strcmp(name, ".space") == 0)
+        return emit_zero(a, args);
+    if(strcmp(name, ".byte") == 0)
+        return emit_data(a, args, 1);
+    if(strcmp(name, ".2byte") == 0 || strcmp(name, ".short") == 0 || strcmp(name, ".word") == 0 || strcmp(name, ".value") == 0)
+        return emit_data(a, args, 2);
+    if(strcmp(name, ".4byte") == 0 || strcmp(name, ".long") == 0 || strcmp(name, ".int") == 0)
+        return emit_data(a, args, 4);
+    if(strcmp(name, ".8byte") == 0 || strcmp(name, ".quad") == 0)
+        return emit_data(a, args, 8);
+    if(strcmp(name, ".ascii") == 0)
+        return emit_strings(a, args, false);
+    if(strcmp(name, ".asciz") == 0 || strcmp(name, ".string") == 0)
+        return emit_strings(a, args, true);
+    if(strcmp(name, ".file") == 0)
+        return add_file(a, args);
+    if(strcmp(name, ".loc") == 0)
+        return add_loc(a, args);
+    return false;
+}
+
+// instructions
+
+static bool is_prefix(const char* mnemonic, u8* byte)
+{
+    if(strcmp(mnemonic, "rep") == 0 || strcmp(mnemonic, "repe") == 0 || strcmp(mnemonic, "repz") == 0)
+        *byte = 0xf3;
+    else if(strcmp(mnemonic, "repne") == 0 || strcmp(mnemonic, "repnz") == 0)
+        *byte = 0xf2;
+    else if(strcmp(mnemonic, "lock") == 0)
+        *byte = 0xf0;
+    else
+        return false;
+    return true;
+}
+
+static bool is_label_target(ASMOperand_T* op)
+{
+    return op->kind == OPND_MEM && !op->indirect && op->base < 0 && op->index < 0 && !op->rip && !op->segment && op->value.sym && !op->value.sub;
+}
+
+static bool assemble_instruction(Assembler_T* a, char* mnemonic, char* args)
+{
+    for(char* c = mnemonic; *c; c++)
+        *c = tolower(*c);
+
+    u8 prefix;
+    if(is_prefix(mnemonic, &prefix))
+    {
+        char* next = skip_spaces(args);
+        char* end = next;
+        while(*end && !isspace(*end))
+            end++;
+        if(end == next)
+            return false;
+        if(*end)
+            *end++ = '\0';
+        emit(a, &prefix, 1);
+        return assemble_instruction(a, next, end);
+    }
+
+    char* texts[ASM_MAX_OPERANDS];
+    ASMOperand_T ops[ASM_MAX_OPERANDS];
+    u32 num_ops = split_args(args, texts, ASM_MAX_OPERANDS);
+    if(num_ops > ASM_MAX_OPERANDS)
+        return false;
+    for(u32 i = 0; i < num_ops; i++)
+        if(!parse_operand(a, texts[i], &ops[i]))
+            return false;
+
+    // jumps to labels get relaxed after all labels are known
+    i32 cond = -1;
+    if(num_ops == 1 && is_label_target(&ops[0]) &&
+        (strcmp(mnemonic, "jmp") == 0 || (mnemonic[0] == 'j' && (cond = asm_condition_code(mnemonic + 1)) >= 0)))
+    {
+        ASMFrag_T* frag = emit_variable(a, FRAG_JUMP);
+        frag->cond = cond;
+        frag->target = ops[0].value;
+        return true;
+    }
+
+    ASMInstr_T instr;
+    if(!asm_encode(mnemonic, ops, num_ops, &instr))
+        return false;
+    for(u8 i = 0; i < instr.num_fixups; i++)
+        add_fixup(a, &instr.fixups[i], instr.fixups[i].offset);
+    emit(a, instr.bytes, instr.len);
+    return true;
+}
+
+static bool define_label(Assembler_T* a, char* name)
+{
+    ASMSymbol_T* sym = get_symbol(a, name);
+    if(sym->section)
+        return false;
+    sym->section = a->section;
+    sym->frag = current_frag(a->section);
+    sym->offset = sym->frag->len;
+    return true;
+}
+
+static bool assemble_statement(Assembler_T* a, char* stmt)
+{
+    char* p = skip_spaces(stmt);
+
+    // labels
+    for(;;)
+    {
+        char* end = p;
+        char* name = parse_name(&end);
+        if(!name || *skip_spaces(end) != ':')
+            break;
+        char* next = skip_spaces(end) + 1;
+        *end = '\0';
+        if(!define_label(a, name))
+            return false;
+        p = skip_spaces(next);
+    }
+
+    if(!*p)
+        return true;
+
+    char* name = p;
+    while(*p && !isspace(*p))
+        p++;
+    if(*p)
+        *p++ = '\0';
+
+    // trailing whitespace
+    char* args = skip_spaces(p);
+    size_t len = strlen(args);
+    while(len && isspace(args[len - 1]))
+        args[--len] = '\0';
+
+    if(*name == '.')
+        return assemble_directive(a, name, args);
+    return assemble_instruction(a, name, args);
+}
+
+// splits a line at `;` and removes `#` comments
+static bool assemble_line(Assembler_T* a, char* line)
+{
+    char* stmt = line;
+    bool in_string = false;
+    for(char* p = line; ; p++)
+    {
+        if(in_string)
+        {
+            if(!*p)
+                return false;
+            if(*p == '\\' && p[1])
+                p++;
+            else if(*p == '"')
+                in_string = false;
+            continue;
+        }
+
+        if(*p == '"')
+            in_string = true;
+        else if(*p == '#' || *p == ';' || !*p)
+        {
+            bool end = *p != ';';
+            *p = '\0';
+            if(!assemble_statement(a, stmt))
+                return false;
+            if(end)
+                return true;
+            stmt = p + 1;
+        }
+    }
+}
+
+// layout
+
+static bool is_resolved_jump(ASMSection_T* section, ASMFrag_T* frag)
+{
+    ASMSymbol_T* sym = frag->target.sym;
+    return sym->section == section && !sym->global;
+}
+
+static u64 variable_size(ASMFrag_T* frag, u64 address)
+{
+    switch(frag->kind)
+    {
+        case FRAG_JUMP:
+            return frag->is_near ? (frag->cond < 0 ? 5 : 6) : 2;
+        case FRAG_ALIGN:
+            return align_to(address, frag->align) - address;
+        default:
+            return 0;
+    }
+}
+
+// jumps start out short and get widened until all of them reach their target
+static void layout_section(ASMSection_T* section)
+{
+    for(size_t i = 0; i < section->frags->size; i++)
+    {
+        ASMFrag_T* frag = section->frags->items[i];
+        if(frag->kind == FRAG_JUMP)
+            frag->is_near = !is_resolved_jump(section, frag);
+    }
+
+    bool changed;
+    do {
+        u64 address = 0;
+        for(size_t i = 0; i < section->frags->size; i++)
+        {
+            ASMFrag_T* frag = section->frags->items[i];
+            frag->address = address;
+            address += frag->len;
+            address += variable_size(frag, address);
+        }
+        section->size = address;
+
+        changed = false;
+        for(size_t i = 0; i < section->frags->size; i++)
+        {
+            ASMFrag_T* frag = section->frags->items[i];
+            if(frag->kind != FRAG_JUMP || frag->is_near)
+                continue;
+            i64 disp = asm_symbol_address(frag->target.sym) + frag->target.addend - (frag->address + frag->len + 2);
+            if(disp < INT8_MIN || disp > INT8_MAX)
+                changed = frag->is_near = true;
+        }
+    } while(changed);
+}
+
+// relocations against local symbols use their section instead. In mergeable sections, this
+// only works without an addend, otherwise the linker could not tell which string is meant.
+static void add_reloc(ASMSection_T* section, u64 offset, ASMSymbol_T* sym, u32 type, i64 addend)
+{
+    ASMReloc_T* reloc = malloc(sizeof(ASMReloc_T));
+    reloc->offset = offset;
+    reloc->type = type;
+    if(sym->section && !sym->global && (!(sym->section->flags & SHF_MERGE) || !addend))
+    {
+        reloc->sym = sym->section->symbol;
+        reloc->addend = addend + asm_symbol_address(sym);
+    }
+    else
+    {
+        reloc->sym = sym;
+        reloc->addend = addend;
+    }
+    reloc->sym->referenced = true;
+    list_push(section->relocs, reloc);
+}
+
+static void put_nops(ASMBuffer_T* out, u64 count)
+{
+    static const u8 nops[][9] = {
+        {0x90},
+        {0x66, 0x90},
+        {0x0f, 0x1f, 0x00},
+        {0x0f, 0x1f, 0x40, 0x00},
+        {0x0f, 0x1f, 0x44, 0x00, 0x00},
+        {0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00},
+        {0x0f, 0x1f, 0x80, 0x00, 0x00, 0x00, 0x00},
+        {0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+        {0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+    };
+
+    while(count)
+    {
+        u64 n = MIN(count, LEN(nops));
+        asm_buffer_put(out, nops[n - 1], n);
+        count -= n;
+    }
+}
+
+// writes the final contents of a section, with all jumps and padding
+static void finish_section(ASMSection_T* section)
+{
+    ASMBuffer_T out = {0};
+    for(size_t i = 0; i < section->frags->size; i++)
+    {
+        ASMFrag_T* frag = section->frags->items[i];
+        asm_buffer_put(&out, section->data.data + frag->start, frag->len);
+        frag->start = out.size - frag->len;
+
+        u64 end = frag->address + frag->len;
+        u64 size = variable_size(frag, end);
+        if(frag->kind == FRAG_ALIGN)
+        {
+            if(section->flags & SHF_EXECINSTR)
+                put_nops(&out, size);
+            else
+                asm_buffer_put(&out, NULL, size);
+        }
+        else if(frag->kind == FRAG_JUMP)
+        {
+            u8 opcode_len = size - (frag->is_near ? 4 : 1);
+            if(!frag->is_near)
+                asm_buffer_put_int(&out, frag->cond < 0 ? 0xeb : 0x70 + frag->cond, 1);
+            else if(frag->cond < 0)
+                asm_buffer_put_int(&out, 0xe9, 1);
+            else
+                asm_buffer_put(&out, (u8[]){0x0f, 0x80 + frag->cond}, 2);
+
+            ASMSymbol_T* target = frag->target.sym;
+            if(is_resolved_jump(section, frag))
+            {
+                i64 disp = asm_symbol_address(target) + frag->target.addend - (end + size);
+                asm_buffer_put_int(&out, disp, frag->is_near ? 4 : 1);
+            }
+            else
+            {
+                add_reloc(section, end + opcode_len, target, target->section && !target->global ? R_X86_64_PC32 : R_X86_64_PLT32, frag->target.addend - 4);
+                asm_buffer_put(&out, NULL, 4);
+            }
+        }
+    }
+
+    free(section->data.data);
+    section->data = out;
+}
+
+static bool resolve_value(ASMValue_T* value, i64* result)
+{
+    *result = value->addend;
+    if(value->sub)
+    {
+        if(!value->sym || !value->sym->section || value->sym->section != value->sub->section)
+            return false;
+        *result += asm_symbol_address(value->sym) - asm_symbol_address(value->sub);
+        return true;
+    }
+    return !value->sym;
+}
+
+static bool apply_fixups(ASMSection_T* section)
+{
+    for(size_t i = 0; i < section->fixups->size; i++)
+    {
+        ASMFixup_T* fixup = section->fixups->items[i];
+        u64 offset = fixup->frag->address + fixup->offset;
+        ASMSymbol_T* sym = fixup->value.sym;
+
+        i64 value;
+        if(sym && !sym->section && is_local_label(sym))
+            return false;
+        if(fixup->pcrel && sym && !fixup->value.sub && sym->section == section && !sym->global)
+            value = asm_symbol_address(sym) + fixup->value.addend - (offset + fixup->bias);
+        else if(!resolve_value(&fixup->value, &value))
+        {
+            if(fixup->value.sub)
+                return false;
+            add_reloc(section, offset, sym, fixup->reloc_type, fixup->value.addend - fixup->bias);
+            continue;
+        }
+
+        // frags were moved to their final offsets by finish_section()
+        u8* field = section->data.data + fixup->frag->start + fixup->offset;
+        for(u8 j = 0; j < fixup->size; j++)
+            field[j] = value >> (j * 8);
+    }
+    return true;
+}
+
+// DWARF
+
+static ASMSection_T* new_debug_section(Assembler_T* a, const char* name)
+{
+    ASMSection_T* section = get_section(a, name);
+    section->flags = 0;
+    a->section = section;
+    return section;
+}
+
+static void emit_int(Assembler_T* a, u64 value, size_t size)
+{
+    u8 bytes[8];
+    for(size_t i = 0; i < size; i++)
+        bytes[i] = value >> (i * 8);
+    emit(a, bytes, size);
+}
+
+static void emit_uleb(Assembler_T* a, u64 value)
+{
+    size_t before = a->section->data.size;
+    asm_buffer_put_uleb(&a->section->data, value);
+    current_frag(a->section)->len += a->section->data.size - before;
+}
+
+static void emit_sleb(Assembler_T* a, i64 value)
+{
+    size_t before = a->section->data.size;
+    asm_buffer_put_sleb(&a->section->data, value);
+    current_frag(a->section)->len += a->section->data.size - before;
+}
+
+static void emit_string(Assembler_T* a, const char* str)
+{
+    emit(a, str, strlen(str) + 1);
+}
+
+static void emit_address(Assembler_T* a, ASMSymbol_T* sym, i64 addend, size_t size)
+{
+    ASMFixup_T fixup = {
+        .size = size,
+        .reloc_type = size == 8 ? R_X86_64_64 : R_X86_64_32,
+        .value = {.sym = sym, .addend = addend}
+    };
+    add_fixup(a, &fixup, 0);
+    emit(a, NULL, size);
+}
+
+static void patch_u32(Assembler_T* a, size_t at, u32 value)
+{
+    for(u8 i = 0; i < 4; i++)
+        a->section->data.data[at + i] = value >> (i * 8);
+}
+
+static void gen_line_program(Assembler_T* a, ASMSection_T* section)
+{
+    u32 file = 1, line = 1;
+    u64 address = 0;
+    bool started = false;
+
+    for(size_t i = 0; i < a->locs->size; i++)
+    {
+        ASMLoc_T* loc = a->locs->items[i];
+        if(loc->section != section)
+            continue;
+
+        u64 loc_address = loc->frag->address + loc->offset;
+        if(!started)
+        {
+            emit_int(a, 0, 1);
+            emit_uleb(a, 9);
+            emit_int(a, DW_LNE_set_address, 1);
+            emit_address(a, section->symbol, loc_address, 8);
+            address = loc_address;
+            started = true;
+        }
+
+        if(loc->file != file)
+        {
+            emit_int(a, DW_LNS_set_file, 1);
+            emit_uleb(a, loc->file);
+            file = loc->file;
+        }
+
+        i64 line_delta = (i64) loc->line - line;
+        u64 address_delta = loc_address - address;
+        if(line_delta < LINE_BASE || line_delta >= LINE_BASE + LINE_RANGE)
+        {
+            emit_int(a, DW_LNS_advance_line, 1);
+            emit_sleb(a, line_delta);
+            line_delta = 0;
+        }
+
+        u64 opcode = (line_delta - LINE_BASE) + LINE_RANGE * address_delta + OPCODE_BASE;
+        if(opcode > 255)
+        {
+            emit_int(a, DW_LNS_advance_pc, 1);
+            emit_uleb(a, address_delta);
+            opcode = (line_delta - LINE_BASE) + OPCODE_BASE;
+        }
+        emit_int(a, opcode, 1);
+
+        line = loc->line;
+        address = loc_address;
+    }
+
+    emit_int(a, DW_LNS_advance_pc, 1);
+    emit_uleb(a, section->size - address);
+    emit_int(a, 0, 1);
+    emit_uleb(a, 1);
+    emit_int(a, DW_LNE_end_sequence, 1);
+}
+
+// builds .debug_line, .debug_info and .debug_abbrev from the `.file` and `.loc` directives
+static bool gen_debug_info(Assembler_T* a)
+{
+    List_T* sections = init_list();
+    for(size_t i = 0; i < a->locs->size; i++)
+    {
+        ASMLoc_T* loc = a->locs->items[i];
+        if(loc->file > a->files->size || !a->files->items[loc->file - 1])
+        {
+            free_list(sections);
+            return false;
+        }
+        if(!list_contains(sections, loc->section))
+            list_push(sections, loc->section);
+    }
+
+    // .debug_line
+    ASMSection_T* line_section = new_debug_section(a, ".debug_line");
+    emit_int(a, 0, 4);
+    emit_int(a, 4, 2);
+    size_t header_length_at = a->section->data.size;
+    emit_int(a, 0, 4);
+    emit(a, (u8[]){1, 1, 1, (u8) LINE_BASE, LINE_RANGE, OPCODE_BASE}, 6);
+    emit(a, (u8[]){0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1}, OPCODE_BASE - 1);
+    emit_int(a, 0, 1);
+    for(size_t i = 0; i < a->files->size; i++)
+    {
+        char* name = a->files->items[i];
+        emit_string(a, name ? name : "");
+        emit_uleb(a, 0);
+        emit_uleb(a, 0);
+        emit_uleb(a, 0);
+    }
+    emit_int(a, 0, 1);
+    patch_u32(a, header_length_at, a->section->data.size - header_length_at - 4);
+
+    for(size_t i = 0; i < sections->size; i++)
+        gen_line_program(a, sections->items[i]);
+    patch_u32(a, 0, a->section->data.size - 4);
+
+    // .debug_ranges, if the code is spread over multiple sections
+    ASMSection_T* ranges_section = NULL;
+    if(sections->size > 1)
+    {
+        ranges_section = new_debug_section(a, ".debug_ranges");
+        for(size_t i = 0; i < sections->size; i++)
+        {
+            ASMSection_T* section = sections->items[i];
+            emit_address(a, section->symbol, 0, 8);
+            emit_address(a, section->symbol, section->size, 8);
+        }
+        emit(a, NULL, 16);
+    }
+
+    // .debug_abbrev
+    ASMSection_T* abbrev_section = new_debug_section(a, ".debug_abbrev");
+    emit_uleb(a, 1);
+    emit_uleb(a, DW_TAG_compile_unit);
+    emit_int(a, DW_CHILDREN_no, 1);
+    emit_uleb(a, DW_AT_stmt_list);
+    emit_uleb(a, DW_FORM_sec_offset);
+    if(ranges_section)
+    {
+        emit_uleb(a, DW_AT_low_pc);
+        emit_uleb(a, DW_FORM_addr);
+        emit_uleb(a, DW_AT_ranges);
+        emit_uleb(a, DW_FORM_sec_offset);
+    }
+    else if(sections->size)
+    {
+        emit_uleb(a, DW_AT_low_pc);
+        emit_uleb(a, DW_FORM_addr);
+        emit_uleb(a, DW_AT_high_pc);
+        emit_uleb(a, DW_FORM_data8);
+    }
+    emit(a, (u8[]){DW_AT_name, DW_FORM_string, DW_AT_comp_dir, DW_FORM_string, DW_AT_producer, DW_FORM_string}, 6);
+    emit(a, (u8[]){DW_AT_language, DW_FORM_data2, 0, 0, 0}, 5);
+
+    // .debug_info
+    char comp_dir[BUFSIZ];
+    if(!getcwd(comp_dir, sizeof(comp_dir)))
+        comp_dir[0] = '\0';
+
+    new_debug_section(a, ".debug_info");
+    emit_int(a, 0, 4);
+    emit_int(a, 4, 2);
+    emit_address(a, abbrev_section->symbol, 0, 4);
+    emit_int(a, 8, 1);
+    emit_uleb(a, 1);
+    emit_address(a, line_section->symbol, 0, 4);
+    if(ranges_section)
+    {
+        emit_int(a, 0, 8);
+        emit_address(a, ranges_section->symbol, 0, 4);
+    }
+    else if(sections->size)
+    {
+        ASMSection_T* text = sections->items[0];
+        emit_address(a, text->symbol, 0, 8);
+        emit_int(a, text->size, 8);
+    }
+    emit_string(a, a->files->size && a->files->items[0] ? a->files->items[0] : EITHER(a->obj.file_name, ""));
+    emit_string(a, comp_dir);
+    emit_string(a, "CSpydr");
+    emit_int(a, DW_LANG_Mips_Assembler, 2);
+    patch_u32(a, 0, a->section->data.size - 4);
+
+    free_list(sections);
+    return true;
+}
+
+// driver
+
+static void free_assembler(Assembler_T* a)
+{
+    for(size_t i = 0; i < a->obj.sections->size; i++)
+    {
+        ASMSection_T* section = a->obj.sections->items[i];
+        for(size_t j = 0; j < section->frags->size; j++)
+            free(section->frags->items[j]);
+        for(size_t j = 0; j < section->fixups->size; j++)
+            free(section->fixups->items[j]);
+        for(size_t j = 0; j < section->relocs->size; j++)
+            free(section->relocs->items[j]);
+        free_list(section->frags);
+        free_list(section->fixups);
+        free_list(section->relocs);
+        free(section->data.data);
+        free(section->name);
+        free(section);
+    }
+
+    for(size_t i = 0; i < a->obj.symbols->size; i++)
+    {
+        ASMSymbol_T* sym = a->obj.symbols->items[i];
+        free(sym->name);
+        free(sym);
+    }
+
+    for(size_t i = 0; i < a->files->size; i++)
+        free(a->files->items[i]);
+    for(size_t i = 0; i < a->locs->size; i++)
+        free(a->locs->items[i]);
+
+    free_list(a->obj.sections);
+    free_list(a->obj.symbols);
+    hashmap_free(a->obj.symbol_map);
+    free_list(a->files);
+    free_list(a->locs);
+    free(a->obj.file_name);
+}
+
+static bool assemble(Assembler_T* a, const char* code, size_t len)
+{
+    a->section = get_section(a, ".text");
+    get_section(a, ".data");
+    get_section(a, ".bss");
+
+    char* line = NULL;
+    size_t line_size = 0;
+    for(const char* start = code, *end = code + len; start < end;)
+    {
+        const char* newline = memchr(start, '\n', end - start);
+        size_t line_len = (newline ? newline : end) - start;
+        if(line_len + 1 > line_size)
+            line = realloc(line, line_size = line_len + 1);
+        memcpy(line, start, line_len);
+        line[line_len] = '\0';
+
+        if(!assemble_line(a, line))
+        {
+            free(line);
+            return false;
+        }
+        start += line_len + 1;
+    }
+    free(line);
+
+    size_t num_code_sections = a->obj.sections->size;
+    for(size_t i = 0; i < num_code_sections; i++)
+        layout_section(a->obj.sections->items[i]);
+
+    if(a->locs->size && !gen_debug_info(a))
+        return false;
+
+    for(size_t i = 0; i < a->obj.sections->size; i++)
+    {
+        ASMSection_T* section = a->obj.sections->items[i];
+        if(i >= num_code_sections)
+            layout_section(section);
+        finish_section(section);
+        if(!apply_fixups(section))
+            return false;
+    }
+
+    // sizes of symbols
+    for(size_t i = 0; i < a->obj.symbols->size; i++)
+    {
+        ASMSymbol_T* sym = a->obj.symbols->items[i];
+        i64 size;
+        if(sym->has_size && !resolve_value(&sym->size, &size))
+            return false;
+        if(!sym->section && sym->has_size)
+            return false;
+    }
+    return true;
+}
+
+bool asm_assemble(Context_T* context, const char* code, size_t len, const char* obj_file)
+{
+    Assembler_T a = {
+        .obj = {
+            .sections = init_list(),
+            .symbols = init_list(),
+            .symbol_map = hashmap_init()
+        },
+        .files = init_list(),
+        .locs = init_list()
+    };
+
+    bool ok = assemble(&a, code, len) && asm_write_elf(&a.obj, obj_file);
+    free_assembler(&a);
+    return ok;
+}
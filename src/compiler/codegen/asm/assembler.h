@@ -0,0 +1,178 @@
+#ifndef CSPYDR_ASSEMBLER_H
+#define CSPYDR_ASSEMBLER_H
+
+#include "context.h"
+#include "hashmap.h"
+#include "list.h"
+#include "util.h"
+
+// The integrated assembler turns the code of the assembly backend into a
+// relocatable x86_64 ELF object without running an external assembler.
+// It understands the subset of the GNU assembler syntax the code generator
+// emits, including `.file`/`.loc`, from which DWARF line tables get built.
+//
+// `asm_assemble()` returns false without writing anything if the code uses
+// something unsupported (e.g. unknown instructions in inline assembly). The
+// caller then falls back to the external assembler.
+
+bool asm_assemble(Context_T* context, const char* code, size_t len, const char* obj_file);
+
+// internals, shared between assembler.c, x86_64_encoder.c and elf_writer.c
+
+typedef struct ASM_SYMBOL_STRUCT  ASMSymbol_T;
+typedef struct ASM_SECTION_STRUCT ASMSection_T;
+typedef struct ASM_FRAG_STRUCT    ASMFrag_T;
+
+typedef struct ASM_BUFFER_STRUCT {
+    u8* data;
+    size_t size;
+    size_t allocated;
+} ASMBuffer_T;
+
+void asm_buffer_put(ASMBuffer_T* buf, const void* data, size_t size);
+void asm_buffer_put_int(ASMBuffer_T* buf, u64 value, size_t size);
+void asm_buffer_put_uleb(ASMBuffer_T* buf, u64 value);
+void asm_buffer_put_sleb(ASMBuffer_T* buf, i64 value);
+
+// `sym - sub + addend`, both symbols are optional
+typedef struct ASM_VALUE_STRUCT {
+    ASMSymbol_T* sym;
+    ASMSymbol_T* sub;
+    i64 addend;
+} ASMValue_T;
+
+struct ASM_SYMBOL_STRUCT {
+    char* name;
+    ASMSection_T* section; // NULL while undefined
+    ASMFrag_T* frag;
+    size_t offset;         // offset into `frag`
+    u8 type;               // STT_*
+    bool global     : 1;
+    bool has_size   : 1;
+    bool referenced : 1; // by a relocation
+    ASMValue_T size;
+    u32 index;             // symbol table index, 0 if not in the symbol table
+};
+
+typedef enum ASM_FRAG_KIND_ENUM {
+    FRAG_FIXED,
+    FRAG_JUMP,  // jmp/jcc to a label, short or near
+    FRAG_ALIGN, // padding up to `align`
+} ASMFragKind_T;
+
+// A fragment is a run of fixed bytes, followed by a part of variable size.
+struct ASM_FRAG_STRUCT {
+    ASMFragKind_T kind;
+    size_t start;   // fixed bytes in the section's data
+    size_t len;
+    u64 address;
+
+    // FRAG_JUMP
+    i32 cond;       // condition code, -1 for jmp
+    ASMValue_T target;
+    bool is_near;
+
+    // FRAG_ALIGN
+    u64 align;
+};
+
+typedef struct ASM_FIXUP_STRUCT {
+    ASMFrag_T* frag;
+    size_t offset;  // offset into the fixed bytes of `frag`
+    u8 size;
+    bool pcrel;
+    u8 bias;        // pc-relative: distance from the field to the end of the instruction
+    u32 reloc_type; // R_X86_64_*
+    ASMValue_T value;
+} ASMFixup_T;
+
+typedef struct ASM_RELOC_STRUCT {
+    u64 offset;
+    ASMSymbol_T* sym;
+    u32 type;
+    i64 addend;
+} ASMReloc_T;
+
+struct ASM_SECTION_STRUCT {
+    char* name;
+    u32 type;       // SHT_*
+    u64 flags;      // SHF_*
+    u64 entsize;
+    u64 align;
+    ASMBuffer_T data;
+    List_T* frags;  // list of ASMFrag_Ts
+    List_T* fixups; // list of ASMFixup_Ts
+    List_T* relocs; // list of ASMReloc_Ts, filled after layout
+    u64 size;
+    ASMSymbol_T* symbol;
+    u32 index;
+};
+
+typedef struct ASM_OBJECT_STRUCT {
+    List_T* sections; // list of ASMSection_Ts
+    List_T* symbols;  // list of ASMSymbol_Ts, in order of their creation
+    HashMap_T* symbol_map;
+    char* file_name;  // from `.file "name"`
+} ASMObject_T;
+
+u64 asm_symbol_address(ASMSymbol_T* sym);
+
+// x86_64_encoder.c
+
+typedef enum ASM_OPERAND_KIND_ENUM {
+    OPND_REG,
+    OPND_IMM,
+    OPND_MEM,
+} ASMOperandKind_T;
+
+typedef enum ASM_REG_CLASS_ENUM {
+    REG_GPR,
+    REG_XMM,
+    REG_YMM,
+    REG_ST,
+} ASMRegClass_T;
+
+typedef struct ASM_OPERAND_STRUCT {
+    ASMOperandKind_T kind;
+    bool indirect; // `*` of jmp/call
+
+    // OPND_REG
+    ASMRegClass_T cls;
+    u8 reg;
+    u8 size;
+    bool high_byte; // %ah, %ch, %dh, %bh
+    bool byte_rex;  // %spl, %bpl, %sil, %dil
+
+    // OPND_MEM
+    i8 base;        // -1 if none
+    i8 index;       // -1 if none
+    u8 scale;
+    bool rip;
+    u8 segment;     // segment override prefix, 0 if none
+
+    // OPND_IMM: the value, OPND_MEM: the displacement
+    ASMValue_T value;
+} ASMOperand_T;
+
+#define ASM_MAX_OPERANDS 3
+#define ASM_MAX_FIXUPS 2
+
+typedef struct ASM_INSTR_STRUCT {
+    u8 bytes[24];
+    u8 len;
+    ASMFixup_T fixups[ASM_MAX_FIXUPS]; // offsets relative to the instruction
+    u8 num_fixups;
+} ASMInstr_T;
+
+// condition code of a `j`, `set` or `cmov` suffix, -1 if invalid
+i32 asm_condition_code(const char* suffix);
+
+// encodes a single instruction, false if it's unsupported. Jumps to labels are
+// handled by the caller.
+bool asm_encode(const char* mnemonic, ASMOperand_T* ops, u32 num_ops, ASMInstr_T* out);
+
+// elf_writer.c
+
+bool asm_write_elf(ASMObject_T* obj, const char* path);
+
+#endif
@@ -0,0 +1,247 @@
+#include "assembler.h"
+
+#include <elf.h>
+#include <stdio.h>
+#include <string.h>
+
+static u32 put_name(ASMBuffer_T* strtab, const char* name)
+{
+    u32 offset = strtab->size;
+    asm_buffer_put(strtab, name, strlen(name) + 1);
+    return offset;
+}
+
+static void put_symbol(ASMBuffer_T* symtab, ASMBuffer_T* strtab, ASMSymbol_T* sym, u8 bind, u8 type, u16 shndx, u64 value, u64 size)
+{
+    Elf64_Sym entry = {
+        .st_name = sym && type != STT_SECTION ? put_name(strtab, sym->name) : 0,
+        .st_info = ELF64_ST_INFO(bind, type),
+        .st_shndx = shndx,
+        .st_value = value,
+        .st_size = size
+    };
+    asm_buffer_put(symtab, &entry, sizeof(Elf64_Sym));
+}
+
+// symbol table order: file, sections, local symbols, global symbols
+static void build_symtab(ASMObject_T* obj, ASMBuffer_T* symtab, ASMBuffer_T* strtab, u32* first_global)
+{
+    u32 count = 0;
+    put_symbol(symtab, strtab, NULL, STB_LOCAL, STT_NOTYPE, SHN_UNDEF, 0, 0);
+    count++;
+    asm_buffer_put(strtab, NULL, 1);
+
+    if(obj->file_name)
+    {
+        Elf64_Sym file = {
+            .st_name = put_name(strtab, obj->file_name),
+            .st_info = ELF64_ST_INFO(STB_LOCAL, STT_FILE),
+            .st_shndx = SHN_ABS
+        };
+        asm_buffer_put(symtab, &file, sizeof(Elf64_Sym));
+        count++;
+    }
+
+    for(size_t i = 0; i < obj->sections->size; i++)
+    {
+        ASMSection_T* section = obj->sections->items[i];
+        if(!section->symbol->referenced)
+            continue;
+        section->symbol->index = count++;
+        put_symbol(symtab, strtab, section->symbol, STB_LOCAL, STT_SECTION, section->index, 0, 0);
+    }
+
+    *first_global = count;
+    for(bool global = false; ; global = true)
+    {
+        if(global)
+            *first_global = count;
+
+        for(size_t i = 0; i < obj->symbols->size; i++)
+        {
+            ASMSymbol_T* sym = obj->symbols->items[i];
+            if(sym->type == STT_SECTION || (strncmp(sym->name, ".L", 2) == 0 && !(sym->section && sym->referenced)))
+                continue;
+
+            bool is_global = sym->global || !sym->section;
+            if(is_global != global)
+                continue;
+
+            i64 size = 0;
+            if(sym->has_size)
+            {
+                size = sym->size.addend;
+                if(sym->size.sym)
+                    size += asm_symbol_address(sym->size.sym) - asm_symbol_address(sym->size.sub);
+            }
+
+            sym->index = count++;
+            put_symbol(symtab, strtab, sym, is_global ? STB_GLOBAL : STB_LOCAL, sym->type,
+                sym->section ? sym->section->index : SHN_UNDEF, sym->section ? asm_symbol_address(sym) : 0, size);
+        }
+
+        if(global)
+            return;
+    }
+}
+
+static void put_padding(ASMBuffer_T* out, u64 align)
+{
+    asm_buffer_put(out, NULL, align_to(out->size, align) - out->size);
+}
+
+bool asm_write_elf(ASMObject_T* obj, const char* path)
+{
+    // section indices, every section with relocations is followed by its .rela section
+    u32 num_sections = 1;
+    for(size_t i = 0; i < obj->sections->size; i++)
+    {
+        ASMSection_T* section = obj->sections->items[i];
+        section->index = num_sections++;
+        if(section->relocs->size)
+            num_sections++;
+    }
+    u32 symtab_index = num_sections++;
+    u32 strtab_index = num_sections++;
+    u32 shstrtab_index = num_sections++;
+
+    ASMBuffer_T symtab = {0}, strtab = {0};
+    u32 first_global;
+    build_symtab(obj, &symtab, &strtab, &first_global);
+
+    // every relocation needs a symbol in the symbol table
+    for(size_t i = 0; i < obj->sections->size; i++)
+    {
+        ASMSection_T* section = obj->sections->items[i];
+        for(size_t j = 0; j < section->relocs->size; j++)
+        {
+            if(!((ASMReloc_T*) section->relocs->items[j])->sym->index)
+            {
+                free(symtab.data);
+                free(strtab.data);
+                return false;
+            }
+        }
+    }
+
+    ASMBuffer_T out = {0};
+    ASMBuffer_T shstrtab = {0};
+    Elf64_Shdr* headers = calloc(num_sections, sizeof(Elf64_Shdr));
+    asm_buffer_put(&shstrtab, NULL, 1);
+    asm_buffer_put(&out, NULL, sizeof(Elf64_Ehdr));
+
+    for(size_t i = 0; i < obj->sections->size; i++)
+    {
+        ASMSection_T* section = obj->sections->items[i];
+        Elf64_Shdr* header = &headers[section->index];
+
+        // ".rela.x" and ".x" share their names
+        u32 name = shstrtab.size;
+        if(section->relocs->size)
+        {
+            asm_buffer_put(&shstrtab, ".rela", 5);
+            name += 5;
+        }
+        put_name(&shstrtab, section->name);
+
+        if(section->type != SHT_NOBITS)
+            put_padding(&out, section->align);
+        header->sh_name = name;
+        header->sh_type = section->type;
+        header->sh_flags = section->flags;
+        header->sh_offset = out.size;
+        header->sh_size = section->size;
+        header->sh_addralign = section->align;
+        header->sh_entsize = section->entsize;
+        if(section->type != SHT_NOBITS)
+            asm_buffer_put(&out, section->data.data, section->size);
+
+        if(!section->relocs->size)
+            continue;
+
+        put_padding(&out, 8);
+        Elf64_Shdr* rela = &headers[section->index + 1];
+        rela->sh_name = name - 5;
+        rela->sh_type = SHT_RELA;
+        rela->sh_flags = SHF_INFO_LINK;
+        rela->sh_offset = out.size;
+        rela->sh_size = section->relocs->size * sizeof(Elf64_Rela);
+        rela->sh_link = symtab_index;
+        rela->sh_info = section->index;
+        rela->sh_addralign = 8;
+        rela->sh_entsize = sizeof(Elf64_Rela);
+
+        for(size_t j = 0; j < section->relocs->size; j++)
+        {
+            ASMReloc_T* reloc = section->relocs->items[j];
+            Elf64_Rela entry = {
+                .r_offset = reloc->offset,
+                .r_info = ELF64_R_INFO(reloc->sym->index, reloc->type),
+                .r_addend = reloc->addend
+            };
+            asm_buffer_put(&out, &entry, sizeof(Elf64_Rela));
+        }
+    }
+
+    put_padding(&out, 8);
+    headers[symtab_index] = (Elf64_Shdr){
+        .sh_name = put_name(&shstrtab, ".symtab"),
+        .sh_type = SHT_SYMTAB,
+        .sh_offset = out.size,
+        .sh_size = symtab.size,
+        .sh_link = strtab_index,
+        .sh_info = first_global,
+        .sh_addralign = 8,
+        .sh_entsize = sizeof(Elf64_Sym)
+    };
+    asm_buffer_put(&out, symtab.data, symtab.size);
+
+    headers[strtab_index] = (Elf64_Shdr){
+        .sh_name = put_name(&shstrtab, ".strtab"),
+        .sh_type = SHT_STRTAB,
+        .sh_offset = out.size,
+        .sh_size = strtab.size,
+        .sh_addralign = 1
+    };
+    asm_buffer_put(&out, strtab.data, strtab.size);
+
+    headers[shstrtab_index] = (Elf64_Shdr){
+        .sh_name = put_name(&shstrtab, ".shstrtab"),
+        .sh_type = SHT_STRTAB,
+        .sh_offset = out.size,
+        .sh_addralign = 1
+    };
+    headers[shstrtab_index].sh_size = shstrtab.size;
+    asm_buffer_put(&out, shstrtab.data, shstrtab.size);
+
+    put_padding(&out, 8);
+    u64 headers_offset = out.size;
+    asm_buffer_put(&out, headers, num_sections * sizeof(Elf64_Shdr));
+
+    Elf64_Ehdr* ehdr = (Elf64_Ehdr*) out.data;
+    memcpy(ehdr->e_ident, ELFMAG, SELFMAG);
+    ehdr->e_ident[EI_CLASS] = ELFCLASS64;
+    ehdr->e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr->e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr->e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    ehdr->e_type = ET_REL;
+    ehdr->e_machine = EM_X86_64;
+    ehdr->e_version = EV_CURRENT;
+    ehdr->e_shoff = headers_offset;
+    ehdr->e_ehsize = sizeof(Elf64_Ehdr);
+    ehdr->e_shentsize = sizeof(Elf64_Shdr);
+    ehdr->e_shnum = num_sections;
+    ehdr->e_shstrndx = shstrtab_index;
+
+    FILE* file = fopen(path, "wb");
+    bool ok = file && fwrite(out.data, 1, out.size, file) == out.size;
+    if(file)
+        ok = !fclose(file) && ok;
+
+    free(headers);
+    free(out.data);
+    free(symtab.data);
+    free(strtab.data);
+    free(shstrtab.data);
+    return ok;
+}
@@ -71,6 +71,10 @@ static int link_exec(Context_T* context, const char* target, char* obj_file) {
             break;
     }
 
+    // drops the sections of unused functions and globals, see asm_gen_section()
+    if(context->flags.lto)
+        list_push(args, "--gc-sections");
+
     for(size_t i = 0; i < context->link_mode.extra->size; i++)
         list_push(args, context->link_mode.extra->items[i]);
 
@@ -101,6 +105,10 @@ static int link_lib(Context_T* context, const char* target, char* obj_file)
     if(context->link_mode.mode == LINK_STATIC)
         list_push(args, "-static");
 
+    // drops the sections of unused functions and globals, see asm_gen_section()
+    if(context->flags.lto)
+        list_push(args, "--gc-sections");
+
     for(size_t i = 0; i < context->link_mode.extra->size; i++)
         list_push(args, context->link_mode.extra->items[i]);
 
@@ -0,0 +1,964 @@
+#include "peephole.h"
+#include "hashmap.h"
+#include "util.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_OPERANDS 3
+#define MAX_ROUNDS 8
+#define MAX_THREADING 16
+
+typedef enum ASM_LINE_KIND_ENUM
+{
+    LINE_INSTR,
+    LINE_LABEL,
+    LINE_LOC,
+    LINE_DIRECTIVE,
+    LINE_OPAQUE, // multiple instructions in one line, never touched
+} ASMLineKind_T;
+
+typedef enum ASM_OP_CLASS_ENUM
+{
+    OP_UNKNOWN, // anything not listed, nothing gets moved across these
+    OP_MOVE,    // last operand = f(first operand)
+    OP_ARITH,   // last operand = last operand op first operand
+    OP_COMPARE,
+    OP_UNARY,
+    OP_SETCC,
+    OP_PUSH,
+    OP_POP,
+    OP_JMP,
+    OP_JCC,
+    OP_CALL,
+    OP_RET,
+} ASMOpClass_T;
+
+typedef enum ASM_FLAGS_ENUM
+{
+    FLAGS_NONE,
+    FLAGS_READ,
+    FLAGS_WRITE,
+    FLAGS_UNKNOWN,
+} ASMFlags_T;
+
+typedef struct ASM_EFFECT_STRUCT
+{
+    ASMOpClass_T cls;
+    ASMFlags_T flags;
+    u32 reads;  // bit set of general purpose registers
+    u32 writes;
+} ASMEffect_T;
+
+typedef struct ASM_LINE_STRUCT
+{
+    ASMLineKind_T kind;
+    char* text;
+    char* fields; // copy of `text`, which `mnemonic` and `ops` point into
+    char* mnemonic;
+    char* ops[MAX_OPERANDS];
+    u32 num_ops;
+    ASMEffect_T effect;
+    bool deleted;
+} ASMLine_T;
+
+typedef struct ASM_MNEMONIC_STRUCT
+{
+    const char* name;
+    ASMOpClass_T cls;
+    ASMFlags_T flags;
+    bool sized; // also matches with a b, w, l or q suffix
+} ASMMnemonic_T;
+
+static const ASMMnemonic_T mnemonics[] = {
+    {"mov",     OP_MOVE,    FLAGS_NONE,    true},
+    {"movabs",  OP_MOVE,    FLAGS_NONE,    true},
+    {"lea",     OP_MOVE,    FLAGS_NONE,    true},
+    {"movzbl",  OP_MOVE,    FLAGS_NONE,    false},
+    {"movzwl",  OP_MOVE,    FLAGS_NONE,    false},
+    {"movsbl",  OP_MOVE,    FLAGS_NONE,    false},
+    {"movswl",  OP_MOVE,    FLAGS_NONE,    false},
+    {"movzbq",  OP_MOVE,    FLAGS_NONE,    false},
+    {"movzwq",  OP_MOVE,    FLAGS_NONE,    false},
+    {"movsbq",  OP_MOVE,    FLAGS_NONE,    false},
+    {"movswq",  OP_MOVE,    FLAGS_NONE,    false},
+    {"movslq",  OP_MOVE,    FLAGS_NONE,    false},
+    {"movsxd",  OP_MOVE,    FLAGS_NONE,    false},
+    {"movzb",   OP_MOVE,    FLAGS_NONE,    false},
+    {"movzw",   OP_MOVE,    FLAGS_NONE,    false},
+    {"movss",   OP_MOVE,    FLAGS_NONE,    false},
+    {"movsd",   OP_MOVE,    FLAGS_NONE,    false},
+    {"add",     OP_ARITH,   FLAGS_WRITE,   true},
+    {"sub",     OP_ARITH,   FLAGS_WRITE,   true},
+    {"and",     OP_ARITH,   FLAGS_WRITE,   true},
+    {"or",      OP_ARITH,   FLAGS_WRITE,   true},
+    {"xor",     OP_ARITH,   FLAGS_WRITE,   true},
+    {"imul",    OP_ARITH,   FLAGS_WRITE,   true},
+    {"shl",     OP_ARITH,   FLAGS_UNKNOWN, true},
+    {"sal",     OP_ARITH,   FLAGS_UNKNOWN, true},
+    {"shr",     OP_ARITH,   FLAGS_UNKNOWN, true},
+    {"sar",     OP_ARITH,   FLAGS_UNKNOWN, true},
+    {"addss",   OP_ARITH,   FLAGS_NONE,    false},
+    {"addsd",   OP_ARITH,   FLAGS_NONE,    false},
+    {"subss",   OP_ARITH,   FLAGS_NONE,    false},
+    {"subsd",   OP_ARITH,   FLAGS_NONE,    false},
+    {"mulss",   OP_ARITH,   FLAGS_NONE,    false},
+    {"mulsd",   OP_ARITH,   FLAGS_NONE,    false},
+    {"divss",   OP_ARITH,   FLAGS_NONE,    false},
+    {"divsd",   OP_ARITH,   FLAGS_NONE,    false},
+    {"pxor",    OP_ARITH,   FLAGS_NONE,    false},
+    {"xorps",   OP_ARITH,   FLAGS_NONE,    false},
+    {"xorpd",   OP_ARITH,   FLAGS_NONE,    false},
+    {"cmp",     OP_COMPARE, FLAGS_WRITE,   true},
+    {"test",    OP_COMPARE, FLAGS_WRITE,   true},
+    {"ucomiss", OP_COMPARE, FLAGS_WRITE,   false},
+    {"ucomisd", OP_COMPARE, FLAGS_WRITE,   false},
+    {"comiss",  OP_COMPARE, FLAGS_WRITE,   false},
+    {"comisd",  OP_COMPARE, FLAGS_WRITE,   false},
+    {"neg",     OP_UNARY,   FLAGS_WRITE,   true},
+    {"not",     OP_UNARY,   FLAGS_NONE,    true},
+    {"inc",     OP_UNARY,   FLAGS_WRITE,   true},
+    {"dec",     OP_UNARY,   FLAGS_WRITE,   true},
+    {"push",    OP_PUSH,    FLAGS_NONE,    true},
+    {"pop",     OP_POP,     FLAGS_NONE,    true},
+    {"jmp",     OP_JMP,     FLAGS_UNKNOWN, false},
+    {"call",    OP_CALL,    FLAGS_UNKNOWN, true},
+    {"ret",     OP_RET,     FLAGS_UNKNOWN, true},
+};
+
+// mnemonics matched by their prefix
+static const ASMMnemonic_T mnemonic_prefixes[] = {
+    {"cvt",  OP_MOVE,  FLAGS_NONE, false},
+    {"set",  OP_SETCC, FLAGS_READ, false},
+    {"cmov", OP_ARITH, FLAGS_READ, false},
+    {"j",    OP_JCC,   FLAGS_READ, false},
+};
+
+#define NUM_GPRS 16
+#define RAX 0
+#define RSP 7
+#define R10 10
+#define GPR_BIT(reg) (1u << (reg))
+#define ALL_GPRS ((1u << NUM_GPRS) - 1)
+
+static const char* inverted_jumps[][2] = {
+    {"je", "jne"}, {"jz", "jnz"}, {"jl", "jge"}, {"jle", "jg"}, {"jb", "jae"}, {"jbe", "ja"}, {"js", "jns"},
+};
+
+// lines
+
+static char* strip(char* s)
+{
+    while(isspace(*s))
+        s++;
+    size_t len = strlen(s);
+    while(len && isspace(s[len - 1]))
+        s[--len] = '\0';
+    return s;
+}
+
+static void parse_fields(ASMLine_T* line)
+{
+    free(line->fields);
+    line->fields = strdup(line->text);
+    line->mnemonic = NULL;
+    line->num_ops = 0;
+
+    char* s = strip(line->fields);
+    size_t len = strlen(s);
+
+    if(!len)
+        line->kind = LINE_DIRECTIVE;
+    else if(s[len - 1] == ':' && !strpbrk(s, " \t\"'"))
+    {
+        s[len - 1] = '\0';
+        line->kind = LINE_LABEL;
+        line->mnemonic = s;
+    }
+    else if(*s == '.')
+    {
+        line->kind = strncmp(s, ".loc", 4) == 0 && isspace(s[4]) ? LINE_LOC : LINE_DIRECTIVE;
+        line->mnemonic = s;
+    }
+    else if(strpbrk(s, ";#\"'"))
+        line->kind = LINE_OPAQUE;
+    else
+    {
+        line->kind = LINE_INSTR;
+        line->mnemonic = s;
+        while(*s && !isspace(*s))
+            s++;
+        if(!*s)
+            return;
+        *s++ = '\0';
+
+        // split the operands at commas outside of parentheses
+        i32 depth = 0;
+        char* op = s;
+        for(;; s++)
+        {
+            if(*s == '(')
+                depth++;
+            else if(*s == ')')
+                depth--;
+            else if(!*s || (*s == ',' && !depth))
+            {
+                if(line->num_ops == MAX_OPERANDS)
+                {
+                    line->kind = LINE_OPAQUE;
+                    return;
+                }
+                bool end = !*s;
+                *s = '\0';
+                line->ops[line->num_ops++] = strip(op);
+                if(end)
+                    break;
+                op = s + 1;
+            }
+        }
+    }
+}
+
+static ASMEffect_T compute_effect(ASMLine_T* line);
+
+static void parse_line(ASMLine_T* line)
+{
+    parse_fields(line);
+    line->effect = compute_effect(line);
+}
+
+static ASMLine_T* init_line(const char* text, size_t len)
+{
+    ASMLine_T* line = calloc(1, sizeof(ASMLine_T));
+    line->text = strndup(text, len);
+    parse_line(line);
+    return line;
+}
+
+static void free_line(ASMLine_T* line)
+{
+    free(line->text);
+    free(line->fields);
+    free(line);
+}
+
+#ifdef __GNUC__
+__attribute((format(printf, 2, 3)))
+#endif
+static void rewrite_line(ASMLine_T* line, const char* fmt, ...)
+{
+    char buf[BUFSIZ];
+    va_list va;
+    va_start(va, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, va);
+    va_end(va);
+
+    free(line->text);
+    line->text = strdup(buf);
+    parse_line(line);
+}
+
+static ASMLine_T* line_at(ASMPeephole_T* p, size_t i)
+{
+    return p->lines->items[i];
+}
+
+// the next instruction, label or directive after `i`, skipping `.loc`s
+static size_t next_line(ASMPeephole_T* p, size_t i)
+{
+    for(i++; i < p->lines->size; i++)
+    {
+        ASMLine_T* line = line_at(p, i);
+        if(!line->deleted && line->kind != LINE_LOC)
+            break;
+    }
+    return i;
+}
+
+// registers and effects
+
+// parses register names like `rax`, `r8d` or `sil`
+static i32 parse_gpr(const char* name, size_t len, u8* size)
+{
+    static const char* legacy[8] = {"ax", "bx", "cx", "dx", "si", "di", "bp", "sp"};
+
+    if(len >= 2 && name[0] == 'r' && isdigit(name[1]))
+    {
+        i32 num = name[1] - '0';
+        size_t i = 2;
+        if(len > 2 && isdigit(name[2]))
+            num = num * 10 + name[i++] - '0';
+        if(num < 8 || num >= NUM_GPRS)
+            return -1;
+
+        if(i == len)
+            *size = 8;
+        else if(i + 1 == len && strchr("dwb", name[i]))
+            *size = name[i] == 'd' ? 4 : name[i] == 'w' ? 2 : 1;
+        else
+            return -1;
+        return num;
+    }
+
+    for(i32 r = 0; r < 8; r++)
+    {
+        const char* base = legacy[r];
+        if(len == 3 && (name[0] == 'r' || name[0] == 'e') && strncmp(name + 1, base, 2) == 0)
+            *size = name[0] == 'r' ? 8 : 4;
+        else if(len == 2 && strncmp(name, base, 2) == 0)
+            *size = 2;
+        else if(r < 4 && len == 2 && name[0] == base[0] && (name[1] == 'l' || name[1] == 'h'))
+            *size = 1;
+        else if(r >= 4 && len == 3 && strncmp(name, base, 2) == 0 && name[2] == 'l')
+            *size = 1;
+        else
+            continue;
+        return r;
+    }
+    return -1;
+}
+
+static size_t register_name_len(const char* name)
+{
+    size_t len = 0;
+    while(isalnum(name[len]))
+        len++;
+    return len;
+}
+
+static i32 gpr(const char* op, u8* size)
+{
+    u8 ignored;
+    if(*op != '%')
+        return -1;
+    size_t len = register_name_len(op + 1);
+    return op[len + 1] ? -1 : parse_gpr(op + 1, len, size ? size : &ignored);
+}
+
+static bool is_gpr64(const char* op)
+{
+    u8 size;
+    return gpr(op, &size) >= 0 && size == 8;
+}
+
+static u32 mentioned_gprs(const char* op)
+{
+    u32 regs = 0;
+    u8 size;
+    for(const char* c = strchr(op, '%'); c; c = strchr(c + 1, '%'))
+    {
+        i32 reg = parse_gpr(c + 1, register_name_len(c + 1), &size);
+        if(reg >= 0)
+            regs |= GPR_BIT(reg);
+    }
+    return regs;
+}
+
+static bool is_memory(const char* op)
+{
+    return *op != '$' && *op != '%';
+}
+
+static bool is_label_operand(const char* op)
+{
+    return !strpbrk(op, "*%$()");
+}
+
+static ASMMnemonic_T find_mnemonic(const char* name)
+{
+    size_t len = strlen(name);
+    for(size_t i = 0; i < LEN(mnemonics); i++)
+    {
+        if(*name != *mnemonics[i].name)
+            continue;
+        size_t mlen = strlen(mnemonics[i].name);
+        if(strncmp(name, mnemonics[i].name, mlen) == 0 && (len == mlen || (mnemonics[i].sized && len == mlen + 1 && strchr("bwlq", name[mlen]))))
+            return mnemonics[i];
+    }
+
+    for(size_t i = 0; i < LEN(mnemonic_prefixes); i++)
+        if(strncmp(name, mnemonic_prefixes[i].name, strlen(mnemonic_prefixes[i].name)) == 0)
+            return mnemonic_prefixes[i];
+
+    return (ASMMnemonic_T){NULL, OP_UNKNOWN, FLAGS_UNKNOWN, false};
+}
+
+static u32 written_gpr(const char* op)
+{
+    i32 reg = gpr(op, NULL);
+    return reg >= 0 ? GPR_BIT(reg) : 0;
+}
+
+static ASMEffect_T compute_effect(ASMLine_T* line)
+{
+    ASMEffect_T unknown = {OP_UNKNOWN, FLAGS_UNKNOWN, ALL_GPRS, ALL_GPRS};
+    if(line->kind != LINE_INSTR)
+        return unknown;
+
+    ASMMnemonic_T m = find_mnemonic(line->mnemonic);
+    ASMEffect_T effect = {m.cls, m.flags, 0, 0};
+    char** ops = line->ops;
+    u32 last = line->num_ops - 1;
+
+    switch(m.cls)
+    {
+        case OP_MOVE:
+            if(line->num_ops != 2)
+                return unknown;
+            effect.reads = mentioned_gprs(ops[0]) | (is_memory(ops[1]) ? mentioned_gprs(ops[1]) : 0);
+            effect.writes = written_gpr(ops[1]);
+            break;
+        case OP_ARITH:
+            if(line->num_ops != 2 && !(line->num_ops == 3 && strncmp(line->mnemonic, "imul", 4) == 0))
+                return unknown;
+            for(u32 i = 0; i < line->num_ops; i++)
+                effect.reads |= mentioned_gprs(ops[i]);
+            if(line->num_ops == 3)
+                effect.reads &= ~written_gpr(ops[last]);
+            effect.writes = written_gpr(ops[last]);
+            break;
+        case OP_COMPARE:
+            if(line->num_ops != 2)
+                return unknown;
+            effect.reads = mentioned_gprs(ops[0]) | mentioned_gprs(ops[1]);
+            break;
+        case OP_UNARY:
+        case OP_SETCC:
+        case OP_PUSH:
+        case OP_POP:
+            if(line->num_ops != 1)
+                return unknown;
+            effect.writes = m.cls == OP_PUSH ? 0 : written_gpr(ops[0]);
+            effect.reads = m.cls == OP_UNARY || m.cls == OP_PUSH || is_memory(ops[0]) ? mentioned_gprs(ops[0]) : 0;
+            break;
+        default:
+            effect.reads = effect.writes = ALL_GPRS;
+            break;
+    }
+
+    return effect;
+}
+
+// instructions only touching registers, which can be moved across
+static bool is_simple(ASMEffect_T* effect)
+{
+    switch(effect->cls)
+    {
+        case OP_MOVE:
+        case OP_ARITH:
+        case OP_COMPARE:
+        case OP_UNARY:
+        case OP_SETCC:
+            return !((effect->reads | effect->writes) & GPR_BIT(RSP));
+        default:
+            return false;
+    }
+}
+
+// the register `line` overwrites completely without depending on its old value
+static i32 full_write(ASMLine_T* line, ASMEffect_T* effect)
+{
+    u8 size;
+    i32 reg;
+    if(effect->cls == OP_POP)
+        return is_gpr64(line->ops[0]) ? gpr(line->ops[0], NULL) : -1;
+    if(line->kind != LINE_INSTR || line->num_ops != 2 || (reg = gpr(line->ops[1], &size)) < 0 || size < 4)
+        return -1;
+
+    if(strncmp(line->mnemonic, "xor", 3) == 0 && strcmp(line->ops[0], line->ops[1]) == 0)
+        return reg;
+    if(effect->cls == OP_MOVE && !(effect->reads & GPR_BIT(reg)))
+        return reg;
+    return -1;
+}
+
+// nothing reads the flags before they get set again
+static bool flags_dead_after(ASMPeephole_T* p, size_t i)
+{
+    for(size_t j = next_line(p, i); j < p->lines->size; j = next_line(p, j))
+    {
+        ASMEffect_T effect = line_at(p, j)->effect;
+        switch(effect.flags)
+        {
+            case FLAGS_NONE:
+                continue;
+            case FLAGS_WRITE:
+                return effect.cls != OP_UNKNOWN;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+// passes
+
+// push %x ... pop %y => mov %x, %y
+static bool combine_push_pop(ASMPeephole_T* p)
+{
+    bool changed = false;
+    for(size_t j = 0; j < p->lines->size; j++)
+    {
+        ASMLine_T* pop = line_at(p, j);
+        if(pop->deleted || pop->kind != LINE_INSTR || pop->effect.cls != OP_POP || !is_gpr64(pop->ops[0]))
+            continue;
+
+        u32 touched = 0, written = 0;
+        i32 depth = 0;
+        for(size_t i = j; i-- > 0;)
+        {
+            ASMLine_T* line = line_at(p, i);
+            if(line->deleted || line->kind == LINE_LOC)
+                continue;
+
+            ASMEffect_T effect = line->effect;
+            if(effect.cls == OP_PUSH && depth == 0)
+            {
+                if(!is_gpr64(line->ops[0]))
+                    break;
+
+                u32 from = GPR_BIT(gpr(line->ops[0], NULL)), to = GPR_BIT(gpr(pop->ops[0], NULL));
+                if(from == to && !(written & from))
+                    line->deleted = true;
+                else if(from != to && !(touched & to))
+                    rewrite_line(line, "  mov %s, %s", line->ops[0], pop->ops[0]);
+                else if(from != to && !(written & from))
+                {
+                    rewrite_line(pop, "  mov %s, %s", line->ops[0], pop->ops[0]);
+                    line->deleted = true;
+                    changed = true;
+                    break;
+                }
+                else
+                    break;
+
+                pop->deleted = true;
+                changed = true;
+                break;
+            }
+
+            if(effect.cls == OP_PUSH || effect.cls == OP_POP)
+            {
+                if(line->kind != LINE_INSTR || !is_gpr64(line->ops[0]))
+                    break;
+                depth += effect.cls == OP_POP ? 1 : -1;
+            }
+            else if(!is_simple(&effect))
+                break;
+
+            touched |= effect.reads | effect.writes;
+            written |= effect.writes;
+        }
+    }
+    return changed;
+}
+
+// mov %x, mem; mov mem, %y => mov %x, mem; mov %x, %y
+static bool forward_stores(ASMPeephole_T* p)
+{
+    bool changed = false;
+    for(size_t i = 0; i < p->lines->size; i++)
+    {
+        ASMLine_T* line = line_at(p, i);
+        if(line->deleted || line->kind != LINE_INSTR || line->num_ops != 2 || (strcmp(line->mnemonic, "mov") && strcmp(line->mnemonic, "movq")))
+            continue;
+
+        if(is_gpr64(line->ops[0]) && strcmp(line->ops[0], line->ops[1]) == 0)
+        {
+            line->deleted = true;
+            changed = true;
+            continue;
+        }
+
+        size_t j = next_line(p, i);
+        if(j >= p->lines->size)
+            break;
+
+        ASMLine_T* next = line_at(p, j);
+        if(next->kind != LINE_INSTR || next->num_ops != 2 || (strcmp(next->mnemonic, "mov") && strcmp(next->mnemonic, "movq"))
+            || !is_gpr64(line->ops[0]) || !is_gpr64(next->ops[1]) || strcmp(line->ops[1], next->ops[0]))
+            continue;
+
+        if(is_memory(line->ops[1]) && strcmp(line->ops[0], next->ops[1]))
+            rewrite_line(next, "  mov %s, %s", line->ops[0], next->ops[1]);
+        else if(is_memory(line->ops[1]) || strcmp(line->ops[0], next->ops[1]) == 0)
+            next->deleted = true;
+        else
+            continue;
+        changed = true;
+    }
+    return changed;
+}
+
+// mov x, %a; mov %a, %b; <overwrite %a> => mov x, %b; <overwrite %a>
+static bool forward_moves(ASMPeephole_T* p)
+{
+    bool changed = false;
+    for(size_t i = 0; i < p->lines->size; i++)
+    {
+        ASMLine_T* line = line_at(p, i);
+        if(line->deleted || line->kind != LINE_INSTR)
+            continue;
+
+        ASMEffect_T effect = line->effect;
+        if(effect.cls != OP_MOVE || !is_gpr64(line->ops[1]))
+            continue;
+
+        size_t j = next_line(p, i), k = next_line(p, j);
+        if(k >= p->lines->size)
+            break;
+
+        ASMLine_T* move = line_at(p, j), *next = line_at(p, k);
+        ASMEffect_T next_effect = next->effect;
+        if(move->kind != LINE_INSTR || strcmp(move->mnemonic, "mov") || move->num_ops != 2 || strcmp(move->ops[0], line->ops[1])
+            || !is_gpr64(move->ops[1]) || full_write(next, &next_effect) != gpr(line->ops[1], NULL))
+            continue;
+
+        rewrite_line(line, "  %s %s, %s", line->mnemonic, line->ops[0], move->ops[1]);
+        move->deleted = true;
+        changed = true;
+    }
+    return changed;
+}
+
+// removes writes to registers, which get overwritten by the next instruction
+static bool remove_dead_writes(ASMPeephole_T* p)
+{
+    bool changed = false;
+    for(size_t i = 0; i < p->lines->size; i++)
+    {
+        ASMLine_T* line = line_at(p, i);
+        if(line->deleted || line->kind != LINE_INSTR)
+            continue;
+
+        ASMEffect_T effect = line->effect;
+
+        // add $0, %reg and sub $0, %reg only set flags
+        if(line->num_ops == 2 && (!strcmp(line->mnemonic, "add") || !strcmp(line->mnemonic, "sub"))
+            && !strcmp(line->ops[0], "$0") && is_gpr64(line->ops[1]) && flags_dead_after(p, i))
+        {
+            line->deleted = true;
+            changed = true;
+            continue;
+        }
+
+        // moves don't touch the flags, but xor %reg, %reg does
+        i32 reg;
+        bool sets_flags = false;
+        if(effect.cls == OP_MOVE && line->num_ops == 2)
+            reg = gpr(line->ops[1], NULL);
+        else if(effect.cls == OP_ARITH && (reg = full_write(line, &effect)) >= 0)
+            sets_flags = true;
+        else
+            continue;
+        if(reg < 0)
+            continue;
+
+        size_t j = next_line(p, i);
+        if(j >= p->lines->size)
+            break;
+
+        ASMLine_T* next = line_at(p, j);
+        ASMEffect_T next_effect = next->effect;
+        if(full_write(next, &next_effect) == reg && (!sets_flags || flags_dead_after(p, i)))
+        {
+            line->deleted = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// lea fn(%rip), %rax ... mov %rax, %r10; mov $0, %eax; call *%r10 => ... mov $0, %eax; call fn
+static bool make_calls_direct(ASMPeephole_T* p)
+{
+    bool changed = false;
+    for(size_t k = 0; k < p->lines->size; k++)
+    {
+        ASMLine_T* call = line_at(p, k);
+        if(call->deleted || call->kind != LINE_INSTR || strcmp(call->mnemonic, "call") || call->num_ops != 1 || strcmp(call->ops[0], "*%r10"))
+            continue;
+
+        // find the instructions before the call
+        ASMLine_T* prev[2] = {NULL, NULL};
+        size_t i = k;
+        for(u32 n = 0; n < 2;)
+        {
+            if(i-- == 0)
+                break;
+            ASMLine_T* line = line_at(p, i);
+            if(!line->deleted && line->kind != LINE_LOC)
+                prev[n++] = line;
+        }
+
+        ASMLine_T* zero = prev[0], *move = prev[1];
+        if(!move || zero->kind != LINE_INSTR || move->kind != LINE_INSTR
+            || strcmp(zero->mnemonic, "mov") || zero->num_ops != 2 || strcmp(zero->ops[0], "$0") || (strcmp(zero->ops[1], "%eax") && strcmp(zero->ops[1], "%rax"))
+            || strcmp(move->mnemonic, "mov") || move->num_ops != 2 || strcmp(move->ops[0], "%rax") || strcmp(move->ops[1], "%r10"))
+            continue;
+
+        while(i-- > 0)
+        {
+            ASMLine_T* line = line_at(p, i);
+            if(line->deleted || line->kind == LINE_LOC)
+                continue;
+
+            ASMEffect_T effect = line->effect;
+            if(effect.cls == OP_MOVE && effect.writes == GPR_BIT(RAX))
+            {
+                size_t len = line->num_ops == 2 ? strlen(line->ops[0]) : 0;
+                if(strcmp(line->mnemonic, "lea") || strcmp(line->ops[1], "%rax") || len < 6 || strcmp(line->ops[0] + len - 6, "(%rip)")
+                    || strchr(line->ops[0], '@'))
+                    break;
+
+                rewrite_line(call, "  call %.*s", (int) len - 6, line->ops[0]);
+                line->deleted = true;
+                move->deleted = true;
+                changed = true;
+                break;
+            }
+
+            if((effect.cls != OP_POP && !is_simple(&effect)) || ((effect.reads | effect.writes) & (GPR_BIT(RAX) | GPR_BIT(R10))))
+                break;
+        }
+    }
+    return changed;
+}
+
+static HashMap_T* find_labels(ASMPeephole_T* p)
+{
+    HashMap_T* labels = hashmap_init();
+    for(size_t i = 0; i < p->lines->size; i++)
+    {
+        ASMLine_T* line = line_at(p, i);
+        if(!line->deleted && line->kind == LINE_LABEL)
+            hashmap_put(labels, line->mnemonic, (void*) (i + 1));
+    }
+    return labels;
+}
+
+// the first line after `i`, which isn't a label, deleted or a `.loc`, reports if it passed `label`
+static size_t skip_labels(ASMPeephole_T* p, size_t i, const char* label, bool* passed)
+{
+    for(i++; i < p->lines->size; i++)
+    {
+        ASMLine_T* line = line_at(p, i);
+        if(line->deleted || line->kind == LINE_LOC)
+            continue;
+        if(line->kind != LINE_LABEL)
+            break;
+        if(passed && label && strcmp(line->mnemonic, label) == 0)
+            *passed = true;
+    }
+    return i;
+}
+
+static const char* invert_jump(const char* mnemonic)
+{
+    for(size_t i = 0; i < LEN(inverted_jumps); i++)
+    {
+        if(strcmp(inverted_jumps[i][0], mnemonic) == 0)
+            return inverted_jumps[i][1];
+        if(strcmp(inverted_jumps[i][1], mnemonic) == 0)
+            return inverted_jumps[i][0];
+    }
+    return NULL;
+}
+
+static bool is_direct_jump(ASMLine_T* line, ASMOpClass_T cls)
+{
+    return !line->deleted && line->kind == LINE_INSTR && line->num_ops == 1 && is_label_operand(line->ops[0]) && line->effect.cls == cls;
+}
+
+static bool optimize_jumps(ASMPeephole_T* p)
+{
+    bool changed = false;
+    HashMap_T* labels = find_labels(p);
+
+    for(size_t i = 0; i < p->lines->size; i++)
+    {
+        ASMLine_T* line = line_at(p, i);
+        bool conditional = is_direct_jump(line, OP_JCC);
+        if(!conditional && !is_direct_jump(line, OP_JMP))
+            continue;
+
+        // jumps to jumps go to the final target directly
+        char* target = line->ops[0];
+        for(u32 n = 0; n < MAX_THREADING; n++)
+        {
+            size_t index = (size_t) hashmap_get(labels, target);
+            if(!index)
+                break;
+
+            size_t j = skip_labels(p, index - 1, NULL, NULL);
+            if(j >= p->lines->size || !is_direct_jump(line_at(p, j), OP_JMP) || strcmp(line_at(p, j)->ops[0], target) == 0)
+                break;
+            target = line_at(p, j)->ops[0];
+        }
+
+        if(target != line->ops[0])
+        {
+            rewrite_line(line, "  %s %s", line->mnemonic, target);
+            changed = true;
+        }
+
+        // jumps to the next instruction
+        bool passed = false;
+        size_t j = skip_labels(p, i, line->ops[0], &passed);
+        if(passed)
+        {
+            line->deleted = true;
+            changed = true;
+            continue;
+        }
+
+        // jcc a; jmp b; a: => jncc b; a:
+        const char* inverted = conditional ? invert_jump(line->mnemonic) : NULL;
+        if(inverted && j < p->lines->size && is_direct_jump(line_at(p, j), OP_JMP) && next_line(p, i) == j)
+        {
+            skip_labels(p, j, line->ops[0], &passed);
+            if(passed)
+            {
+                rewrite_line(line, "  %s %s", inverted, line_at(p, j)->ops[0]);
+                line_at(p, j)->deleted = true;
+                changed = true;
+            }
+        }
+    }
+
+    hashmap_free(labels);
+    return changed;
+}
+
+// instructions after unconditional jumps are unreachable until the next label
+static bool remove_unreachable(ASMPeephole_T* p)
+{
+    bool changed = false;
+    for(size_t i = 0; i < p->lines->size; i++)
+    {
+        ASMLine_T* line = line_at(p, i);
+        if(line->deleted || line->kind != LINE_INSTR)
+            continue;
+
+        ASMOpClass_T cls = line->effect.cls;
+        if(cls != OP_JMP && cls != OP_RET)
+            continue;
+
+        for(size_t j = next_line(p, i); j < p->lines->size && line_at(p, j)->kind == LINE_INSTR; j = next_line(p, j))
+        {
+            line_at(p, j)->deleted = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// a `.loc` directly followed by another one or repeating the current location has no effect
+static void remove_redundant_locs(ASMPeephole_T* p)
+{
+    ASMLine_T* current = NULL;
+    ASMLine_T* pending = NULL;
+
+    for(size_t i = 0; i < p->lines->size; i++)
+    {
+        ASMLine_T* line = line_at(p, i);
+        if(line->deleted)
+            continue;
+
+        switch(line->kind)
+        {
+            case LINE_LOC:
+                if(pending)
+                    pending->deleted = true;
+                pending = NULL;
+                if(current && strcmp(current->mnemonic, line->mnemonic) == 0)
+                    line->deleted = true;
+                else
+                    pending = line;
+                break;
+            case LINE_INSTR:
+            case LINE_OPAQUE:
+                if(pending)
+                    current = pending;
+                pending = NULL;
+                break;
+            case LINE_DIRECTIVE:
+                current = pending = NULL;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void init_asm_peephole(ASMPeephole_T* p)
+{
+    memset(p, 0, sizeof(ASMPeephole_T));
+    p->lines = init_list();
+}
+
+void free_asm_peephole(ASMPeephole_T* p)
+{
+    for(size_t i = 0; i < p->lines->size; i++)
+        free_line(p->lines->items[i]);
+    free_list(p->lines);
+    free(p->partial);
+}
+
+void asm_peephole_append(ASMPeephole_T* p, const char* text)
+{
+    const char* newline;
+    while((newline = strchr(text, '\n')))
+    {
+        size_t len = newline - text;
+        if(p->partial_len)
+        {
+            p->partial = realloc(p->partial, p->partial_len + len + 1);
+            memcpy(p->partial + p->partial_len, text, len);
+            list_push(p->lines, init_line(p->partial, p->partial_len + len));
+            p->partial_len = 0;
+        }
+        else
+            list_push(p->lines, init_line(text, len));
+        text = newline + 1;
+    }
+
+    size_t len = strlen(text);
+    if(len)
+    {
+        p->partial = realloc(p->partial, p->partial_len + len + 1);
+        memcpy(p->partial + p->partial_len, text, len);
+        p->partial_len += len;
+    }
+}
+
+void asm_peephole_flush(ASMPeephole_T* p, FILE* out)
+{
+    for(u32 round = 0; round < MAX_ROUNDS; round++)
+    {
+        bool changed = combine_push_pop(p);
+        changed |= forward_stores(p);
+        changed |= forward_moves(p);
+        changed |= make_calls_direct(p);
+        changed |= remove_dead_writes(p);
+        changed |= optimize_jumps(p);
+        changed |= remove_unreachable(p);
+        if(!changed)
+            break;
+    }
+    remove_redundant_locs(p);
+
+    for(size_t i = 0; i < p->lines->size; i++)
+    {
+        ASMLine_T* line = line_at(p, i);
+        if(!line->deleted)
+        {
+            fputs(line->text, out);
+            fputc('\n', out);
+        }
+        free_line(line);
+    }
+    list_clear(p->lines);
+}
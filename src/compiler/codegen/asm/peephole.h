@@ -0,0 +1,36 @@
+#ifndef CSPYDR_ASM_PEEPHOLE_H
+#define CSPYDR_ASM_PEEPHOLE_H
+
+#include <stdio.h>
+
+#include "list.h"
+
+// When optimizing, the assembly backend doesn't write its code out directly
+// but collects it as a list of parsed lines. After every function, a peephole
+// pass removes redundant instructions before the lines get written out:
+//
+// - push/pop pairs become register moves
+// - loads directly following a store to the same slot and values only moved
+//   between registers get forwarded
+// - writes to registers, which get overwritten before being read, get removed
+// - indirect calls of known functions become direct calls
+// - jumps to the next instruction get removed, jumps to jumps get threaded
+// - repeated `.loc` directives get removed
+
+typedef struct ASM_PEEPHOLE_STRUCT
+{
+    List_T* lines;  // list of ASMLine_Ts
+    char* partial;  // line without a newline yet
+    size_t partial_len;
+} ASMPeephole_T;
+
+void init_asm_peephole(ASMPeephole_T* p);
+void free_asm_peephole(ASMPeephole_T* p);
+
+// adds text to the current function, lines are separated by '\n'
+void asm_peephole_append(ASMPeephole_T* p, const char* text);
+
+// optimizes all collected lines and writes them to `out`
+void asm_peephole_flush(ASMPeephole_T* p, FILE* out);
+
+#endif
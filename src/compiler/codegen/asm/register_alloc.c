@@ -0,0 +1,205 @@
+#include "register_alloc.h"
+#include "ast/ast_iterator.h"
+#include "codegen/codegen_utils.h"
+#include "list.h"
+#include "util.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+
+#define GET_REG_ALLOC(va) RegAlloc_T* ra = va_arg(va, RegAlloc_T*)
+
+// uses in loops are worth 8 times as much per level of nesting
+#define LOOP_WEIGHT_SHIFT 3
+#define MAX_LOOP_DEPTH 4
+
+typedef struct REG_CANDIDATE_STRUCT {
+    ASTObj_T* var;
+    u64 weight;
+    bool escaped;
+} RegCandidate_T;
+
+typedef struct REG_ALLOC_STRUCT {
+    RegCandidate_T* candidates;
+    size_t num_candidates;
+    u32 loop_depth;
+    bool has_lambda;
+    bool has_inline_asm;
+} RegAlloc_T;
+
+static bool fits_register(ASTObj_T* var)
+{
+    ASTType_T* ty = unpack(var->data_type);
+    if(!ty || !(is_integer(ty) || ty->kind == TY_PTR))
+        return false;
+    return ty->size == 1 || ty->size == 2 || ty->size == 4 || ty->size == 8;
+}
+
+static RegCandidate_T* find_candidate(RegAlloc_T* ra, ASTNode_T* node)
+{
+    if(!node || node->kind != ND_ID)
+        return NULL;
+
+    for(size_t i = 0; i < ra->num_candidates; i++)
+        if(ra->candidates[i].var == node->referenced_obj)
+            return &ra->candidates[i];
+    return NULL;
+}
+
+// variables get their address taken, if they appear anywhere `asm_gen_addr()` is used
+static void escape(RegAlloc_T* ra, ASTNode_T* node)
+{
+    while(node && (node->kind == ND_CAST || node->kind == ND_CLOSURE))
+        node = node->kind == ND_CAST ? node->left : (node->exprs->size ? node->exprs->items[node->exprs->size - 1] : NULL);
+
+    RegCandidate_T* candidate = find_candidate(ra, node);
+    if(candidate)
+        candidate->escaped = true;
+}
+
+static void reg_alloc_id(ASTNode_T* id, va_list args)
+{
+    GET_REG_ALLOC(args);
+    RegCandidate_T* candidate = find_candidate(ra, id);
+    if(candidate)
+        candidate->weight += 1ull << (LOOP_WEIGHT_SHIFT * MIN(ra->loop_depth, MAX_LOOP_DEPTH));
+}
+
+static void reg_alloc_enter_loop(ASTNode_T* loop, va_list args)
+{
+    GET_REG_ALLOC(args);
+    ra->loop_depth++;
+}
+
+static void reg_alloc_leave_loop(ASTNode_T* loop, va_list args)
+{
+    GET_REG_ALLOC(args);
+    ra->loop_depth--;
+}
+
+static void reg_alloc_assign(ASTNode_T* assign, va_list args)
+{
+    GET_REG_ALLOC(args);
+    if(assign->left->kind != ND_ID)
+        escape(ra, assign->left);
+}
+
+static void reg_alloc_ref(ASTNode_T* ref, va_list args)
+{
+    GET_REG_ALLOC(args);
+    escape(ra, ref->right);
+}
+
+static void reg_alloc_member(ASTNode_T* member, va_list args)
+{
+    GET_REG_ALLOC(args);
+    escape(ra, member->left);
+}
+
+static void reg_alloc_call(ASTNode_T* call, va_list args)
+{
+    GET_REG_ALLOC(args);
+    escape(ra, call->expr);
+}
+
+static void reg_alloc_len(ASTNode_T* len, va_list args)
+{
+    GET_REG_ALLOC(args);
+    escape(ra, len->expr);
+}
+
+static void reg_alloc_lambda(ASTNode_T* lambda, va_list args)
+{
+    GET_REG_ALLOC(args);
+    ra->has_lambda = true;
+}
+
+static void reg_alloc_inline_asm(ASTNode_T* inline_asm, va_list args)
+{
+    GET_REG_ALLOC(args);
+    ra->has_inline_asm = true;
+}
+
+static const ASTIteratorList_T reg_alloc_iter = {
+    .node_start_fns = {
+        [ND_ID] = reg_alloc_id,
+        [ND_FOR] = reg_alloc_enter_loop,
+        [ND_FOR_RANGE] = reg_alloc_enter_loop,
+        [ND_WHILE] = reg_alloc_enter_loop,
+        [ND_DO_WHILE] = reg_alloc_enter_loop,
+        [ND_LOOP] = reg_alloc_enter_loop,
+        [ND_ASSIGN] = reg_alloc_assign,
+        [ND_INC] = reg_alloc_assign,
+        [ND_DEC] = reg_alloc_assign,
+        [ND_REF] = reg_alloc_ref,
+        [ND_MEMBER] = reg_alloc_member,
+        [ND_CALL] = reg_alloc_call,
+        [ND_LEN] = reg_alloc_len,
+        [ND_LAMBDA] = reg_alloc_lambda,
+        [ND_ASM] = reg_alloc_inline_asm,
+    },
+    .node_end_fns = {
+        [ND_FOR] = reg_alloc_leave_loop,
+        [ND_FOR_RANGE] = reg_alloc_leave_loop,
+        [ND_WHILE] = reg_alloc_leave_loop,
+        [ND_DO_WHILE] = reg_alloc_leave_loop,
+        [ND_LOOP] = reg_alloc_leave_loop,
+    }
+};
+
+static void add_candidates(RegAlloc_T* ra, List_T* vars)
+{
+    for(size_t i = 0; i < vars->size; i++)
+    {
+        ASTObj_T* var = vars->items[i];
+        // arguments with positive offsets are passed by stack
+        if((var->kind == OBJ_LOCAL || var->kind == OBJ_FN_ARG) && var->offset <= 0 && fits_register(var))
+            ra->candidates[ra->num_candidates++] = (RegCandidate_T){.var = var};
+    }
+}
+
+void asm_alloc_registers(ASTObj_T* fn)
+{
+    RegAlloc_T ra = {
+        .candidates = calloc(fn->args->size + fn->objs->size, sizeof(RegCandidate_T))
+    };
+    add_candidates(&ra, fn->args);
+    add_candidates(&ra, fn->objs);
+
+    ast_iterate_stmt(&reg_alloc_iter, fn->body, &ra);
+
+    // lambdas share the frame of their function, inline assembly may access any variable
+    if(ra.has_lambda || ra.has_inline_asm)
+    {
+        // inline assembly might clobber the registers of the caller
+        fn->asm_reg = ra.has_inline_asm ? ASM_NUM_VAR_REGS : 0;
+        free(ra.candidates);
+        return;
+    }
+
+    fn->asm_reg = 0;
+    while(fn->asm_reg < ASM_NUM_VAR_REGS)
+    {
+        RegCandidate_T* best = NULL;
+        for(size_t i = 0; i < ra.num_candidates; i++)
+        {
+            RegCandidate_T* candidate = &ra.candidates[i];
+            if(!candidate->escaped && !candidate->var->asm_reg && (!best || candidate->weight > best->weight))
+                best = candidate;
+        }
+
+        // a single use does not outweigh saving and restoring the register
+        if(!best || best->weight < 2)
+            break;
+        best->var->asm_reg = ++fn->asm_reg;
+    }
+
+    free(ra.candidates);
+}
+
+bool asm_has_inline_asm(ASTNode_T* body)
+{
+    RegAlloc_T ra = {0};
+    ast_iterate_stmt(&reg_alloc_iter, body, &ra);
+    return ra.has_inline_asm;
+}
@@ -0,0 +1,18 @@
+#ifndef CSPYDR_REGISTER_ALLOC_H
+#define CSPYDR_REGISTER_ALLOC_H
+
+#include "ast/ast.h"
+
+// Scalar locals and passed-by-register arguments, whose address is never taken,
+// get kept in callee-saved registers instead of the stack frame. Variables are
+// ranked by their number of uses, weighted by the depth of loops they're used in.
+//
+// After allocation, `var->asm_reg` is the 1-based index of the variable's register
+// and `fn->asm_reg` the number of registers the function has to save.
+
+#define ASM_NUM_VAR_REGS 4
+
+void asm_alloc_registers(ASTObj_T* fn);
+bool asm_has_inline_asm(ASTNode_T* body);
+
+#endif
@@ -186,10 +186,10 @@ size_t gen_relocation(ASMCodegenData_T* cg, ASTNode_T* node, size_t target_size)
             if(target_size <= 8)
             {
                 size_generated = asm_gen_const_data(cg, target_size);
-                asm_println(cg, "%s", asm_gen_identifier(cg->context, node->id));
+                asm_println(cg, "%s", asm_gen_identifier(cg, node->id));
                 break;
             }
-            throw_error(cg->context, ERR_CODEGEN, node->tok, "cannot generate relocation for identifiers with types > 8 bytes");
+            asm_error(cg, ERR_CODEGEN, node->tok, "cannot generate relocation for identifiers with types > 8 bytes");
             break;
 
         default:
@@ -225,7 +225,7 @@ size_t gen_relocation(ASMCodegenData_T* cg, ASTNode_T* node, size_t target_size)
                 return size_generated;
             }
 
-            throw_error(cg->context, ERR_CODEGEN, node->tok, "cannot generate relocation for `%s` (%d)", node->tok->value, node->kind);
+            asm_error(cg, ERR_CODEGEN, node->tok, "cannot generate relocation for `%.*s` (%d)", TOKEN_VALUE(node->tok), node->kind);
             break;
     }
 
@@ -0,0 +1,465 @@
+#include "vectorizer.h"
+#include "codegen/codegen_utils.h"
+#include "context.h"
+#include "util.h"
+
+#define MAX_ARRAYS 6  // base addresses stay in registers during the loop
+#define MAX_SCALARS 8 // broadcast to %xmm8-15
+#define MAX_TEMPS 8   // %xmm0-7
+
+static const char* base_regs[MAX_ARRAYS] = {"%rsi", "%rdi", "%r8", "%r9", "%r10", "%r11"};
+
+typedef struct VECTOR_LOOP_STRUCT {
+    TargetISA_T isa;
+    ASTNode_T* var;    // the induction variable `i`
+    ASTNode_T* limit;  // `n` of `i < n`
+    ASTType_T* elem;   // element type of all accessed arrays
+    ASTNode_T* assign; // `x[i] = <expr>`
+
+    ASTNode_T* arrays[MAX_ARRAYS]; // ids of the accessed arrays
+    u32 num_arrays;
+    ASTNode_T* scalars[MAX_SCALARS];
+    u32 num_scalars;
+} VectorLoop_T;
+
+static ASTNode_T* strip_closure(ASTNode_T* node)
+{
+    while(node->kind == ND_CLOSURE && node->exprs->size == 1)
+        node = node->exprs->items[0];
+    return node;
+}
+
+// ids don't always carry their type
+static ASTType_T* type_of(ASTNode_T* node)
+{
+    if(node->kind == ND_ID && node->referenced_obj)
+        return unpack(EITHER(node->data_type, node->referenced_obj->data_type));
+    return unpack(node->data_type);
+}
+
+static bool is_lane_type(ASTType_T* ty)
+{
+    switch(ty->kind)
+    {
+        case TY_CHAR:
+        case TY_I8:
+        case TY_U8:
+        case TY_I16:
+        case TY_U16:
+        case TY_I32:
+        case TY_U32:
+        case TY_I64:
+        case TY_U64:
+        case TY_F32:
+        case TY_F64:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_var(VectorLoop_T* vl, ASTNode_T* node)
+{
+    node = strip_closure(node);
+    if(node->kind == ND_CAST)
+        return is_integer(type_of(node)) && type_of(node)->size >= type_of(node->left)->size && is_var(vl, node->left);
+    return node->kind == ND_ID && node->referenced_obj == vl->var->referenced_obj;
+}
+
+// loop-invariant values without side effects, computed once and broadcast to all lanes
+static bool is_scalar(VectorLoop_T* vl, ASTNode_T* node)
+{
+    node = strip_closure(node);
+    ASTType_T* ty = type_of(node);
+    if(!ty || !(is_integer(ty) || ty->kind == TY_F32 || ty->kind == TY_F64))
+        return false;
+
+    switch(node->kind)
+    {
+        case ND_INT:
+        case ND_LONG:
+        case ND_ULONG:
+        case ND_CHAR:
+        case ND_FLOAT:
+        case ND_DOUBLE:
+            return true;
+
+        case ND_ID:
+        {
+            ASTObj_T* obj = node->referenced_obj;
+            return obj && obj != vl->var->referenced_obj
+                && (obj->kind == OBJ_LOCAL || obj->kind == OBJ_FN_ARG || obj->kind == OBJ_GLOBAL);
+        }
+
+        case ND_CAST:
+            return is_scalar(vl, node->left);
+
+        case ND_ADD:
+        case ND_SUB:
+        case ND_MUL:
+        case ND_BIT_AND:
+        case ND_BIT_OR:
+        case ND_XOR:
+            return is_scalar(vl, node->left) && is_scalar(vl, node->right);
+
+        // integer division could trap before the loop
+        case ND_DIV:
+            return is_flonum(ty) && is_scalar(vl, node->left) && is_scalar(vl, node->right);
+
+        default:
+            return false;
+    }
+}
+
+// `x[i]` of a local or global array, which cannot overlap any other array
+static bool is_element(VectorLoop_T* vl, ASTNode_T* node)
+{
+    if(node->kind != ND_INDEX || node->from_back || node->left->kind != ND_ID || !is_var(vl, node->expr))
+        return false;
+
+    ASTObj_T* obj = node->left->referenced_obj;
+    ASTType_T* ty = type_of(node->left);
+    ASTType_T* elem = type_of(node);
+    return obj && (obj->kind == OBJ_LOCAL || obj->kind == OBJ_GLOBAL) && (ty->kind == TY_C_ARRAY || ty->kind == TY_ARRAY)
+        && is_lane_type(elem) && (!vl->elem || (elem->kind == vl->elem->kind && elem->size == vl->elem->size));
+}
+
+static bool add_array(VectorLoop_T* vl, ASTNode_T* id)
+{
+    for(u32 i = 0; i < vl->num_arrays; i++)
+        if(vl->arrays[i]->referenced_obj == id->referenced_obj)
+            return true;
+    if(vl->num_arrays == MAX_ARRAYS)
+        return false;
+    vl->arrays[vl->num_arrays++] = id;
+    return true;
+}
+
+static i32 find_scalar(VectorLoop_T* vl, ASTNode_T* node)
+{
+    for(u32 i = 0; i < vl->num_scalars; i++)
+        if(vl->scalars[i] == node)
+            return i;
+    return -1;
+}
+
+// packed instruction computing `kind` on all lanes, NULL if there is none
+static const char* lane_op(VectorLoop_T* vl, ASTNodeKind_T kind)
+{
+    static const char* int_ops[][4] = {
+        [ND_ADD]     = {"paddb", "paddw", "paddd", "paddq"},
+        [ND_SUB]     = {"psubb", "psubw", "psubd", "psubq"},
+        [ND_MUL]     = {NULL, "pmullw", "pmulld", NULL},
+        [ND_BIT_AND] = {"pand", "pand", "pand", "pand"},
+        [ND_BIT_OR]  = {"por", "por", "por", "por"},
+        [ND_XOR]     = {"pxor", "pxor", "pxor", "pxor"},
+    };
+
+    if(is_flonum(vl->elem))
+    {
+        bool single = vl->elem->kind == TY_F32;
+        switch(kind)
+        {
+            case ND_ADD:
+                return single ? "addps" : "addpd";
+            case ND_SUB:
+                return single ? "subps" : "subpd";
+            case ND_MUL:
+                return single ? "mulps" : "mulpd";
+            case ND_DIV:
+                return single ? "divps" : "divpd";
+            default:
+                return NULL;
+        }
+    }
+
+    if((size_t) kind >= LEN(int_ops))
+        return NULL;
+
+    u32 size_index = vl->elem->size == 1 ? 0 : vl->elem->size == 2 ? 1 : vl->elem->size == 4 ? 2 : 3;
+    const char* op = int_ops[kind][size_index];
+    // pmulld came with SSE4.1
+    if(op && kind == ND_MUL && vl->elem->size == 4 && vl->isa < ISA_SSE4_1)
+        return NULL;
+    return op;
+}
+
+// checks an expression computing all lanes at once, `*temps` is the number of %xmm0-7 it uses
+static bool check_lanes(VectorLoop_T* vl, ASTNode_T* node, u32* temps)
+{
+    node = strip_closure(node);
+    ASTType_T* ty = type_of(node);
+
+    if(is_scalar(vl, node))
+    {
+        // narrow integer scalars other than literals are only extended to %eax
+        if((is_flonum(vl->elem) ? ty->kind != vl->elem->kind : !is_integer(ty) || (ty->size < 8 && vl->elem->size == 8 && node->kind != ND_INT))
+            || vl->num_scalars == MAX_SCALARS)
+            return false;
+        vl->scalars[vl->num_scalars++] = node;
+        *temps = 0;
+        return true;
+    }
+
+    if(node->kind == ND_INDEX)
+    {
+        *temps = 1;
+        return is_element(vl, node) && add_array(vl, node->left);
+    }
+
+    // integer lanes wrap around like the scalar code, as long as no intermediate result is narrower
+    if(!ty || (is_flonum(vl->elem) ? ty->kind != vl->elem->kind : !is_integer(ty) || ty->size < vl->elem->size))
+        return false;
+
+    if(node->kind == ND_CAST)
+        return !is_flonum(vl->elem) && check_lanes(vl, node->left, temps);
+
+    u32 left, right;
+    if(!lane_op(vl, node->kind) || !check_lanes(vl, node->left, &left) || !check_lanes(vl, node->right, &right))
+        return false;
+
+    *temps = MAX(MAX(left, 1), right + 1);
+    return *temps <= MAX_TEMPS;
+}
+
+static bool is_unit_step(VectorLoop_T* vl, ASTNode_T* step)
+{
+    if(step->kind == ND_INC)
+        return is_var(vl, step->left) && step->left->kind == ND_ID;
+    if(step->kind != ND_ASSIGN || step->left->kind != ND_ID || !is_var(vl, step->left))
+        return false;
+
+    ASTNode_T* add = step->right;
+    if(add->kind != ND_ADD || add->left->kind != ND_ID || !is_var(vl, add->left))
+        return false;
+    switch(add->right->kind)
+    {
+        case ND_INT:
+            return add->right->int_val == 1;
+        case ND_LONG:
+            return add->right->long_val == 1;
+        case ND_ULONG:
+            return add->right->ulong_val == 1;
+        default:
+            return false;
+    }
+}
+
+// `len` of arrays or a scalar
+static bool is_limit(VectorLoop_T* vl, ASTNode_T* node)
+{
+    node = strip_closure(node);
+    if(node->kind == ND_CAST)
+        return is_limit(vl, node->left);
+    if(node->kind == ND_LEN)
+        return node->expr->kind == ND_ID && (type_of(node->expr)->kind == TY_C_ARRAY || type_of(node->expr)->kind == TY_ARRAY);
+    return is_scalar(vl, node);
+}
+
+static bool match_loop(VectorLoop_T* vl, ASTNode_T* loop)
+{
+    // `i < n` with `n` being invariant
+    ASTNode_T* cond = loop->condition;
+    if(!cond || cond->kind != ND_LT || cond->left->kind != ND_ID || !cond->left->referenced_obj)
+        return false;
+
+    vl->var = cond->left;
+    vl->limit = cond->right;
+    ASTObj_T* var = vl->var->referenced_obj;
+    ASTType_T* ty = unpack(var->data_type);
+    if((var->kind != OBJ_LOCAL && var->kind != OBJ_FN_ARG) || (ty->kind != TY_I32 && ty->kind != TY_I64 && ty->kind != TY_U64))
+        return false;
+    if(type_of(vl->var)->kind != ty->kind || type_of(vl->limit)->kind != ty->kind || !is_limit(vl, vl->limit))
+        return false;
+
+    if(!loop->expr || !is_unit_step(vl, loop->expr))
+        return false;
+
+    // a single `x[i] = <expr>;`
+    ASTNode_T* body = loop->body;
+    if(body->kind == ND_BLOCK)
+    {
+        if(body->stmts->size != 1 || (body->locals && body->locals->size))
+            return false;
+        body = body->stmts->items[0];
+    }
+    if(body->kind != ND_EXPR_STMT || body->expr->kind != ND_ASSIGN || !is_element(vl, body->expr->left))
+        return false;
+
+    vl->assign = body->expr;
+    vl->elem = type_of(vl->assign->left);
+    add_array(vl, vl->assign->left->left);
+
+    u32 temps;
+    return check_lanes(vl, vl->assign->right, &temps) && temps <= MAX_TEMPS;
+}
+
+static const char* vec_reg_prefix(VectorLoop_T* vl)
+{
+    return vl->isa >= ISA_AVX2 ? "ymm" : "xmm";
+}
+
+static const char* move_op(VectorLoop_T* vl)
+{
+    return vl->elem->kind == TY_F32 ? "movups" : vl->elem->kind == TY_F64 ? "movupd" : "movdqu";
+}
+
+// broadcasts the scalar in %rax or %xmm0 to register `reg`
+static void gen_broadcast(ASMCodegenData_T* cg, VectorLoop_T* vl, u32 reg)
+{
+    static const char* broadcasts[] = {[1] = "vpbroadcastb", [2] = "vpbroadcastw", [4] = "vpbroadcastd", [8] = "vpbroadcastq"};
+    u32 size = vl->elem->size;
+
+    if(vl->isa >= ISA_AVX2)
+    {
+        if(is_flonum(vl->elem))
+            asm_println(cg, "  %s %%xmm0, %%ymm%u", size == 4 ? "vbroadcastss" : "vbroadcastsd", reg);
+        else
+        {
+            asm_println(cg, "  %s %s, %%xmm%u", size == 8 ? "vmovq" : "vmovd", size == 8 ? "%rax" : "%eax", reg);
+            asm_println(cg, "  %s %%xmm%u, %%ymm%u", broadcasts[size], reg, reg);
+        }
+        return;
+    }
+
+    switch(vl->elem->kind)
+    {
+        case TY_F32:
+            asm_println(cg, "  movaps %%xmm0, %%xmm%u", reg);
+            asm_println(cg, "  shufps $0, %%xmm%u, %%xmm%u", reg, reg);
+            return;
+        case TY_F64:
+            asm_println(cg, "  movapd %%xmm0, %%xmm%u", reg);
+            asm_println(cg, "  unpcklpd %%xmm%u, %%xmm%u", reg, reg);
+            return;
+        default:
+            break;
+    }
+
+    if(size == 8)
+    {
+        asm_println(cg, "  movq %%rax, %%xmm%u", reg);
+        asm_println(cg, "  punpcklqdq %%xmm%u, %%xmm%u", reg, reg);
+        return;
+    }
+
+    asm_println(cg, "  movd %%eax, %%xmm%u", reg);
+    if(size == 1)
+        asm_println(cg, "  punpcklbw %%xmm%u, %%xmm%u", reg, reg);
+    if(size <= 2)
+        asm_println(cg, "  punpcklwd %%xmm%u, %%xmm%u", reg, reg);
+    asm_println(cg, "  pshufd $0, %%xmm%u, %%xmm%u", reg, reg);
+}
+
+static i32 find_array(VectorLoop_T* vl, ASTNode_T* id)
+{
+    for(u32 i = 0; i < vl->num_arrays; i++)
+        if(vl->arrays[i]->referenced_obj == id->referenced_obj)
+            return i;
+    return -1;
+}
+
+// computes all lanes of `node` into temporary register `temp`, the index is in %rax
+static void gen_lanes(ASMCodegenData_T* cg, VectorLoop_T* vl, ASTNode_T* node, u32 temp)
+{
+    const char* v = vl->isa >= ISA_AVX2 ? "v" : "";
+    const char* r = vec_reg_prefix(vl);
+
+    node = strip_closure(node);
+    i32 scalar = find_scalar(vl, node);
+    if(scalar >= 0)
+    {
+        asm_println(cg, "  %s%s %%%s%u, %%%s%u", v, is_flonum(vl->elem) ? "movaps" : "movdqa", r, scalar + 8, r, temp);
+        return;
+    }
+
+    switch(node->kind)
+    {
+        case ND_INDEX:
+            asm_println(cg, "  %s%s (%s,%%rax,%d), %%%s%u", v, move_op(vl), base_regs[find_array(vl, node->left)], vl->elem->size, r, temp);
+            return;
+
+        case ND_CAST:
+            gen_lanes(cg, vl, node->left, temp);
+            return;
+
+        default:
+            break;
+    }
+
+    gen_lanes(cg, vl, node->left, temp);
+
+    u32 src = temp + 1;
+    ASTNode_T* right = strip_closure(node->right);
+    if((scalar = find_scalar(vl, right)) >= 0)
+        src = scalar + 8;
+    else
+        gen_lanes(cg, vl, right, src);
+
+    if(vl->isa >= ISA_AVX2)
+        asm_println(cg, "  v%s %%ymm%u, %%ymm%u, %%ymm%u", lane_op(vl, node->kind), src, temp, temp);
+    else
+        asm_println(cg, "  %s %%xmm%u, %%xmm%u", lane_op(vl, node->kind), src, temp);
+}
+
+// evaluates `node` to %rax, sign-extended to 64 bits
+static void gen_index_value(ASMCodegenData_T* cg, ASTNode_T* node)
+{
+    asm_gen_expr(cg, node);
+    if(type_of(node)->size == 4)
+        asm_println(cg, "  movsxd %%eax, %%rax");
+}
+
+void asm_gen_vector_loop(ASMCodegenData_T* cg, ASTNode_T* loop)
+{
+    VectorLoop_T vl = {.isa = cg->context->target_isa};
+    if(!cg->context->flags.optimize || loop->kind != ND_FOR || !match_loop(&vl, loop))
+        return;
+
+    u64 c = cg->max_count++;
+    u32 width = vl.isa >= ISA_AVX2 ? 32 : 16;
+    u32 lanes = width / vl.elem->size;
+    bool is_signed = unpack(vl.var->referenced_obj->data_type)->kind != TY_U64;
+    const char* v = vl.isa >= ISA_AVX2 ? "v" : "";
+
+    for(u32 i = 0; i < vl.num_scalars; i++)
+    {
+        asm_gen_expr(cg, vl.scalars[i]);
+        gen_broadcast(cg, &vl, i + 8);
+    }
+
+    for(u32 i = 0; i < vl.num_arrays; i++)
+    {
+        asm_gen_addr(cg, vl.arrays[i]);
+        // arrays start with their length
+        if(type_of(vl.arrays[i])->kind == TY_ARRAY)
+            asm_println(cg, "  add $8, %%rax");
+        asm_push(cg);
+    }
+
+    gen_index_value(cg, vl.limit);
+    asm_push(cg);
+    gen_index_value(cg, vl.var);
+    asm_pop(cg, "%rdx");
+    for(i32 i = vl.num_arrays - 1; i >= 0; i--)
+        asm_pop(cg, base_regs[i]);
+
+    asm_println(cg, "  cmp %%rdx, %%rax");
+    asm_println(cg, "  %s .L.vector_end.%lu", is_signed ? "jge" : "jae", c);
+    asm_println(cg, ".L.vector.%lu:", c);
+    asm_println(cg, "  mov %%rdx, %%rcx");
+    asm_println(cg, "  sub %%rax, %%rcx");
+    asm_println(cg, "  cmp $%u, %%rcx", lanes);
+    asm_println(cg, "  jb .L.vector_end.%lu", c);
+
+    gen_lanes(cg, &vl, vl.assign->right, 0);
+    asm_println(cg, "  %s%s %%%s0, (%s,%%rax,%d)", v, move_op(&vl), vec_reg_prefix(&vl), base_regs[0], vl.elem->size);
+
+    asm_println(cg, "  add $%u, %%rax", lanes);
+    asm_println(cg, "  jmp .L.vector.%lu", c);
+    asm_println(cg, ".L.vector_end.%lu:", c);
+    // avoid the penalty of mixing avx and legacy sse code
+    if(vl.isa >= ISA_AVX2)
+        asm_println(cg, "  vzeroupper");
+    asm_store_var(cg, vl.var->referenced_obj, vl.var->referenced_obj->data_type);
+}
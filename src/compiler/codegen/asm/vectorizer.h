@@ -0,0 +1,18 @@
+#ifndef CSPYDR_VECTORIZER_H
+#define CSPYDR_VECTORIZER_H
+
+#include "asm_codegen.h"
+
+// Counted loops over C arrays and arrays of the form
+//
+//     for let i = a; i < n; i++; { x[i] = <expr>; }
+//
+// where <expr> combines elements `y[i]` and loop-invariant scalars with +, -, *, &, |
+// and ^ (or / for floats), get a loop in front of them, which processes 16 bytes
+// (32 with AVX2) per iteration using packed SSE2, SSE4.1 or AVX2 instructions, as
+// allowed by --target-cpu. The original loop then only handles the remainder.
+//
+// Gets called after the loop's initializer; emits nothing for other loops.
+void asm_gen_vector_loop(ASMCodegenData_T* cg, ASTNode_T* loop);
+
+#endif
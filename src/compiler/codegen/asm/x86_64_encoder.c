@@ -0,0 +1,1117 @@
+#include "assembler.h"
+
+#include <elf.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ASM_INSTR_DEF_STRUCT ASMInstrDef_T;
+
+typedef bool (*ASMEncodeFn_T)(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops);
+
+struct ASM_INSTR_DEF_STRUCT {
+    const char* name;
+    ASMEncodeFn_T encode;
+    u32 opcode;
+    u8 arg;     // ModRM.reg extension, condition code or similar
+    u8 prefix;  // mandatory prefix
+    bool sized; // accepts a b/w/l/q suffix
+};
+
+static const char* condition_codes[] = {
+    "o", "no", "b", "ae", "e", "ne", "be", "a", "s", "ns", "p", "np", "l", "ge", "le", "g"
+};
+
+static const struct {
+    const char* name;
+    i32 code;
+} condition_aliases[] = {
+    {"c", 2}, {"nae", 2}, {"nb", 3}, {"nc", 3}, {"z", 4}, {"nz", 5}, {"na", 6}, {"nbe", 7},
+    {"pe", 10}, {"po", 11}, {"nge", 12}, {"nl", 13}, {"ng", 14}, {"nle", 15}
+};
+
+i32 asm_condition_code(const char* suffix)
+{
+    for(size_t i = 0; i < LEN(condition_codes); i++)
+        if(strcmp(suffix, condition_codes[i]) == 0)
+            return i;
+    for(size_t i = 0; i < LEN(condition_aliases); i++)
+        if(strcmp(suffix, condition_aliases[i].name) == 0)
+            return condition_aliases[i].code;
+    return -1;
+}
+
+// bytes
+
+static void put_byte(ASMInstr_T* in, u8 byte)
+{
+    in->bytes[in->len++] = byte;
+}
+
+static void put_int(ASMInstr_T* in, u64 value, u8 size)
+{
+    for(u8 i = 0; i < size; i++)
+        put_byte(in, value >> (i * 8));
+}
+
+static void put_opcode(ASMInstr_T* in, u32 opcode)
+{
+    if(opcode > 0xffff)
+        put_byte(in, opcode >> 16);
+    if(opcode > 0xff)
+        put_byte(in, opcode >> 8);
+    put_byte(in, opcode);
+}
+
+static bool put_fixup(ASMInstr_T* in, ASMValue_T* value, u8 size, bool pcrel, u32 reloc_type)
+{
+    if(in->num_fixups == ASM_MAX_FIXUPS || value->sub || !reloc_type)
+        return false;
+
+    in->fixups[in->num_fixups++] = (ASMFixup_T){
+        .offset = in->len,
+        .size = size,
+        .pcrel = pcrel,
+        .reloc_type = reloc_type,
+        .value = *value
+    };
+    put_int(in, 0, size);
+    return true;
+}
+
+// operands
+
+static bool is_gpr(ASMOperand_T* op)
+{
+    return op->kind == OPND_REG && op->cls == REG_GPR;
+}
+
+static bool is_xmm(ASMOperand_T* op)
+{
+    return op->kind == OPND_REG && op->cls == REG_XMM;
+}
+
+static bool is_rm(ASMOperand_T* op)
+{
+    return is_gpr(op) || op->kind == OPND_MEM;
+}
+
+static bool is_const(ASMOperand_T* op)
+{
+    return op->kind == OPND_IMM && !op->value.sym && !op->value.sub;
+}
+
+static bool fits_i8(i64 value)
+{
+    return value >= INT8_MIN && value <= INT8_MAX;
+}
+
+static bool fits_i32(i64 value)
+{
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+// size of the first general purpose register operand
+static u8 gpr_size(ASMOperand_T* ops, u32 num_ops)
+{
+    for(u32 i = 0; i < num_ops; i++)
+        if(is_gpr(&ops[i]))
+            return ops[i].size;
+    return 0;
+}
+
+// checks and sign-extends a constant operand of an instruction with operands of `size` bytes
+static bool const_value(ASMOperand_T* op, u8 size, i64* value)
+{
+    i64 v = op->value.addend;
+    switch(size)
+    {
+        case 1:
+            *value = (i8) v;
+            return v >= INT8_MIN && v <= UINT8_MAX;
+        case 2:
+            *value = (i16) v;
+            return v >= INT16_MIN && v <= UINT16_MAX;
+        case 4:
+            *value = (i32) v;
+            return v >= INT32_MIN && v <= UINT32_MAX;
+        default:
+            *value = v;
+            return true;
+    }
+}
+
+// immediate of `imm_size` bytes for an instruction with operands of `size` bytes
+static bool put_imm(ASMInstr_T* in, ASMOperand_T* op, u8 size, u8 imm_size)
+{
+    if(op->value.sym)
+    {
+        u32 type = imm_size == 8 ? R_X86_64_64 : imm_size == 4 ? (size == 8 ? R_X86_64_32S : R_X86_64_32) : imm_size == 2 ? R_X86_64_16 : R_X86_64_8;
+        return put_fixup(in, &op->value, imm_size, false, type);
+    }
+
+    i64 value;
+    if(op->value.sub || !const_value(op, size, &value) || (imm_size == 4 && !fits_i32(value)))
+        return false;
+    put_int(in, value, imm_size);
+    return true;
+}
+
+static bool put_imm8(ASMInstr_T* in, i64 value)
+{
+    put_byte(in, value);
+    return true;
+}
+
+static u8 imm_size(u8 size)
+{
+    return size > 4 ? 4 : size;
+}
+
+// ModRM and everything following it of a memory operand
+static bool put_mem(ASMInstr_T* in, u8 reg, ASMOperand_T* mem)
+{
+    static const u8 scales[] = {[1] = 0, [2] = 1, [4] = 2, [8] = 3};
+
+    reg = (reg & 7) << 3;
+    if(mem->rip)
+    {
+        put_byte(in, 0x05 | reg);
+        if(mem->value.sym)
+            return put_fixup(in, &mem->value, 4, true, R_X86_64_PC32);
+        put_int(in, mem->value.addend, 4);
+        return !mem->value.sub && fits_i32(mem->value.addend);
+    }
+
+    if(mem->value.sub || (!mem->value.sym && !fits_i32(mem->value.addend)))
+        return false;
+    if(mem->scale > 8 || (mem->scale & (mem->scale - 1)) || mem->index == 4)
+        return false;
+
+    bool symbolic = mem->value.sym;
+    i64 disp = mem->value.addend;
+    u8 mod;
+    if(mem->base < 0)
+    {
+        // absolute addresses or index only, always with disp32
+        put_byte(in, 0x04 | reg);
+        put_byte(in, (mem->index < 0 ? 0x20 : scales[mem->scale] << 6 | (mem->index & 7) << 3) | 0x05);
+        mod = 2;
+    }
+    else
+    {
+        if(!symbolic && !disp && (mem->base & 7) != 5)
+            mod = 0;
+        else if(!symbolic && fits_i8(disp))
+            mod = 1;
+        else
+            mod = 2;
+
+        if(mem->index < 0 && (mem->base & 7) != 4)
+            put_byte(in, mod << 6 | reg | (mem->base & 7));
+        else
+        {
+            put_byte(in, mod << 6 | reg | 0x04);
+            put_byte(in, (mem->index < 0 ? 0x20 : scales[mem->scale] << 6 | (mem->index & 7) << 3) | (mem->base & 7));
+        }
+    }
+
+    if(mod == 1)
+        put_byte(in, disp);
+    else if(mod == 2)
+    {
+        if(symbolic)
+            return put_fixup(in, &mem->value, 4, false, R_X86_64_32S);
+        put_int(in, disp, 4);
+    }
+    return true;
+}
+
+static bool put_rex(ASMInstr_T* in, bool w, u8 r, ASMOperand_T* reg, ASMOperand_T* rm)
+{
+    u8 rex = (w ? 8 : 0) | (r & 8 ? 4 : 0);
+    bool force = reg && reg->byte_rex;
+    bool high_byte = reg && reg->high_byte;
+
+    if(rm && rm->kind == OPND_MEM)
+    {
+        if(rm->base >= 8)
+            rex |= 1;
+        if(rm->index >= 8)
+            rex |= 2;
+    }
+    else if(rm && rm->kind == OPND_REG)
+    {
+        if(rm->reg >= 8)
+            rex |= 1;
+        force |= rm->byte_rex;
+        high_byte |= rm->high_byte;
+    }
+
+    if(rex || force)
+    {
+        if(high_byte)
+            return false;
+        put_byte(in, 0x40 | rex);
+    }
+    return true;
+}
+
+// [prefixes] [REX] opcode ModRM [SIB] [disp], `reg` is either a register operand or `digit`
+static bool put_op(ASMInstr_T* in, u8 prefix, u8 size, u32 opcode, ASMOperand_T* reg, u8 digit, ASMOperand_T* rm)
+{
+    if(!is_rm(rm) && !(rm->kind == OPND_REG && rm->cls == REG_XMM))
+        return false;
+
+    if(rm->kind == OPND_MEM && rm->segment)
+        put_byte(in, rm->segment);
+    if(size == 2)
+        put_byte(in, 0x66);
+    if(prefix)
+        put_byte(in, prefix);
+
+    u8 r = reg ? reg->reg : digit;
+    if(!put_rex(in, size == 8, r, reg, rm))
+        return false;
+    put_opcode(in, opcode);
+
+    if(rm->kind == OPND_REG)
+    {
+        put_byte(in, 0xc0 | (r & 7) << 3 | (rm->reg & 7));
+        return true;
+    }
+    return put_mem(in, r, rm);
+}
+
+// [prefixes] [REX] opcode+reg
+static bool put_op_reg(ASMInstr_T* in, u8 size, u32 opcode, ASMOperand_T* reg)
+{
+    if(size == 2)
+        put_byte(in, 0x66);
+    if(!put_rex(in, size == 8, 0, NULL, reg))
+        return false;
+    put_opcode(in, opcode | (reg ? reg->reg & 7 : 0));
+    return true;
+}
+
+// encoders
+
+static bool enc_fixed(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops)
+        return false;
+    if(def->prefix)
+        put_byte(in, def->prefix);
+    put_opcode(in, def->opcode);
+    return true;
+}
+
+static bool enc_alu(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2)
+        return false;
+    ASMOperand_T* src = &ops[0];
+    ASMOperand_T* dst = &ops[1];
+    if(!size && !(size = gpr_size(ops, num_ops)))
+        return false;
+
+    u8 base = def->arg * 8;
+    u8 wide = size != 1;
+    if(src->kind == OPND_IMM)
+    {
+        i64 value;
+        if(is_const(src) && wide && const_value(src, size, &value) && fits_i8(value))
+            return put_op(in, 0, size, 0x83, NULL, def->arg, dst) && put_imm8(in, value);
+        if(is_gpr(dst) && dst->reg == 0)
+            return put_op_reg(in, size, base + 4 + wide, NULL) && put_imm(in, src, size, imm_size(size));
+        return put_op(in, 0, size, 0x80 + wide, NULL, def->arg, dst) && put_imm(in, src, size, imm_size(size));
+    }
+
+    if(is_gpr(src) && is_rm(dst))
+        return put_op(in, 0, size, base + wide, src, 0, dst);
+    if(src->kind == OPND_MEM && is_gpr(dst))
+        return put_op(in, 0, size, base + 2 + wide, dst, 0, src);
+    return false;
+}
+
+static bool enc_mov(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2)
+        return false;
+    ASMOperand_T* src = &ops[0];
+    ASMOperand_T* dst = &ops[1];
+    if(is_xmm(src) || is_xmm(dst))
+        return false;
+    if(!size && !(size = gpr_size(ops, num_ops)))
+        return false;
+
+    u8 wide = size != 1;
+    if(src->kind == OPND_IMM)
+    {
+        if(size == 8 && is_gpr(dst) && is_const(src) && !fits_i32(src->value.addend))
+            return put_op_reg(in, 8, 0xb8, dst) && put_imm(in, src, 8, 8);
+        if(size != 8 && is_gpr(dst))
+            return put_op_reg(in, size, size == 1 ? 0xb0 : 0xb8, dst) && put_imm(in, src, size, size);
+        return put_op(in, 0, size, 0xc6 + wide, NULL, 0, dst) && put_imm(in, src, size, imm_size(size));
+    }
+
+    if(is_gpr(src) && is_rm(dst))
+        return put_op(in, 0, size, 0x88 + wide, src, 0, dst);
+    if(src->kind == OPND_MEM && is_gpr(dst))
+        return put_op(in, 0, size, 0x8a + wide, dst, 0, src);
+    return false;
+}
+
+static bool enc_movabs(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2 || ops[0].kind != OPND_IMM || !is_gpr(&ops[1]) || ops[1].size != 8)
+        return false;
+    return put_op_reg(in, 8, 0xb8, &ops[1]) && put_imm(in, &ops[0], 8, 8);
+}
+
+// movq and movd, between general purpose and xmm registers
+static bool enc_movq(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2)
+        return false;
+    ASMOperand_T* src = &ops[0];
+    ASMOperand_T* dst = &ops[1];
+    size = def->arg;
+
+    if(!is_xmm(src) && !is_xmm(dst))
+        return size == 8 && enc_mov(in, def, 8, ops, num_ops);
+
+    if(is_xmm(dst) && is_gpr(src))
+        return put_op(in, 0x66, size, 0x0f6e, dst, 0, src);
+    if(is_xmm(src) && is_gpr(dst))
+        return put_op(in, 0x66, size, 0x0f7e, src, 0, dst);
+    if(size == 4)
+    {
+        if(is_xmm(dst) && src->kind == OPND_MEM)
+            return put_op(in, 0x66, 0, 0x0f6e, dst, 0, src);
+        if(is_xmm(src) && dst->kind == OPND_MEM)
+            return put_op(in, 0x66, 0, 0x0f7e, src, 0, dst);
+        return false;
+    }
+    if(is_xmm(dst) && (is_xmm(src) || src->kind == OPND_MEM))
+        return put_op(in, 0xf3, 0, 0x0f7e, dst, 0, src);
+    if(is_xmm(src) && dst->kind == OPND_MEM)
+        return put_op(in, 0x66, 0, 0x0fd6, src, 0, dst);
+    return false;
+}
+
+// movsx and movzx, `opcode` is the byte source form, `arg` the source and destination size
+static bool enc_movx(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2 || !is_rm(&ops[0]) || !is_gpr(&ops[1]))
+        return false;
+    ASMOperand_T* src = &ops[0];
+    ASMOperand_T* dst = &ops[1];
+
+    u8 src_size = def->arg >> 4;
+    u8 dst_size = def->arg & 0xf;
+    if(!src_size)
+        src_size = is_gpr(src) ? src->size : 0;
+    if(!dst_size)
+        dst_size = dst->size;
+    if(dst_size != dst->size || (is_gpr(src) && src->size != src_size) || src_size >= dst_size)
+        return false;
+
+    switch(src_size)
+    {
+        case 1:
+            return put_op(in, 0, dst_size, def->opcode, dst, 0, src);
+        case 2:
+            return put_op(in, 0, dst_size, def->opcode + 1, dst, 0, src);
+        case 4:
+            // movsxd
+            return def->opcode == 0x0fbe && dst_size == 8 && put_op(in, 0, 8, 0x63, dst, 0, src);
+        default:
+            return false;
+    }
+}
+
+static bool enc_lea(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2 || ops[0].kind != OPND_MEM || !is_gpr(&ops[1]) || ops[1].size == 1)
+        return false;
+    return put_op(in, 0, ops[1].size, 0x8d, &ops[1], 0, &ops[0]);
+}
+
+static bool enc_push(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 1 || (size && size != 8))
+        return false;
+    ASMOperand_T* op = &ops[0];
+    bool push = def->opcode == 0x50;
+
+    if(is_gpr(op))
+        return op->size == 8 && put_op_reg(in, 0, def->opcode, op);
+    if(op->kind == OPND_MEM)
+        return put_op(in, 0, 0, push ? 0xff : 0x8f, NULL, push ? 6 : 0, op);
+    if(!push)
+        return false;
+
+    i64 value;
+    if(is_const(op) && const_value(op, 8, &value) && fits_i8(value))
+    {
+        put_byte(in, 0x6a);
+        return put_imm(in, op, 1, 1);
+    }
+    put_byte(in, 0x68);
+    return put_imm(in, op, 8, 4);
+}
+
+// not, neg, mul, div, idiv, inc, dec
+static bool enc_unary(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 1 || (!size && !(size = gpr_size(ops, num_ops))))
+        return false;
+    return put_op(in, 0, size, def->opcode + (size != 1), NULL, def->arg, &ops[0]);
+}
+
+static bool enc_imul(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops == 1)
+        return enc_unary(in, def, size, ops, num_ops);
+    if(!size && !(size = gpr_size(ops, num_ops)))
+        return false;
+    if(size == 1)
+        return false;
+
+    ASMOperand_T* imm = NULL;
+    ASMOperand_T* src;
+    ASMOperand_T* dst = &ops[num_ops - 1];
+    if(num_ops == 2 && ops[0].kind == OPND_IMM)
+    {
+        imm = &ops[0];
+        src = dst;
+    }
+    else if(num_ops == 3 && ops[0].kind == OPND_IMM)
+    {
+        imm = &ops[0];
+        src = &ops[1];
+    }
+    else if(num_ops == 2)
+        src = &ops[0];
+    else
+        return false;
+
+    if(!is_gpr(dst) || !is_rm(src))
+        return false;
+    if(!imm)
+        return put_op(in, 0, size, 0x0faf, dst, 0, src);
+
+    i64 value;
+    if(is_const(imm) && const_value(imm, size, &value) && fits_i8(value))
+        return put_op(in, 0, size, 0x6b, dst, 0, src) && put_imm8(in, value);
+    return put_op(in, 0, size, 0x69, dst, 0, src) && put_imm(in, imm, size, imm_size(size));
+}
+
+static bool enc_shift(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops < 1 || num_ops > 2)
+        return false;
+    ASMOperand_T* dst = &ops[num_ops - 1];
+    if(!size && !(size = is_gpr(dst) ? dst->size : 0))
+        return false;
+
+    u8 wide = size != 1;
+    if(num_ops == 1)
+        return put_op(in, 0, size, 0xd0 + wide, NULL, def->arg, dst);
+
+    ASMOperand_T* count = &ops[0];
+    if(is_gpr(count) && count->reg == 1 && count->size == 1)
+        return put_op(in, 0, size, 0xd2 + wide, NULL, def->arg, dst);
+    if(!is_const(count))
+        return false;
+    if(count->value.addend == 1)
+        return put_op(in, 0, size, 0xd0 + wide, NULL, def->arg, dst);
+    return put_op(in, 0, size, 0xc0 + wide, NULL, def->arg, dst) && put_imm(in, count, 1, 1);
+}
+
+static bool enc_test(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2 || (!size && !(size = gpr_size(ops, num_ops))))
+        return false;
+    ASMOperand_T* src = &ops[0];
+    ASMOperand_T* dst = &ops[1];
+
+    u8 wide = size != 1;
+    if(src->kind == OPND_IMM)
+    {
+        if(is_gpr(dst) && dst->reg == 0)
+            return put_op_reg(in, size, 0xa8 + wide, NULL) && put_imm(in, src, size, imm_size(size));
+        return put_op(in, 0, size, 0xf6 + wide, NULL, 0, dst) && put_imm(in, src, size, imm_size(size));
+    }
+    if(is_gpr(src) && is_rm(dst))
+        return put_op(in, 0, size, 0x84 + wide, src, 0, dst);
+    if(src->kind == OPND_MEM && is_gpr(dst))
+        return put_op(in, 0, size, 0x84 + wide, dst, 0, src);
+    return false;
+}
+
+static bool enc_xchg(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2 || (!size && !(size = gpr_size(ops, num_ops))))
+        return false;
+    if(is_gpr(&ops[0]) && is_rm(&ops[1]))
+        return put_op(in, 0, size, 0x86 + (size != 1), &ops[0], 0, &ops[1]);
+    if(is_gpr(&ops[1]) && ops[0].kind == OPND_MEM)
+        return put_op(in, 0, size, 0x86 + (size != 1), &ops[1], 0, &ops[0]);
+    return false;
+}
+
+static bool enc_setcc(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 1 || (is_gpr(&ops[0]) && ops[0].size != 1))
+        return false;
+    return put_op(in, 0, 0, 0x0f90 + def->arg, NULL, 0, &ops[0]);
+}
+
+static bool enc_cmovcc(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2 || !is_gpr(&ops[1]) || ops[1].size == 1)
+        return false;
+    return put_op(in, 0, ops[1].size, 0x0f40 + def->arg, &ops[1], 0, &ops[0]);
+}
+
+// indirect jumps and calls, direct ones get handled by the assembler
+static bool enc_branch(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 1 || (size && size != 8))
+        return false;
+    ASMOperand_T* target = &ops[0];
+    if(target->indirect)
+    {
+        if(is_gpr(target) && target->size != 8)
+            return false;
+        return put_op(in, 0, 0, 0xff, NULL, def->arg, target);
+    }
+
+    // direct call, `arg` is 2 for call and 4 for jmp
+    if(def->arg != 2 || target->kind != OPND_MEM || target->base >= 0 || target->index >= 0 || target->rip || !target->value.sym)
+        return false;
+    put_byte(in, 0xe8);
+    return put_fixup(in, &target->value, 4, true, R_X86_64_PLT32);
+}
+
+static bool enc_ret(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops == 0)
+    {
+        put_byte(in, 0xc3);
+        return true;
+    }
+    if(num_ops != 1 || !is_const(&ops[0]))
+        return false;
+    put_byte(in, 0xc2);
+    return put_imm(in, &ops[0], 2, 2);
+}
+
+// string operations, `opcode` is the byte form
+static bool enc_string(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops)
+        return false;
+    size = def->arg;
+    if(size == 2)
+        put_byte(in, 0x66);
+    if(size == 8)
+        put_byte(in, 0x48);
+    put_byte(in, def->opcode + (size != 1));
+    return true;
+}
+
+// movs and cmps without operands are string operations, with operands sign-extending moves or sse
+static bool enc_sse(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops);
+
+static bool enc_movs(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    static const ASMInstrDef_T movsb = {"movsb", enc_movx, 0x0fbe, 0x10, 0, false};
+    static const ASMInstrDef_T movsw = {"movsw", enc_movx, 0x0fbe, 0x20, 0, false};
+    static const ASMInstrDef_T movsd = {"movsd", enc_sse, 0x0f10, 0x11, 0xf2, false};
+
+    if(!num_ops)
+        return enc_string(in, def, size, ops, num_ops);
+    switch(def->arg)
+    {
+        case 1:
+            return enc_movx(in, &movsb, 0, ops, num_ops);
+        case 2:
+            return enc_movx(in, &movsw, 0, ops, num_ops);
+        case 4:
+            return enc_sse(in, &movsd, 0, ops, num_ops);
+        default:
+            return false;
+    }
+}
+
+// sse instructions with xmm destinations, `arg` is the opcode of the store form, if any
+static bool enc_sse(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2)
+        return false;
+    ASMOperand_T* src = &ops[0];
+    ASMOperand_T* dst = &ops[1];
+
+    if(is_xmm(dst) && (is_xmm(src) || src->kind == OPND_MEM))
+        return put_op(in, def->prefix, 0, def->opcode, dst, 0, src);
+    if(def->arg && is_xmm(src) && dst->kind == OPND_MEM)
+        return put_op(in, def->prefix, 0, 0x0f00 | def->arg, src, 0, dst);
+    return false;
+}
+
+// cvtsi2ss and cvtsi2sd
+static bool enc_cvt_from_int(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2 || !is_rm(&ops[0]) || !is_xmm(&ops[1]))
+        return false;
+    if(!size && !(size = gpr_size(ops, 1)))
+        return false;
+    if(size != 4 && size != 8)
+        return false;
+    return put_op(in, def->prefix, size, def->opcode, &ops[1], 0, &ops[0]);
+}
+
+// cvt(t)ss2si and cvt(t)sd2si
+static bool enc_cvt_to_int(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2 || !(is_xmm(&ops[0]) || ops[0].kind == OPND_MEM) || !is_gpr(&ops[1]))
+        return false;
+    size = ops[1].size;
+    if(size != 4 && size != 8)
+        return false;
+    return put_op(in, def->prefix, size, def->opcode, &ops[1], 0, &ops[0]);
+}
+
+// sse instructions with an 8 bit immediate, `$imm, src, dst`
+static bool enc_sse_imm(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 3 || !is_const(&ops[0]) || ops[0].value.addend < 0 || ops[0].value.addend > UINT8_MAX)
+        return false;
+    if(!is_xmm(&ops[2]) || !(is_xmm(&ops[1]) || ops[1].kind == OPND_MEM))
+        return false;
+    return put_op(in, def->prefix, 0, def->opcode, &ops[2], 0, &ops[1]) && put_imm8(in, ops[0].value.addend);
+}
+
+static bool is_vec(ASMOperand_T* op)
+{
+    return op->kind == OPND_REG && (op->cls == REG_XMM || op->cls == REG_YMM);
+}
+
+// [VEX] opcode ModRM [SIB] [disp], `opcode` includes the 0f, 0f38 or 0f3a escape
+// and `prefix` the mandatory prefix of the legacy encoding
+static bool put_vex_op(ASMInstr_T* in, u8 prefix, bool w, bool l, u32 opcode, u8 reg, u8 vvvv, ASMOperand_T* rm)
+{
+    u8 pp = prefix == 0x66 ? 1 : prefix == 0xf3 ? 2 : prefix == 0xf2 ? 3 : 0;
+    u8 map = opcode <= 0xffff ? 1 : (opcode >> 8 & 0xff) == 0x38 ? 2 : 3;
+    bool x = rm->kind == OPND_MEM && rm->index >= 8;
+    bool b = rm->kind == OPND_MEM ? rm->base >= 8 : rm->reg >= 8;
+    u8 last = (w ? 0x80 : 0) | (~vvvv & 0xf) << 3 | (l ? 4 : 0) | pp;
+
+    if(rm->kind == OPND_MEM && rm->segment)
+        put_byte(in, rm->segment);
+    if(map == 1 && !x && !b && !w)
+    {
+        put_byte(in, 0xc5);
+        put_byte(in, (reg & 8 ? 0 : 0x80) | (last & 0x7f));
+    }
+    else
+    {
+        put_byte(in, 0xc4);
+        put_byte(in, (reg & 8 ? 0 : 0x80) | (x ? 0 : 0x40) | (b ? 0 : 0x20) | map);
+        put_byte(in, last);
+    }
+    put_byte(in, opcode);
+
+    if(rm->kind == OPND_REG)
+    {
+        put_byte(in, 0xc0 | (reg & 7) << 3 | (rm->reg & 7));
+        return true;
+    }
+    return put_mem(in, reg, rm);
+}
+
+// three operand avx instructions, `src2, src1, dst`
+static bool enc_vex(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 3 || !is_vec(&ops[2]) || !is_vec(&ops[1]) || ops[1].cls != ops[2].cls)
+        return false;
+    if(!(ops[0].kind == OPND_MEM || (is_vec(&ops[0]) && ops[0].cls == ops[2].cls)))
+        return false;
+    return put_vex_op(in, def->prefix, false, ops[2].cls == REG_YMM, def->opcode, ops[2].reg, ops[1].reg, &ops[0]);
+}
+
+// avx moves, `arg` is the opcode of the store form
+static bool enc_vex_mov(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2)
+        return false;
+    ASMOperand_T* src = &ops[0];
+    ASMOperand_T* dst = &ops[1];
+
+    // register moves from %xmm8-15 use the store form, which fits the two byte VEX prefix
+    if(is_vec(dst) && (src->kind == OPND_MEM || (is_vec(src) && src->cls == dst->cls && (src->reg < 8 || dst->reg >= 8))))
+        return put_vex_op(in, def->prefix, false, dst->cls == REG_YMM, def->opcode, dst->reg, 0, src);
+    if(is_vec(src) && (dst->kind == OPND_MEM || (is_vec(dst) && src->cls == dst->cls)))
+        return put_vex_op(in, def->prefix, false, src->cls == REG_YMM, (def->opcode & ~0xff) | def->arg, src->reg, 0, dst);
+    return false;
+}
+
+// broadcasts of the lowest element of an xmm register or of memory
+static bool enc_vex_broadcast(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2 || !is_vec(&ops[1]) || !(is_xmm(&ops[0]) || ops[0].kind == OPND_MEM))
+        return false;
+    return put_vex_op(in, def->prefix, false, ops[1].cls == REG_YMM, def->opcode, ops[1].reg, 0, &ops[0]);
+}
+
+// vmovd and vmovq, between general purpose and xmm registers, `arg` is the operand size
+static bool enc_vex_movq(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 2)
+        return false;
+    ASMOperand_T* src = &ops[0];
+    ASMOperand_T* dst = &ops[1];
+    bool w = def->arg == 8;
+
+    if(is_xmm(dst) && ((is_gpr(src) && src->size == def->arg) || src->kind == OPND_MEM))
+        return put_vex_op(in, 0x66, w, false, 0x0f6e, dst->reg, 0, src);
+    if(is_xmm(src) && ((is_gpr(dst) && dst->size == def->arg) || dst->kind == OPND_MEM))
+        return put_vex_op(in, 0x66, w, false, 0x0f7e, src->reg, 0, dst);
+    return false;
+}
+
+// x87 memory operands, `arg` is the ModRM.reg extension
+static bool enc_x87_mem(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    if(num_ops != 1 || ops[0].kind != OPND_MEM)
+        return false;
+    return put_op(in, 0, 0, def->opcode, NULL, def->arg, &ops[0]);
+}
+
+// x87 register operations, `opcode` is the encoding for %st(0) with `arg` as the default register
+static bool enc_x87_reg(ASMInstr_T* in, const ASMInstrDef_T* def, u8 size, ASMOperand_T* ops, u32 num_ops)
+{
+    u8 reg = def->arg;
+    if(num_ops == 1 && ops[0].kind == OPND_REG && ops[0].cls == REG_ST)
+        reg = ops[0].reg;
+    else if(num_ops == 2 && ops[0].kind == OPND_REG && ops[0].cls == REG_ST && ops[1].kind == OPND_REG && ops[1].cls == REG_ST)
+    {
+        // `%st(i), %st` for comparisons, `%st, %st(i)` for popping arithmetic
+        if(ops[0].reg && !ops[1].reg)
+            reg = ops[0].reg;
+        else if(!ops[0].reg && ops[1].reg)
+            reg = ops[1].reg;
+        else
+            return false;
+    }
+    else if(num_ops)
+        return false;
+
+    put_opcode(in, def->opcode + reg);
+    return true;
+}
+
+// sorted by name for bsearch()
+static const ASMInstrDef_T instructions[] = {
+    {"adc",       enc_alu,          0,      2, 0,    true},
+    {"add",       enc_alu,          0,      0, 0,    true},
+    {"addpd",     enc_sse,          0x0f58, 0, 0x66, false},
+    {"addps",     enc_sse,          0x0f58, 0, 0,    false},
+    {"addsd",     enc_sse,          0x0f58, 0, 0xf2, false},
+    {"addss",     enc_sse,          0x0f58, 0, 0xf3, false},
+    {"and",       enc_alu,          0,      4, 0,    true},
+    {"andnpd",    enc_sse,          0x0f55, 0, 0x66, false},
+    {"andnps",    enc_sse,          0x0f55, 0, 0,    false},
+    {"andpd",     enc_sse,          0x0f54, 0, 0x66, false},
+    {"andps",     enc_sse,          0x0f54, 0, 0,    false},
+    {"call",      enc_branch,       0,      2, 0,    true},
+    {"cbtw",      enc_fixed,        0x6698, 0, 0,    false},
+    {"cbw",       enc_fixed,        0x6698, 0, 0,    false},
+    {"cdq",       enc_fixed,        0x99,   0, 0,    false},
+    {"cdqe",      enc_fixed,        0x4898, 0, 0,    false},
+    {"cld",       enc_fixed,        0xfc,   0, 0,    false},
+    {"cltd",      enc_fixed,        0x99,   0, 0,    false},
+    {"cltq",      enc_fixed,        0x4898, 0, 0,    false},
+    {"cmp",       enc_alu,          0,      7, 0,    true},
+    {"comisd",    enc_sse,          0x0f2f, 0, 0x66, false},
+    {"comiss",    enc_sse,          0x0f2f, 0, 0,    false},
+    {"cqo",       enc_fixed,        0x4899, 0, 0,    false},
+    {"cqto",      enc_fixed,        0x4899, 0, 0,    false},
+    {"cvtpd2ps",  enc_sse,          0x0f5a, 0, 0x66, false},
+    {"cvtps2pd",  enc_sse,          0x0f5a, 0, 0,    false},
+    {"cvtsd2si",  enc_cvt_to_int,   0x0f2d, 0, 0xf2, true},
+    {"cvtsd2ss",  enc_sse,          0x0f5a, 0, 0xf2, false},
+    {"cvtsi2sd",  enc_cvt_from_int, 0x0f2a, 0, 0xf2, true},
+    {"cvtsi2ss",  enc_cvt_from_int, 0x0f2a, 0, 0xf3, true},
+    {"cvtss2sd",  enc_sse,          0x0f5a, 0, 0xf3, false},
+    {"cvtss2si",  enc_cvt_to_int,   0x0f2d, 0, 0xf3, true},
+    {"cvttsd2si", enc_cvt_to_int,   0x0f2c, 0, 0xf2, true},
+    {"cvttss2si", enc_cvt_to_int,   0x0f2c, 0, 0xf3, true},
+    {"cwd",       enc_fixed,        0x6699, 0, 0,    false},
+    {"cwde",      enc_fixed,        0x98,   0, 0,    false},
+    {"cwtd",      enc_fixed,        0x6699, 0, 0,    false},
+    {"cwtl",      enc_fixed,        0x98,   0, 0,    false},
+    {"dec",       enc_unary,        0xfe,   1, 0,    true},
+    {"div",       enc_unary,        0xf6,   6, 0,    true},
+    {"divpd",     enc_sse,          0x0f5e, 0, 0x66, false},
+    {"divps",     enc_sse,          0x0f5e, 0, 0,    false},
+    {"divsd",     enc_sse,          0x0f5e, 0, 0xf2, false},
+    {"divss",     enc_sse,          0x0f5e, 0, 0xf3, false},
+    {"fabs",      enc_fixed,        0xd9e1, 0, 0,    false},
+    {"faddp",     enc_x87_reg,      0xdec0, 1, 0,    false},
+    {"fchs",      enc_fixed,        0xd9e0, 0, 0,    false},
+    {"fcomip",    enc_x87_reg,      0xdff0, 1, 0,    false},
+    {"fdivp",     enc_x87_reg,      0xdef0, 1, 0,    false},
+    {"fdivrp",    enc_x87_reg,      0xdef8, 1, 0,    false},
+    {"fildl",     enc_x87_mem,      0xdb,   0, 0,    false},
+    {"fildll",    enc_x87_mem,      0xdf,   5, 0,    false},
+    {"fildq",     enc_x87_mem,      0xdf,   5, 0,    false},
+    {"filds",     enc_x87_mem,      0xdf,   0, 0,    false},
+    {"fistpl",    enc_x87_mem,      0xdb,   3, 0,    false},
+    {"fistpll",   enc_x87_mem,      0xdf,   7, 0,    false},
+    {"fistpq",    enc_x87_mem,      0xdf,   7, 0,    false},
+    {"fisttpl",   enc_x87_mem,      0xdb,   1, 0,    false},
+    {"fisttpll",  enc_x87_mem,      0xdd,   1, 0,    false},
+    {"fisttpq",   enc_x87_mem,      0xdd,   1, 0,    false},
+    {"fld",       enc_x87_reg,      0xd9c0, 0, 0,    false},
+    {"fld1",      enc_fixed,        0xd9e8, 0, 0,    false},
+    {"fldcw",     enc_x87_mem,      0xd9,   5, 0,    false},
+    {"fldl",      enc_x87_mem,      0xdd,   0, 0,    false},
+    {"flds",      enc_x87_mem,      0xd9,   0, 0,    false},
+    {"fldt",      enc_x87_mem,      0xdb,   5, 0,    false},
+    {"fldz",      enc_fixed,        0xd9ee, 0, 0,    false},
+    {"fmulp",     enc_x87_reg,      0xdec8, 1, 0,    false},
+    {"fnstcw",    enc_x87_mem,      0xd9,   7, 0,    false},
+    {"fstl",      enc_x87_mem,      0xdd,   2, 0,    false},
+    {"fstp",      enc_x87_reg,      0xddd8, 0, 0,    false},
+    {"fstpl",     enc_x87_mem,      0xdd,   3, 0,    false},
+    {"fstps",     enc_x87_mem,      0xd9,   3, 0,    false},
+    {"fstpt",     enc_x87_mem,      0xdb,   7, 0,    false},
+    {"fsts",      enc_x87_mem,      0xd9,   2, 0,    false},
+    {"fsubp",     enc_x87_reg,      0xdee0, 1, 0,    false},
+    {"fsubrp",    enc_x87_reg,      0xdee8, 1, 0,    false},
+    {"fucomip",   enc_x87_reg,      0xdfe8, 1, 0,    false},
+    {"fxch",      enc_x87_reg,      0xd9c8, 1, 0,    false},
+    {"hlt",       enc_fixed,        0xf4,   0, 0,    false},
+    {"idiv",      enc_unary,        0xf6,   7, 0,    true},
+    {"imul",      enc_imul,         0xf6,   5, 0,    true},
+    {"inc",       enc_unary,        0xfe,   0, 0,    true},
+    {"int3",      enc_fixed,        0xcc,   0, 0,    false},
+    {"jmp",       enc_branch,       0,      4, 0,    true},
+    {"lea",       enc_lea,          0,      0, 0,    true},
+    {"leave",     enc_fixed,        0xc9,   0, 0,    true},
+    {"lfence",    enc_fixed,        0x0faee8, 0, 0,  false},
+    {"lodsb",     enc_string,       0xac,   1, 0,    false},
+    {"lodsq",     enc_string,       0xac,   8, 0,    false},
+    {"maxsd",     enc_sse,          0x0f5f, 0, 0xf2, false},
+    {"maxss",     enc_sse,          0x0f5f, 0, 0xf3, false},
+    {"mfence",    enc_fixed,        0x0faef0, 0, 0,  false},
+    {"minsd",     enc_sse,          0x0f5d, 0, 0xf2, false},
+    {"minss",     enc_sse,          0x0f5d, 0, 0xf3, false},
+    {"mov",       enc_mov,          0,      0, 0,    true},
+    {"movabs",    enc_movabs,       0,      0, 0,    true},
+    {"movapd",    enc_sse,          0x0f28, 0x29, 0x66, false},
+    {"movaps",    enc_sse,          0x0f28, 0x29, 0, false},
+    {"movd",      enc_movq,         0,      4, 0,    false},
+    {"movdqa",    enc_sse,          0x0f6f, 0x7f, 0x66, false},
+    {"movdqu",    enc_sse,          0x0f6f, 0x7f, 0xf3, false},
+    {"movq",      enc_movq,         0,      8, 0,    false},
+    {"movsb",     enc_movs,         0xa4,   1, 0,    false},
+    {"movsbl",    enc_movx,         0x0fbe, 0x14, 0, false},
+    {"movsbq",    enc_movx,         0x0fbe, 0x18, 0, false},
+    {"movsbw",    enc_movx,         0x0fbe, 0x12, 0, false},
+    {"movsd",     enc_movs,         0xa4,   4, 0,    false},
+    {"movslq",    enc_movx,         0x0fbe, 0x48, 0, false},
+    {"movsq",     enc_string,       0xa4,   8, 0,    false},
+    {"movss",     enc_sse,          0x0f10, 0x11, 0xf3, false},
+    {"movsw",     enc_movs,         0xa4,   2, 0,    false},
+    {"movswl",    enc_movx,         0x0fbe, 0x24, 0, false},
+    {"movswq",    enc_movx,         0x0fbe, 0x28, 0, false},
+    {"movsx",     enc_movx,         0x0fbe, 0,    0, false},
+    {"movsxd",    enc_movx,         0x0fbe, 0x48, 0, false},
+    {"movupd",    enc_sse,          0x0f10, 0x11, 0x66, false},
+    {"movups",    enc_sse,          0x0f10, 0x11, 0, false},
+    {"movzb",     enc_movx,         0x0fb6, 0x10, 0, false},
+    {"movzbl",    enc_movx,         0x0fb6, 0x14, 0, false},
+    {"movzbq",    enc_movx,         0x0fb6, 0x18, 0, false},
+    {"movzbw",    enc_movx,         0x0fb6, 0x12, 0, false},
+    {"movzw",     enc_movx,         0x0fb6, 0x20, 0, false},
+    {"movzwl",    enc_movx,         0x0fb6, 0x24, 0, false},
+    {"movzwq",    enc_movx,         0x0fb6, 0x28, 0, false},
+    {"movzx",     enc_movx,         0x0fb6, 0,    0, false},
+    {"mul",       enc_unary,        0xf6,   4, 0,    true},
+    {"mulpd",     enc_sse,          0x0f59, 0, 0x66, false},
+    {"mulps",     enc_sse,          0x0f59, 0, 0,    false},
+    {"mulsd",     enc_sse,          0x0f59, 0, 0xf2, false},
+    {"mulss",     enc_sse,          0x0f59, 0, 0xf3, false},
+    {"neg",       enc_unary,        0xf6,   3, 0,    true},
+    {"nop",       enc_fixed,        0x90,   0, 0,    false},
+    {"not",       enc_unary,        0xf6,   2, 0,    true},
+    {"or",        enc_alu,          0,      1, 0,    true},
+    {"orpd",      enc_sse,          0x0f56, 0, 0x66, false},
+    {"orps",      enc_sse,          0x0f56, 0, 0,    false},
+    {"paddb",     enc_sse,          0x0ffc, 0, 0x66, false},
+    {"paddd",     enc_sse,          0x0ffe, 0, 0x66, false},
+    {"paddq",     enc_sse,          0x0fd4, 0, 0x66, false},
+    {"paddw",     enc_sse,          0x0ffd, 0, 0x66, false},
+    {"pand",      enc_sse,          0x0fdb, 0, 0x66, false},
+    {"pause",     enc_fixed,        0x90,   0, 0xf3, false},
+    {"pmulld",    enc_sse,          0x0f3840, 0, 0x66, false},
+    {"pmullw",    enc_sse,          0x0fd5, 0, 0x66, false},
+    {"pop",       enc_push,         0x58,   0, 0,    true},
+    {"por",       enc_sse,          0x0feb, 0, 0x66, false},
+    {"pshufd",    enc_sse_imm,      0x0f70, 0, 0x66, false},
+    {"psubb",     enc_sse,          0x0ff8, 0, 0x66, false},
+    {"psubd",     enc_sse,          0x0ffa, 0, 0x66, false},
+    {"psubq",     enc_sse,          0x0ffb, 0, 0x66, false},
+    {"psubw",     enc_sse,          0x0ff9, 0, 0x66, false},
+    {"punpcklbw", enc_sse,          0x0f60, 0, 0x66, false},
+    {"punpcklqdq", enc_sse,         0x0f6c, 0, 0x66, false},
+    {"punpcklwd", enc_sse,          0x0f61, 0, 0x66, false},
+    {"push",      enc_push,         0x50,   0, 0,    true},
+    {"pxor",      enc_sse,          0x0fef, 0, 0x66, false},
+    {"rcl",       enc_shift,        0,      2, 0,    true},
+    {"rcr",       enc_shift,        0,      3, 0,    true},
+    {"ret",       enc_ret,          0,      0, 0,    true},
+    {"rol",       enc_shift,        0,      0, 0,    true},
+    {"ror",       enc_shift,        0,      1, 0,    true},
+    {"sal",       enc_shift,        0,      4, 0,    true},
+    {"sar",       enc_shift,        0,      7, 0,    true},
+    {"sbb",       enc_alu,          0,      3, 0,    true},
+    {"scasb",     enc_string,       0xae,   1, 0,    false},
+    {"sfence",    enc_fixed,        0x0faef8, 0, 0,  false},
+    {"shl",       enc_shift,        0,      4, 0,    true},
+    {"shr",       enc_shift,        0,      5, 0,    true},
+    {"shufps",    enc_sse_imm,      0x0fc6, 0, 0,    false},
+    {"sqrtsd",    enc_sse,          0x0f51, 0, 0xf2, false},
+    {"sqrtss",    enc_sse,          0x0f51, 0, 0xf3, false},
+    {"std",       enc_fixed,        0xfd,   0, 0,    false},
+    {"stosb",     enc_string,       0xaa,   1, 0,    false},
+    {"stosl",     enc_string,       0xaa,   4, 0,    false},
+    {"stosq",     enc_string,       0xaa,   8, 0,    false},
+    {"stosw",     enc_string,       0xaa,   2, 0,    false},
+    {"sub",       enc_alu,          0,      5, 0,    true},
+    {"subpd",     enc_sse,          0x0f5c, 0, 0x66, false},
+    {"subps",     enc_sse,          0x0f5c, 0, 0,    false},
+    {"subsd",     enc_sse,          0x0f5c, 0, 0xf2, false},
+    {"subss",     enc_sse,          0x0f5c, 0, 0xf3, false},
+    {"syscall",   enc_fixed,        0x0f05, 0, 0,    false},
+    {"test",      enc_test,         0,      0, 0,    true},
+    {"ucomisd",   enc_sse,          0x0f2e, 0, 0x66, false},
+    {"ucomiss",   enc_sse,          0x0f2e, 0, 0,    false},
+    {"ud2",       enc_fixed,        0x0f0b, 0, 0,    false},
+    {"unpcklpd",  enc_sse,          0x0f14, 0, 0x66, false},
+    {"unpcklps",  enc_sse,          0x0f14, 0, 0,    false},
+    {"vaddpd",    enc_vex,          0x0f58, 0, 0x66, false},
+    {"vaddps",    enc_vex,          0x0f58, 0, 0,    false},
+    {"vbroadcastsd", enc_vex_broadcast, 0x0f3819, 0, 0x66, false},
+    {"vbroadcastss", enc_vex_broadcast, 0x0f3818, 0, 0x66, false},
+    {"vdivpd",    enc_vex,          0x0f5e, 0, 0x66, false},
+    {"vdivps",    enc_vex,          0x0f5e, 0, 0,    false},
+    {"vmovapd",   enc_vex_mov,      0x0f28, 0x29, 0x66, false},
+    {"vmovaps",   enc_vex_mov,      0x0f28, 0x29, 0, false},
+    {"vmovd",     enc_vex_movq,     0,      4, 0,    false},
+    {"vmovdqa",   enc_vex_mov,      0x0f6f, 0x7f, 0x66, false},
+    {"vmovdqu",   enc_vex_mov,      0x0f6f, 0x7f, 0xf3, false},
+    {"vmovq",     enc_vex_movq,     0,      8, 0,    false},
+    {"vmovupd",   enc_vex_mov,      0x0f10, 0x11, 0x66, false},
+    {"vmovups",   enc_vex_mov,      0x0f10, 0x11, 0, false},
+    {"vmulpd",    enc_vex,          0x0f59, 0, 0x66, false},
+    {"vmulps",    enc_vex,          0x0f59, 0, 0,    false},
+    {"vpaddb",    enc_vex,          0x0ffc, 0, 0x66, false},
+    {"vpaddd",    enc_vex,          0x0ffe, 0, 0x66, false},
+    {"vpaddq",    enc_vex,          0x0fd4, 0, 0x66, false},
+    {"vpaddw",    enc_vex,          0x0ffd, 0, 0x66, false},
+    {"vpand",     enc_vex,          0x0fdb, 0, 0x66, false},
+    {"vpbroadcastb", enc_vex_broadcast, 0x0f3878, 0, 0x66, false},
+    {"vpbroadcastd", enc_vex_broadcast, 0x0f3858, 0, 0x66, false},
+    {"vpbroadcastq", enc_vex_broadcast, 0x0f3859, 0, 0x66, false},
+    {"vpbroadcastw", enc_vex_broadcast, 0x0f3879, 0, 0x66, false},
+    {"vpmulld",   enc_vex,          0x0f3840, 0, 0x66, false},
+    {"vpmullw",   enc_vex,          0x0fd5, 0, 0x66, false},
+    {"vpor",      enc_vex,          0x0feb, 0, 0x66, false},
+    {"vpsubb",    enc_vex,          0x0ff8, 0, 0x66, false},
+    {"vpsubd",    enc_vex,          0x0ffa, 0, 0x66, false},
+    {"vpsubq",    enc_vex,          0x0ffb, 0, 0x66, false},
+    {"vpsubw",    enc_vex,          0x0ff9, 0, 0x66, false},
+    {"vpxor",     enc_vex,          0x0fef, 0, 0x66, false},
+    {"vsubpd",    enc_vex,          0x0f5c, 0, 0x66, false},
+    {"vsubps",    enc_vex,          0x0f5c, 0, 0,    false},
+    {"vzeroupper", enc_fixed,       0xc5f877, 0, 0,  false},
+    {"xchg",      enc_xchg,         0,      0, 0,    true},
+    {"xor",       enc_alu,          0,      6, 0,    true},
+    {"xorpd",     enc_sse,          0x0f57, 0, 0x66, false},
+    {"xorps",     enc_sse,          0x0f57, 0, 0,    false},
+};
+
+static int compare_instr(const void* name, const void* def)
+{
+    return strcmp(name, ((const ASMInstrDef_T*) def)->name);
+}
+
+static const ASMInstrDef_T* find_instr(const char* name)
+{
+    return bsearch(name, instructions, LEN(instructions), sizeof(ASMInstrDef_T), compare_instr);
+}
+
+static u8 suffix_size(char suffix)
+{
+    switch(suffix)
+    {
+        case 'b': return 1;
+        case 'w': return 2;
+        case 'l': return 4;
+        case 'q': return 8;
+        default:  return 0;
+    }
+}
+
+bool asm_encode(const char* mnemonic, ASMOperand_T* ops, u32 num_ops, ASMInstr_T* out)
+{
+    memset(out, 0, sizeof(ASMInstr_T));
+
+    u8 size = 0;
+    const ASMInstrDef_T* def = find_instr(mnemonic);
+    ASMInstrDef_T cc_def;
+    if(!def)
+    {
+        // setcc and cmovcc
+        size_t len = strlen(mnemonic);
+        i32 cc;
+        if(strncmp(mnemonic, "set", 3) == 0 && (cc = asm_condition_code(mnemonic + 3)) >= 0)
+            cc_def = (ASMInstrDef_T){mnemonic, enc_setcc, 0, cc, 0, false};
+        else if(strncmp(mnemonic, "cmov", 4) == 0 && (cc = asm_condition_code(mnemonic + 4)) >= 0)
+            cc_def = (ASMInstrDef_T){mnemonic, enc_cmovcc, 0, cc, 0, false};
+        else if(len > 1 && len < 16 && (size = suffix_size(mnemonic[len - 1])))
+        {
+            char base[16];
+            memcpy(base, mnemonic, len - 1);
+            base[len - 1] = '\0';
+            if(strncmp(base, "cmov", 4) == 0 && (cc = asm_condition_code(base + 4)) >= 0)
+                cc_def = (ASMInstrDef_T){mnemonic, enc_cmovcc, 0, cc, 0, false};
+            else if(!(def = find_instr(base)) || !def->sized)
+                return false;
+        }
+        else
+            return false;
+
+        if(!def)
+            def = &cc_def;
+    }
+
+    // suffixes have to match register operands
+    if(size && def->encode != enc_cvt_from_int && def->encode != enc_cvt_to_int)
+        for(u32 i = 0; i < num_ops; i++)
+            if(is_gpr(&ops[i]) && ops[i].size != size && def->encode != enc_shift)
+                return false;
+
+    if(!def->encode(out, def, size, ops, num_ops))
+        return false;
+
+    for(u8 i = 0; i < out->num_fixups; i++)
+        if(out->fixups[i].pcrel)
+            out->fixups[i].bias = out->len - out->fixups[i].offset;
+    return true;
+}
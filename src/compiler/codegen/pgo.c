@@ -0,0 +1,139 @@
+#include "pgo.h"
+
+#include "config.h"
+#include "io/io.h"
+#include "io/log.h"
+#include "list.h"
+#include "platform/platform_bindings.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+char* pgo_profile_dir(Context_T* context, char* buffer)
+{
+    if(context->pgo_use)
+    {
+        snprintf(buffer, BUFSIZ, "%s", context->pgo_use);
+        return buffer;
+    }
+
+    return get_cached_file_path(buffer, context->paths.target, ".pgo");
+}
+
+static char* read_profile_file(Context_T* context, const char* name, size_t* size)
+{
+    char path[BUFSIZ * 2];
+    char dir[BUFSIZ];
+    snprintf(path, sizeof(path), "%s" DIRECTORY_DELIMS "%s", pgo_profile_dir(context, dir), name);
+
+    FILE* fp = fopen(path, "rb");
+    if(!fp)
+        return NULL;
+
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    rewind(fp);
+
+    char* data = malloc(len + 1);
+    *size = fread(data, 1, len, fp);
+    data[*size] = '\0';
+    fclose(fp);
+    return data;
+}
+
+// gcc writes a `.gcda` file per object, nested under the object's absolute path,
+// clang's raw profiles get merged into `.profdata` files
+static bool has_cc_profile(const char* dir)
+{
+    DIR* profile_dir = opendir(dir);
+    if(!profile_dir)
+        return false;
+
+    bool found = false;
+    struct dirent* entry;
+    while(!found && (entry = readdir(profile_dir)) != NULL)
+    {
+        // hidden directories like `.cache` may be part of the object's path
+        if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        if(entry->d_type == DT_DIR)
+        {
+            char path[BUFSIZ * 2];
+            snprintf(path, sizeof(path), "%s" DIRECTORY_DELIMS "%s", dir, entry->d_name);
+            found = has_cc_profile(path);
+        }
+        else
+            found = str_ends_with(entry->d_name, ".gcda") || str_ends_with(entry->d_name, ".profdata");
+    }
+
+    closedir(profile_dir);
+    return found;
+}
+
+bool pgo_has_cc_profile(Context_T* context)
+{
+    char dir[BUFSIZ];
+    return has_cc_profile(pgo_profile_dir(context, dir));
+}
+
+bool pgo_load_profile(Context_T* context, PGOProfile_T* profile)
+{
+    memset(profile, 0, sizeof(PGOProfile_T));
+
+    size_t names_size, counts_size;
+    profile->names = read_profile_file(context, PGO_NAMES_FILE, &names_size);
+    profile->values = (u64*) read_profile_file(context, PGO_COUNTS_FILE, &counts_size);
+    if(!profile->names || !profile->values)
+    {
+        free_pgo_profile(profile);
+        return false;
+    }
+
+    // the names belong to the counters in the order they appear in
+    profile->counts = hashmap_init();
+    size_t index = 0;
+    for(char* name = strtok(profile->names, "\n"); name && index < counts_size / sizeof(u64); name = strtok(NULL, "\n"))
+        hashmap_put(profile->counts, name, (void*) ++index);
+
+    return true;
+}
+
+void free_pgo_profile(PGOProfile_T* profile)
+{
+    if(profile->counts)
+        hashmap_free(profile->counts);
+    free(profile->values);
+    free(profile->names);
+    memset(profile, 0, sizeof(PGOProfile_T));
+}
+
+bool pgo_count(const PGOProfile_T* profile, const char* name, u64* count)
+{
+    size_t index = (size_t) hashmap_get(profile->counts, name);
+    if(!index)
+        return false;
+
+    *count = profile->values[index - 1];
+    return true;
+}
+
+void pgo_write_names(Context_T* context, List_T* names)
+{
+    char dir[BUFSIZ];
+    if(make_dir(get_cache_dir(dir)) || make_dir(pgo_profile_dir(context, dir)))
+    {
+        LOG_ERROR_F("error creating profile directory `%s`.\n", dir);
+        throw(context->main_error_exception);
+    }
+
+    char path[BUFSIZ * 2];
+    snprintf(path, sizeof(path), "%s" DIRECTORY_DELIMS PGO_NAMES_FILE, dir);
+
+    FILE* fp = open_file(path);
+    for(size_t i = 0; i < names->size; i++)
+        fprintf(fp, "%s\n", (char*) names->items[i]);
+    fclose(fp);
+}
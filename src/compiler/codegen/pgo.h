@@ -0,0 +1,42 @@
+#ifndef CSPYDR_PGO_H
+#define CSPYDR_PGO_H
+
+#include "context.h"
+#include "hashmap.h"
+
+// Profile-guided optimization: programs built with --pgo-generate count how often their functions
+// and branches run and store the counts in a profile directory (by default `<target>.pgo` in the
+// cache), which later builds read with --pgo-use.
+//
+// The C backend leaves both to the C compiler. gcc names its profiles after the objects, which
+// is why the C units are named after the main file and don't depend on `-o` or `-j`. The assembly backend counts the calls of every
+// function and both branches of every `if` statement itself; the program writes the counters to
+// `asm.counts` when `main` returns and the compiler writes their names to `asm.names`.
+
+#define PGO_NAMES_FILE  "asm.names"
+#define PGO_COUNTS_FILE "asm.counts"
+
+typedef struct PGO_PROFILE_STRUCT
+{
+    HashMap_T* counts; // counter names -> indices into `values` + 1
+    u64* values;
+    char* names;
+} PGOProfile_T;
+
+// the profile directory of the current build, `buffer` has to hold BUFSIZ bytes
+char* pgo_profile_dir(Context_T* context, char* buffer);
+
+// whether the profile directory holds profiles the C compiler wrote
+bool pgo_has_cc_profile(Context_T* context);
+
+// reads the counters of the assembly backend, returns false if there are none
+bool pgo_load_profile(Context_T* context, PGOProfile_T* profile);
+void free_pgo_profile(PGOProfile_T* profile);
+
+// looks up a counter, returns false if the profile doesn't contain it
+bool pgo_count(const PGOProfile_T* profile, const char* name, u64* count);
+
+// writes the counter names of an instrumented program in the order of its counter table
+void pgo_write_names(Context_T* context, List_T* names);
+
+#endif
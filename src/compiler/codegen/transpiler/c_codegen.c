@@ -23,6 +23,9 @@
 #include "util.h"
 #include "debugger/register.h"
 #include "timer/timer.h"
+#include "thread_pool.h"
+#include "../pgo.h"
+#include "c_hints.h"
 
 #define ID_PREFIX  "__csp_"
 #define MAIN_FN_ID ID_PREFIX "main"
@@ -30,6 +33,9 @@
 
 #define C_NUM_REGISTERS DEBUGGER_REG_RFLAGS
 
+// the number of units does not depend on `-j`, so that their cached objects stay valid
+#define C_NUM_UNITS 8
+
 #define GET_CG(args) CCodegenData_T* cg = va_arg(args, CCodegenData_T*)
 
 static void c_gen_entry_point(CCodegenData_T* cg);
@@ -38,6 +44,8 @@ static void c_gen_structs(CCodegenData_T* cg, List_T* objs);
 static void c_gen_globals(CCodegenData_T* cg, List_T* objs);
 static void c_gen_function_definitions(CCodegenData_T* cg, List_T* objs);
 static void c_gen_functions(CCodegenData_T* cg, List_T* objs);
+static void c_gen_function(CCodegenData_T* cg, ASTObj_T* fn);
+static char* c_gen_identifier(Context_T* context, ASTIdentifier_T* id);
 static void c_gen_expr(CCodegenData_T* cg, ASTNode_T* node, bool with_casts);
 static void c_gen_stmt(CCodegenData_T* cg, ASTNode_T* stmt);
 static void c_gen_type(CCodegenData_T* cg, ASTType_T* type, bool c_arr_as_ptr);
@@ -111,6 +119,28 @@ static const char c_header_text[] =
     "static const _Bool _false = 0;\n"
     "static const _Bool _true = 1;\n"
     "\n"
+    "#if defined(__has_attribute)\n"
+    "  #if __has_attribute(musttail)\n"
+    "    #define _musttail __attribute__((musttail))\n"
+    "  #endif\n"
+    "#endif\n"
+    "#ifndef _musttail\n"
+    "  #define _musttail\n"
+    "  #define _tailcall _Pragma(\"GCC error \\\"[tailcall] functions need a C compiler supporting __attribute__((musttail))\\\"\")\n"
+    "#else\n"
+    "  #define _tailcall _musttail\n"
+    "#endif\n"
+    "\n"
+    "#ifdef __GNUC__\n"
+    "  #define _attr(...) __attribute__((__VA_ARGS__))\n"
+    "  #define _likely(x) __builtin_expect(!!(x), 1)\n"
+    "  #define _unlikely(x) __builtin_expect(!!(x), 0)\n"
+    "#else\n"
+    "  #define _attr(...)\n"
+    "  #define _likely(x) (x)\n"
+    "  #define _unlikely(x) (x)\n"
+    "#endif\n"
+    "\n"
     "static inline uint64_t _inline_strlen(const char* s) {\n"
     "  uint64_t l;\n"
     "  for(l = 0; s[l]; l++);\n"
@@ -231,6 +261,10 @@ void free_c_cg(CCodegenData_T* cg)
     free(cg->buf);
     free_list(cg->blocks);
 
+    for(u32 i = 0; i < cg->num_units; i++)
+        free(cg->units[i].buf);
+    free(cg->units);
+
     List_T* arrays = hashmap_keys(cg->arrays);
     for(size_t i = 0; i < arrays->size; i++)
         free(arrays->items[i]);
@@ -273,6 +307,13 @@ static void c_rewind(CCodegenData_T* cg, i64 amount)
     fseek(cg->code_buffer, amount, SEEK_END);
 }
 
+static void write_buffer(char* path, const char* buf, size_t len)
+{
+    FILE* out = open_file(path);
+    fwrite(buf, len, 1, out);
+    fclose(out);
+}
+
 static void write_code(CCodegenData_T* cg, const char* target, bool cachefile)
 {
     char file_path[BUFSIZ * 2] = {'\0'};
@@ -290,16 +331,21 @@ static void write_code(CCodegenData_T* cg, const char* target, bool cachefile)
             LOG_ERROR("error creating cache directory `" DIRECTORY_DELIMS CACHE_DIR DIRECTORY_DELIMS "`.\n");
             throw(cg->context->main_error_exception);
         }
-        sprintf(file_path, "%s" DIRECTORY_DELIMS "%s.c", cache_dir, basename((char*) target));
+        sprintf(file_path, "%s" DIRECTORY_DELIMS "%s.h", cache_dir, cg->unit_name);
     }
     else
         sprintf(file_path, "%s.c", basename((char*) target));
 
     fclose(cg->code_buffer);
+    write_buffer(file_path, cg->buf, cg->buf_len);
 
-    FILE* out = open_file(file_path);
-    fwrite(cg->buf, cg->buf_len, 1, out);
-    fclose(out);
+    for(u32 i = 0; i < cg->num_units; i++)
+    {
+        char suffix[32];
+        sprintf(suffix, ".%u.c", i);
+        get_cached_file_path(file_path, cg->unit_name, suffix);
+        write_buffer(file_path, cg->units[i].buf, cg->units[i].buf_len);
+    }
 }
 
 i32 transpiler_pass(Context_T* context, ASTProg_T* ast)
@@ -315,153 +361,443 @@ i32 transpiler_pass(Context_T* context, ASTProg_T* ast)
     return 0;
 }
 
-void c_gen_code(CCodegenData_T* cg, const char* target)
+static void c_collect_functions(CCodegenData_T* cg, List_T* objs, List_T* functions)
 {
-    timer_start(cg->context, "C code generation");
-
-    char platform[1024] = { '\0' };
-    get_build(platform);
-    if(!cg->silent)
+    for(size_t i = 0; i < objs->size; i++)
     {
-        LOG_OK_F(COLOR_BOLD_BLUE "  Generating" COLOR_BOLD_WHITE " C99" COLOR_RESET " for " COLOR_BOLD_WHITE "%s\n" COLOR_RESET, platform);
+        ASTObj_T* obj = objs->items[i];
+        switch(obj->kind)
+        {
+        case OBJ_NAMESPACE:
+            c_collect_functions(cg, obj->objs, functions);
+            break;
+        
+        case OBJ_FUNCTION:
+            if(!obj->is_extern && should_emit(cg->context, obj))
+                list_push(functions, obj);
+            break;
+
+        default:
+            break;
+        }
     }
+}
 
-    // generate the c code
-    c_print(cg, "%s", c_header_text);
-    c_gen_typedefs(cg, cg->ast->objs);
-    c_gen_array_types(cg);
-    c_gen_structs(cg, cg->ast->objs);
-    c_gen_globals(cg, cg->ast->objs);
-    c_gen_pipe_buffers(cg);
-    c_gen_function_definitions(cg, cg->ast->objs);
-    c_gen_lambdas(cg);
-    c_gen_functions(cg, cg->ast->objs);
-    c_gen_entry_point(cg);
-    write_code(cg, target, cg->context->flags.do_assembling);
+static void c_push_march(CCodegenData_T* cg, List_T* arg_list, char march[BUFSIZ])
+{
+    if(cg->context->target_cpu)
+    {
+        snprintf(march, BUFSIZ, "-march=%s", cg->context->target_cpu);
+        list_push(arg_list, march);
+    }
+}
 
-    if(cg->print)
+// the C compiler instruments the program and reads the profile itself
+static void c_push_pgo_flags(CCodegenData_T* cg, List_T* arg_list, char pgo[BUFSIZ * 2])
+{
+    char dir[BUFSIZ];
+    if(cg->context->pgo_generate)
+        snprintf(pgo, BUFSIZ * 2, "-fprofile-generate=%s", pgo_profile_dir(cg->context, dir));
+    else if(cg->context->pgo_use)
     {
-        if(!cg->silent)
-            LOG_INFO(COLOR_RESET);
-        fprintf(OUTPUT_STREAM, "%s", cg->buf);
+        snprintf(pgo, BUFSIZ * 2, "-fprofile-use=%s", pgo_profile_dir(cg->context, dir));
+        list_push(arg_list, "-fprofile-correction");
     }
+    else
+        return;
 
-    timer_stop(cg->context);
+    list_push(arg_list, pgo);
+}
 
-    if(!cg->context->flags.do_assembling)
+// with --lto, the C compiler optimizes the units and C objects from `[link_obj()]` together when linking
+static void c_push_lto_flags(CCodegenData_T* cg, List_T* arg_list, bool link)
+{
+    if(!cg->context->flags.lto)
         return;
 
-    timer_start(cg->context, "compiling C code");
+    list_push(arg_list, "-flto");
+    list_push(arg_list, "-ffunction-sections");
+    list_push(arg_list, "-fdata-sections");
+    if(link)
+        list_push(arg_list, "-Wl,--gc-sections");
+}
 
-    char c_source_file[BUFSIZ] = {'\0'};
-    get_cached_file_path(c_source_file, target, ".c");
+static void c_push_link_flags(CCodegenData_T* cg, List_T* arg_list)
+{
+    switch(cg->context->link_mode.mode)
+    {
+        case LINK_STATIC:
+            list_push(arg_list, "-static");
+            break;
+        case LINK_DYNAMIC:
+        {
+            const char* dynamic_linker = cg->context->link_mode.ldynamic.dynamic_linker;
+            if(!file_exists(dynamic_linker))
+            {
+                cg->context->emitted_warnings++;
+                LOG_WARN_F(COLOR_BOLD_YELLOW "[Warning]" COLOR_RESET COLOR_YELLOW " dynamic linker `%s` does not exist.\n", dynamic_linker);
+            }
 
-    // run the compiler
-    if(cg->context->flags.do_linking)
+            size_t len = strlen(dynamic_linker) + 32;
+            char* dynamic_linker_buf = calloc(len + 1, sizeof(char));
+            CONTEXT_ALLOC_REGISTER(cg->context, (void*) dynamic_linker_buf);
+
+            snprintf(dynamic_linker_buf, len, "-Wl,-dynamic-linker,%s", dynamic_linker);
+            list_push(arg_list, dynamic_linker_buf);
+        } break;
+    }
+
+    for(size_t i = 0; i < cg->context->compiler_flags->size; i++)
+        list_push(arg_list, cg->context->compiler_flags->items[i]);
+
+    for(size_t i = 0; i < cg->context->link_mode.extra->size; i++)
+        list_push(arg_list, cg->context->link_mode.extra->items[i]);
+
+    for(size_t i = 0; i < cg->context->link_mode.libs->size; i++)
+        list_push(arg_list, cg->context->link_mode.libs->items[i]);
+}
+
+static void c_run_cc(CCodegenData_T* cg, List_T* arg_list)
+{
+    list_push(arg_list, NULL);
+
+    i32 exit_code = subprocess(arg_list->items[0], (char* const*) arg_list->items, false);
+    free_list(arg_list);
+
+    if(exit_code != 0)
     {
-        if(!cg->silent)
-            print_linking_msg(cg->context, target, cg->context->flags.require_entrypoint);
+        LOG_ERROR_F("error compiling code. (exit code %d)\n", exit_code);
+        throw(cg->context->main_error_exception);
+    }
+}
+
+typedef struct C_UNIT_JOB_STRUCT
+{
+    ThreadPoolJob_T job;
+    char source_file[BUFSIZ];
+    char obj_file[BUFSIZ];
+    char hash_file[BUFSIZ];
+    List_T* args;
+    u64 hash;
+    bool cached;
+    i32 exit_code;
+} CUnitJob_T;
+
+// FNV-1a, 64 bit variant
+static u64 hash_bytes(u64 hash, const void* data, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= ((const u8*) data)[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// identifies the C compiler by its `--version` output, since updating it keeps its path
+static u64 c_hash_cc(CCodegenData_T* cg)
+{
+    char command[BUFSIZ];
+    snprintf(command, sizeof(command), "\"%s\" --version 2>&1", cg->context->cc);
+
+    u64 hash = 14695981039346656037ull;
+    FILE* fp = popen(command, "r");
+    if(!fp)
+        return hash;
+
+    char buf[BUFSIZ];
+    size_t read;
+    while((read = fread(buf, sizeof(char), sizeof(buf), fp)) > 0)
+        hash = hash_bytes(hash, buf, read);
+    pclose(fp);
+    return hash;
+}
+
+// objects depend on the header, the unit, the compiler and its arguments
+static u64 c_hash_unit(CCodegenData_T* cg, CCodeUnit_T* unit, List_T* args, u64 cc_hash)
+{
+    u64 hash = hash_bytes(cc_hash, cg->buf, cg->buf_len);
+    hash = hash_bytes(hash, unit->buf, unit->buf_len);
+    for(size_t i = 0; i < args->size && args->items[i]; i++)
+        hash = hash_bytes(hash, args->items[i], strlen(args->items[i]) + 1);
+    return hash;
+}
+
+// the hash of the unit a cached object was compiled from, 0 if there is none
+static u64 c_read_unit_hash(CUnitJob_T* job)
+{
+    if(!file_exists(job->obj_file))
+        return 0;
+
+    FILE* fp = fopen(job->hash_file, "r");
+    if(!fp)
+        return 0;
+
+    u64 hash = 0;
+    if(fscanf(fp, "%" SCNx64, &hash) != 1)
+        hash = 0;
+    fclose(fp);
+    return hash;
+}
+
+static void c_write_unit_hash(CUnitJob_T* job)
+{
+    FILE* fp = fopen(job->hash_file, "w");
+    if(!fp)
+        return;
+    fprintf(fp, "%016" PRIx64 "\n", job->hash);
+    fclose(fp);
+}
+
+static void run_unit_job(void* arg)
+{
+    CUnitJob_T* job = arg;
+    job->exit_code = subprocess(job->args->items[0], (char* const*) job->args->items, false);
+}
 
+// compiles the changed units on `-j` threads, then links all objects
+static void c_compile_units(CCodegenData_T* cg, const char* target)
+{
+    ThreadPool_T pool;
+    init_thread_pool(&pool, cg->context->num_threads);
+
+    char march[BUFSIZ] = {'\0'};
+    char pgo[BUFSIZ * 2] = {'\0'};
+    u64 cc_hash = c_hash_cc(cg);
+    CUnitJob_T* jobs = calloc(cg->num_units, sizeof(CUnitJob_T));
+    for(u32 i = 0; i < cg->num_units; i++)
+    {
+        CUnitJob_T* job = &jobs[i];
+        char suffix[32];
+        sprintf(suffix, ".%u.c", i);
+        get_cached_file_path(job->source_file, cg->unit_name, suffix);
+        sprintf(suffix, ".%u.o", i);
+        get_cached_file_path(job->obj_file, cg->unit_name, suffix);
+        sprintf(suffix, ".%u.hash", i);
+        get_cached_file_path(job->hash_file, cg->unit_name, suffix);
 
         const char* args[] = {
             cg->context->cc,
-            c_source_file,
+            "-c",
+            job->source_file,
             "-std=c99",
             "-o",
-            target,
-            "-Wno-builtin-declaration-mismatch", // disable warnings for "extern "C"" function declarations
+            job->obj_file,
+            "-Wno-builtin-declaration-mismatch",
         };
-        List_T* arg_list = init_list_with((void**) args, LEN(args));
+        job->args = init_list_with((void**) args, LEN(args));
 
         if(cg->context->flags.embed_debug_info)
-            list_push(arg_list, "-g");
-        
+            list_push(job->args, "-g");
         if(!cg->context->flags.require_entrypoint)
-        {
-            list_push(arg_list, "-shared");
-            list_push(arg_list, "-fPIC");
-        }
-
+            list_push(job->args, "-fPIC");
         if(cg->context->flags.optimize)
-            list_push(arg_list, "-O2");
-        
-        switch(cg->context->link_mode.mode)
-        {
-            case LINK_STATIC:
-                list_push(arg_list, "-static");
-                break;
-            case LINK_DYNAMIC:
-            {
-                const char* dynamic_linker = cg->context->link_mode.ldynamic.dynamic_linker;
-                if(!file_exists(dynamic_linker))
-                {
-                    cg->context->emitted_warnings++;
-                    LOG_WARN_F(COLOR_BOLD_YELLOW "[Warning]" COLOR_RESET COLOR_YELLOW " dynamic linker `%s` does not exist.\n", dynamic_linker);
-                }
+            list_push(job->args, "-O2");
+        c_push_march(cg, job->args, march);
+        c_push_pgo_flags(cg, job->args, pgo);
+        c_push_lto_flags(cg, job->args, false);
+        for(size_t j = 0; j < cg->context->compiler_flags->size; j++)
+            list_push(job->args, cg->context->compiler_flags->items[j]);
+        list_push(job->args, NULL);
+
+        // unchanged units reuse their object from the last build, unless the profile might have changed
+        job->hash = c_hash_unit(cg, &cg->units[i], job->args, cc_hash);
+        job->cached = !cg->context->pgo_use && c_read_unit_hash(job) == job->hash;
+        if(job->cached)
+            continue;
 
-                size_t len = strlen(dynamic_linker) + 32;
-                char* dynamic_linker_buf = calloc(len + 1, sizeof(char));
-                CONTEXT_ALLOC_REGISTER(cg->context, (void*) dynamic_linker_buf);
+        remove(job->hash_file);
+        init_thread_pool_job(&job->job, run_unit_job, job);
+        thread_pool_submit(&pool, &job->job);
+    }
 
-                snprintf(dynamic_linker_buf, len, "-Wl,-dynamic-linker,%s", dynamic_linker);
-                list_push(arg_list, dynamic_linker_buf);
-            } break;
+    i32 exit_code = 0;
+    for(u32 i = 0; i < cg->num_units; i++)
+    {
+        CUnitJob_T* job = &jobs[i];
+        if(!job->cached)
+        {
+            thread_pool_await(&pool, &job->job);
+            if(job->exit_code)
+                exit_code = job->exit_code;
+            else
+                c_write_unit_hash(job);
         }
+        free_list(job->args);
+    }
+    free_thread_pool(&pool);
 
-        for(size_t i = 0; i < cg->context->compiler_flags->size; i++)
-            list_push(arg_list, cg->context->compiler_flags->items[i]);
-
-        for(size_t i = 0; i < cg->context->link_mode.extra->size; i++)
-            list_push(arg_list, cg->context->link_mode.extra->items[i]);
+    if(exit_code != 0)
+    {
+        free(jobs);
+        LOG_ERROR_F("error compiling code. (exit code %d)\n", exit_code);
+        throw(cg->context->main_error_exception);
+    }
 
-        for(size_t i = 0; i < cg->context->link_mode.libs->size; i++)
-            list_push(arg_list, cg->context->link_mode.libs->items[i]);
+    List_T* arg_list = init_list();
+    list_push(arg_list, cg->context->cc);
+    for(u32 i = 0; i < cg->num_units; i++)
+        list_push(arg_list, jobs[i].obj_file);
 
-        list_push(arg_list, NULL);
-        
-        i32 exit_code = subprocess(arg_list->items[0], (char* const*) arg_list->items, false);
-        free_list(arg_list);
+    char obj_file[BUFSIZ] = {'\0'};
+    if(cg->context->flags.do_linking)
+    {
+        if(!cg->silent)
+            print_linking_msg(cg->context, target, cg->context->flags.require_entrypoint);
 
-        if(exit_code != 0)
+        list_push(arg_list, "-o");
+        list_push(arg_list, (void*) target);
+        if(cg->context->flags.embed_debug_info)
+            list_push(arg_list, "-g");
+        if(!cg->context->flags.require_entrypoint)
+            list_push(arg_list, "-shared");
+        // link-time optimization compiles the units again
+        if(cg->context->flags.lto)
         {
-            LOG_ERROR_F("error compiling code. (exit code %d)\n", exit_code);
-            throw(cg->context->main_error_exception);
+            if(cg->context->flags.optimize)
+                list_push(arg_list, "-O2");
+            c_push_march(cg, arg_list, march);
         }
+        c_push_pgo_flags(cg, arg_list, pgo);
+        c_push_lto_flags(cg, arg_list, true);
+        c_push_link_flags(cg, arg_list);
     }
     else
     {
-        char obj_file[BUFSIZ] = {'\0'};
+        // merge the units into one relocatable object
         get_cached_file_path(obj_file, target, ".o");
+        list_push(arg_list, "-r");
+        list_push(arg_list, "-o");
+        list_push(arg_list, obj_file);
+    }
 
-        const char* args[] = {
-            cg->context->cc,
-            "-c",
-            c_source_file,
-            "-std=c99",
-            "-o",
-            obj_file,
-        };
-        List_T* arg_list = init_list_with((void**) args, LEN(args));
+    c_run_cc(cg, arg_list);
+    free(jobs);
+}
 
-        if(cg->context->flags.embed_debug_info)
-            list_push(arg_list, "-g");
-         
-        for(size_t i = 0; i < cg->context->compiler_flags->size; i++)
-            list_push(arg_list, cg->context->compiler_flags->items[i]);
+// Units are named after the main file instead of the target, so that their cached objects and the
+// profiles the C compiler names after them don't depend on `-o`.
+static char* c_gen_unit_name(CCodegenData_T* cg)
+{
+    char* path = get_absolute_path((char*) cg->ast->main_file_path);
+    const char* main_file = path ? path : cg->ast->main_file_path;
 
-        list_push(arg_list, NULL);
+    char* name = calloc(strlen(main_file) + 32, sizeof(char));
+    CONTEXT_ALLOC_REGISTER(cg->context, (void*) name);
+    sprintf(name, "%s.%08zx", basename((char*) main_file), hashmap_default_hash(main_file) & 0xffffffff);
 
-        i32 exit_code = subprocess(arg_list->items[0], (char* const*) arg_list->items, false);
-        free_list(arg_list);
+    free(path);
+    return name;
+}
 
-        if(exit_code != 0)
-        {
-            LOG_ERROR_F("error compiling code. (exit code %d)\n", exit_code);
-            throw(cg->context->main_error_exception);
-        }
+// splits the program into a header with all declarations and units, which include it
+static void c_gen_units(CCodegenData_T* cg, const char* target)
+{
+    cg->unit_name = c_gen_unit_name(cg);
+
+    List_T* functions = init_list();
+    c_collect_functions(cg, cg->ast->objs, functions);
+    cg->num_units = MAX(MIN(C_NUM_UNITS, functions->size), 1);
+    cg->units = calloc(cg->num_units, sizeof(CCodeUnit_T));
+
+    cg->declare_only = true;
+    c_print(cg, "%s", c_header_text);
+    c_gen_typedefs(cg, cg->ast->objs);
+    c_gen_array_types(cg);
+    c_gen_structs(cg, cg->ast->objs);
+    c_gen_globals(cg, cg->ast->objs);
+    c_gen_pipe_buffers(cg);
+    c_gen_function_definitions(cg, cg->ast->objs);
+    c_gen_lambdas(cg);
+    cg->declare_only = false;
+
+    FILE* header = cg->code_buffer;
+    for(u32 i = 0; i < cg->num_units; i++)
+    {
+        CCodeUnit_T* unit = &cg->units[i];
+        unit->code_buffer = open_memstream(&unit->buf, &unit->buf_len);
+        fprintf(unit->code_buffer, "#include \"%s.h\"\n\n", cg->unit_name);
+    }
+
+    // all global ids are taken by now, the ids of locals only have to be unique per function
+    u64 local_ids = cg->unique_id;
+
+    cg->code_buffer = cg->units[0].code_buffer;
+    c_gen_globals(cg, cg->ast->objs);
+    c_gen_lambdas(cg);
+    c_gen_entry_point(cg);
+
+    // functions get assigned by name, so changing one leaves the other units untouched
+    for(size_t i = 0; i < functions->size; i++)
+    {
+        ASTObj_T* fn = functions->items[i];
+        cg->unique_id = local_ids;
+        cg->code_buffer = cg->units[hashmap_default_hash(c_gen_identifier(cg->context, fn->id)) % cg->num_units].code_buffer;
+        c_gen_function(cg, fn);
+    }
+
+    for(u32 i = 0; i < cg->num_units; i++)
+        fclose(cg->units[i].code_buffer);
+    cg->code_buffer = header;
+    free_list(functions);
+}
+
+void c_gen_code(CCodegenData_T* cg, const char* target)
+{
+    timer_start(cg->context, "C code generation");
+
+    char platform[1024] = { '\0' };
+    get_build(platform);
+    if(!cg->silent)
+    {
+        LOG_OK_F(COLOR_BOLD_BLUE "  Generating" COLOR_BOLD_WHITE " C99" COLOR_RESET " for " COLOR_BOLD_WHITE "%s\n" COLOR_RESET, platform);
+    }
+
+    c_derive_hints(cg->ast);
+
+    // generate the c code
+    if(cg->context->flags.do_assembling)
+        c_gen_units(cg, target);
+    else
+    {
+        c_print(cg, "%s", c_header_text);
+        c_gen_typedefs(cg, cg->ast->objs);
+        c_gen_array_types(cg);
+        c_gen_structs(cg, cg->ast->objs);
+        c_gen_globals(cg, cg->ast->objs);
+        c_gen_pipe_buffers(cg);
+        c_gen_function_definitions(cg, cg->ast->objs);
+        c_gen_lambdas(cg);
+        c_gen_functions(cg, cg->ast->objs);
+        c_gen_entry_point(cg);
+    }
+    write_code(cg, target, cg->context->flags.do_assembling);
+
+    if(cg->print)
+    {
+        if(!cg->silent)
+            LOG_INFO(COLOR_RESET);
+        fprintf(OUTPUT_STREAM, "%s", cg->buf);
+        for(u32 i = 0; i < cg->num_units; i++)
+            fprintf(OUTPUT_STREAM, "%s", cg->units[i].buf);
     }
 
     timer_stop(cg->context);
+
+    if(!cg->context->flags.do_assembling)
+        return;
+
+    timer_start(cg->context, "compiling C code");
+
+    if(cg->context->pgo_use && !pgo_has_cc_profile(cg->context))
+    {
+        cg->context->emitted_warnings++;
+        LOG_WARN_F(COLOR_BOLD_YELLOW "[Warning]" COLOR_RESET COLOR_YELLOW " no profile of the C compiler found in `%s`.\n", cg->context->pgo_use);
+    }
+
+    c_compile_units(cg, target);
+
+    timer_stop(cg->context);
 }
 
 static char* c_gen_identifier(Context_T* context, ASTIdentifier_T* id)
@@ -850,6 +1186,11 @@ static void c_gen_globals(CCodegenData_T* cg, List_T* objs)
                         if(!should_emit(cg->context, member))
                             continue;
                         char* id = c_gen_identifier(cg->context, member->id);
+                        if(cg->declare_only)
+                        {
+                            c_println(cg, "extern int %s;", id);
+                            continue;
+                        }
                         c_print(cg, "int %s = ", id);
                         c_gen_expr(cg, member->value, false);
                         c_println(cg, ";");
@@ -860,10 +1201,10 @@ static void c_gen_globals(CCodegenData_T* cg, List_T* objs)
             if(!should_emit(cg->context, obj))
                 continue;
             {
-                if(obj->is_extern)
+                if(obj->is_extern || cg->declare_only)
                     c_print(cg, "extern ");
                 c_gen_typed_name_str(cg, obj->is_extern ? EITHER(obj->exported, obj->id->callee) : c_gen_identifier(cg->context, obj->id), obj->data_type);
-                if(obj->value)
+                if(obj->value && !cg->declare_only)
                 {
                     c_print(cg, " = ");
                     c_gen_expr(cg, obj->value, false);
@@ -880,16 +1221,29 @@ static void c_gen_globals(CCodegenData_T* cg, List_T* objs)
     }
 }
 
+static void c_gen_function_attributes(CCodegenData_T* cg, ASTObj_T* obj)
+{
+    if(obj->data_type->no_return)
+        c_print(cg, "_attr(noreturn, cold) ");
+    else if(obj->purity == PURITY_CONST)
+        c_print(cg, "_attr(const) ");
+    else if(obj->purity == PURITY_PURE)
+        c_print(cg, "_attr(pure) ");
+}
+
 static void c_gen_function_declaration(CCodegenData_T* cg, ASTObj_T* obj)
 {
     if(obj->return_type->kind == TY_STRUCT)
         c_gen_anon_struct_typedef(cg, obj->return_type);
 
-    if(cg->context->flags.embed_debug_info && obj->tok)
+    // line numbers would change the header with every added line
+    if(cg->context->flags.embed_debug_info && obj->tok && !cg->declare_only)
         c_println(cg, "#line %zu \"%s\"", obj->tok->line + 1, obj->tok->source->path);
 
-    c_print(cg, obj->is_extern || obj->exported ? "extern " : "static ");
-    
+    // units call each other's functions
+    c_print(cg, obj->is_extern || obj->exported ? "extern " : cg->num_units ? "" : "static ");
+    c_gen_function_attributes(cg, obj);
+
     if(obj->return_type->kind == TY_STRUCT)
     {
         char buffer[BUFSIZ] = {0};
@@ -907,7 +1261,13 @@ static void c_gen_function_declaration(CCodegenData_T* cg, ASTObj_T* obj)
     for(size_t i = 0; i < obj->args->size; i++)
     {
         ASTObj_T* arg = obj->args->items[i];
-        c_gen_typed_name(cg, arg->id, arg->data_type);
+        if(obj->no_alias && unpack(arg->data_type)->kind == TY_PTR)
+        {
+            c_gen_type(cg, arg->data_type, false);
+            c_print(cg, " restrict %s", c_gen_identifier(cg->context, arg->id));
+        }
+        else
+            c_gen_typed_name(cg, arg->id, arg->data_type);
         if(obj->args->size - i > 1)
             c_putc(cg, ',');
     }
@@ -945,7 +1305,10 @@ static void c_gen_lambda(ASTNode_T* node, va_list custom_args)
 {
     GET_CG(custom_args);
 
-    u64 uid = node->long_val = cg->unique_id++;
+    // lambdas declared in the header keep their id
+    if(cg->declare_only || !cg->num_units)
+        node->long_val = cg->unique_id++;
+    u64 uid = node->long_val;
 
     c_gen_type(cg, node->data_type->base, false);
     c_print(cg, " " UNIQUE_ID_FMT "(void** __args", uid);
@@ -961,6 +1324,12 @@ static void c_gen_lambda(ASTNode_T* node, va_list custom_args)
                 c_putc(cg, ',');
         }
     }
+
+    if(cg->declare_only)
+    {
+        c_println(cg, ");");
+        return;
+    }
     c_println(cg, "){");
 
     u64 index = 0;
@@ -1024,10 +1393,38 @@ static void c_gen_lambdas(CCodegenData_T* cg)
     ast_iterate(&iter, cg->ast, cg);
 }
 
+static bool c_same_type(ASTType_T* a, ASTType_T* b)
+{
+    a = unpack(a);
+    b = unpack(b);
+    if(a == b)
+        return true;
+    if(a->kind != b->kind || a->size != b->size)
+        return false;
+    if(a->kind == TY_PTR)
+        return c_same_type(a->base, b->base);
+    return (is_numeric(a) && a->kind != TY_ENUM) || a->kind == TY_VOID;
+}
+
+// `musttail` requires the caller and callee of tail calls to have matching signatures
+static bool c_same_signature(ASTObj_T* caller, ASTObj_T* callee)
+{
+    if(!callee || callee->kind != OBJ_FUNCTION || caller->args->size != callee->args->size)
+        return false;
+    if(is_variadic(caller->data_type) || is_variadic(callee->data_type) || !c_same_type(caller->return_type, callee->return_type))
+        return false;
+
+    for(size_t i = 0; i < caller->args->size; i++)
+        if(!c_same_type(((ASTObj_T*) caller->args->items[i])->data_type, ((ASTObj_T*) callee->args->items[i])->data_type))
+            return false;
+    return true;
+}
+
 static void c_gen_function(CCodegenData_T* cg, ASTObj_T* fn)
 {
     c_gen_function_declaration(cg, fn);
     c_println(cg, "{");
+    cg->current_fn = fn;
 
     if(fn->va_area)
     {
@@ -1636,9 +2033,12 @@ static void c_gen_stmt(CCodegenData_T* cg, ASTNode_T* node)
     } break;
 
     case ND_IF:
-        c_print(cg, "if(");
+    {
+        // branches ending in `[no_return]` calls are error paths
+        bool cold_if = c_is_cold_path(node->if_branch), cold_else = c_is_cold_path(node->else_branch);
+        c_print(cg, "if(%s(", cold_if == cold_else ? "" : cold_if ? "_unlikely" : "_likely");
         c_gen_expr(cg, node->condition, true);
-        c_println(cg, "){");
+        c_println(cg, ")){");
         c_gen_stmt(cg, node->if_branch);
         if(node->else_branch)
         {
@@ -1646,7 +2046,7 @@ static void c_gen_stmt(CCodegenData_T* cg, ASTNode_T* node)
             c_gen_stmt(cg, node->else_branch);
         }
         c_println(cg, "}");
-        break;
+    } break;
     
     case ND_LOOP:
         c_println(cg, "for(;;){");
@@ -1671,9 +2071,9 @@ static void c_gen_stmt(CCodegenData_T* cg, ASTNode_T* node)
         break;
     
     case ND_DO_UNLESS:
-        c_print(cg, "if(!(");
+        c_print(cg, "if(%s(!(", c_is_cold_path(node->body) ? "_unlikely" : "");
         c_gen_expr(cg, node->condition, true);
-        c_println(cg, ")){");
+        c_println(cg, "))){");
         c_gen_stmt(cg, node->body);
         c_println(cg, "}");
         break;
@@ -1694,8 +2094,19 @@ static void c_gen_stmt(CCodegenData_T* cg, ASTNode_T* node)
     case ND_RETURN:
         if(node->return_val) 
         {
-            if(unpack(node->return_val->data_type)->kind != TY_VOID)
+            // calls in `[tailcall]` functions must not silently become normal calls
+            if(node->tail_call && cg->current_fn->tail_call)
+            {
+                if(!c_same_signature(cg->current_fn, node->return_val->called_obj))
+                    throw_error(cg->context, ERR_CODEGEN, node->tok, "cannot compile this call as a tail call in C: `musttail` requires the called function to have the same signature");
+                c_print(cg, "_tailcall return ");
+            }
+            else if(unpack(node->return_val->data_type)->kind != TY_VOID)
+            {
+                if(node->tail_call && c_same_signature(cg->current_fn, node->return_val->called_obj))
+                    c_print(cg, "_musttail ");
                 c_print(cg, "return ");
+            }
             c_gen_expr(cg, node->return_val, true);
             c_println(cg, ";");
         }
@@ -10,6 +10,14 @@
 extern char* cc;
 extern char* cc_flags;
 
+// a separately compiled .c file
+typedef struct C_CODE_UNIT_STRUCT
+{
+    char* buf;
+    size_t buf_len;
+    FILE* code_buffer;
+} CCodeUnit_T;
+
 typedef struct C_CODEGEN_DATA_STRUCT
 {
     Context_T* context;
@@ -22,10 +30,17 @@ typedef struct C_CODEGEN_DATA_STRUCT
     HashMap_T* arrays;
     HashMap_T* anon_structs;
     List_T* blocks;
+    ASTObj_T* current_fn;
 
     char* buf;
     size_t buf_len;
     FILE* code_buffer;
+
+    // when compiling, functions get split into units, which share `buf` as header
+    CCodeUnit_T* units;
+    u32 num_units;
+    char* unit_name; // base name of the header and unit files in the cache
+    bool declare_only; // declare globals and lambdas in the header instead of defining them
 } CCodegenData_T;
 
 i32 transpiler_pass(Context_T* context, ASTProg_T* ast);
@@ -0,0 +1,382 @@
+#include "c_hints.h"
+#include "ast/ast_iterator.h"
+#include "codegen/codegen_utils.h"
+#include "list.h"
+
+#include <stdarg.h>
+
+#define GET_FN_HINTS(va) FnHints_T* h = va_arg(va, FnHints_T*)
+#define GET_CALL_SITES(va) CallSites_T* cs = va_arg(va, CallSites_T*)
+
+typedef struct FN_HINTS_STRUCT
+{
+    ASTObj_T* fn;
+    CPurity_T purity;
+    bool no_alias;
+    List_T* accesses; // ids of pointer arguments, which get dereferenced
+} FnHints_T;
+
+typedef struct CALL_SITES_STRUCT
+{
+    List_T* passed;  // addresses of locals passed to `no_alias` functions
+    List_T* targets; // the function each of `passed` gets passed to
+    List_T* benign;  // ids of called functions and indexed arrays
+    List_T* escaped; // locals, whose address gets taken elsewhere
+} CallSites_T;
+
+static CPurity_T fn_purity(ASTObj_T* fn);
+
+// ids don't always carry their type
+static ASTType_T* type_of(ASTNode_T* node)
+{
+    return unpack(node->kind == ND_ID && node->referenced_obj ? node->referenced_obj->data_type : node->data_type);
+}
+
+static bool is_pointer_obj(ASTObj_T* obj)
+{
+    ASTType_T* ty = unpack(obj->data_type);
+    return ty && is_pointer(ty);
+}
+
+static bool is_c_array(ASTNode_T* node)
+{
+    ASTType_T* ty = type_of(node);
+    return ty && ty->kind == TY_C_ARRAY;
+}
+
+static ASTObj_T* referenced(ASTNode_T* node, ASTObjKind_T kind)
+{
+    return node->kind == ND_ID && node->referenced_obj && node->referenced_obj->kind == kind ? node->referenced_obj : NULL;
+}
+
+// whether accessing elements or members of `node` reads memory outside the stack frame,
+// C array arguments are pointers in C
+static bool is_indirect(ASTNode_T* node)
+{
+    ASTType_T* ty = type_of(node);
+    return !ty || ty->kind == TY_PTR || ty->kind == TY_VLA || (referenced(node, OBJ_FN_ARG) && ty->kind == TY_C_ARRAY);
+}
+
+// whether writing to `node` stays inside the stack frame
+static bool in_frame(ASTNode_T* node)
+{
+    switch(node->kind)
+    {
+        case ND_CLOSURE:
+            return node->exprs->size && in_frame(node->exprs->items[node->exprs->size - 1]);
+        case ND_ID:
+            return referenced(node, OBJ_LOCAL) || (referenced(node, OBJ_FN_ARG) && !is_c_array(node));
+        case ND_MEMBER:
+        case ND_INDEX:
+            return !is_indirect(node->left) && in_frame(node->left);
+        default:
+            return false;
+    }
+}
+
+static void lower(FnHints_T* h, CPurity_T purity)
+{
+    if(purity < h->purity)
+        h->purity = purity;
+}
+
+static void hints_id(ASTNode_T* id, va_list args)
+{
+    GET_FN_HINTS(args);
+    ASTObj_T* obj = id->referenced_obj;
+    if(!obj)
+        return;
+
+    if(obj->kind == OBJ_GLOBAL && !obj->is_constant)
+        lower(h, PURITY_PURE);
+    else if(obj->kind == OBJ_FN_ARG && is_pointer_obj(obj) && !list_contains(h->accesses, id))
+        h->no_alias = false;
+}
+
+static void hints_access(FnHints_T* h, ASTNode_T* base)
+{
+    if(is_indirect(base))
+        lower(h, PURITY_PURE);
+    if(base->kind == ND_ID)
+        list_push(h->accesses, base);
+}
+
+static void hints_deref(ASTNode_T* deref, va_list args)
+{
+    GET_FN_HINTS(args);
+    lower(h, PURITY_PURE);
+    if(deref->right->kind == ND_ID)
+        list_push(h->accesses, deref->right);
+}
+
+static void hints_member(ASTNode_T* node, va_list args)
+{
+    GET_FN_HINTS(args);
+    hints_access(h, node->left);
+}
+
+// `len` reads the length of VLAs and the string behind `&char`
+static void hints_len(ASTNode_T* len, va_list args)
+{
+    GET_FN_HINTS(args);
+    hints_access(h, len->expr);
+}
+
+static void hints_write(ASTNode_T* node, va_list args)
+{
+    GET_FN_HINTS(args);
+    if(!in_frame(node->left))
+        lower(h, PURITY_NONE);
+}
+
+static void hints_call(ASTNode_T* call, va_list args)
+{
+    GET_FN_HINTS(args);
+    ASTObj_T* callee = referenced(call->expr, OBJ_FUNCTION);
+    CPurity_T purity = callee ? fn_purity(callee) : PURITY_NONE;
+    lower(h, purity);
+
+    // other functions could access the arguments' memory
+    if(purity != PURITY_CONST)
+        h->no_alias = false;
+}
+
+// loops may not terminate, pipes use global buffers
+static void hints_impure(ASTNode_T* node, va_list args)
+{
+    GET_FN_HINTS(args);
+    lower(h, PURITY_NONE);
+}
+
+static void hints_opaque(ASTNode_T* node, va_list args)
+{
+    GET_FN_HINTS(args);
+    lower(h, PURITY_NONE);
+    h->no_alias = false;
+}
+
+static const ASTIteratorList_T fn_hints_iter = {
+    .node_start_fns = {
+        [ND_ID] = hints_id,
+        [ND_DEREF] = hints_deref,
+        [ND_MEMBER] = hints_member,
+        [ND_INDEX] = hints_member,
+        [ND_LEN] = hints_len,
+        [ND_ASSIGN] = hints_write,
+        [ND_INC] = hints_write,
+        [ND_DEC] = hints_write,
+        [ND_CALL] = hints_call,
+        [ND_LOOP] = hints_impure,
+        [ND_WHILE] = hints_impure,
+        [ND_DO_WHILE] = hints_impure,
+        [ND_FOR] = hints_impure,
+        [ND_FOR_RANGE] = hints_impure,
+        [ND_PIPE] = hints_impure,
+        [ND_WITH] = hints_opaque,
+        [ND_LAMBDA] = hints_opaque,
+        [ND_ASM] = hints_opaque,
+    }
+};
+
+static bool has_pointer_args(ASTObj_T* fn)
+{
+    for(size_t i = 0; i < fn->args->size; i++)
+        if(is_pointer_obj(fn->args->items[i]))
+            return true;
+    return false;
+}
+
+static CPurity_T fn_purity(ASTObj_T* fn)
+{
+    if(fn->purity != PURITY_UNKNOWN)
+        return fn->purity;
+
+    // recursion may not terminate
+    fn->purity = PURITY_NONE;
+    if(!fn->body || fn->is_entry_point || is_variadic(fn->data_type) || fn->data_type->no_return)
+        return PURITY_NONE;
+
+    FnHints_T h = {
+        .fn = fn,
+        .purity = PURITY_CONST,
+        .no_alias = !fn->exported && !fn->before_main && !fn->after_main && has_pointer_args(fn),
+        .accesses = init_list()
+    };
+    ast_iterate_stmt(&fn_hints_iter, fn->body, &h);
+    free_list(h.accesses);
+
+    // the C compiler may drop calls of `pure` functions without using their result
+    ASTType_T* ret = unpack(fn->return_type);
+    fn->purity = ret && ret->kind != TY_VOID ? h.purity : PURITY_NONE;
+    fn->no_alias = h.no_alias;
+    return fn->purity;
+}
+
+static void derive_fn_hints(List_T* objs)
+{
+    for(size_t i = 0; i < objs->size; i++)
+    {
+        ASTObj_T* obj = objs->items[i];
+        if(obj->kind == OBJ_NAMESPACE)
+            derive_fn_hints(obj->objs);
+        else if(obj->kind == OBJ_FUNCTION)
+            fn_purity(obj);
+    }
+}
+
+static ASTNode_T* strip_arg(ASTNode_T* node)
+{
+    while((node->kind == ND_CLOSURE && node->exprs->size == 1) || node->kind == ND_CAST)
+        node = node->kind == ND_CAST ? node->left : node->exprs->items[0];
+    return node;
+}
+
+// the local `arg` points to, arrays decay to their address
+static ASTObj_T* address_of_local(ASTNode_T* arg)
+{
+    if(arg->kind == ND_REF)
+        return referenced(arg->right, OBJ_LOCAL);
+    return is_c_array(arg) ? referenced(arg, OBJ_LOCAL) : NULL;
+}
+
+static void sites_call(ASTNode_T* call, va_list args)
+{
+    GET_CALL_SITES(args);
+    ASTObj_T* fn = referenced(call->expr, OBJ_FUNCTION);
+    if(!fn)
+        return;
+    list_push(cs->benign, call->expr);
+    if(!fn->no_alias)
+        return;
+
+    if(call->args->size != fn->args->size)
+    {
+        fn->no_alias = false;
+        return;
+    }
+
+    List_T* locals = init_list();
+    for(size_t i = 0; i < call->args->size && fn->no_alias; i++)
+    {
+        if(!is_pointer_obj(fn->args->items[i]))
+            continue;
+
+        ASTNode_T* arg = call->args->items[i];
+        ASTNode_T* stripped = strip_arg(arg);
+        ASTObj_T* local = address_of_local(stripped);
+        if(arg->unpack_mode || !local || list_contains(locals, local))
+        {
+            fn->no_alias = false;
+            break;
+        }
+
+        list_push(locals, local);
+        list_push(cs->passed, stripped);
+        list_push(cs->targets, fn);
+    }
+    free_list(locals);
+}
+
+static void sites_id(ASTNode_T* id, va_list args)
+{
+    GET_CALL_SITES(args);
+    if(list_contains(cs->benign, id) || list_contains(cs->passed, id))
+        return;
+
+    ASTObj_T* fn = referenced(id, OBJ_FUNCTION);
+    if(fn)
+        // function pointers hide the call sites
+        fn->no_alias = false;
+    else if(is_c_array(id) && referenced(id, OBJ_LOCAL))
+        list_push(cs->escaped, id->referenced_obj);
+}
+
+static void sites_ref(ASTNode_T* ref, va_list args)
+{
+    GET_CALL_SITES(args);
+    ASTObj_T* local = referenced(ref->right, OBJ_LOCAL);
+    if(!local)
+        return;
+    list_push(cs->benign, ref->right);
+    if(!list_contains(cs->passed, ref))
+        list_push(cs->escaped, local);
+}
+
+static void sites_access(ASTNode_T* node, va_list args)
+{
+    GET_CALL_SITES(args);
+    ASTNode_T* base = node->kind == ND_LEN ? node->expr : node->left;
+    if(base->kind == ND_ID)
+        list_push(cs->benign, base);
+}
+
+static void sites_fn_end(ASTObj_T* fn, va_list args)
+{
+    GET_CALL_SITES(args);
+    for(size_t i = 0; i < cs->passed->size; i++)
+        if(list_contains(cs->escaped, address_of_local(cs->passed->items[i])))
+            ((ASTObj_T*) cs->targets->items[i])->no_alias = false;
+
+    list_clear(cs->passed);
+    list_clear(cs->targets);
+    list_clear(cs->benign);
+    list_clear(cs->escaped);
+}
+
+static const ASTIteratorList_T call_sites_iter = {
+    .node_start_fns = {
+        [ND_CALL] = sites_call,
+        [ND_ID] = sites_id,
+        [ND_REF] = sites_ref,
+        [ND_INDEX] = sites_access,
+        [ND_ASSIGN] = sites_access,
+        [ND_LEN] = sites_access,
+    },
+    .obj_end_fns = {
+        [OBJ_FUNCTION] = sites_fn_end,
+    }
+};
+
+void c_derive_hints(ASTProg_T* ast)
+{
+    derive_fn_hints(ast->objs);
+
+    CallSites_T cs = {
+        .passed = init_list(),
+        .targets = init_list(),
+        .benign = init_list(),
+        .escaped = init_list()
+    };
+    ast_iterate(&call_sites_iter, ast, &cs);
+
+    free_list(cs.passed);
+    free_list(cs.targets);
+    free_list(cs.benign);
+    free_list(cs.escaped);
+}
+
+bool c_is_cold_path(ASTNode_T* stmt)
+{
+    if(!stmt)
+        return false;
+
+    switch(stmt->kind)
+    {
+        case ND_EXPR_STMT:
+            return c_is_cold_path(stmt->expr);
+        case ND_CALL:
+        {
+            ASTType_T* ty = unpack(stmt->expr->data_type);
+            return ty && ty->no_return;
+        }
+        case ND_BLOCK:
+            for(size_t i = 0; i < stmt->stmts->size; i++)
+                if(c_is_cold_path(stmt->stmts->items[i]))
+                    return true;
+            return false;
+        case ND_IF:
+            return c_is_cold_path(stmt->if_branch) && c_is_cold_path(stmt->else_branch);
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef CSPYDR_C_HINTS_H
+#define CSPYDR_C_HINTS_H
+
+#include "ast/ast.h"
+
+// Facts about functions, which the transpiler passes on to the C compiler:
+//
+// - functions without loops, inline assembly or lambdas, which only write local variables and only
+//   call such functions, are `pure`, or `const` if they don't read memory through pointers or
+//   mutable globals either;
+// - pointer arguments get `restrict` if the function only dereferences them and every call passes
+//   the addresses of distinct local variables, whose addresses are not taken anywhere else;
+// - `[no_return]` functions are `noreturn` and `cold`, branches calling them are unlikely.
+
+typedef enum {
+    PURITY_UNKNOWN,
+    PURITY_NONE,
+    PURITY_PURE,
+    PURITY_CONST,
+} CPurity_T;
+
+// sets `purity` and `no_alias` of all functions
+void c_derive_hints(ASTProg_T* ast);
+
+// whether `stmt` always ends in a call to a `[no_return]` function
+bool c_is_cold_path(ASTNode_T* stmt);
+
+#endif
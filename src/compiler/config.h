@@ -70,6 +70,7 @@
 #define __CSP_MAX_PASSES 32
 
 #define MALLOC_RETRY_COUNT 10
+#define ALLOCATOR_CHUNK_SIZE 0x10000 // size of the chunks used by region allocators
 
 #define OUTPUT_STREAM stdout
 #define ERR_OUTPUT_STREAM stderr
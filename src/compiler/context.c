@@ -1,6 +1,7 @@
 #include "context.h"
 #include "config.h"
 #include "hashmap.h"
+#include "interner.h"
 #include "list.h"
 #include "memory/allocator.h"
 
@@ -21,12 +22,14 @@ void init_context(Context_T* context)
 {
     memset(context, 0, sizeof(Context_T));
     
-    init_allocator(&context->raw_allocator, free);
+    init_region_allocator(&context->raw_allocator);
     init_allocator(&context->list_allocator, (void (*)(void*)) free_list);
     init_allocator(&context->hashmap_allocator, (void (*)(void*)) hashmap_free);
+    init_interner(&context->interner);
     context->flags = default_flags();
 
     context->max_macro_call_depth = __CSP_DEFAULT_MAX_MACRO_CALL_DEPTH;
+    context->num_threads = 1;
     
     context->compiler_flags = init_list();
     link_mode_init_default(&context->link_mode);
@@ -45,6 +48,7 @@ void free_context(Context_T *context)
     free_allocator(&context->raw_allocator);
     free_allocator(&context->list_allocator);
     free_allocator(&context->raw_allocator);
+    free_interner(&context->interner);
     link_mode_free(&context->link_mode);
 }
 
@@ -53,6 +57,7 @@ void context_free_allocators(Context_T* context)
     free_allocator(&context->raw_allocator);
     free_allocator(&context->list_allocator);
     free_allocator(&context->raw_allocator);
+    free_interner(&context->interner);
 }
 
 void link_mode_init_default(LinkMode_T* link_mode)
@@ -70,3 +75,46 @@ void link_mode_free(LinkMode_T* link_mode)
     free_list(link_mode->extra);
 }
 
+
+bool target_cpu_isa(const char* cpu, TargetISA_T* isa)
+{
+    static const struct {
+        const char* name;
+        TargetISA_T isa;
+    } cpus[] = {
+        {"x86-64",      ISA_SSE2},
+        {"x86-64-v2",   ISA_SSE4_1},
+        {"x86-64-v3",   ISA_AVX2},
+        {"x86-64-v4",   ISA_AVX2},
+        {"nehalem",     ISA_SSE4_1},
+        {"sandybridge", ISA_SSE4_1},
+        {"haswell",     ISA_AVX2},
+        {"skylake",     ISA_AVX2},
+        {"znver1",      ISA_AVX2},
+        {"znver2",      ISA_AVX2},
+        {"znver3",      ISA_AVX2},
+        {"znver4",      ISA_AVX2},
+    };
+
+    if(strcmp(cpu, "native") == 0)
+    {
+        // the binary runs on the machine compiling it
+        *isa = ISA_SSE2;
+#if defined(__GNUC__) && defined(__x86_64__)
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+            *isa = ISA_AVX2;
+        else if(__builtin_cpu_supports("sse4.1"))
+            *isa = ISA_SSE4_1;
+#endif
+        return true;
+    }
+
+    for(size_t i = 0; i < LEN(cpus); i++)
+        if(strcmp(cpu, cpus[i].name) == 0)
+        {
+            *isa = cpus[i].isa;
+            return true;
+        }
+    return false;
+}
@@ -4,6 +4,7 @@
 #include "ast/ast.h"
 #include "error/exception.h"
 #include "hashmap.h"
+#include "interner.h"
 #include "list.h"
 #include "memory/allocator.h"
 #include "util.h"
@@ -41,12 +42,22 @@ typedef struct CSPYDR_LINKMODE_STRUCT {
 void link_mode_init_default(LinkMode_T* link_mode);
 void link_mode_free(LinkMode_T* link_mode);
 
+// vector extensions the generated code may use, selected with --target-cpu
+typedef enum TARGET_ISA_ENUM {
+    ISA_SSE2, // baseline x86_64
+    ISA_SSE4_1,
+    ISA_AVX2,
+} TargetISA_T;
+
+bool target_cpu_isa(const char* cpu, TargetISA_T* isa);
+
 typedef struct CSPYDR_CONTEXT_STRUCT {
     i32 ct;
     i32 fs;
 
     i32 last_exit_code;
     u32 max_macro_call_depth;
+    u32 num_threads; // threads used by parallel stages (-j)
 
     u32 emitted_warnings;
     u32 emitted_errors;
@@ -70,6 +81,14 @@ typedef struct CSPYDR_CONTEXT_STRUCT {
 
     char* as;
 
+    char* target_cpu; // passed to the C compiler as -march, NULL for the default
+    bool no_loop_opt; // --no-loop-opt, see optimizer/loops.h
+    TargetISA_T target_isa;
+
+    // profile-guided optimization, see codegen/pgo.h
+    bool pgo_generate; // --pgo-generate
+    char* pgo_use;     // profile directory of --pgo-use, NULL otherwise
+
     char* ld;
     LinkMode_T link_mode;
     
@@ -85,6 +104,9 @@ typedef struct CSPYDR_CONTEXT_STRUCT {
     Allocator_T list_allocator;
     Allocator_T hashmap_allocator;
 
+    // identifiers and other names, compared by address
+    Interner_T interner;
+
     // timesteps recorded by `timer/timer.c`
     List_T* timesteps;
 } Context_T;
@@ -45,7 +45,12 @@ void default_error_handler(Context_T* context, ErrorType_T ty, Token_T* tok, con
                             "%*s | " COLOR_BOLD_BLUE "%*s^"; // the pointer to the error in the source
     const char err_tmp3[] = "-here" COLOR_RESET "\n";        // the end of the error message
 
-    char* raw_src_line = get_line(tok->source, tok->line);
+    // source lines are not '\0'-terminated, so copy the line before trimming it
+    char raw_src_line[BUFSIZ] = {'\0'};
+    u32 line_len = MIN(get_line_len(tok->source, tok->line), LEN(raw_src_line) - 1);
+    if(line_len)
+        memcpy(raw_src_line, get_line(tok->source, tok->line), line_len);
+    
     char* src_line = trim(raw_src_line);
     ptrdiff_t trim_offset = src_line - raw_src_line;
 
@@ -60,9 +65,9 @@ void default_error_handler(Context_T* context, ErrorType_T ty, Token_T* tok, con
     fprintf(ERR_OUTPUT_STREAM, err_tmp1, source_file_path, (long) line, (long) character, is_error ? COLOR_BOLD_RED : COLOR_BOLD_YELLOW, error_str);
     vfprintf(ERR_OUTPUT_STREAM, format, args);
     fprintf(ERR_OUTPUT_STREAM, err_tmp2, ERR_LINE_NUMBER_SPACES, line, src_line, src_line[strlen(src_line) - 1] == '\n' ? "" : "\n ", 
-            ERR_LINE_NUMBER_SPACES, "", (int) (character - strlen(tok->value) - trim_offset), "");
+            ERR_LINE_NUMBER_SPACES, "", (int) (character - tok->length - trim_offset), "");
 
-    for(u32 i = 0; i < strlen(tok->value) - 1; i++)
+    for(u32 i = 1; i < tok->length; i++)
         putc('~', ERR_OUTPUT_STREAM);
     fprintf(ERR_OUTPUT_STREAM, err_tmp3);
 }
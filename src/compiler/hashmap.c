@@ -1,4 +1,5 @@
 #include "hashmap.h"
+#include "interner.h"
 #include "list.h"
 #include "util.h"
 
@@ -25,6 +26,7 @@ struct HASHMAP_STRUCT
     size_t size;
     size_t alloc;
     HashPair_T* pairs;
+    bool interned_keys; // use the stored hash and compare keys by address
 };
 
 static inline size_t hashmap_calc_size(HashMap_T* map);
@@ -45,11 +47,19 @@ HashMap_T* hashmap_init_sized(size_t size)
     HashMap_T* map = malloc(sizeof(struct HASHMAP_STRUCT));
     map->size = 0;
     map->alloc = actual_size;
+    map->interned_keys = false;
     map->pairs = calloc(map->alloc, sizeof(HashPair_T));
 
     return map;
 }
 
+HashMap_T* hashmap_init_interned(void)
+{
+    HashMap_T* map = hashmap_init();
+    map->interned_keys = true;
+    return map;
+}
+
 void hashmap_free(HashMap_T* map)
 {
     free(map->pairs);
@@ -63,7 +73,7 @@ int hashmap_put(HashMap_T* map, char* key, void* value)
 
     size_t map_size = hashmap_calc_size(map);
     
-    if(map_size > map->size)
+    if(map_size > map->alloc)
         hashmap_rehash(map, map_size);
 
     HashPair_T* pair = hashmap_find_pair(map, key, true);
@@ -176,7 +186,7 @@ size_t hashmap_default_hash(const char* data)
 
 static inline size_t hashmap_calc_index(const HashMap_T* map, const char* key)
 {
-    size_t index = HASHMAP_HASH_FUNCTION(key);
+    size_t index = map->interned_keys ? interned_hash(key) : HASHMAP_HASH_FUNCTION(key);
     return HASHMAP_SIZE_MOD(map, index);
 }
 
@@ -191,7 +201,7 @@ static inline HashPair_T* hashmap_find_pair(const HashMap_T* map, const char* ke
         if(!pair->key)
             return find_empty ? pair : NULL;
         
-        if(strcmp(key, pair->key) == 0)
+        if(map->interned_keys ? key == pair->key : strcmp(key, pair->key) == 0)
             return pair;
         
         index = HASHMAP_PROBE_NEXT(map, index);
@@ -7,6 +7,7 @@ typedef struct HASHMAP_STRUCT HashMap_T;
 
 HashMap_T* hashmap_init();
 HashMap_T* hashmap_init_sized(size_t size);
+HashMap_T* hashmap_init_interned(void); // keys have to be interned, see interner.h
 void hashmap_free(HashMap_T* map);
 int hashmap_put(HashMap_T* map, char* key, void* val);
 void* hashmap_get(const HashMap_T* map, const char* key);
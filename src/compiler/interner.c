@@ -0,0 +1,159 @@
+#include "interner.h"
+#include "io/log.h"
+
+#include <string.h>
+#include <assert.h>
+
+#ifndef INTERNER_INIT_SIZE
+    #define INTERNER_INIT_SIZE 1024
+#endif
+
+#ifndef INTERNER_CHUNK_SIZE
+    #define INTERNER_CHUNK_SIZE 0x4000
+#endif
+
+#define INTERNER_SIZE_MOD(interner, val) ((val) & ((interner)->alloc - 1))
+
+// every interned string is preceded by this header
+typedef struct INTERNED_HEADER_STRUCT {
+    u32 hash;
+    u32 length;
+} InternedHeader_T;
+
+#define INTERNED_HEADER(str) (((InternedHeader_T*) (str)) - 1)
+
+struct INTERNER_CHUNK_STRUCT {
+    InternerChunk_T* next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+void init_interner(Interner_T* interner)
+{
+    // lazy initialization, like the allocators
+    memset(interner, 0, sizeof(Interner_T));
+}
+
+void free_interner(Interner_T* interner)
+{
+    for(InternerChunk_T* chunk = interner->chunks, *next; chunk; chunk = next)
+    {
+        next = chunk->next;
+        free(chunk);
+    }
+
+    free(interner->slots);
+    init_interner(interner);
+}
+
+static void* interner_calloc(size_t count, size_t size)
+{
+    void* ptr = calloc(count, size);
+    if(!ptr)
+    {
+        LOG_ERROR_F(COLOR_BOLD_RED "[Error]" COLOR_RESET COLOR_RED " allocating %ld bytes of memory\n", count * size);
+        exit(2);
+    }
+    return ptr;
+}
+
+// FNV-1a, see http://www.isthe.com/chongo/tech/comp/fnv/
+static inline u32 interner_hash(const char* str, size_t length)
+{
+    u32 hash = 2166136261u;
+    for(size_t i = 0; i < length; i++)
+    {
+        hash ^= (u8) str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static char* interner_store(Interner_T* interner, const char* str, size_t length, u32 hash)
+{
+    size_t needed = (sizeof(InternedHeader_T) + length + 1 + 7) & ~7ul; // keep headers aligned
+
+    InternerChunk_T* chunk = interner->chunks;
+    if(!chunk || chunk->size - chunk->used < needed)
+    {
+        size_t size = MAX(needed, INTERNER_CHUNK_SIZE);
+        chunk = interner_calloc(1, sizeof(InternerChunk_T) + size);
+        chunk->size = size;
+        chunk->next = interner->chunks;
+        interner->chunks = chunk;
+    }
+
+    InternedHeader_T* header = (InternedHeader_T*) &chunk->data[chunk->used];
+    chunk->used += needed;
+
+    header->hash = hash;
+    header->length = length;
+
+    char* interned = (char*) (header + 1);
+    memcpy(interned, str, length);
+    interned[length] = '\0';
+    return interned;
+}
+
+static void interner_grow(Interner_T* interner)
+{
+    size_t old_alloc = interner->alloc;
+    char** old_slots = interner->slots;
+
+    interner->alloc = old_alloc ? old_alloc << 1 : INTERNER_INIT_SIZE;
+    interner->slots = interner_calloc(interner->alloc, sizeof(char*));
+
+    for(size_t i = 0; i < old_alloc; i++)
+    {
+        if(!old_slots[i])
+            continue;
+
+        size_t index = INTERNER_SIZE_MOD(interner, interned_hash(old_slots[i]));
+        while(interner->slots[index])
+            index = INTERNER_SIZE_MOD(interner, index + 1);
+        interner->slots[index] = old_slots[i];
+    }
+
+    free(old_slots);
+}
+
+char* intern_n(Interner_T* interner, const char* str, size_t length)
+{
+    assert(str != NULL);
+
+    // keep the load factor below 3/4
+    if((interner->size + 1) * 4 > interner->alloc * 3)
+        interner_grow(interner);
+
+    u32 hash = interner_hash(str, length);
+    size_t index = INTERNER_SIZE_MOD(interner, hash);
+
+    // linear probing
+    char* slot;
+    while((slot = interner->slots[index]))
+    {
+        InternedHeader_T* header = INTERNED_HEADER(slot);
+        if(header->hash == hash && header->length == length && memcmp(slot, str, length) == 0)
+            return slot;
+        index = INTERNER_SIZE_MOD(interner, index + 1);
+    }
+
+    interner->size++;
+    return interner->slots[index] = interner_store(interner, str, length, hash);
+}
+
+char* intern(Interner_T* interner, const char* str)
+{
+    return intern_n(interner, str, strlen(str));
+}
+
+u32 interned_hash(const char* str)
+{
+    return INTERNED_HEADER(str)->hash;
+}
+
+u32 interned_length(const char* str)
+{
+    return INTERNED_HEADER(str)->length;
+}
@@ -0,0 +1,30 @@
+#ifndef CSPYDR_INTERNER_H
+#define CSPYDR_INTERNER_H
+
+#include <stdlib.h>
+#include "util.h"
+
+// Interned strings are stored exactly once per interner, so two interned
+// strings are equal if and only if their pointers are equal. Their hash gets
+// computed once and is stored right in front of the characters.
+
+typedef struct INTERNER_CHUNK_STRUCT InternerChunk_T;
+
+typedef struct INTERNER_STRUCT {
+    char** slots;
+    size_t size;
+    size_t alloc;
+
+    InternerChunk_T* chunks;
+} Interner_T;
+
+void init_interner(Interner_T* interner);
+void free_interner(Interner_T* interner);
+
+char* intern(Interner_T* interner, const char* str);
+char* intern_n(Interner_T* interner, const char* str, size_t length);
+
+u32 interned_hash(const char* str);
+u32 interned_length(const char* str);
+
+#endif
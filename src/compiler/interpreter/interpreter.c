@@ -178,6 +178,7 @@ static InterpreterValue_T (*const type_cast_map[TY_KIND_LEN][TY_KIND_LEN])(Inter
 };
 
 static void eval_stmt(InterpreterContext_T* ictx, ASTNode_T* stmt);
+static const ASTObj_T* eval_call(InterpreterContext_T* ictx, ASTNode_T* call, InterpreterValueList_T** args);
 static InterpreterValue_T call_fn(InterpreterContext_T* ictx, const ASTObj_T* fn, const InterpreterValueList_T* args);
 
 static LValue_T lvalue_from_id(InterpreterContext_T* ictx, ASTObj_T* obj, ASTType_T* ty, Token_T* tok);
@@ -196,6 +197,8 @@ void init_interpreter_context(InterpreterContext_T* ictx, Context_T* context, AS
 
     ictx->string_literals = hashmap_init();
     ictx->broken = false;
+    ictx->tail_fn = NULL;
+    ictx->tail_args = NULL;
 
     // assure that address 0 is always occupied
     u8 null_byte = 0;
@@ -293,6 +296,11 @@ static void eval_stmt(InterpreterContext_T* ictx, ASTNode_T* stmt)
             break;
         case ND_RETURN:
             ictx->returned = true;
+            if(stmt->tail_call)
+            {
+                ictx->tail_fn = eval_call(ictx, stmt->return_val, &ictx->tail_args);
+                break;
+            }
             ictx->return_value = stmt->return_val ? interpreter_eval_expr(ictx, stmt->return_val) : VOID_VALUE;
             break;
         case ND_EXPR_STMT:
@@ -688,15 +696,9 @@ InterpreterValue_T interpreter_eval_expr(InterpreterContext_T* ictx, ASTNode_T*
         COMPARISON_OP_CASE(ND_GT, >);
         COMPARISON_OP_CASE(ND_GE, >=);
         case ND_CALL: {
-            InterpreterValue_T callee = interpreter_eval_expr(ictx, expr->expr);
-            InterpreterValueList_T* args = init_interpreter_value_list(expr->args->size);
-            for(size_t i = 0; i < expr->args->size; i++)
-            {
-                InterpreterValue_T arg = interpreter_eval_expr(ictx, expr->args->items[i]);
-                interpreter_value_list_push(&args, &arg);
-            }
-
-            InterpreterValue_T result = call_fn(ictx, callee.value.fn_obj, args);
+            InterpreterValueList_T* args;
+            const ASTObj_T* fn = eval_call(ictx, expr, &args);
+            InterpreterValue_T result = call_fn(ictx, fn, args);
             free_interpreter_value_list(args);
             return result;
         }
@@ -708,9 +710,21 @@ InterpreterValue_T interpreter_eval_expr(InterpreterContext_T* ictx, ASTNode_T*
     return VOID_VALUE;
 }
 
+// evaluates the called function and the arguments of `call`
+static const ASTObj_T* eval_call(InterpreterContext_T* ictx, ASTNode_T* call, InterpreterValueList_T** args)
+{
+    InterpreterValue_T callee = interpreter_eval_expr(ictx, call->expr);
+    *args = init_interpreter_value_list(call->args->size);
+    for(size_t i = 0; i < call->args->size; i++)
+    {
+        InterpreterValue_T arg = interpreter_eval_expr(ictx, call->args->items[i]);
+        interpreter_value_list_push(args, &arg);
+    }
+    return callee.value.fn_obj;
+}
+
 static InterpreterValue_T call_fn(InterpreterContext_T* ictx, const ASTObj_T* fn, const InterpreterValueList_T* args)
 {
-    assert(args->size == fn->args->size);
     ictx->recursion_depth++;
     if(ictx->recursion_depth > MAX_RECURSION_DEPTH)
     {
@@ -722,28 +736,47 @@ static InterpreterValue_T call_fn(InterpreterContext_T* ictx, const ASTObj_T* fn
     //    printf(COLOR_BOLD_CYAN ">>> Entering %s(%zu)\n" COLOR_RESET, fn->id->callee, args->size);
     
     const size_t stack_size_before = ictx->stack->size;
-    for(size_t i = 0; i < args->size; i++) {
-        const InterpreterValue_T* arg_value = &args->data[i];
-        ASTObj_T* arg = fn->args->items[i];
-        arg->offset = ictx->stack->size;
-        interpreter_stack_push(&ictx->stack, &arg_value->value, arg->data_type->size);
-    }
+    InterpreterValueList_T* tail_args = NULL;
 
-    size_t stack_size = ictx->stack->size;
-    for(size_t i = 0; i < fn->objs->size; i++)
+    // tail calls replace the current function instead of nesting
+    for(;;)
     {
-        ASTObj_T* local = fn->objs->items[i];
-        stack_size = align_to(stack_size, local->data_type->align);
-        local->offset = stack_size;
-        stack_size += local->data_type->size;
-    }
-    interpreter_stack_grow(&ictx->stack, stack_size - stack_size_before);
+        assert(args->size == fn->args->size);
+        for(size_t i = 0; i < args->size; i++) {
+            const InterpreterValue_T* arg_value = &args->data[i];
+            ASTObj_T* arg = fn->args->items[i];
+            arg->offset = ictx->stack->size;
+            interpreter_stack_push(&ictx->stack, &arg_value->value, arg->data_type->size);
+        }
+
+        size_t stack_size = ictx->stack->size;
+        for(size_t i = 0; i < fn->objs->size; i++)
+        {
+            ASTObj_T* local = fn->objs->items[i];
+            stack_size = align_to(stack_size, local->data_type->align);
+            local->offset = stack_size;
+            stack_size += local->data_type->size;
+        }
+        interpreter_stack_grow(&ictx->stack, stack_size - stack_size_before);
 
-//    dump_stack(ictx->stack);
+//        dump_stack(ictx->stack);
     
-    eval_stmt(ictx, fn->body);
+        eval_stmt(ictx, fn->body);
+
+        interpreter_stack_shrink_to(ictx->stack, stack_size_before);
+        if(!ictx->tail_fn)
+            break;
+
+        fn = ictx->tail_fn;
+        if(tail_args)
+            free_interpreter_value_list(tail_args);
+        args = tail_args = ictx->tail_args;
+        ictx->tail_fn = NULL;
+        ictx->returned = false;
+    }
 
-    interpreter_stack_shrink_to(ictx->stack, stack_size_before);
+    if(tail_args)
+        free_interpreter_value_list(tail_args);
 //    printf(COLOR_BOLD_CYAN "<<<\n" COLOR_RESET);
     ictx->recursion_depth--;
 
@@ -25,6 +25,10 @@ typedef struct INTERPRETER_CONTEXT_STRUCT
     bool continued; // reached `continue`
     bool returned;  // reached `return`
     InterpreterValue_T return_value;
+
+    // reached `return` of a tail call, which replaces the current function
+    const ASTObj_T* tail_fn;
+    InterpreterValueList_T* tail_args;
 } InterpreterContext_T;
 
 void init_interpreter_context(InterpreterContext_T* ictx, Context_T* context, ASTProg_T* ast);
@@ -2,29 +2,56 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 
-File_T* init_file(List_T* lines, const char* path)
+static void index_lines(File_T* file)
+{
+    u32 num_lines = 0;
+    for(char* c = file->buffer; (c = memchr(c, '\n', file->buffer + file->size - c)); c++)
+        num_lines++;
+    
+    // the last line does not need to end with '\n'
+    if(file->size && file->buffer[file->size - 1] != '\n')
+        num_lines++;
+
+    file->num_lines = num_lines;
+    file->line_offsets = malloc((num_lines + 1) * sizeof(u32));
+    file->line_offsets[0] = 0;
+
+    u32 line = 1;
+    for(size_t i = 0; i < file->size && line < num_lines; i++)
+        if(file->buffer[i] == '\n')
+            file->line_offsets[line++] = i + 1;
+    file->line_offsets[num_lines] = file->size;
+}
+
+File_T* init_file(char* buffer, size_t size, const char* path)
 {
     File_T* file = malloc(sizeof(File_T));
 
-    file->lines = lines;
+    file->buffer = buffer;
+    file->size = size;
+    file->mapped = false;
     file->path = (char*) path;
-    file->num_lines = file->lines->size;
     file->short_path = NULL;
     file->file_no = 0;
 
+    index_lines(file);
+
     return file;
 }
 
 void free_file(File_T* file)
 {
-    for(size_t i = 0; i < file->num_lines; i++)
-        free(file->lines->items[i]);
+    if(file->mapped)
+        munmap(file->buffer, file->size);
+    else
+        free(file->buffer);
 
     if(file->short_path)
         free(file->short_path);
 
-    free_list(file->lines);
+    free(file->line_offsets);
     free(file);
 }
 
@@ -33,7 +60,7 @@ char* get_line(File_T* file, u32 line)
     if(line >= file->num_lines)
         return NULL;
     
-    return file->lines->items[line];
+    return file->buffer + file->line_offsets[line];
 }
 
 u32 get_line_len(File_T* file, u32 line)
@@ -41,7 +68,7 @@ u32 get_line_len(File_T* file, u32 line)
     if(line >= file->num_lines)
         return 0;
 
-    return strlen((char*) file->lines->items[line]);
+    return file->line_offsets[line + 1] - file->line_offsets[line];
 }
 
 char get_char(File_T* file, u32 line, u32 i)
@@ -49,5 +76,5 @@ char get_char(File_T* file, u32 line, u32 i)
     if(line >= file->num_lines || i >= get_line_len(file, line))
         return -1;
 
-    return ((char*) file->lines->items[line])[i];
+    return file->buffer[file->line_offsets[line] + i];
 }
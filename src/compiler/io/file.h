@@ -4,9 +4,15 @@
 #include "list.h"
 #include "util.h"
 
+#include <stddef.h>
+
 typedef struct SRC_FILE_STRUCT 
 {
-    List_T* lines;
+    char* buffer;      // contiguous, '\0'-terminated source text
+    size_t size;       // length of `buffer` without the terminating '\0'
+    bool mapped;       // `buffer` is mmap'd and gets unmapped on free
+
+    u32* line_offsets; // start of every line in `buffer`, `num_lines + 1` entries
     u32 num_lines;
     u32 file_no;
     i32 wd; // inotify watchdog
@@ -15,11 +21,12 @@ typedef struct SRC_FILE_STRUCT
     char* short_path;
 } File_T;
 
-File_T* init_file(List_T* lines, const char* path);
+File_T* init_file(char* buffer, size_t size, const char* path);
 void free_file(File_T* file);
 
+// lines are not '\0'-terminated, use `get_line_len()` to get their length (including '\n')
 char* get_line(File_T* file, u32 line);
 char get_char(File_T* file, u32 line, u32 i);
 u32 get_line_len(File_T* file, u32 line);
 
-#endif
\ No newline at end of file
+#endif
@@ -13,36 +13,46 @@
 #include <unistd.h>
 #include <stdarg.h>
 #include <libgen.h>
-#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 File_T* read_file(const char* path)
 {
-    List_T* buffer_list = init_list();
-
-    FILE* fp;
-    char* line = NULL;
-    size_t len = 0;
-    ssize_t read;
-
-    fp = fopen(path, "r");
-    if(fp == NULL) 
+    i32 fd = open(path, O_RDONLY);
+    struct stat st;
+    if(fd == -1 || fstat(fd, &st) == -1) 
     {
         LOG_ERROR_F("Could not read file '%s'\n", path);
         exit(1);
     }
 
-    while((read = getline(&line, &len, fp)) != -1) 
-    {
-        list_push(buffer_list, strdup(line));
-    }
+    size_t size = st.st_size;
+    char* buffer = MAP_FAILED;
 
-    fclose(fp);
-    if(line) 
+    // mmap zero-fills the rest of the last page, which gives us the terminating '\0' for free.
+    // if the file fills its last page completely, fall back to reading it into a heap buffer.
+    if(size && size % sysconf(_SC_PAGESIZE))
+        buffer = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    
+    if(buffer != MAP_FAILED)
     {
-        free(line);
+        close(fd);
+        File_T* file = init_file(buffer, size, path);
+        file->mapped = true;
+        return file;
     }
 
-    return init_file(buffer_list, path);
+    buffer = malloc((size + 1) * sizeof(char));
+    size_t total = 0;
+    ssize_t bytes_read;
+    while(total < size && (bytes_read = read(fd, buffer + total, size - total)) > 0)
+        total += bytes_read;
+    buffer[total] = '\0';
+
+    close(fd);
+
+    return init_file(buffer, total, path);
 }
 
 FILE *open_file(char *path)
@@ -0,0 +1,203 @@
+#include "ir.h"
+#include "context.h"
+#include "memory/allocator.h"
+
+#include <string.h>
+
+static const char* opcode_names[] = {
+    [IR_NOP] = "nop",
+    [IR_CONST] = "const",
+    [IR_COPY] = "copy",
+    [IR_ARG] = "arg",
+    [IR_PHI] = "phi",
+    [IR_ADDR] = "addr",
+    [IR_STRING] = "string",
+    [IR_LOAD] = "load",
+    [IR_STORE] = "store",
+    [IR_EXT] = "ext",
+    [IR_ADD] = "add",
+    [IR_SUB] = "sub",
+    [IR_MUL] = "mul",
+    [IR_DIV] = "div",
+    [IR_MOD] = "mod",
+    [IR_AND] = "and",
+    [IR_OR] = "or",
+    [IR_XOR] = "xor",
+    [IR_SHL] = "shl",
+    [IR_SHR] = "shr",
+    [IR_NEG] = "neg",
+    [IR_NOT] = "not",
+    [IR_EQ] = "eq",
+    [IR_NE] = "ne",
+    [IR_LT] = "lt",
+    [IR_LE] = "le",
+    [IR_CALL] = "call",
+    [IR_JMP] = "jmp",
+    [IR_BR] = "br",
+    [IR_RET] = "ret",
+};
+
+IRFunction_T* init_ir_function(Context_T* context, ASTObj_T* obj)
+{
+    IRFunction_T* fn = allocator_malloc(&context->raw_allocator, sizeof(IRFunction_T));
+    fn->obj = obj;
+    fn->blocks = init_list();
+    CONTEXT_ALLOC_REGISTER(context, fn->blocks);
+    return fn;
+}
+
+IRBlock_T* ir_new_block(Context_T* context, IRFunction_T* fn)
+{
+    IRBlock_T* block = allocator_malloc(&context->raw_allocator, sizeof(IRBlock_T));
+    block->id = fn->num_blocks++;
+    block->instrs = init_list();
+    block->preds = init_list();
+    CONTEXT_ALLOC_REGISTER(context, block->instrs);
+    CONTEXT_ALLOC_REGISTER(context, block->preds);
+    return block;
+}
+
+IRInstr_T* ir_new_instr(Context_T* context, IROpcode_T op)
+{
+    IRInstr_T* instr = allocator_malloc(&context->raw_allocator, sizeof(IRInstr_T));
+    instr->op = op;
+    return instr;
+}
+
+IRValue_T ir_new_value(IRFunction_T* fn)
+{
+    return ++fn->num_values;
+}
+
+bool ir_is_terminator(IROpcode_T op)
+{
+    return op == IR_JMP || op == IR_BR || op == IR_RET;
+}
+
+bool ir_has_side_effects(IROpcode_T op)
+{
+    return op == IR_STORE || op == IR_CALL || op == IR_ARG || ir_is_terminator(op);
+}
+
+IRInstr_T* ir_terminator(IRBlock_T* block)
+{
+    IRInstr_T* last = block->instrs->size ? list_last(block->instrs) : NULL;
+    return last && ir_is_terminator(last->op) ? last : NULL;
+}
+
+u32 ir_successors(IRBlock_T* block, IRBlock_T* succs[2])
+{
+    IRInstr_T* term = ir_terminator(block);
+    if(!term || term->op == IR_RET)
+        return 0;
+
+    succs[0] = term->targets[0];
+    if(term->op == IR_JMP || term->targets[0] == term->targets[1])
+        return 1;
+    succs[1] = term->targets[1];
+    return 2;
+}
+
+void ir_foreach_operand(IRInstr_T* instr, void (*fn)(IRValue_T* operand, void* data), void* data)
+{
+    if(instr->a)
+        fn(&instr->a, data);
+    if(instr->b)
+        fn(&instr->b, data);
+    for(u32 i = 0; i < instr->num_args; i++)
+        fn(&instr->args[i], data);
+}
+
+static void print_instr(FILE* out, IRInstr_T* instr)
+{
+    fprintf(out, "  ");
+    if(instr->dst)
+        fprintf(out, "v%u = ", instr->dst);
+    fprintf(out, "%s", opcode_names[instr->op]);
+
+    switch(instr->op)
+    {
+        case IR_LOAD:
+        case IR_STORE:
+        case IR_EXT:
+            fprintf(out, ".%c%d", instr->is_unsigned ? 'u' : 's', instr->size);
+            break;
+        case IR_ADD ... IR_LE:
+            fprintf(out, "%s%s", instr->wide ? ".64" : ".32", instr->is_unsigned ? "u" : "");
+            break;
+        default:
+            break;
+    }
+
+    if(instr->op == IR_CONST || instr->op == IR_ARG || ((instr->op == IR_LOAD || instr->op == IR_STORE) && instr->imm))
+        fprintf(out, " %ld", (long) instr->imm);
+    if(instr->a)
+        fprintf(out, " v%u", instr->a);
+    if(instr->b)
+        fprintf(out, ", v%u", instr->b);
+    for(u32 i = 0; i < instr->num_args; i++)
+        fprintf(out, "%sv%u", i || instr->a ? ", " : " ", instr->args[i]);
+    if(instr->node && instr->node->kind == ND_ID && instr->node->id)
+        fprintf(out, " `%s`", instr->node->id->callee);
+
+    switch(instr->op)
+    {
+        case IR_JMP:
+            fprintf(out, " bb%u", instr->targets[0]->id);
+            break;
+        case IR_BR:
+            fprintf(out, " ? bb%u : bb%u", instr->targets[0]->id, instr->targets[1]->id);
+            break;
+        default:
+            break;
+    }
+
+    fprintf(out, "\n");
+}
+
+void ir_print(FILE* out, IRFunction_T* fn)
+{
+    fprintf(out, "fn %s (%u values):\n", fn->obj->id->callee, fn->num_values);
+    for(size_t i = 0; i < fn->blocks->size; i++)
+    {
+        IRBlock_T* block = fn->blocks->items[i];
+        fprintf(out, "bb%u:", block->id);
+        for(size_t j = 0; j < block->preds->size; j++)
+            fprintf(out, "%s bb%u", j ? "," : " <-", ((IRBlock_T*) block->preds->items[j])->id);
+        fprintf(out, "\n");
+
+        for(size_t j = 0; j < block->instrs->size; j++)
+            print_instr(out, block->instrs->items[j]);
+    }
+}
+
+void ir_leave_ssa(Context_T* context, IRFunction_T* fn)
+{
+    for(size_t i = 0; i < fn->blocks->size; i++)
+    {
+        IRBlock_T* block = fn->blocks->items[i];
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IRInstr_T* phi = block->instrs->items[j];
+            if(phi->op != IR_PHI)
+                break;
+
+            // the shadow is only ever read by the phi, so the copies in the predecessors never clobber
+            // each other, even if phis of the same block depend on one another
+            IRValue_T shadow = ir_new_value(fn);
+            for(size_t k = 0; k < block->preds->size; k++)
+            {
+                IRBlock_T* pred = block->preds->items[k];
+                IRInstr_T* copy = ir_new_instr(context, IR_COPY);
+                copy->dst = shadow;
+                copy->a = phi->args[k];
+                list_insert(pred->instrs, copy, pred->instrs->size - 1);
+            }
+
+            phi->op = IR_COPY;
+            phi->a = shadow;
+            phi->args = NULL;
+            phi->num_args = 0;
+        }
+    }
+}
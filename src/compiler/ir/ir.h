@@ -0,0 +1,127 @@
+#ifndef CSPYDR_IR_H
+#define CSPYDR_IR_H
+
+#include <stdio.h>
+
+#include "ast/ast.h"
+#include "list.h"
+#include "util.h"
+
+// A mid-level, three-address IR in SSA form. Every instruction defines at most
+// one virtual register (`dst`); virtual registers are numbered from 1, 0 means
+// "no value". Each value holds the 64 bits %rax would contain in the assembly
+// backend after evaluating the same expression.
+//
+// Functions get lowered by `ir_pass()`, if they only use the supported subset
+// of the language (scalar integers and pointers), all others stay on the AST.
+
+typedef u32 IRValue_T;
+
+typedef struct IR_INSTR_STRUCT    IRInstr_T;
+typedef struct IR_BLOCK_STRUCT    IRBlock_T;
+typedef struct IR_FUNCTION_STRUCT IRFunction_T;
+
+typedef enum IR_OPCODE_ENUM {
+    IR_NOP,
+    IR_CONST,   // dst = imm
+    IR_COPY,    // dst = a
+    IR_ARG,     // dst = argument register imm
+    IR_PHI,     // dst = args[i] coming from preds[i]
+    IR_ADDR,    // dst = address of the global object or function `node`
+    IR_STRING,  // dst = address of the string literal `node`
+    IR_LOAD,    // dst = extend(size, is_unsigned) *(a + imm)
+    IR_STORE,   // *(a + imm) = b, truncated to size
+    IR_EXT,     // dst = extend(size, is_unsigned) a
+
+    // binary operations, 32 bit unless `wide`
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,     // `size` 8 sign-extends with cqo instead of cdq
+    IR_MOD,
+    IR_AND,
+    IR_OR,
+    IR_XOR,
+    IR_SHL,
+    IR_SHR,
+
+    // unary operations, always 64 bit
+    IR_NEG,
+    IR_NOT,
+
+    // comparisons, result is 0 or 1
+    IR_EQ,
+    IR_NE,
+    IR_LT,
+    IR_LE,
+
+    IR_CALL,    // dst = result of calling `node->expr` with args, `tail` if returned right away
+
+    // terminators
+    IR_JMP,     // goto targets[0]
+    IR_BR,      // if a != 0 goto targets[0] else targets[1]
+    IR_RET,     // return a (if any)
+} IROpcode_T;
+
+struct IR_INSTR_STRUCT {
+    IROpcode_T op;
+    IRValue_T dst;
+    IRValue_T a;
+    IRValue_T b;
+    i64 imm;
+
+    u8 size;
+    bool wide        : 1;
+    bool is_unsigned : 1;
+    bool tail        : 1;
+
+    ASTNode_T* node;
+    Token_T* tok;
+
+    IRValue_T* args;
+    u32 num_args;
+
+    IRBlock_T* targets[2];
+};
+
+struct IR_BLOCK_STRUCT {
+    u32 id;
+    List_T* instrs; // list of IRInstr_Ts, phis first, terminator last
+    List_T* preds;  // list of IRBlock_Ts
+
+    // SSA construction
+    bool sealed;
+    IRValue_T* defs;
+    size_t num_defs;
+    List_T* incomplete_phis;
+};
+
+struct IR_FUNCTION_STRUCT {
+    ASTObj_T* obj;
+    List_T* blocks; // list of IRBlock_Ts, in emission order, entry first
+    u32 num_blocks;
+    u32 num_values;
+};
+
+IRFunction_T* init_ir_function(Context_T* context, ASTObj_T* obj);
+IRBlock_T* ir_new_block(Context_T* context, IRFunction_T* fn);
+IRInstr_T* ir_new_instr(Context_T* context, IROpcode_T op);
+IRValue_T ir_new_value(IRFunction_T* fn);
+
+bool ir_is_terminator(IROpcode_T op);
+bool ir_has_side_effects(IROpcode_T op);
+IRInstr_T* ir_terminator(IRBlock_T* block);
+u32 ir_successors(IRBlock_T* block, IRBlock_T* succs[2]);
+
+// calls `fn` for every value operand of `instr`
+void ir_foreach_operand(IRInstr_T* instr, void (*fn)(IRValue_T* operand, void* data), void* data);
+
+void ir_print(FILE* out, IRFunction_T* fn);
+
+// ir_opt.c
+void ir_optimize(Context_T* context, IRFunction_T* fn);
+
+// replaces phis by copies through shadow values, which get written at the end of each predecessor
+void ir_leave_ssa(Context_T* context, IRFunction_T* fn);
+
+#endif
@@ -0,0 +1,1181 @@
+#include "ir.h"
+#include "passes.h"
+#include "context.h"
+#include "error/exception.h"
+#include "ast/types.h"
+#include "codegen/codegen_utils.h"
+#include "memory/allocator.h"
+#include "timer/timer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define IR_MAX_ARGS 6
+
+// SSA construction follows Braun et al., "Simple and Efficient Construction of
+// Static Single Assignment Form": variables are looked up in the current block
+// and recursively in its predecessors, blocks with unknown predecessors get
+// incomplete phis, which are completed once the block gets sealed.
+//
+// Everything outside of the supported subset throws `unsupported`, leaving the
+// function to the AST backend.
+
+typedef struct IR_LOWERING_STRUCT {
+    Context_T* context;
+    IRFunction_T* fn;
+    IRBlock_T* block;  // NULL after a terminator
+    List_T* blocks;    // all created blocks, including unfinished ones
+    List_T* vars;      // variable number -> ASTObj_T*, NULL for temporaries
+    IRValue_T zero;
+
+    IRBlock_T* break_block;
+    IRBlock_T* continue_block;
+
+    Exception_T unsupported;
+} IRLowering_T;
+
+static IRValue_T lower_expr(IRLowering_T* l, ASTNode_T* node);
+static IRValue_T lower_addr(IRLowering_T* l, ASTNode_T* node);
+static void lower_stmt(IRLowering_T* l, ASTNode_T* node);
+
+static bool is_scalar(ASTType_T* ty)
+{
+    ty = unpack(ty);
+    if(!ty || !(is_integer(ty) || ty->kind == TY_PTR))
+        return false;
+    return ty->size == 1 || ty->size == 2 || ty->size == 4 || ty->size == 8;
+}
+
+// same rule as the AST backend uses for choosing between 32 and 64 bit registers
+static bool is_wide(ASTType_T* ty)
+{
+    return ty->kind == TY_I64 || ty->kind == TY_U64 || ty->base;
+}
+
+static bool cmp_zero_wide(ASTType_T* ty)
+{
+    ty = unpack(ty);
+    return !(is_integer(ty) && ty->size <= 4);
+}
+
+// loads of 4 bytes always sign-extend, see `asm_load()`
+static bool loads_unsigned(ASTType_T* ty)
+{
+    ty = unpack(ty);
+    return ty->size < 4 && is_unsigned(ty);
+}
+
+static bool same_extension(ASTType_T* a, ASTType_T* b)
+{
+    return unpack(a)->size == unpack(b)->size && loads_unsigned(a) == loads_unsigned(b);
+}
+
+static void unsupported(IRLowering_T* l)
+{
+    throw(l->unsupported);
+}
+
+static IRBlock_T* new_block(IRLowering_T* l)
+{
+    IRBlock_T* block = ir_new_block(l->context, l->fn);
+    list_push(l->blocks, block);
+    return block;
+}
+
+static void start_block(IRLowering_T* l, IRBlock_T* block)
+{
+    list_push(l->fn->blocks, block);
+    l->block = block;
+}
+
+// code after `return`, `break` or `continue` still gets lowered, into a block without predecessors
+static IRBlock_T* current_block(IRLowering_T* l)
+{
+    if(!l->block)
+    {
+        IRBlock_T* block = new_block(l);
+        block->sealed = true;
+        start_block(l, block);
+    }
+    return l->block;
+}
+
+static IRInstr_T* emit(IRLowering_T* l, IROpcode_T op, ASTNode_T* node)
+{
+    IRBlock_T* block = current_block(l);
+    IRInstr_T* instr = ir_new_instr(l->context, op);
+    instr->tok = node ? node->tok : NULL;
+    list_push(block->instrs, instr);
+    return instr;
+}
+
+static IRValue_T emit_value(IRLowering_T* l, IRInstr_T* instr)
+{
+    return instr->dst = ir_new_value(l->fn);
+}
+
+static IRValue_T emit_const(IRLowering_T* l, i64 imm, ASTNode_T* node)
+{
+    IRInstr_T* instr = emit(l, IR_CONST, node);
+    instr->imm = imm;
+    return emit_value(l, instr);
+}
+
+static IRValue_T emit_binary(IRLowering_T* l, IROpcode_T op, IRValue_T a, IRValue_T b, bool wide, bool is_unsigned, ASTNode_T* node)
+{
+    IRInstr_T* instr = emit(l, op, node);
+    instr->a = a;
+    instr->b = b;
+    instr->wide = wide;
+    instr->is_unsigned = is_unsigned;
+    return emit_value(l, instr);
+}
+
+// `size` 8 sign-extends the dividend with cqo, everything else with cdq
+static IRValue_T emit_div(IRLowering_T* l, IROpcode_T op, IRValue_T a, IRValue_T b, bool wide, bool is_unsigned, u8 size, ASTNode_T* node)
+{
+    IRInstr_T* instr = emit(l, op, node);
+    instr->a = a;
+    instr->b = b;
+    instr->wide = wide;
+    instr->is_unsigned = is_unsigned;
+    instr->size = size;
+    return emit_value(l, instr);
+}
+
+static IRValue_T emit_unary(IRLowering_T* l, IROpcode_T op, IRValue_T a, ASTNode_T* node)
+{
+    IRInstr_T* instr = emit(l, op, node);
+    instr->a = a;
+    instr->wide = true;
+    return emit_value(l, instr);
+}
+
+static IRValue_T emit_ext(IRLowering_T* l, IRValue_T a, u8 size, bool is_unsigned, ASTNode_T* node)
+{
+    IRInstr_T* instr = emit(l, IR_EXT, node);
+    instr->a = a;
+    instr->size = size;
+    instr->is_unsigned = is_unsigned;
+    return emit_value(l, instr);
+}
+
+// extends `a` the way loading a value of type `ty` would
+static IRValue_T emit_ext_to(IRLowering_T* l, IRValue_T a, ASTType_T* ty, ASTNode_T* node)
+{
+    u8 size = unpack(ty)->size;
+    return size == 8 ? a : emit_ext(l, a, size, loads_unsigned(ty), node);
+}
+
+static IRValue_T emit_load(IRLowering_T* l, IRValue_T addr, ASTType_T* ty, ASTNode_T* node)
+{
+    IRInstr_T* instr = emit(l, IR_LOAD, node);
+    instr->a = addr;
+    instr->size = unpack(ty)->size;
+    instr->is_unsigned = loads_unsigned(ty);
+    return emit_value(l, instr);
+}
+
+static void emit_store(IRLowering_T* l, IRValue_T addr, IRValue_T value, ASTType_T* ty, ASTNode_T* node)
+{
+    IRInstr_T* instr = emit(l, IR_STORE, node);
+    instr->a = addr;
+    instr->b = value;
+    instr->size = unpack(ty)->size;
+}
+
+static void emit_jmp(IRLowering_T* l, IRBlock_T* target)
+{
+    if(!l->block)
+        return;
+
+    IRInstr_T* instr = emit(l, IR_JMP, NULL);
+    instr->targets[0] = target;
+    list_push(target->preds, l->block);
+    l->block = NULL;
+}
+
+static void emit_br(IRLowering_T* l, IRValue_T cond, bool wide, IRBlock_T* then_block, IRBlock_T* else_block, ASTNode_T* node)
+{
+    IRInstr_T* instr = emit(l, IR_BR, node);
+    instr->a = cond;
+    instr->wide = wide;
+    instr->targets[0] = then_block;
+    instr->targets[1] = else_block;
+    list_push(then_block->preds, l->block);
+    list_push(else_block->preds, l->block);
+    l->block = NULL;
+}
+
+static void lower_cond_br(IRLowering_T* l, ASTNode_T* cond, IRBlock_T* then_block, IRBlock_T* else_block)
+{
+    IRValue_T value = lower_expr(l, cond);
+    emit_br(l, value, cmp_zero_wide(cond->data_type), then_block, else_block, cond);
+}
+
+// SSA construction
+
+static size_t var_index(IRLowering_T* l, ASTObj_T* var)
+{
+    for(size_t i = 0; i < l->vars->size; i++)
+        if(l->vars->items[i] == var)
+            return i;
+    list_push(l->vars, var);
+    return l->vars->size - 1;
+}
+
+static size_t new_temporary(IRLowering_T* l)
+{
+    list_push(l->vars, NULL);
+    return l->vars->size - 1;
+}
+
+static void write_var(IRBlock_T* block, size_t var, IRValue_T value)
+{
+    if(var >= block->num_defs)
+    {
+        size_t num_defs = MAX(var + 1, block->num_defs * 2);
+        block->defs = realloc(block->defs, num_defs * sizeof(IRValue_T));
+        memset(block->defs + block->num_defs, 0, (num_defs - block->num_defs) * sizeof(IRValue_T));
+        block->num_defs = num_defs;
+    }
+    block->defs[var] = value;
+}
+
+static IRValue_T read_var(IRLowering_T* l, IRBlock_T* block, size_t var);
+
+static IRInstr_T* new_phi(IRLowering_T* l, IRBlock_T* block, size_t var)
+{
+    IRInstr_T* phi = ir_new_instr(l->context, IR_PHI);
+    phi->dst = ir_new_value(l->fn);
+    phi->imm = var;
+    list_insert(block->instrs, phi, 0);
+    return phi;
+}
+
+static void add_phi_operands(IRLowering_T* l, IRBlock_T* block, IRInstr_T* phi)
+{
+    phi->num_args = block->preds->size;
+    phi->args = allocator_malloc(&l->context->raw_allocator, MAX(phi->num_args, 1) * sizeof(IRValue_T));
+    for(u32 i = 0; i < phi->num_args; i++)
+        phi->args[i] = read_var(l, block->preds->items[i], phi->imm);
+}
+
+static IRValue_T read_var_recursive(IRLowering_T* l, IRBlock_T* block, size_t var)
+{
+    IRValue_T value;
+    if(!block->sealed)
+    {
+        IRInstr_T* phi = new_phi(l, block, var);
+        if(!block->incomplete_phis)
+            block->incomplete_phis = init_list();
+        list_push(block->incomplete_phis, phi);
+        value = phi->dst;
+    }
+    else if(block->preds->size == 1)
+        value = read_var(l, block->preds->items[0], var);
+    else if(block->preds->size == 0)
+        value = l->zero; // unreachable or read before the first assignment
+    else
+    {
+        IRInstr_T* phi = new_phi(l, block, var);
+        write_var(block, var, phi->dst); // breaks cycles through loops
+        add_phi_operands(l, block, phi);
+        value = phi->dst;
+    }
+
+    write_var(block, var, value);
+    return value;
+}
+
+static IRValue_T read_var(IRLowering_T* l, IRBlock_T* block, size_t var)
+{
+    if(var < block->num_defs && block->defs[var])
+        return block->defs[var];
+    return read_var_recursive(l, block, var);
+}
+
+static void seal_block(IRLowering_T* l, IRBlock_T* block)
+{
+    if(block->incomplete_phis)
+        for(size_t i = 0; i < block->incomplete_phis->size; i++)
+            add_phi_operands(l, block, block->incomplete_phis->items[i]);
+    block->sealed = true;
+}
+
+// expressions
+
+static IRValue_T lower_var(IRLowering_T* l, ASTNode_T* id)
+{
+    ASTObj_T* var = id->referenced_obj;
+    if(!is_scalar(var->data_type))
+        unsupported(l);
+
+    IRValue_T value = read_var(l, current_block(l), var_index(l, var));
+    if(id->data_type && !same_extension(id->data_type, var->data_type))
+        value = emit_ext_to(l, value, id->data_type, id);
+    return value;
+}
+
+static bool is_global_id(ASTNode_T* id)
+{
+    ASTObj_T* obj = id->referenced_obj;
+    return obj && (obj->kind == OBJ_GLOBAL || obj->kind == OBJ_ENUM_MEMBER) && !id->call
+        && unpack(EITHER(id->data_type, obj->data_type))->kind != TY_VLA;
+}
+
+static IRValue_T lower_global_addr(IRLowering_T* l, ASTNode_T* id)
+{
+    IRInstr_T* instr = emit(l, IR_ADDR, id);
+    instr->node = id;
+    return emit_value(l, instr);
+}
+
+static IRValue_T lower_id(IRLowering_T* l, ASTNode_T* id)
+{
+    if(!id->referenced_obj)
+        unsupported(l);
+
+    switch(id->referenced_obj->kind)
+    {
+        case OBJ_LOCAL:
+        case OBJ_FN_ARG:
+            return lower_var(l, id);
+        case OBJ_GLOBAL:
+        case OBJ_ENUM_MEMBER:
+            if(!is_global_id(id))
+                unsupported(l);
+            return emit_load(l, lower_global_addr(l, id), EITHER(id->data_type, id->referenced_obj->data_type), id);
+        default:
+            unsupported(l);
+    }
+    return 0;
+}
+
+static IRValue_T lower_index_addr(IRLowering_T* l, ASTNode_T* index)
+{
+    ASTType_T* left_type = unpack(index->left->data_type);
+    IRValue_T base, offset;
+
+    switch(left_type->kind)
+    {
+        case TY_PTR:
+            base = lower_expr(l, index->left);
+            offset = emit_binary(l, IR_MUL, lower_expr(l, index->expr), emit_const(l, index->data_type->size, index), true, false, index);
+            break;
+        case TY_C_ARRAY:
+            base = lower_addr(l, index->left);
+            if(index->from_back)
+            {
+                offset = emit_binary(l, IR_MUL, lower_expr(l, index->expr), emit_const(l, -index->data_type->size, index), true, false, index);
+                offset = emit_binary(l, IR_ADD, offset, emit_const(l, index->left->data_type->size + index->data_type->size, index), true, false, index);
+            }
+            else
+                offset = emit_binary(l, IR_MUL, lower_expr(l, index->expr), emit_const(l, index->data_type->size, index), true, false, index);
+            break;
+        default:
+            unsupported(l);
+            return 0;
+    }
+
+    return emit_binary(l, IR_ADD, offset, base, true, false, index);
+}
+
+static IRValue_T lower_addr(IRLowering_T* l, ASTNode_T* node)
+{
+    switch(node->kind)
+    {
+        case ND_CLOSURE:
+            if(!node->exprs->size)
+                unsupported(l);
+            return lower_addr(l, node->exprs->items[node->exprs->size - 1]);
+        case ND_ID:
+            // locals live in virtual registers and have no address
+            if(!is_global_id(node))
+                unsupported(l);
+            return lower_global_addr(l, node);
+        case ND_DEREF:
+            return lower_expr(l, node->right);
+        case ND_MEMBER:
+            if(unpack(node->data_type)->kind == TY_FN)
+                unsupported(l);
+            return emit_binary(l, IR_ADD, lower_addr(l, node->left), emit_const(l, node->body->offset, node), true, false, node);
+        case ND_INDEX:
+            return lower_index_addr(l, node);
+        case ND_CAST:
+            return lower_addr(l, node->left);
+        default:
+            unsupported(l);
+            return 0;
+    }
+}
+
+static IRValue_T lower_assign(IRLowering_T* l, ASTNode_T* assign)
+{
+    ASTNode_T* left = assign->left;
+    ASTObj_T* var = left->kind == ND_ID ? left->referenced_obj : NULL;
+
+    if(var && (var->kind == OBJ_LOCAL || var->kind == OBJ_FN_ARG))
+    {
+        if(!is_scalar(var->data_type))
+            unsupported(l);
+
+        // the result of the assignment is the unextended value
+        IRValue_T value = lower_expr(l, assign->right);
+        write_var(current_block(l), var_index(l, var), emit_ext_to(l, value, var->data_type, assign));
+        return value;
+    }
+
+    if(!is_scalar(left->data_type))
+        unsupported(l);
+
+    IRValue_T addr = lower_addr(l, left);
+    IRValue_T value = lower_expr(l, assign->right);
+    emit_store(l, addr, value, left->data_type, assign);
+    return value;
+}
+
+// the same conversion as `asm_gen_inc()`
+static IRValue_T lower_inc(IRLowering_T* l, ASTNode_T* node)
+{
+    ASTNode_T addend = {
+        .kind = ND_INT,
+        .int_val = node->kind == ND_INC ? 1 : -1,
+        .data_type = (ASTType_T*) primitives[TY_I32]
+    };
+
+    ASTNode_T converted = {
+        .kind = ND_SUB,
+        .data_type = node->data_type,
+        .right = &addend,
+        .left = &(ASTNode_T) {
+            .kind = ND_ASSIGN,
+            .tok = node->tok,
+            .data_type = node->data_type,
+            .left = node->left,
+            .right = &(ASTNode_T) {
+                .kind = ND_ADD,
+                .left = node->left,
+                .right = &addend,
+                .data_type = node->left->data_type
+            }
+        }
+    };
+
+    return lower_expr(l, &converted);
+}
+
+enum { EXT_NONE, EXT_S1, EXT_U1, EXT_S2, EXT_U2, EXT_S4, EXT_U4 };
+enum { I8, I16, I32, I64, U8, U16, U32, U64, LAST };
+
+// the integer part of the cast table in `asm_codegen.c`
+static const u8 cast_table[LAST][LAST] = {
+    // i8     i16     i32       i64     u8      u16     u32       u64
+    {EXT_NONE, EXT_NONE, EXT_NONE, EXT_S4, EXT_U1, EXT_U2, EXT_NONE, EXT_S4},   // i8
+    {EXT_S1,   EXT_NONE, EXT_NONE, EXT_S4, EXT_U1, EXT_U2, EXT_NONE, EXT_S4},   // i16
+    {EXT_S1,   EXT_S2,   EXT_NONE, EXT_S4, EXT_U1, EXT_U2, EXT_NONE, EXT_S4},   // i32
+    {EXT_S1,   EXT_S2,   EXT_NONE, EXT_NONE, EXT_U1, EXT_U2, EXT_NONE, EXT_NONE}, // i64
+    {EXT_S1,   EXT_NONE, EXT_NONE, EXT_S4, EXT_NONE, EXT_NONE, EXT_NONE, EXT_S4}, // u8
+    {EXT_S1,   EXT_S2,   EXT_NONE, EXT_S4, EXT_U1, EXT_NONE, EXT_NONE, EXT_S4},   // u16
+    {EXT_S1,   EXT_S2,   EXT_NONE, EXT_U4, EXT_U1, EXT_U2, EXT_NONE, EXT_U4},   // u32
+    {EXT_S1,   EXT_S2,   EXT_NONE, EXT_NONE, EXT_U1, EXT_U2, EXT_NONE, EXT_NONE}, // u64
+};
+
+static i32 get_type_id(ASTType_T* ty)
+{
+    switch(unpack(ty)->kind)
+    {
+        case TY_I8:
+        case TY_CHAR:
+            return I8;
+        case TY_U8:
+            return U8;
+        case TY_I16:
+            return I16;
+        case TY_U16:
+            return U16;
+        case TY_I32:
+            return I32;
+        case TY_U32:
+            return U32;
+        case TY_I64:
+            return I64;
+        default:
+            return U64;
+    }
+}
+
+static IRValue_T lower_cast(IRLowering_T* l, ASTNode_T* cast)
+{
+    ASTType_T* from = cast->left->data_type;
+    ASTType_T* to = cast->data_type;
+    IRValue_T value = lower_expr(l, cast->left);
+
+    if(to->kind == TY_VOID)
+        return value;
+    if(to->kind == TY_BOOL)
+        return emit_binary(l, IR_NE, value, l->zero, cmp_zero_wide(from), false, cast);
+
+    // arithmetic on narrow integers leaves the upper bits set, casting truncates them again
+    i32 t1 = get_type_id(from);
+    i32 t2 = get_type_id(to);
+    if(t1 == t2)
+        t1 = I64;
+
+    switch(cast_table[t1][t2])
+    {
+        case EXT_S1:
+            return emit_ext(l, value, 1, false, cast);
+        case EXT_U1:
+            return emit_ext(l, value, 1, true, cast);
+        case EXT_S2:
+            return emit_ext(l, value, 2, false, cast);
+        case EXT_U2:
+            return emit_ext(l, value, 2, true, cast);
+        case EXT_S4:
+            return emit_ext(l, value, 4, false, cast);
+        case EXT_U4:
+            return emit_ext(l, value, 4, true, cast);
+        default:
+            return value;
+    }
+}
+
+// the result of `tail` calls gets returned unchanged, see tail_calls.c
+static IRValue_T lower_call(IRLowering_T* l, ASTNode_T* call, bool tail)
+{
+    ASTObj_T* callee = call->called_obj;
+    ASTNode_T* expr = call->expr;
+    if(!callee || callee->kind != OBJ_FUNCTION || call->return_buffer || call->args->size > IR_MAX_ARGS)
+        unsupported(l);
+    if(expr->kind != ND_ID || !expr->referenced_obj || expr->referenced_obj->kind != OBJ_FUNCTION)
+        unsupported(l);
+    if(expr->call && (!expr->call->referenced_obj || expr->call->referenced_obj->kind != OBJ_FUNCTION))
+        unsupported(l);
+
+    IRValue_T* args = allocator_malloc(&l->context->raw_allocator, MAX(call->args->size, 1) * sizeof(IRValue_T));
+
+    // arguments get evaluated from right to left
+    for(i64 i = call->args->size - 1; i >= 0; i--)
+    {
+        ASTNode_T* arg = call->args->items[i];
+        if(arg->unpack_mode || !is_scalar(arg->data_type))
+            unsupported(l);
+        args[i] = lower_expr(l, arg);
+    }
+
+    IRInstr_T* instr = emit(l, IR_CALL, call);
+    instr->node = call;
+    instr->args = args;
+    instr->num_args = call->args->size;
+    instr->tail = tail;
+    IRValue_T result = emit_value(l, instr);
+    if(tail)
+        return result;
+
+    // the upper bits of short return values are undefined
+    switch(call->data_type->kind)
+    {
+        case TY_BOOL:
+            return emit_ext(l, result, 1, true, call);
+        case TY_CHAR:
+        case TY_I8:
+            return emit_ext(l, result, 1, false, call);
+        case TY_U8:
+            return emit_ext(l, result, 1, true, call);
+        case TY_I16:
+            return emit_ext(l, result, 2, false, call);
+        case TY_U16:
+            return emit_ext(l, result, 2, true, call);
+        default:
+            return result;
+    }
+}
+
+static IRValue_T lower_logical(IRLowering_T* l, ASTNode_T* node)
+{
+    size_t result = new_temporary(l);
+    IRBlock_T* rhs_block = new_block(l);
+    IRBlock_T* true_block = new_block(l);
+    IRBlock_T* false_block = new_block(l);
+    IRBlock_T* end_block = new_block(l);
+
+    if(node->kind == ND_AND)
+        lower_cond_br(l, node->left, rhs_block, false_block);
+    else
+        lower_cond_br(l, node->left, true_block, rhs_block);
+
+    seal_block(l, rhs_block);
+    start_block(l, rhs_block);
+    lower_cond_br(l, node->right, true_block, false_block);
+
+    seal_block(l, true_block);
+    start_block(l, true_block);
+    write_var(true_block, result, emit_const(l, 1, node));
+    emit_jmp(l, end_block);
+
+    seal_block(l, false_block);
+    start_block(l, false_block);
+    write_var(false_block, result, l->zero);
+    emit_jmp(l, end_block);
+
+    seal_block(l, end_block);
+    start_block(l, end_block);
+    return read_var(l, end_block, result);
+}
+
+static IRValue_T lower_ternary(IRLowering_T* l, ASTNode_T* ternary)
+{
+    size_t result = new_temporary(l);
+    IRBlock_T* then_block = new_block(l);
+    IRBlock_T* else_block = new_block(l);
+    IRBlock_T* end_block = new_block(l);
+
+    lower_cond_br(l, ternary->condition, then_block, else_block);
+
+    seal_block(l, then_block);
+    start_block(l, then_block);
+    IRValue_T value = lower_expr(l, ternary->if_branch);
+    write_var(current_block(l), result, value);
+    emit_jmp(l, end_block);
+
+    seal_block(l, else_block);
+    start_block(l, else_block);
+    value = lower_expr(l, ternary->else_branch);
+    write_var(current_block(l), result, value);
+    emit_jmp(l, end_block);
+
+    seal_block(l, end_block);
+    start_block(l, end_block);
+    return read_var(l, end_block, result);
+}
+
+static IRValue_T lower_binary(IRLowering_T* l, ASTNode_T* node)
+{
+    ASTType_T* left_type = node->left->data_type;
+    ASTType_T* right_type = node->right->data_type;
+    if(!is_scalar(left_type) || !is_scalar(right_type))
+        unsupported(l);
+
+    IROpcode_T op;
+    bool swap = false;
+    switch(node->kind)
+    {
+        case ND_ADD: op = IR_ADD; break;
+        case ND_SUB: op = IR_SUB; break;
+        case ND_MUL: op = IR_MUL; break;
+        case ND_DIV: op = IR_DIV; break;
+        case ND_MOD: op = IR_MOD; break;
+        case ND_BIT_AND: op = IR_AND; break;
+        case ND_BIT_OR: op = IR_OR; break;
+        case ND_XOR: op = IR_XOR; break;
+        case ND_LSHIFT: op = IR_SHL; break;
+        case ND_RSHIFT: op = IR_SHR; break;
+        case ND_EQ: op = IR_EQ; break;
+        case ND_NE: op = IR_NE; break;
+        case ND_LT: op = IR_LT; break;
+        case ND_LE: op = IR_LE; break;
+        case ND_GT: op = IR_LT; swap = true; break;
+        case ND_GE: op = IR_LE; swap = true; break;
+        default:
+            unsupported(l);
+            return 0;
+    }
+
+    // pointer arithmetic scales the second operand like the AST backend does
+    i64 scale = 0;
+    if(node->kind == ND_ADD)
+    {
+        if(unpack(left_type)->base && unpack(right_type)->base)
+            unsupported(l);
+        if(ptr_type(left_type))
+            scale = MAX(unpack(left_type)->base->size, 1);
+    }
+    else if(node->kind == ND_SUB && ptr_type(left_type))
+    {
+        if(is_integer(right_type))
+            scale = MAX(unpack(left_type)->base->size, 1);
+        else if(!node->bool_val)
+        {
+            // pointer difference, (a - b) / sizeof *a
+            IRValue_T right = lower_expr(l, node->right);
+            IRValue_T left = lower_expr(l, node->left);
+            IRValue_T diff = emit_binary(l, IR_SUB, left, right, true, false, node);
+            IRValue_T size = emit_const(l, unpack(left_type)->base->size, node);
+            return emit_div(l, IR_DIV, diff, size, is_wide(node->data_type), false, node->data_type->size, node);
+        }
+    }
+
+    IRValue_T left, right;
+    if(swap)
+    {
+        left = lower_expr(l, node->left);
+        right = lower_expr(l, node->right);
+    }
+    else
+    {
+        right = lower_expr(l, node->right);
+        left = lower_expr(l, node->left);
+    }
+
+    // the offset gets extended first, so negative offsets stay negative
+    if(scale)
+        right = emit_ext_to(l, right, right_type, node);
+    if(scale > 1)
+        right = emit_binary(l, IR_MUL, right, emit_const(l, scale, node), true, false, node);
+
+    bool is_unsigned = false;
+    switch(op)
+    {
+        case IR_DIV:
+        case IR_MOD:
+            is_unsigned = unsigned_type(node->data_type);
+            break;
+        case IR_SHR:
+        case IR_EQ ... IR_LE:
+            is_unsigned = unsigned_type(left_type);
+            break;
+        default:
+            break;
+    }
+
+    if(op == IR_DIV || op == IR_MOD)
+        return emit_div(l, op, left, right, is_wide(left_type), is_unsigned, left_type->size, node);
+    return swap
+        ? emit_binary(l, op, right, left, is_wide(left_type), is_unsigned, node)
+        : emit_binary(l, op, left, right, is_wide(left_type), is_unsigned, node);
+}
+
+static IRValue_T lower_expr(IRLowering_T* l, ASTNode_T* node)
+{
+    if(node->data_type && unpack(node->data_type)->kind != TY_VOID && !is_scalar(node->data_type))
+        unsupported(l);
+
+    switch(node->kind)
+    {
+        case ND_NOOP:
+            return l->zero;
+        case ND_INT:
+        case ND_CHAR:
+            return emit_const(l, node->int_val, node);
+        case ND_LONG:
+            return emit_const(l, node->long_val, node);
+        case ND_ULONG:
+            return emit_const(l, (i64) node->ulong_val, node);
+        case ND_BOOL:
+            return emit_const(l, node->bool_val, node);
+        case ND_NIL:
+            return l->zero;
+        case ND_SIZEOF:
+            return emit_const(l, node->the_type->size, node);
+        case ND_ALIGNOF:
+            return emit_const(l, node->the_type->align, node);
+        case ND_STR:
+        {
+            IRInstr_T* instr = emit(l, IR_STRING, node);
+            instr->node = node;
+            return emit_value(l, instr);
+        }
+        case ND_CLOSURE:
+        {
+            IRValue_T value = l->zero;
+            for(size_t i = 0; i < node->exprs->size; i++)
+                value = lower_expr(l, node->exprs->items[i]);
+            return value;
+        }
+        case ND_ID:
+            return lower_id(l, node);
+        case ND_DEREF:
+            return emit_load(l, lower_expr(l, node->right), node->data_type, node);
+        case ND_MEMBER:
+        case ND_INDEX:
+            return emit_load(l, lower_addr(l, node), node->data_type, node);
+        case ND_REF:
+            return lower_addr(l, node->right);
+        case ND_ASSIGN:
+            return lower_assign(l, node);
+        case ND_INC:
+        case ND_DEC:
+            return lower_inc(l, node);
+        case ND_CAST:
+            return lower_cast(l, node);
+        case ND_NOT:
+            return emit_binary(l, IR_EQ, lower_expr(l, node->right), l->zero, cmp_zero_wide(node->right->data_type), false, node);
+        case ND_BIT_NEG:
+            return emit_unary(l, IR_NOT, lower_expr(l, node->right), node);
+        case ND_NEG:
+            return emit_unary(l, IR_NEG, lower_expr(l, node->right), node);
+        case ND_AND:
+        case ND_OR:
+            return lower_logical(l, node);
+        case ND_TERNARY:
+            return lower_ternary(l, node);
+        case ND_CALL:
+            return lower_call(l, node, false);
+        case ND_ADD:
+        case ND_SUB:
+        case ND_MUL:
+        case ND_DIV:
+        case ND_MOD:
+        case ND_BIT_AND:
+        case ND_BIT_OR:
+        case ND_XOR:
+        case ND_LSHIFT:
+        case ND_RSHIFT:
+        case ND_EQ:
+        case ND_NE:
+        case ND_LT:
+        case ND_LE:
+        case ND_GT:
+        case ND_GE:
+            return lower_binary(l, node);
+        default:
+            unsupported(l);
+            return 0;
+    }
+}
+
+// statements
+
+static void lower_loop_body(IRLowering_T* l, ASTNode_T* body, IRBlock_T* break_block, IRBlock_T* continue_block)
+{
+    IRBlock_T* prev_break = l->break_block;
+    IRBlock_T* prev_continue = l->continue_block;
+    l->break_block = break_block;
+    l->continue_block = continue_block;
+    lower_stmt(l, body);
+    l->break_block = prev_break;
+    l->continue_block = prev_continue;
+}
+
+static void lower_if(IRLowering_T* l, ASTNode_T* node)
+{
+    IRBlock_T* then_block = new_block(l);
+    IRBlock_T* else_block = node->else_branch ? new_block(l) : NULL;
+    IRBlock_T* end_block = new_block(l);
+
+    lower_cond_br(l, node->condition, then_block, EITHER(else_block, end_block));
+
+    seal_block(l, then_block);
+    start_block(l, then_block);
+    lower_stmt(l, node->if_branch);
+    emit_jmp(l, end_block);
+
+    if(else_block)
+    {
+        seal_block(l, else_block);
+        start_block(l, else_block);
+        lower_stmt(l, node->else_branch);
+        emit_jmp(l, end_block);
+    }
+
+    seal_block(l, end_block);
+    start_block(l, end_block);
+}
+
+static void lower_while(IRLowering_T* l, ASTNode_T* node)
+{
+    IRBlock_T* header = new_block(l);
+    IRBlock_T* body = new_block(l);
+    IRBlock_T* exit = new_block(l);
+
+    emit_jmp(l, header);
+    start_block(l, header);
+    lower_cond_br(l, node->condition, body, exit);
+
+    seal_block(l, body);
+    start_block(l, body);
+    lower_loop_body(l, node->body, exit, header);
+    emit_jmp(l, header);
+
+    seal_block(l, header);
+    seal_block(l, exit);
+    start_block(l, exit);
+}
+
+static void lower_for(IRLowering_T* l, ASTNode_T* node)
+{
+    if(node->init_stmt)
+        lower_stmt(l, node->init_stmt);
+
+    IRBlock_T* header = new_block(l);
+    IRBlock_T* body = new_block(l);
+    IRBlock_T* latch = new_block(l);
+    IRBlock_T* exit = new_block(l);
+
+    emit_jmp(l, header);
+    start_block(l, header);
+    if(node->condition)
+        lower_cond_br(l, node->condition, body, exit);
+    else
+        emit_jmp(l, body);
+
+    seal_block(l, body);
+    start_block(l, body);
+    lower_loop_body(l, node->body, exit, latch);
+    emit_jmp(l, latch);
+
+    seal_block(l, latch);
+    start_block(l, latch);
+    if(node->expr)
+        lower_expr(l, node->expr);
+    emit_jmp(l, header);
+
+    seal_block(l, header);
+    seal_block(l, exit);
+    start_block(l, exit);
+}
+
+static void lower_for_range(IRLowering_T* l, ASTNode_T* node)
+{
+    // the counter is a signed 64 bit integer, see `asm_gen_stmt()`
+    size_t counter = new_temporary(l);
+    IRValue_T begin = lower_expr(l, node->left);
+    IRValue_T end = lower_expr(l, node->right);
+    write_var(current_block(l), counter, begin);
+
+    IRBlock_T* header = new_block(l);
+    IRBlock_T* body = new_block(l);
+    IRBlock_T* latch = new_block(l);
+    IRBlock_T* exit = new_block(l);
+
+    emit_jmp(l, header);
+    start_block(l, header);
+    IRValue_T cond = emit_binary(l, IR_LT, read_var(l, header, counter), end, true, false, node);
+    emit_br(l, cond, true, body, exit, node);
+
+    seal_block(l, body);
+    start_block(l, body);
+    lower_loop_body(l, node->body, exit, latch);
+    emit_jmp(l, latch);
+
+    seal_block(l, latch);
+    start_block(l, latch);
+    IRValue_T next = emit_binary(l, IR_ADD, read_var(l, latch, counter), emit_const(l, 1, node), true, false, node);
+    write_var(latch, counter, next);
+    emit_jmp(l, header);
+
+    seal_block(l, header);
+    seal_block(l, exit);
+    start_block(l, exit);
+}
+
+static void lower_loop(IRLowering_T* l, ASTNode_T* node)
+{
+    IRBlock_T* header = new_block(l);
+    IRBlock_T* exit = new_block(l);
+
+    emit_jmp(l, header);
+    start_block(l, header);
+    lower_loop_body(l, node->body, exit, header);
+    emit_jmp(l, header);
+
+    seal_block(l, header);
+    seal_block(l, exit);
+    start_block(l, exit);
+}
+
+static void lower_do_while(IRLowering_T* l, ASTNode_T* node)
+{
+    IRBlock_T* body = new_block(l);
+    IRBlock_T* latch = new_block(l);
+    IRBlock_T* exit = new_block(l);
+
+    emit_jmp(l, body);
+    start_block(l, body);
+    lower_loop_body(l, node->body, exit, latch);
+    emit_jmp(l, latch);
+
+    seal_block(l, latch);
+    start_block(l, latch);
+    lower_cond_br(l, node->condition, body, exit);
+
+    seal_block(l, body);
+    seal_block(l, exit);
+    start_block(l, exit);
+}
+
+static void lower_do_unless(IRLowering_T* l, ASTNode_T* node)
+{
+    IRBlock_T* body = new_block(l);
+    IRBlock_T* end = new_block(l);
+
+    lower_cond_br(l, node->condition, end, body);
+
+    seal_block(l, body);
+    start_block(l, body);
+    lower_stmt(l, node->body);
+    emit_jmp(l, end);
+
+    seal_block(l, end);
+    start_block(l, end);
+}
+
+static void lower_stmt(IRLowering_T* l, ASTNode_T* node)
+{
+    switch(node->kind)
+    {
+        case ND_NOOP:
+            return;
+        case ND_BLOCK:
+            for(size_t i = 0; i < node->locals->size; i++)
+            {
+                ASTObj_T* local = node->locals->items[i];
+                if(!is_scalar(local->data_type))
+                    unsupported(l);
+                write_var(current_block(l), var_index(l, local), l->zero);
+            }
+            for(size_t i = 0; i < node->stmts->size; i++)
+                lower_stmt(l, node->stmts->items[i]);
+            return;
+        case ND_EXPR_STMT:
+            lower_expr(l, node->expr);
+            return;
+        case ND_RETURN:
+        {
+            IRValue_T value = node->tail_call ? lower_call(l, node->return_val, true)
+                : node->return_val ? lower_expr(l, node->return_val) : 0;
+            IRInstr_T* ret = emit(l, IR_RET, node);
+            ret->a = value;
+            l->block = NULL;
+        } return;
+        case ND_IF:
+            lower_if(l, node);
+            return;
+        case ND_WHILE:
+            lower_while(l, node);
+            return;
+        case ND_FOR:
+            lower_for(l, node);
+            return;
+        case ND_FOR_RANGE:
+            lower_for_range(l, node);
+            return;
+        case ND_LOOP:
+            lower_loop(l, node);
+            return;
+        case ND_DO_WHILE:
+            lower_do_while(l, node);
+            return;
+        case ND_DO_UNLESS:
+            lower_do_unless(l, node);
+            return;
+        case ND_BREAK:
+            if(!l->break_block)
+                unsupported(l);
+            emit_jmp(l, l->break_block);
+            return;
+        case ND_CONTINUE:
+            if(!l->continue_block)
+                unsupported(l);
+            emit_jmp(l, l->continue_block);
+            return;
+        case ND_USING:
+        case ND_MATCH_TYPE:
+            if(node->body)
+                lower_stmt(l, node->body);
+            return;
+        default:
+            unsupported(l);
+    }
+}
+
+static bool supported_signature(ASTObj_T* fn)
+{
+    if(!fn->body || is_variadic(fn->data_type) || fn->return_ptr || fn->args->size > IR_MAX_ARGS)
+        return false;
+
+    ASTType_T* return_type = unpack(fn->return_type);
+    if(return_type && return_type->kind != TY_VOID && !is_scalar(return_type))
+        return false;
+
+    for(size_t i = 0; i < fn->args->size; i++)
+        if(!is_scalar(((ASTObj_T*) fn->args->items[i])->data_type))
+            return false;
+    return true;
+}
+
+static void lower_function(Context_T* context, ASTObj_T* obj)
+{
+    if(!supported_signature(obj))
+        return;
+
+    IRLowering_T l = {
+        .context = context,
+        .fn = init_ir_function(context, obj),
+        .blocks = init_list(),
+        .vars = init_list()
+    };
+    volatile bool lowered = false;
+
+    try(l.unsupported)
+    {
+        IRBlock_T* entry = new_block(&l);
+        entry->sealed = true;
+        start_block(&l, entry);
+
+        for(size_t i = 0; i < obj->args->size; i++)
+        {
+            ASTObj_T* arg = obj->args->items[i];
+            IRInstr_T* instr = emit(&l, IR_ARG, NULL);
+            instr->imm = i;
+            IRValue_T value = emit_ext_to(&l, emit_value(&l, instr), arg->data_type, NULL);
+            write_var(entry, var_index(&l, arg), value);
+        }
+        l.zero = emit_const(&l, 0, NULL);
+
+        lower_stmt(&l, obj->body);
+        if(l.block)
+            emit(&l, IR_RET, NULL);
+        lowered = true;
+    }
+
+    for(size_t i = 0; i < l.blocks->size; i++)
+    {
+        IRBlock_T* block = l.blocks->items[i];
+        free(block->defs);
+        block->defs = NULL;
+        block->num_defs = 0;
+        if(block->incomplete_phis)
+            free_list(block->incomplete_phis);
+        block->incomplete_phis = NULL;
+    }
+    free_list(l.blocks);
+    free_list(l.vars);
+
+    if(lowered)
+    {
+        ir_optimize(context, l.fn);
+        // leaving SSA allocates, which code generation on worker threads must not do
+        ir_leave_ssa(context, l.fn);
+        obj->ir = l.fn;
+    }
+}
+
+static void lower_objs(Context_T* context, List_T* objs)
+{
+    for(size_t i = 0; i < objs->size; i++)
+    {
+        ASTObj_T* obj = objs->items[i];
+        switch(obj->kind)
+        {
+            case OBJ_NAMESPACE:
+                lower_objs(context, obj->objs);
+                break;
+            case OBJ_FUNCTION:
+                if(!obj->is_extern && should_emit(context, obj))
+                    lower_function(context, obj);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+i32 ir_pass(Context_T* context, ASTProg_T* ast)
+{
+    timer_start(context, "ir lowering");
+    lower_objs(context, ast->objs);
+    timer_stop(context);
+    return 0;
+}
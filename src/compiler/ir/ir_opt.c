@@ -0,0 +1,621 @@
+#include "ir.h"
+#include "context.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Optimizations on the SSA form:
+//   - removal of unreachable blocks and constant branches
+//   - copy propagation, including trivial phis
+//   - constant folding with the exact semantics of the emitted instructions
+//   - local common subexpression elimination (value numbering per block)
+//   - folding constant address offsets into loads and stores
+//   - dead code elimination
+
+#define IR_MAX_OPT_ROUNDS 8
+
+typedef struct IR_OPTIMIZER_STRUCT {
+    Context_T* context;
+    IRFunction_T* fn;
+    IRInstr_T** defs;      // value -> defining instruction
+    IRValue_T* replace;    // value -> replacement, 0 if none
+} IROptimizer_T;
+
+static void find_defs(IROptimizer_T* o)
+{
+    memset(o->defs, 0, (o->fn->num_values + 1) * sizeof(IRInstr_T*));
+    for(size_t i = 0; i < o->fn->blocks->size; i++)
+    {
+        IRBlock_T* block = o->fn->blocks->items[i];
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IRInstr_T* instr = block->instrs->items[j];
+            if(instr->dst)
+                o->defs[instr->dst] = instr;
+        }
+    }
+}
+
+static IRInstr_T* const_def(IROptimizer_T* o, IRValue_T value)
+{
+    IRInstr_T* def = value ? o->defs[value] : NULL;
+    return def && def->op == IR_CONST ? def : NULL;
+}
+
+static IRValue_T resolve(IROptimizer_T* o, IRValue_T value)
+{
+    while(o->replace[value])
+        value = o->replace[value];
+    return value;
+}
+
+static void replace_operand(IRValue_T* operand, void* data)
+{
+    *operand = resolve(data, *operand);
+}
+
+// applies all pending replacements and removes the replaced instructions
+static bool apply_replacements(IROptimizer_T* o)
+{
+    bool changed = false;
+    for(size_t i = 0; i < o->fn->blocks->size; i++)
+    {
+        IRBlock_T* block = o->fn->blocks->items[i];
+        size_t kept = 0;
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IRInstr_T* instr = block->instrs->items[j];
+            if(instr->dst && o->replace[instr->dst])
+            {
+                changed = true;
+                continue;
+            }
+            ir_foreach_operand(instr, replace_operand, o);
+            block->instrs->items[kept++] = instr;
+        }
+        block->instrs->size = kept;
+    }
+
+    memset(o->replace, 0, (o->fn->num_values + 1) * sizeof(IRValue_T));
+    return changed;
+}
+
+static void remove_pred(IRBlock_T* block, size_t index)
+{
+    for(size_t i = index + 1; i < block->preds->size; i++)
+        block->preds->items[i - 1] = block->preds->items[i];
+    block->preds->size--;
+
+    for(size_t i = 0; i < block->instrs->size; i++)
+    {
+        IRInstr_T* phi = block->instrs->items[i];
+        if(phi->op != IR_PHI)
+            break;
+        for(u32 j = index + 1; j < phi->num_args; j++)
+            phi->args[j - 1] = phi->args[j];
+        phi->num_args--;
+    }
+}
+
+static void remove_edge(IRBlock_T* from, IRBlock_T* to)
+{
+    for(size_t i = to->preds->size; i > 0; i--)
+        if(to->preds->items[i - 1] == from)
+        {
+            remove_pred(to, i - 1);
+            return;
+        }
+}
+
+static void mark_reachable(IRBlock_T* block, bool* reachable)
+{
+    if(reachable[block->id])
+        return;
+    reachable[block->id] = true;
+
+    IRBlock_T* succs[2];
+    u32 num_succs = ir_successors(block, succs);
+    for(u32 i = 0; i < num_succs; i++)
+        mark_reachable(succs[i], reachable);
+}
+
+static bool remove_unreachable_blocks(IROptimizer_T* o)
+{
+    bool* reachable = calloc(o->fn->num_blocks, sizeof(bool));
+    mark_reachable(o->fn->blocks->items[0], reachable);
+
+    bool changed = false;
+    size_t kept = 0;
+    for(size_t i = 0; i < o->fn->blocks->size; i++)
+    {
+        IRBlock_T* block = o->fn->blocks->items[i];
+        if(!reachable[block->id])
+        {
+            IRBlock_T* succs[2];
+            u32 num_succs = ir_successors(block, succs);
+            for(u32 j = 0; j < num_succs; j++)
+                if(reachable[succs[j]->id])
+                    while(list_contains(succs[j]->preds, block))
+                        remove_edge(block, succs[j]);
+            changed = true;
+            continue;
+        }
+        o->fn->blocks->items[kept++] = block;
+    }
+    o->fn->blocks->size = kept;
+
+    free(reachable);
+    return changed;
+}
+
+static bool propagate_copies(IROptimizer_T* o)
+{
+    bool found = false;
+    for(size_t i = 0; i < o->fn->blocks->size; i++)
+    {
+        IRBlock_T* block = o->fn->blocks->items[i];
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IRInstr_T* instr = block->instrs->items[j];
+            switch(instr->op)
+            {
+                case IR_COPY:
+                    o->replace[instr->dst] = resolve(o, instr->a);
+                    found = true;
+                    break;
+
+                case IR_PHI:
+                {
+                    // a phi only referring to itself and one other value is that value
+                    IRValue_T unique = 0;
+                    bool trivial = true;
+                    for(u32 k = 0; k < instr->num_args && trivial; k++)
+                    {
+                        IRValue_T arg = resolve(o, instr->args[k]);
+                        if(arg == instr->dst || arg == unique)
+                            continue;
+                        if(unique)
+                            trivial = false;
+                        unique = arg;
+                    }
+                    if(trivial && unique)
+                    {
+                        o->replace[instr->dst] = unique;
+                        found = true;
+                    }
+                } break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    return found && apply_replacements(o);
+}
+
+// constant folding
+
+static u64 extend(u64 value, u8 size, bool is_unsigned)
+{
+    // short extensions write a 32 bit register, clearing the upper half
+    switch(size)
+    {
+        case 1:
+            return is_unsigned ? (u8) value : (u32) (i32) (i8) value;
+        case 2:
+            return is_unsigned ? (u16) value : (u32) (i32) (i16) value;
+        case 4:
+            return is_unsigned ? (u32) value : (u64) (i64) (i32) value;
+        default:
+            return value;
+    }
+}
+
+static bool fold_binary(IRInstr_T* instr, u64 a, u64 b, u64* result)
+{
+    if(!instr->wide)
+    {
+        a = (u32) a;
+        b = (u32) b;
+    }
+
+    switch(instr->op)
+    {
+        case IR_ADD:
+            *result = a + b;
+            break;
+        case IR_SUB:
+            *result = a - b;
+            break;
+        case IR_MUL:
+            *result = a * b;
+            break;
+        case IR_AND:
+            *result = a & b;
+            break;
+        case IR_OR:
+            *result = a | b;
+            break;
+        case IR_XOR:
+            *result = a ^ b;
+            break;
+        case IR_SHL:
+            *result = a << (b & (instr->wide ? 63 : 31));
+            break;
+        case IR_SHR:
+            if(instr->is_unsigned)
+                *result = a >> (b & (instr->wide ? 63 : 31));
+            else if(instr->wide)
+                *result = (u64) ((i64) a >> (b & 63));
+            else
+                *result = (u32) ((i32) a >> (b & 31));
+            break;
+        case IR_DIV:
+        case IR_MOD:
+            // the sign extension of mixed widths depends on register contents
+            if(b == 0 || (!instr->is_unsigned && instr->wide != (instr->size == 8)))
+                return false;
+            if(instr->is_unsigned)
+                *result = instr->op == IR_DIV ? a / b : a % b;
+            else if(instr->wide)
+            {
+                if((i64) a == INT64_MIN && (i64) b == -1)
+                    return false;
+                *result = instr->op == IR_DIV ? (u64) ((i64) a / (i64) b) : (u64) ((i64) a % (i64) b);
+            }
+            else
+            {
+                if((i32) a == INT32_MIN && (i32) b == -1)
+                    return false;
+                *result = instr->op == IR_DIV ? (u32) ((i32) a / (i32) b) : (u32) ((i32) a % (i32) b);
+            }
+            break;
+        case IR_EQ:
+            *result = a == b;
+            return true;
+        case IR_NE:
+            *result = a != b;
+            return true;
+        case IR_LT:
+            *result = instr->is_unsigned ? a < b : instr->wide ? (i64) a < (i64) b : (i32) a < (i32) b;
+            return true;
+        case IR_LE:
+            *result = instr->is_unsigned ? a <= b : instr->wide ? (i64) a <= (i64) b : (i32) a <= (i32) b;
+            return true;
+        default:
+            return false;
+    }
+
+    if(!instr->wide)
+        *result = (u32) *result;
+    return true;
+}
+
+static void make_const(IRInstr_T* instr, u64 value)
+{
+    instr->op = IR_CONST;
+    instr->imm = value;
+    instr->a = instr->b = 0;
+}
+
+static bool is_bool_value(IROptimizer_T* o, IRValue_T value)
+{
+    IRInstr_T* def = o->defs[value];
+    if(!def)
+        return false;
+    return (def->op >= IR_EQ && def->op <= IR_LE) || (def->op == IR_CONST && (def->imm == 0 || def->imm == 1));
+}
+
+static bool fold_constants(IROptimizer_T* o)
+{
+    bool changed = false;
+    for(size_t i = 0; i < o->fn->blocks->size; i++)
+    {
+        IRBlock_T* block = o->fn->blocks->items[i];
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IRInstr_T* instr = block->instrs->items[j];
+            IRInstr_T* a = const_def(o, instr->a);
+            IRInstr_T* b = const_def(o, instr->b);
+            u64 result;
+
+            switch(instr->op)
+            {
+                case IR_EXT:
+                {
+                    IRInstr_T* def = o->defs[instr->a];
+                    if(a)
+                    {
+                        make_const(instr, extend(a->imm, instr->size, instr->is_unsigned));
+                        changed = true;
+                    }
+                    // extending an already extended value again does nothing
+                    else if(is_bool_value(o, instr->a) || (def && (def->op == IR_EXT || def->op == IR_LOAD) && def->size == instr->size && def->is_unsigned == instr->is_unsigned))
+                    {
+                        o->replace[instr->dst] = instr->a;
+                        changed = true;
+                    }
+                } break;
+
+                case IR_NEG:
+                case IR_NOT:
+                    if(a)
+                    {
+                        make_const(instr, instr->op == IR_NEG ? -(u64) a->imm : ~(u64) a->imm);
+                        changed = true;
+                    }
+                    break;
+
+                case IR_ADD ... IR_SHR:
+                case IR_EQ ... IR_LE:
+                    if(a && b && fold_binary(instr, a->imm, b->imm, &result))
+                    {
+                        make_const(instr, result);
+                        changed = true;
+                    }
+                    // x + 0, x - 0, x | 0, x ^ 0 and x * 1 in 64 bit
+                    else if(instr->wide && b && ((b->imm == 0 && (instr->op == IR_ADD || instr->op == IR_SUB || instr->op == IR_OR || instr->op == IR_XOR)) || (b->imm == 1 && instr->op == IR_MUL)))
+                    {
+                        o->replace[instr->dst] = instr->a;
+                        changed = true;
+                    }
+                    else if(instr->wide && a && ((a->imm == 0 && (instr->op == IR_ADD || instr->op == IR_OR || instr->op == IR_XOR)) || (a->imm == 1 && instr->op == IR_MUL)))
+                    {
+                        o->replace[instr->dst] = instr->b;
+                        changed = true;
+                    }
+                    break;
+
+                case IR_BR:
+                    if(a || instr->targets[0] == instr->targets[1])
+                    {
+                        bool taken = a ? (instr->wide ? a->imm != 0 : (u32) a->imm != 0) : true;
+                        IRBlock_T* target = instr->targets[!taken];
+                        remove_edge(block, instr->targets[taken]);
+                        instr->op = IR_JMP;
+                        instr->a = 0;
+                        instr->targets[0] = target;
+                        instr->targets[1] = NULL;
+                        changed = true;
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    apply_replacements(o);
+    return changed;
+}
+
+// value numbering
+
+typedef struct IR_EXPR_KEY_STRUCT {
+    IROpcode_T op;
+    IRValue_T a, b;
+    i64 imm;
+    u8 size;
+    bool wide, is_unsigned;
+    void* obj;
+    u32 memory; // loads are only equal in between the same stores and calls
+} IRExprKey_T;
+
+typedef struct IR_EXPR_ENTRY_STRUCT {
+    IRExprKey_T key;
+    IRValue_T value;
+    bool used;
+} IRExprEntry_T;
+
+static bool is_pure(IROpcode_T op)
+{
+    switch(op)
+    {
+        case IR_CONST:
+        case IR_ADDR:
+        case IR_LOAD:
+        case IR_EXT:
+        case IR_ADD ... IR_LE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_commutative(IROpcode_T op)
+{
+    return op == IR_ADD || op == IR_MUL || op == IR_AND || op == IR_OR || op == IR_XOR || op == IR_EQ || op == IR_NE;
+}
+
+static u64 hash_key(IRExprKey_T* key)
+{
+    u64 hash = key->op;
+    hash = hash * 31 + key->a;
+    hash = hash * 31 + key->b;
+    hash = hash * 31 + (u64) key->imm;
+    hash = hash * 31 + key->size + key->wide * 2 + key->is_unsigned * 4;
+    hash = hash * 31 + (u64) (uintptr_t) key->obj;
+    hash = hash * 31 + key->memory;
+    return hash ^ (hash >> 29);
+}
+
+static bool eliminate_common_subexprs(IROptimizer_T* o)
+{
+    bool found = false;
+    for(size_t i = 0; i < o->fn->blocks->size; i++)
+    {
+        IRBlock_T* block = o->fn->blocks->items[i];
+        size_t capacity = 16;
+        while(capacity < block->instrs->size * 2)
+            capacity *= 2;
+
+        IRExprEntry_T* table = calloc(capacity, sizeof(IRExprEntry_T));
+        u32 memory = 0;
+
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IRInstr_T* instr = block->instrs->items[j];
+            if(instr->op == IR_STORE || instr->op == IR_CALL)
+                memory++;
+            if(!is_pure(instr->op))
+                continue;
+
+            // keys get compared with memcmp, so the padding has to be zeroed
+            IRExprKey_T key;
+            memset(&key, 0, sizeof(IRExprKey_T));
+            key.op = instr->op;
+            key.a = instr->a;
+            key.b = instr->b;
+            key.imm = instr->imm;
+            key.size = instr->size;
+            key.wide = instr->wide;
+            key.is_unsigned = instr->is_unsigned;
+            key.obj = instr->op == IR_ADDR ? (void*) instr->node->referenced_obj : NULL;
+            key.memory = instr->op == IR_LOAD ? memory : 0;
+            if(is_commutative(key.op) && key.a > key.b)
+            {
+                key.a = instr->b;
+                key.b = instr->a;
+            }
+
+            size_t slot = hash_key(&key) & (capacity - 1);
+            while(table[slot].used && memcmp(&table[slot].key, &key, sizeof(IRExprKey_T)))
+                slot = (slot + 1) & (capacity - 1);
+
+            if(table[slot].used)
+            {
+                o->replace[instr->dst] = table[slot].value;
+                found = true;
+            }
+            else
+                table[slot] = (IRExprEntry_T){.key = key, .value = instr->dst, .used = true};
+        }
+
+        free(table);
+    }
+
+    return found && apply_replacements(o);
+}
+
+// member accesses and indices with constant offsets fold into the addressing mode
+static bool fold_addresses(IROptimizer_T* o)
+{
+    bool changed = false;
+    for(size_t i = 0; i < o->fn->blocks->size; i++)
+    {
+        IRBlock_T* block = o->fn->blocks->items[i];
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IRInstr_T* instr = block->instrs->items[j];
+            if(instr->op != IR_LOAD && instr->op != IR_STORE)
+                continue;
+
+            IRInstr_T* addr = o->defs[instr->a];
+            if(!addr || addr->op != IR_ADD || !addr->wide)
+                continue;
+
+            IRInstr_T* offset = const_def(o, addr->b);
+            IRValue_T base = addr->a;
+            if(!offset)
+            {
+                offset = const_def(o, addr->a);
+                base = addr->b;
+            }
+
+            if(offset && instr->imm + offset->imm == (i32) (instr->imm + offset->imm))
+            {
+                instr->a = base;
+                instr->imm += offset->imm;
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+static void mark_live(IROptimizer_T* o, bool* live, IRValue_T value);
+
+static void mark_operand_live(IRValue_T* operand, void* data)
+{
+    void** args = data;
+    mark_live(args[0], args[1], *operand);
+}
+
+static void mark_live(IROptimizer_T* o, bool* live, IRValue_T value)
+{
+    if(live[value])
+        return;
+    live[value] = true;
+
+    IRInstr_T* def = o->defs[value];
+    if(def)
+        ir_foreach_operand(def, mark_operand_live, (void*[]){o, live});
+}
+
+static void eliminate_dead_code(IROptimizer_T* o)
+{
+    bool* live = calloc(o->fn->num_values + 1, sizeof(bool));
+    for(size_t i = 0; i < o->fn->blocks->size; i++)
+    {
+        IRBlock_T* block = o->fn->blocks->items[i];
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IRInstr_T* instr = block->instrs->items[j];
+            if(!ir_has_side_effects(instr->op))
+                continue;
+            if(instr->dst)
+                mark_live(o, live, instr->dst);
+            else
+                ir_foreach_operand(instr, mark_operand_live, (void*[]){o, live});
+        }
+    }
+
+    for(size_t i = 0; i < o->fn->blocks->size; i++)
+    {
+        IRBlock_T* block = o->fn->blocks->items[i];
+        size_t kept = 0;
+        for(size_t j = 0; j < block->instrs->size; j++)
+        {
+            IRInstr_T* instr = block->instrs->items[j];
+            if(instr->op == IR_NOP || (!ir_has_side_effects(instr->op) && !live[instr->dst]))
+                continue;
+            block->instrs->items[kept++] = instr;
+        }
+        block->instrs->size = kept;
+    }
+
+    free(live);
+}
+
+void ir_optimize(Context_T* context, IRFunction_T* fn)
+{
+    IROptimizer_T o = {
+        .context = context,
+        .fn = fn,
+        .defs = malloc((fn->num_values + 1) * sizeof(IRInstr_T*)),
+        .replace = calloc(fn->num_values + 1, sizeof(IRValue_T))
+    };
+
+    for(u32 round = 0; round < IR_MAX_OPT_ROUNDS; round++)
+    {
+        bool changed = remove_unreachable_blocks(&o);
+        changed |= propagate_copies(&o);
+
+        find_defs(&o);
+        changed |= fold_constants(&o);
+        changed |= eliminate_common_subexprs(&o);
+
+        find_defs(&o);
+        changed |= fold_addresses(&o);
+        if(!changed)
+            break;
+    }
+
+    find_defs(&o);
+    eliminate_dead_code(&o);
+
+    free(o.defs);
+    free(o.replace);
+}
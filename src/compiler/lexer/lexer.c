@@ -2,6 +2,7 @@
 #include "ast/ast.h"
 #include "config.h"
 #include "error/error.h"
+#include "interner.h"
 #include "list.h"
 #include "token.h"
 
@@ -14,48 +15,72 @@
 #include <stdlib.h>
 #include <string.h>
 
+// detached lexers must not report errors themselves, so they bail out
+// and leave it to the main thread to lex the file again
+#define lexer_error(lexer, ...) do {                \
+        if((lexer)->detached)                       \
+            throw(*(lexer)->detached);              \
+        throw_error((lexer)->context, __VA_ARGS__); \
+    } while(0)
+
+// keywords are looked up using a perfect hash of their length, first, second and last
+// character (like gperf does), so each identifier needs at most one comparison
+#define KEYWORD_MIN_LENGTH 2
+#define KEYWORD_MAX_LENGTH 9
+#define KEYWORD_HASH_SIZE 44
+
+static const u8 keyword_asso[256] = {
+    ['a'] = 7, ['b'] = 3, ['c'] = 7, ['d'] = 2, ['f'] = 8, ['g'] = 9, ['h'] = 13,
+    ['i'] = 13, ['k'] = 2, ['l'] = 8, ['m'] = 9, ['n'] = 13, ['o'] = 2, ['p'] = 8,
+    ['s'] = 13, ['u'] = 11, ['w'] = 3, ['x'] = 6, ['y'] = 1
+};
+
+static inline size_t keyword_hash(const char* id, size_t length)
+{
+    return length + keyword_asso[(u8) id[0]] + keyword_asso[(u8) id[1]] + keyword_asso[(u8) id[length - 1]];
+}
+
 const struct { 
     const char* str; 
     TokenType_T type; 
-} keywords[] = {
-    {"alignof", TOKEN_ALIGNOF},
-    {"asm", TOKEN_ASM},
-    {"break", TOKEN_BREAK},
-    {"const", TOKEN_CONST},
-    {"continue", TOKEN_CONTINUE},
-    {"defer", TOKEN_DEFER},
-    {"do", TOKEN_DO},
-    {"else", TOKEN_ELSE},
-    {"embed", TOKEN_EMBED},
-    {"enum", TOKEN_ENUM},
-    {"extern", TOKEN_EXTERN},
-    {"false", TOKEN_FALSE},
-    {"fn", TOKEN_FN},
-    {"for", TOKEN_FOR},
-    {"if", TOKEN_IF},
-    {"import", TOKEN_IMPORT},
-    {"interface", TOKEN_INTERFACE},
-    {"len", TOKEN_LEN},
-    {"let", TOKEN_LET},
-    {"loop", TOKEN_LOOP},
-    {"macro", TOKEN_MACRO},
-    {"match", TOKEN_MATCH},
-    {"namespace", TOKEN_NAMESPACE},
-    {"nil", TOKEN_NIL},
-    {"noop", TOKEN_NOOP},
-    {"operator", TOKEN_OPERATOR_KW},
-    {"ret", TOKEN_RETURN},
-    {"sizeof", TOKEN_SIZEOF},
-    {"struct", TOKEN_STRUCT},
-    {"true", TOKEN_TRUE},
-    {"type", TOKEN_TYPE},
-    {"typeof", TOKEN_TYPEOF},
-    {"union", TOKEN_UNION},
-    {"unless", TOKEN_UNLESS},
-    {"using", TOKEN_USING},
-    {"while", TOKEN_WHILE},
-    {"with", TOKEN_WITH},
-    {NULL, TOKEN_EOF}   // end of array indicator
+} keywords[KEYWORD_HASH_SIZE] = {
+    [3] = {"ret", TOKEN_RETURN},
+    [4] = {"true", TOKEN_TRUE},
+    [5] = {"type", TOKEN_TYPE},
+    [7] = {"defer", TOKEN_DEFER},
+    [8] = {"do", TOKEN_DO},
+    [10] = {"break", TOKEN_BREAK},
+    [11] = {"let", TOKEN_LET},
+    [12] = {"else", TOKEN_ELSE},
+    [13] = {"for", TOKEN_FOR},
+    [14] = {"const", TOKEN_CONST},
+    [15] = {"typeof", TOKEN_TYPEOF},
+    [16] = {"embed", TOKEN_EMBED},
+    [17] = {"continue", TOKEN_CONTINUE},
+    [18] = {"operator", TOKEN_OPERATOR_KW},
+    [19] = {"struct", TOKEN_STRUCT},
+    [20] = {"false", TOKEN_FALSE},
+    [21] = {"while", TOKEN_WHILE},
+    [22] = {"loop", TOKEN_LOOP},
+    [23] = {"macro", TOKEN_MACRO},
+    [24] = {"len", TOKEN_LEN},
+    [25] = {"extern", TOKEN_EXTERN},
+    [26] = {"enum", TOKEN_ENUM},
+    [27] = {"noop", TOKEN_NOOP},
+    [28] = {"import", TOKEN_IMPORT},
+    [29] = {"namespace", TOKEN_NAMESPACE},
+    [30] = {"alignof", TOKEN_ALIGNOF},
+    [31] = {"if", TOKEN_IF},
+    [32] = {"asm", TOKEN_ASM},
+    [33] = {"with", TOKEN_WITH},
+    [34] = {"match", TOKEN_MATCH},
+    [35] = {"interface", TOKEN_INTERFACE},
+    [36] = {"fn", TOKEN_FN},
+    [37] = {"nil", TOKEN_NIL},
+    [38] = {"using", TOKEN_USING},
+    [40] = {"sizeof", TOKEN_SIZEOF},
+    [42] = {"union", TOKEN_UNION},
+    [43] = {"unless", TOKEN_UNLESS},
 };
 
 const struct { 
@@ -101,9 +126,13 @@ void init_lexer(Lexer_T* lexer, Context_T* context, File_T* src)
     lexer->context = context;
     lexer->file = src;
 
+    lexer->offset = 0;
     lexer->pos = 0;
     lexer->line = 0;
-    lexer->c = get_char(lexer->file, lexer->line, lexer->pos);
+    lexer->c = lexer->file->buffer[lexer->offset];
+
+    lexer->allocator = &context->raw_allocator;
+    lexer->detached = NULL;
 
     lexer->tmp_buffer_size = LEXER_TMP_BUFFER_DEFAULT_SIZE;
     lexer->tmp_buffer = malloc(lexer->tmp_buffer_size * sizeof(char));
@@ -139,29 +168,28 @@ i32 lexer_pass(Context_T* context, ASTProg_T* ast)
 
 static void lexer_advance(Lexer_T* lexer)
 {
-    lexer->pos++;
-    if(lexer->pos >= get_line_len(lexer->file, lexer->line))
-    {
-        if(lexer->line >= lexer->file->num_lines - 1)
-        {
-            lexer->c = '\0';
-            // end of file
-            return;
-        }
+    if(lexer->offset >= lexer->file->size)
+        return; // end of file
 
+    // a trailing '\n' does not begin a new line
+    if(lexer->c == '\n' && lexer->offset + 1 < lexer->file->size)
+    {
         lexer->pos = 0;
         lexer->line++;
     }
+    else
+        lexer->pos++;
 
-    lexer->c = get_char(lexer->file, lexer->line, lexer->pos);
+    lexer->c = lexer->file->buffer[++lexer->offset];
 }
 
 static char lexer_peek(Lexer_T* lexer, int offset)
 {
-    if(lexer->pos + offset >= get_line_len(lexer->file, lexer->line))
+    // negative offsets wrap around and get caught here as well
+    if(lexer->offset + offset >= lexer->file->size)
         return -1;
     
-    return get_char(lexer->file, lexer->line, lexer->pos + offset);
+    return lexer->file->buffer[lexer->offset + offset];
 }
 
 Token_T* lexer_consume(Lexer_T* lexer, Token_T* token)
@@ -172,7 +200,7 @@ Token_T* lexer_consume(Lexer_T* lexer, Token_T* token)
 
 Token_T* lexer_consume_type(Lexer_T* lexer, TokenType_T type)
 {
-    return lexer_consume(lexer, init_token(&lexer->context->raw_allocator, (char[]){lexer->c, '\0'}, lexer->line, lexer->pos, type, lexer->file));
+    return lexer_consume(lexer, init_token(lexer->allocator, (char[]){lexer->c, '\0'}, lexer->line, lexer->pos, type, lexer->file));
 }
 
 Token_T* lexer_next_token(Lexer_T* lexer)
@@ -217,7 +245,7 @@ static void lexer_skip_multiline_comment(Lexer_T* lexer)
         else if(lexer->c == '\0')
         {   
             //end of file
-            throw_error(lexer->context, ERR_SYNTAX_ERROR,  init_token(&lexer->context->raw_allocator, "#[", start_line, start_pos + 1, TOKEN_ID, lexer->file), "unterminated multiline comment");
+            lexer_error(lexer, ERR_SYNTAX_ERROR,  init_token_static(lexer->allocator, "#[", start_line, start_pos + 1, TOKEN_ID, lexer->file), "unterminated multiline comment");
             return;
         }
         lexer_advance(lexer);
@@ -236,6 +264,7 @@ static void lexer_skip_comment(Lexer_T* lexer)
     {
         if(lexer->line >= lexer->file->num_lines - 1)
         {
+            lexer->offset = lexer->file->size;
             lexer->c = '\0';
             // end of file
             return;
@@ -243,8 +272,9 @@ static void lexer_skip_comment(Lexer_T* lexer)
 
         lexer->pos = 0;
         lexer->line++;
+        lexer->offset = lexer->file->line_offsets[lexer->line];
 
-        lexer->c = get_char(lexer->file, lexer->line, lexer->pos);
+        lexer->c = lexer->file->buffer[lexer->offset];
     }
 
     lexer_skip_whitespace(lexer);
@@ -253,25 +283,26 @@ static void lexer_skip_comment(Lexer_T* lexer)
         lexer_skip_comment(lexer);
 }
 
-static TokenType_T lexer_get_id_type(char* id)
+static i32 lexer_find_keyword(const char* id, size_t length)
 {
-    TokenType_T type = TOKEN_ID;
-    for(int i = 0; keywords[i].str != NULL; i++)
-        if(strcmp(keywords[i].str, id) == 0)
-            type = keywords[i].type;
+    if(length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH)
+        return -1;
 
-    return type;
+    size_t hash = keyword_hash(id, length);
+    if(hash < KEYWORD_HASH_SIZE && keywords[hash].str && strncmp(keywords[hash].str, id, length) == 0 && keywords[hash].str[length] == '\0')
+        return hash;
+
+    return -1;
 }
 
 static Token_T* lexer_get_id(Lexer_T* lexer)
 {
-    *lexer->tmp_buffer = '\0';
+    size_t start = lexer->offset;
 
     while(isalnum(lexer->c) || lexer->c == '_' || lexer->c == '?' || lexer->c == '\'')
-    {
-        strcat(lexer->tmp_buffer, (char[]){lexer->c, '\0'});
         lexer_advance(lexer);
-    }
+    
+    size_t length = lexer->offset - start;
 
     bool is_macro = false;
     if(lexer->c == '!')
@@ -280,44 +311,55 @@ static Token_T* lexer_get_id(Lexer_T* lexer)
         is_macro = true;
     }
 
-    Token_T* id_token = init_token(&lexer->context->raw_allocator, lexer->tmp_buffer, lexer->line, lexer->pos - 1 - (int) is_macro, is_macro ? TOKEN_MACRO_CALL : lexer_get_id_type(lexer->tmp_buffer), lexer->file);
+    u32 pos = lexer->pos - 1 - (int) is_macro;
+    i32 keyword = is_macro ? -1 : lexer_find_keyword(&lexer->file->buffer[start], length);
+    if(keyword >= 0)
+        return init_token_static(lexer->allocator, keywords[keyword].str, lexer->line, pos, keywords[keyword].type, lexer->file);
 
-    if(str_starts_with(id_token->value, "__csp_"))
-        throw_error(lexer->context, ERR_SYNTAX_WARNING, id_token, "Unsafe identifier name:\nidentifiers starting with `__csp_` may be used internally");
+    Token_T* id_token = init_token_slice(lexer->allocator, lexer->file, start, length, lexer->line, pos, is_macro ? TOKEN_MACRO_CALL : TOKEN_ID);
+    if(!lexer->detached)
+        lexer_intern(lexer->context, id_token);
 
     return id_token;
 }
 
+void lexer_intern(Context_T* context, Token_T* token)
+{
+    token->value = intern_n(&context->interner, token->value, token->length);
+
+    if(str_starts_with(token->value, "__csp_"))
+        throw_error(context, ERR_SYNTAX_WARNING, token, "Unsafe identifier name:\nidentifiers starting with `__csp_` may be used internally");
+}
+
+Token_T* init_id_token(Context_T* context, const char* id, u32 line, u32 pos, File_T* source)
+{
+    return init_token_static(&context->raw_allocator, intern(&context->interner, id), line, pos, TOKEN_ID, source);
+}
+
 static Token_T* lexer_get_int(Lexer_T* lexer, const char* digits, i32 base)
 {
     lexer_advance(lexer);    // cut the '0x'
     lexer_advance(lexer);
 
-    *lexer->tmp_buffer = '\0';
-
-    while(strchr(digits, lexer->c))
+    size_t length = 0;
+    while(lexer->c && strchr(digits, lexer->c))
     {
-        if(lexer->c == '_')
-        {
-            lexer_advance(lexer);
-            continue;
-        }
-        strcat(lexer->tmp_buffer, (char[2]){lexer->c, '\0'});
-
+        if(lexer->c != '_' && length < lexer->tmp_buffer_size - 1)
+            lexer->tmp_buffer[length++] = lexer->c;
         lexer_advance(lexer);
     }
+    lexer->tmp_buffer[length] = '\0';
 
     u64 decimal = strtoll(lexer->tmp_buffer, NULL, base);
     sprintf(lexer->tmp_buffer, "%lu", decimal);
 
-    Token_T* token = init_token(&lexer->context->raw_allocator, lexer->tmp_buffer, lexer->line, lexer->pos, TOKEN_INT, lexer->file);
-    return token;
+    return init_token(lexer->allocator, lexer->tmp_buffer, lexer->line, lexer->pos, TOKEN_INT, lexer->file);
 }
 
 static Token_T* lexer_get_decimal(Lexer_T* lexer)
 {
     TokenType_T type = TOKEN_INT;
-    *lexer->tmp_buffer = '\0';
+    size_t length = 0;
 
     while(isdigit(lexer->c) || lexer->c == '.' || lexer->c == '_')
     {
@@ -327,26 +369,26 @@ static Token_T* lexer_get_decimal(Lexer_T* lexer)
             continue;
         }
 
-        strcat(lexer->tmp_buffer, (char[2]){lexer->c, '\0'});
+        if(length < lexer->tmp_buffer_size - 1)
+            lexer->tmp_buffer[length++] = lexer->c;
+        lexer->tmp_buffer[length] = '\0';
 
         if(lexer->c == '.')
         {   
             if(lexer_peek(lexer, 1) == '.')
-            {
-                Token_T* token = init_token(&lexer->context->raw_allocator, lexer->tmp_buffer, lexer->line, lexer->pos, type, lexer->file);
-                return token;
-            }
+                return init_token(lexer->allocator, lexer->tmp_buffer, lexer->line, lexer->pos, type, lexer->file);
 
             if(type == TOKEN_FLOAT)
-                throw_error(lexer->context, ERR_SYNTAX_ERROR,  &(Token_T){.line = lexer->line, .pos = lexer->pos, .source = lexer->file}, "multiple `.` found in number literal");
+                lexer_error(lexer, ERR_SYNTAX_ERROR,  &(Token_T){.line = lexer->line, .pos = lexer->pos, .source = lexer->file, .value = ""}, "multiple `.` found in number literal");
 
             type = TOKEN_FLOAT;
         }
         lexer_advance(lexer);
     }
 
-    Token_T* token = init_token(&lexer->context->raw_allocator, lexer->tmp_buffer, lexer->line, lexer->pos - 1, type, lexer->file);
-    return token;
+    lexer->tmp_buffer[length] = '\0';
+
+    return init_token(lexer->allocator, lexer->tmp_buffer, lexer->line, lexer->pos - 1, type, lexer->file);
 }
 
 static Token_T* lexer_get_number(Lexer_T* lexer)
@@ -370,31 +412,25 @@ static Token_T* lexer_get_number(Lexer_T* lexer)
 
 static Token_T* lexer_get_str(Lexer_T* lexer)
 {
-    u64 length = DEFAULT_STRING_TOKEN_SIZE;
-    char* buffer = calloc(length, sizeof(char));
-
     size_t start_line = lexer->line;
     size_t start_pos = lexer->pos;
+    size_t start = lexer->offset;
 
     lexer_advance(lexer);
 
     while(lexer->c != '"' || (lexer_peek(lexer, -1) == '\\' && lexer_peek(lexer, -2) != '\\'))
     {
-        if(strlen(buffer) - 3 >= length)
-            buffer = realloc(buffer, length *= 2);
-
-        strcat(buffer, (char[2]){lexer->c, '\0'});
-
         lexer_advance(lexer);
 
         if(lexer->c == '\0')
-            throw_error(lexer->context, ERR_SYNTAX_ERROR, init_token(&lexer->context->raw_allocator, "\"", start_line, start_pos, TOKEN_STRING, lexer->file), "unterminated string literal, expect `\"`");        
+            lexer_error(lexer, ERR_SYNTAX_ERROR, init_token_static(lexer->allocator, "\"", start_line, start_pos, TOKEN_STRING, lexer->file), "unterminated string literal, expect `\"`");        
     }
+
+    // the string's value is the raw text between the quotes
+    size_t length = lexer->offset - start - 1;
     lexer_advance(lexer);
 
-    Token_T* token = init_token(&lexer->context->raw_allocator, buffer, lexer->line, lexer->pos, TOKEN_STRING, lexer->file);
-    free(buffer);
-    return token;
+    return init_token_slice(lexer->allocator, lexer->file, start + 1, length, lexer->line, lexer->pos, TOKEN_STRING);
 }
 
 static Token_T* lexer_get_char(Lexer_T* lexer)
@@ -403,8 +439,8 @@ static Token_T* lexer_get_char(Lexer_T* lexer)
 
     if(lexer->c == '\'')
     {
-        throw_error(lexer->context, ERR_SYNTAX_ERROR,  &(Token_T){.line = lexer->line, .pos = lexer->pos, .source = lexer->file}, "empty char literal");
-        return init_token(&lexer->context->raw_allocator, "EOF", lexer->line, lexer->pos, TOKEN_EOF, lexer->file);
+        lexer_error(lexer, ERR_SYNTAX_ERROR,  &(Token_T){.line = lexer->line, .pos = lexer->pos, .source = lexer->file, .value = ""}, "empty char literal");
+        return init_token_static(lexer->allocator, "EOF", lexer->line, lexer->pos, TOKEN_EOF, lexer->file);
     }
 
     char data[3] = {lexer->c, '\0', '\0'};
@@ -415,7 +451,7 @@ static Token_T* lexer_get_char(Lexer_T* lexer)
     case 'C':
         if(lexer_peek(lexer, 1) != '\'') 
         {
-            Token_T* tok = init_token(&lexer->context->raw_allocator, (char[]){'\'', lexer->c, '\0'}, lexer->line, lexer->pos, TOKEN_C_ARRAY, lexer->file);
+            Token_T* tok = init_token(lexer->allocator, (char[]){'\'', lexer->c, '\0'}, lexer->line, lexer->pos, TOKEN_C_ARRAY, lexer->file);
             lexer_advance(lexer);
             return tok;
         }
@@ -432,13 +468,13 @@ static Token_T* lexer_get_char(Lexer_T* lexer)
         break;
     }
     
-    Token_T* token = init_token(&lexer->context->raw_allocator, data, lexer->line, lexer->pos, TOKEN_CHAR, lexer->file);
+    Token_T* token = init_token(lexer->allocator, data, lexer->line, lexer->pos, TOKEN_CHAR, lexer->file);
     lexer_advance(lexer);
 
     if(lexer->c != '\'')
     {
-        throw_error(lexer->context, ERR_SYNTAX_ERROR, init_token(&lexer->context->raw_allocator, "'", lexer->line, lexer->pos, TOKEN_CHAR, lexer->file), "unterminated char literal, expect `'`");
-        return init_token(&lexer->context->raw_allocator, "EOF", lexer->line, lexer->pos, TOKEN_EOF, lexer->file); 
+        lexer_error(lexer, ERR_SYNTAX_ERROR, init_token_static(lexer->allocator, "'", lexer->line, lexer->pos, TOKEN_CHAR, lexer->file), "unterminated char literal, expect `'`");
+        return init_token_static(lexer->allocator, "EOF", lexer->line, lexer->pos, TOKEN_EOF, lexer->file); 
     }
     lexer_advance(lexer);
 
@@ -473,24 +509,22 @@ static inline bool is_operator_char(char c)
 
 static Token_T* lexer_get_operator(Lexer_T* lexer)
 {
-    *lexer->tmp_buffer = '\0';
+    size_t start = lexer->offset;
 
     while(is_operator_char(lexer->c))
-    {
-        strcat(lexer->tmp_buffer, (char[]){lexer->c, '\0'});
         lexer_advance(lexer);
-    }
 
-    Token_T* operator = init_token(&lexer->context->raw_allocator, lexer->tmp_buffer, lexer->line, lexer->pos - 1, TOKEN_OPERATOR, lexer->file);
+    size_t length = lexer->offset - start;
+    const char* op = &lexer->file->buffer[start];
 
     for(size_t i = 0; operator_overrides[i].symbol; i++)
-        if(strcmp(operator->value, operator_overrides[i].symbol) == 0)
-        {
-            operator->type = operator_overrides[i].type;
-            break;
-        }
+        if(strncmp(op, operator_overrides[i].symbol, length) == 0 && operator_overrides[i].symbol[length] == '\0')
+            return init_token_static(lexer->allocator, operator_overrides[i].symbol, lexer->line, lexer->pos - 1, operator_overrides[i].type, lexer->file);
 
-    return operator;
+    Token_T* token = init_token_slice(lexer->allocator, lexer->file, start, length, lexer->line, lexer->pos - 1, TOKEN_OPERATOR);
+    if(!lexer->detached)
+        lexer_intern(lexer->context, token);
+    return token;
 }
 
 static Token_T* lexer_get_symbol(Lexer_T* lexer)
@@ -500,19 +534,19 @@ static Token_T* lexer_get_symbol(Lexer_T* lexer)
         const char* s = symbols[i].symbol;
         if(strlen(s) == 1 && lexer->c == s[0])
             return lexer_consume(lexer, 
-                init_token(&lexer->context->raw_allocator, (char*) s, lexer->line, lexer->pos, symbols[i].type, lexer->file)
+                init_token_static(lexer->allocator, s, lexer->line, lexer->pos, symbols[i].type, lexer->file)
             );
         if(strlen(s) == 2 && lexer->c == s[0] && lexer_peek(lexer, 1) == s[1])
             return lexer_consume(lexer, 
                 lexer_consume(lexer, 
-                    init_token(&lexer->context->raw_allocator, (char*) s, lexer->line, lexer->pos + 1, symbols[i].type, lexer->file)
+                    init_token_static(lexer->allocator, s, lexer->line, lexer->pos + 1, symbols[i].type, lexer->file)
                 )
             );
         if(strlen(s) == 3 && lexer->c == s[0] && lexer_peek(lexer, 1) == s[1] && lexer_peek(lexer, 2) == s[2])
             return lexer_consume(lexer, 
                 lexer_consume(lexer, 
                     lexer_consume(lexer, 
-                        init_token(&lexer->context->raw_allocator, (char*) s, lexer->line, lexer->pos + 2, symbols[i].type, lexer->file)
+                        init_token_static(lexer->allocator, s, lexer->line, lexer->pos + 2, symbols[i].type, lexer->file)
                     )
                 )
             );
@@ -530,16 +564,16 @@ static Token_T* lexer_get_symbol(Lexer_T* lexer)
             return lexer_get_char(lexer);
         
         case '\0':
-            return init_token(&lexer->context->raw_allocator, "EOF", lexer->line, lexer->pos, TOKEN_EOF, lexer->file);
+            return init_token_static(lexer->allocator, "EOF", lexer->line, lexer->pos, TOKEN_EOF, lexer->file);
 
         default: {
             if(!lexer->c || lexer->c == -1) 
             {
                 // file is empty, return EOF
-                return init_token(&lexer->context->raw_allocator, "EOF", lexer->line, lexer->pos, TOKEN_EOF, lexer->file);
+                return init_token_static(lexer->allocator, "EOF", lexer->line, lexer->pos, TOKEN_EOF, lexer->file);
             }
             else
-                throw_error(lexer->context, ERR_SYNTAX_ERROR, init_token(&lexer->context->raw_allocator, &lexer->c, lexer->line, lexer->pos, TOKEN_ERROR, lexer->file), "unknown token `%c` (id: %d)", lexer->c, lexer->c);
+                lexer_error(lexer, ERR_SYNTAX_ERROR, init_token(lexer->allocator, (char[]){lexer->c, '\0'}, lexer->line, lexer->pos, TOKEN_ERROR, lexer->file), "unknown token `%c` (id: %d)", lexer->c, lexer->c);
         }
     }
     // satisfy -Wall
@@ -548,8 +582,8 @@ static Token_T* lexer_get_symbol(Lexer_T* lexer)
 
 bool token_is_keyword(TokenType_T type)
 {
-    for(size_t i = 0; keywords[i].str; i++) {
-        if(keywords[i].type == type)
+    for(size_t i = 0; i < KEYWORD_HASH_SIZE; i++) {
+        if(keywords[i].str && keywords[i].type == type)
             return true;
     }
     return false;
@@ -7,6 +7,8 @@
 #include "token.h"
 #include "io/file.h"
 #include "error/error.h"
+#include "error/exception.h"
+#include "memory/allocator.h"
 
 #define LEXER_TMP_BUFFER_DEFAULT_SIZE (0x2000)
 
@@ -15,9 +17,15 @@ typedef struct LEXER_STRUCT
     Context_T* context;
     File_T* file;
 
+    Allocator_T* allocator; // tokens get allocated here
+    // set when lexing off the main thread: errors jump here and identifiers
+    // and operators have to be interned using lexer_intern() afterwards
+    Exception_T* detached;
+
     char c;          // current character
+    size_t offset;   // current position in the source buffer
     size_t line;     // current line
-    size_t pos;      // current position
+    size_t pos;      // current position in the line
 
     char* tmp_buffer;
     size_t tmp_buffer_size;
@@ -29,6 +37,9 @@ Token_T* lexer_consume(Lexer_T* lexer, Token_T* token);
 Token_T* lexer_consume_type(Lexer_T* lexer, TokenType_T type);
 Token_T* lexer_next_token(Lexer_T* lexer);
 bool token_is_keyword(TokenType_T type);
+void lexer_intern(Context_T* context, Token_T* token);
+// synthesized identifier tokens, interned like the lexed ones
+Token_T* init_id_token(Context_T* context, const char* id, u32 line, u32 pos, File_T* source);
 
 i32 lexer_pass(Context_T* context, ASTProg_T* ast);
 
@@ -1,39 +1,103 @@
 #include "token.h"
 #include "memory/allocator.h"
 
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-#define SIZEOF_TOKEN(value) (sizeof(struct CSPYDR_TOKEN_STRUCT) + (strlen((value)) + 1) * sizeof(char))
+// owned values are stored directly behind the token
+#define SIZEOF_TOKEN(length) (sizeof(struct CSPYDR_TOKEN_STRUCT) + ((length) + 1) * sizeof(char))
+
+static Token_T* alloc_token(Allocator_T* alloc, size_t value_length, u32 line, u32 pos, TokenType_T type, File_T* source)
+{
+    Token_T* token = allocator_malloc(alloc, SIZEOF_TOKEN(value_length));
+
+    token->line = line;
+    token->pos = pos;
+    token->type = type;
+    token->source = source;
+    token->length = value_length;
+    token->value = (char*) (token + 1);
+
+    return token;
+}
 
 Token_T* init_token(Allocator_T* alloc, char* value, u32 line, u32 pos, TokenType_T type, File_T* source)
 {
-    Token_T* token = allocator_malloc(alloc, SIZEOF_TOKEN(value));
+    // identifiers get compared by pointer, use init_id_token() to intern them
+    assert(type != TOKEN_ID && type != TOKEN_MACRO_CALL);
+
+    size_t length = strlen(value);
+    Token_T* token = alloc_token(alloc, length, line, pos, type, source);
+    memcpy(token->value, value, length + 1);
+
+    return token;
+}
+
+Token_T* init_token_static(Allocator_T* alloc, const char* value, u32 line, u32 pos, TokenType_T type, File_T* source)
+{
+    Token_T* token = allocator_malloc(alloc, sizeof(struct CSPYDR_TOKEN_STRUCT));
 
     token->line = line;
     token->pos = pos;
     token->type = type;
     token->source = source;
+    token->length = strlen(value);
+    token->value = (char*) value;
 
-    strcpy(token->value, value);
+    return token;
+}
+
+Token_T* init_token_slice(Allocator_T* alloc, File_T* source, u32 offset, u32 length, u32 line, u32 pos, TokenType_T type)
+{
+    Token_T* token = allocator_malloc(alloc, sizeof(struct CSPYDR_TOKEN_STRUCT));
+
+    token->line = line;
+    token->pos = pos;
+    token->type = type;
+    token->source = source;
+    token->length = length;
+    token->value = source->buffer + offset;
 
     return token;
 }
 
 char* token_to_str(Token_T* token)
 {
-    const char* template = "Tok: [type: %d, value: `%s`, line: %d, pos: %d]";
-    char* buffer = calloc(strlen(template) + strlen(token->value) + 1, sizeof(char));
+    const char* template = "Tok: [type: %d, value: `%.*s`, line: %d, pos: %d]";
+    char* buffer = calloc(strlen(template) + token->length + 1, sizeof(char));
 
-    sprintf(buffer, template, token->type, token->value, token->line, token->pos);
+    sprintf(buffer, template, token->type, TOKEN_VALUE(token), token->line, token->pos);
 
     return buffer;
 }
 
 Token_T* duplicate_token(Allocator_T* alloc, const Token_T* tok)
 {
-    Token_T* duplicate = allocator_malloc(alloc, SIZEOF_TOKEN(tok->value));
-    memcpy(duplicate, tok, SIZEOF_TOKEN(tok->value));
+    // interned identifiers must stay shared, other values get copied, so they can be modified safely
+    if(tok->type == TOKEN_ID || tok->type == TOKEN_MACRO_CALL)
+    {
+        Token_T* duplicate = allocator_malloc(alloc, sizeof(struct CSPYDR_TOKEN_STRUCT));
+        memcpy(duplicate, tok, sizeof(struct CSPYDR_TOKEN_STRUCT));
+        return duplicate;
+    }
+
+    Token_T* duplicate = allocator_malloc(alloc, SIZEOF_TOKEN(tok->length));
+    memcpy(duplicate, tok, sizeof(struct CSPYDR_TOKEN_STRUCT));
+
+    duplicate->value = (char*) (duplicate + 1);
+    memcpy(duplicate->value, tok->value, tok->length);
+    duplicate->value[tok->length] = '\0';
     return duplicate;
 }
+
+bool token_is_interned(TokenType_T type)
+{
+    return type == TOKEN_ID || type == TOKEN_MACRO_CALL || type == TOKEN_OPERATOR;
+}
+
+bool token_value_is(const Token_T* tok, const char* value)
+{
+    return strncmp(tok->value, value, tok->length) == 0 && value[tok->length] == '\0';
+}
@@ -19,11 +19,25 @@ typedef struct CSPYDR_TOKEN_STRUCT {
 
     bool in_macro_expansion;
 
-    char value[];
+    u32 length; // of `value`
+    char* value; // not '\0'-terminated if it is a slice of the read-only `source->buffer`
 } __attribute__((packed)) Token_T;
 
+// arguments for printing a token's value with "%.*s"
+#define TOKEN_VALUE(tok) (int) (tok)->length, (tok)->value
+
+// copies `value`, identifiers have to be created with init_id_token() instead
 Token_T* init_token(Allocator_T* alloc, char* value, u32 line, u32 position, TokenType_T type, File_T* source);
+// does not copy `value`, it has to outlive the token (keywords, symbols, ...)
+Token_T* init_token_static(Allocator_T* alloc, const char* value, u32 line, u32 position, TokenType_T type, File_T* source);
+// uses `length` characters at `offset` of the read-only source buffer as the token's value without copying them
+Token_T* init_token_slice(Allocator_T* alloc, File_T* source, u32 offset, u32 length, u32 line, u32 position, TokenType_T type);
 Token_T* duplicate_token(Allocator_T* alloc, const Token_T* tok);
 char* token_to_str(Token_T* token);
 
+// identifiers and operators are lexed as slices and get interned on the main thread,
+// string literals stay slices
+bool token_is_interned(TokenType_T type);
+bool token_value_is(const Token_T* tok, const char* value);
+
 #endif
@@ -0,0 +1,230 @@
+#include "token_cache.h"
+#include "config.h"
+#include "version.h"
+#include "io/io.h"
+#include "memory/allocator.h"
+#include "platform/platform_bindings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+// bump this whenever the layout below changes
+#define TOKEN_CACHE_FORMAT 2
+#define TOKEN_CACHE_MAGIC "CSPT"
+
+typedef struct TOKEN_CACHE_HEADER_STRUCT {
+    char magic[4];
+    u32 format;
+    u64 compiler_hash;
+    u64 content_hash;
+    u64 content_size;
+    u32 num_tokens;
+    u32 strings_size;
+} TokenCacheHeader_T;
+
+typedef struct CACHED_TOKEN_STRUCT {
+    u32 type;
+    u32 line;
+    u32 pos;
+    u32 length;
+    u32 value; // offset into the string table, values are '\0'-terminated there
+} CachedToken_T;
+
+// FNV-1a, 64 bit variant
+static u64 hash_bytes(u64 hash, const void* data, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= ((const u8*) data)[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+#define HASH_INIT 14695981039346656037ull
+
+static u64 compiler_hash(void)
+{
+    const char* version = get_cspydr_version();
+    u64 hash = hash_bytes(HASH_INIT, version, strlen(version));
+    hash = hash_bytes(hash, CSPYDR_BUILD_HASH, strlen(CSPYDR_BUILD_HASH));
+
+    // changes to the token types invalidate the cache as well
+    u32 num_token_types = TOKEN_EOF + 1;
+    return hash_bytes(hash, &num_token_types, sizeof(u32));
+}
+
+static void get_token_cache_path(char* buffer, const char* path)
+{
+    get_cache_dir(buffer);
+    sprintf(buffer + strlen(buffer), DIRECTORY_DELIMS TOKEN_CACHE_DIR DIRECTORY_DELIMS "%016lx.tok", (unsigned long) hash_bytes(HASH_INIT, path, strlen(path)));
+}
+
+static bool read_fully(i32 fd, void* buffer, size_t size)
+{
+    while(size > 0)
+    {
+        ssize_t n = read(fd, buffer, size);
+        if(n <= 0)
+            return false;
+        buffer = (u8*) buffer + n;
+        size -= n;
+    }
+    return true;
+}
+
+// opens the cache entry at `path` and reads its header, returns -1 if the entry is missing or stale
+static i32 open_cache_entry(const char* path, File_T* file, u64 content_hash, TokenCacheHeader_T* header)
+{
+    i32 fd = open(path, O_RDONLY);
+    if(fd == -1)
+        return -1;
+
+    struct stat st;
+    bool valid = fstat(fd, &st) != -1
+        && read_fully(fd, header, sizeof(TokenCacheHeader_T))
+        && memcmp(header->magic, TOKEN_CACHE_MAGIC, sizeof(header->magic)) == 0
+        && header->format == TOKEN_CACHE_FORMAT
+        && header->compiler_hash == compiler_hash()
+        && header->content_size == file->size
+        && header->content_hash == content_hash
+        && sizeof(TokenCacheHeader_T) + header->num_tokens * sizeof(CachedToken_T) + header->strings_size == (size_t) st.st_size;
+
+    if(!valid)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool load_cached_tokens(Lexer_T* lexer, List_T* tokens)
+{
+    File_T* file = lexer->file;
+    char path[BUFSIZ] = {'\0'};
+    get_token_cache_path(path, file->path);
+
+    TokenCacheHeader_T header;
+    i32 fd = open_cache_entry(path, file, hash_bytes(HASH_INIT, file->buffer, file->size), &header);
+    if(fd == -1)
+        return false;
+
+    // the string table gets read straight into the lexer's memory, the cached tokens are only needed below
+    CachedToken_T* cached = malloc(header.num_tokens * sizeof(CachedToken_T));
+    char* values = allocator_malloc(lexer->allocator, header.strings_size);
+    bool complete = read_fully(fd, cached, header.num_tokens * sizeof(CachedToken_T))
+        && read_fully(fd, values, header.strings_size);
+    close(fd);
+
+    if(!complete)
+    {
+        free(cached);
+        return false;
+    }
+
+    // all tokens are allocated at once
+    Token_T* new_tokens = allocator_malloc(lexer->allocator, header.num_tokens * sizeof(Token_T));
+
+    for(u32 i = 0; i < header.num_tokens; i++)
+    {
+        Token_T* tok = &new_tokens[i];
+        tok->type = cached[i].type;
+        tok->line = cached[i].line;
+        tok->pos = cached[i].pos;
+        tok->length = cached[i].length;
+        tok->value = values + cached[i].value;
+        tok->source = file;
+
+        if(token_is_interned(tok->type) && !lexer->detached)
+            lexer_intern(lexer->context, tok);
+
+        list_push(tokens, tok);
+    }
+
+    free(cached);
+    return true;
+}
+
+void cache_tokens(File_T* file, Token_T** tokens, size_t num_tokens)
+{
+    if(num_tokens >= UINT32_MAX)
+        return;
+
+    // another compiler process might have cached this file in the meantime
+    char path[BUFSIZ] = {'\0'};
+    u64 content_hash = hash_bytes(HASH_INIT, file->buffer, file->size);
+    TokenCacheHeader_T existing;
+    get_token_cache_path(path, file->path);
+    i32 existing_fd = open_cache_entry(path, file, content_hash, &existing);
+    if(existing_fd != -1)
+    {
+        close(existing_fd);
+        return;
+    }
+
+    get_cache_dir(path);
+    if(make_dir(path))
+        return;
+    strcat(path, DIRECTORY_DELIMS TOKEN_CACHE_DIR);
+    if(make_dir(path))
+        return;
+
+    size_t strings_size = 0;
+    for(size_t i = 0; i < num_tokens; i++)
+        strings_size += tokens[i]->length + 1;
+    if(strings_size >= UINT32_MAX)
+        return;
+
+    size_t size = sizeof(TokenCacheHeader_T) + num_tokens * sizeof(CachedToken_T) + strings_size;
+    u8* data = calloc(size, sizeof(u8));
+
+    TokenCacheHeader_T* header = (TokenCacheHeader_T*) data;
+    memcpy(header->magic, TOKEN_CACHE_MAGIC, sizeof(header->magic));
+    header->format = TOKEN_CACHE_FORMAT;
+    header->compiler_hash = compiler_hash();
+    header->content_hash = content_hash;
+    header->content_size = file->size;
+    header->num_tokens = num_tokens;
+    header->strings_size = strings_size;
+
+    CachedToken_T* cached = (CachedToken_T*) (header + 1);
+    char* strings = (char*) (cached + num_tokens);
+    size_t strings_used = 0;
+
+    for(size_t i = 0; i < num_tokens; i++)
+    {
+        Token_T* tok = tokens[i];
+        cached[i] = (CachedToken_T){
+            .type = tok->type,
+            .line = tok->line,
+            .pos = tok->pos,
+            .length = tok->length,
+            .value = strings_used
+        };
+
+        // `strings` is zeroed, which terminates slices of the source
+        memcpy(strings + strings_used, tok->value, tok->length);
+        strings_used += tok->length + 1;
+    }
+
+    // write to a temporary file first, so that other compiler processes never see half-written caches
+    char tmp_path[BUFSIZ + 64] = {'\0'};
+    get_token_cache_path(path, file->path);
+    sprintf(tmp_path, "%s.%d.%lx", path, (int) getpid(), (unsigned long) pthread_self());
+
+    i32 fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd != -1)
+    {
+        bool written = write(fd, data, size) == (ssize_t) size;
+        close(fd);
+        if(!written || rename(tmp_path, path) == -1)
+            unlink(tmp_path);
+    }
+
+    free(data);
+}
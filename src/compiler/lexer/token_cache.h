@@ -0,0 +1,18 @@
+#ifndef CSPYDR_TOKEN_CACHE_H
+#define CSPYDR_TOKEN_CACHE_H
+
+#include "lexer.h"
+#include "token.h"
+#include "list.h"
+
+// The token streams of imported files get cached in `<cache dir>/tokens`.
+// Cache files are named after the hash of the file's path and are only used
+// if both the file's content and the compiler version still match.
+
+#define TOKEN_CACHE_DIR "tokens"
+
+// pushes the cached tokens of `lexer->file` to `tokens` (without EOF), returns false on a cache miss
+bool load_cached_tokens(Lexer_T* lexer, List_T* tokens);
+void cache_tokens(File_T* file, Token_T** tokens, size_t num_tokens);
+
+#endif
@@ -121,7 +121,7 @@ const char help_text[] = "%s"
                        "      --silent              | Disables all command line output except error messages\n"
                        "      --cc [compiler]       | Sets the C compiler being used after transpiling (default: " DEFAULT_CC ")\n"
                        "      --cc-flags [flags]    | Adds flags passed to the C compiler when transpiling\n"
-                       "      --as [assembler]      | Sets the assembler being used after code generation (default: " DEFAULT_ASSEMBLER ")\n"
+                       "      --as [assembler]      | Uses an external assembler instead of the integrated one (fallback: " DEFAULT_ASSEMBLER ")\n"
                        "  -S                        | Comple only; do not assemble or link\n"
                        "  -c                        | Compile and assemble, but do not link\n"
                        "      --ld [linker]         | Sets the linker being used after compilation (default: " DEFAULT_LINKER ")\n"
@@ -129,7 +129,13 @@ const char help_text[] = "%s"
                        "      --dynamic-linker [ld] | Sets the dynamic linker path (default: " CSPYDR_DEFAULT_DYNAMIC_LINKER_PATH ")\n"
                        "  -g -g0                    | Include/Exclude debug symbols in binary\n"
                        "  -0, --no-opt              | Disables all code optimization\n"
+                       "      --no-loop-opt         | Disables hoisting loop invariants and reducing induction variables\n"
+                       "      --target-cpu [cpu]    | Sets the CPU to generate code for, enables SSE4.1 and AVX2 loops (default: x86-64)\n"
+                       "      --pgo-generate        | Instruments the program to record a profile in the cache when it runs\n"
+                       "      --pgo-use <dir>       | Optimizes using the profile directory <dir> (required) that --pgo-generate recorded in the cache\n"
+                       "      --lto                 | Optimizes across objects at link time and removes unused functions\n"
                        "      --set-mmcd [int]      | Sets the maximum macro call depth (default: %d) (unsafe: could cause stack overflow)\n"
+                       "  -j, --jobs [int]          | Sets the number of threads used to lex imported files, generate assembly and compile C units (default: 1)\n"
                        "      --show-timings        | Shows the duration the different compiler stages took\n"
                        "  -p, --std-path            | Set the path of the standard library (default: " DEFAULT_STD_PATH ")\n"
                        "      --clear-cache         | Clears the cache located at %s" DIRECTORY_DELIMS CACHE_DIR "\n"
@@ -294,6 +300,7 @@ i32 main(i32 argc, char* argv[])
                 exit(1);
             }
             context.as = argv[i];
+            context.flags.external_assembler = true;
         }
         else if(streq(arg, "--ld"))
         {
@@ -315,6 +322,35 @@ i32 main(i32 argc, char* argv[])
         }
         else if(streq(arg, "-0") || streq(arg, "--no-opt"))
             context.flags.optimize = false;
+        else if(streq(arg, "--no-loop-opt"))
+            context.no_loop_opt = true;
+        else if(streq(arg, "--target-cpu"))
+        {
+            if(!argv[++i])
+            {
+                LOG_ERROR(COLOR_BOLD_RED "[Error]" COLOR_RESET COLOR_RED " Expect cpu name after --target-cpu.\n");
+                exit(1);
+            }
+            if(!target_cpu_isa(argv[i], &context.target_isa))
+            {
+                LOG_ERROR_F(COLOR_BOLD_RED "[Error]" COLOR_RESET COLOR_RED " unknown target cpu `%s`.\n", argv[i]);
+                exit(1);
+            }
+            context.target_cpu = argv[i];
+        }
+        else if(streq(arg, "--lto"))
+            context.flags.lto = true;
+        else if(streq(arg, "--pgo-generate"))
+            context.pgo_generate = true;
+        else if(streq(arg, "--pgo-use"))
+        {
+            if(!argv[++i])
+            {
+                LOG_ERROR(COLOR_BOLD_RED "[Error]" COLOR_RESET COLOR_RED " Expect profile directory after --pgo-use.\n");
+                exit(1);
+            }
+            context.pgo_use = argv[i];
+        }
         else if(streq(arg, "--set-mmcd"))
         {
             if(!(context.max_macro_call_depth = atoi(argv[++i])))
@@ -323,6 +359,16 @@ i32 main(i32 argc, char* argv[])
                 exit(1);
             }
         }
+        else if(streq(arg, "-j") || streq(arg, "--jobs"))
+        {
+            i32 num_threads = argv[i + 1] ? atoi(argv[++i]) : 0;
+            if(num_threads <= 0)
+            {
+                LOG_ERROR(COLOR_BOLD_RED "[Error]" COLOR_RESET COLOR_RED " `--jobs` expects an integer greater than 0\n");
+                exit(1);
+            }
+            context.num_threads = num_threads;
+        }
         else if(streq(arg, "--show-timings"))
             enable_timer(&context);
         else if(streq(arg, "-p") || streq(arg, "--std-path"))
@@ -360,6 +406,12 @@ i32 main(i32 argc, char* argv[])
             evaluate_info_flags(&context, argv[i]);
     }
 
+    if(context.pgo_generate && context.pgo_use)
+    {
+        LOG_ERROR(COLOR_BOLD_RED "[Error]" COLOR_RESET COLOR_RED " --pgo-generate and --pgo-use cannot be used together.\n");
+        exit(1);
+    }
+
     if(context.ct == CT_INTERPRETER && action != AC_RUN)
     {
         LOG_ERROR(COLOR_BOLD_RED "[Error]" COLOR_RESET COLOR_RED " using interpreter without code execution; aborting.\n");
@@ -1,52 +1,155 @@
 #include "allocator.h"
 #include "config.h"
 #include "io/log.h"
+#include "util.h"
 
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
 
 #define LAZY_INIT(list) do {   \
     if(!(list))                \
         (list) = init_list();  \
     } while(0)
 
+#define ALLOCATOR_ALIGN(size) (((size) + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1))
+
+struct CSPYDR_ALLOCATOR_CHUNK_STRUCT {
+    AllocatorChunk_T* next;
+    size_t used;
+    size_t size;
+    _Alignas(max_align_t) char data[];
+};
+
 void init_allocator(Allocator_T* alloc, void (*free_func)(void*))
 {
+    memset(alloc, 0, sizeof(Allocator_T));
     alloc->pointers = NULL; // lazy initialization
     alloc->free_func = free_func;
 }
 
+void init_region_allocator(Allocator_T* alloc)
+{
+    init_allocator(alloc, free); // pushed pointers still get freed individually
+    alloc->region = true;
+}
+
 void free_allocator(Allocator_T* alloc)
 {
-    if(!alloc->pointers) 
+    for(AllocatorChunk_T* chunk = alloc->chunks, *next; chunk; chunk = next)
+    {
+        next = chunk->next;
+        free(chunk);
+    }
+    alloc->chunks = NULL;
+    alloc->last = NULL;
+    alloc->last_size = 0;
+
+    if(!alloc->pointers)
         return;
-    
+
     for(size_t i = 0; i < alloc->pointers->size; i++)
         alloc->free_func(alloc->pointers->items[i]);
     free_list(alloc->pointers);
     alloc->pointers = NULL;
 }
 
-void* allocator_malloc(Allocator_T* alloc, size_t malloc_size)
+static void* allocator_calloc(size_t size)
 {
-    LAZY_INIT(alloc->pointers);
-
     uint32_t retry = 0;
     void* ptr;
     do {
-        ptr = calloc(1, malloc_size);
+        ptr = calloc(1, size);
         if(retry++ > MALLOC_RETRY_COUNT)
         {
-            LOG_ERROR_F(COLOR_BOLD_RED "[Error]" COLOR_RESET COLOR_RED " allocating %ld bytes of memory\n", malloc_size);
+            LOG_ERROR_F(COLOR_BOLD_RED "[Error]" COLOR_RESET COLOR_RED " allocating %ld bytes of memory\n", size);
             exit(2);
         }
     } while(!ptr);
 
+    return ptr;
+}
+
+static void* region_malloc(Allocator_T* alloc, size_t malloc_size)
+{
+    size_t size = ALLOCATOR_ALIGN(MAX(malloc_size, 1));
+    AllocatorChunk_T* chunk = alloc->chunks;
+
+    if(!chunk || chunk->size - chunk->used < size)
+    {
+        // oversized allocations get a chunk of their own, so the current one stays in use
+        bool oversized = chunk && size > ALLOCATOR_CHUNK_SIZE / 4;
+        size_t chunk_size = MAX(size, ALLOCATOR_CHUNK_SIZE);
+
+        AllocatorChunk_T* new_chunk = allocator_calloc(sizeof(AllocatorChunk_T) + chunk_size);
+        new_chunk->size = chunk_size;
+
+        if(oversized)
+        {
+            new_chunk->next = chunk->next;
+            chunk->next = new_chunk;
+        }
+        else
+        {
+            new_chunk->next = chunk;
+            alloc->chunks = new_chunk;
+        }
+        chunk = new_chunk;
+    }
+
+    void* ptr = &chunk->data[chunk->used];
+    chunk->used += size;
+
+    alloc->last = ptr;
+    alloc->last_size = malloc_size;
+    return ptr;
+}
+
+void* allocator_malloc(Allocator_T* alloc, size_t malloc_size)
+{
+    if(alloc->region)
+        return region_malloc(alloc, malloc_size);
+
+    LAZY_INIT(alloc->pointers);
+
+    void* ptr = allocator_calloc(malloc_size);
     list_push(alloc->pointers, ptr);
     return ptr;
 }
 
 void* allocator_realloc(Allocator_T* alloc, void* ptr, size_t new_size)
 {
+    if(alloc->region)
+    {
+        if(!ptr)
+            return region_malloc(alloc, new_size);
+
+        // regions don't know the size of older allocations, so they can only resize their latest one
+        if(ptr != alloc->last)
+        {
+            LOG_ERROR_F(COLOR_BOLD_RED "[Error]" COLOR_RESET COLOR_RED " resizing %p, which is not the latest allocation of its region\n", ptr);
+            exit(2);
+        }
+
+        AllocatorChunk_T* chunk = alloc->chunks;
+        size_t old_size = ALLOCATOR_ALIGN(MAX(alloc->last_size, 1));
+        size_t size = ALLOCATOR_ALIGN(MAX(new_size, 1));
+        if(&chunk->data[chunk->used - old_size] == ptr && chunk->size - chunk->used + old_size >= size)
+        {
+            if(size < old_size) // chunk memory has to stay zeroed
+                memset((char*) ptr + size, 0, old_size - size);
+            chunk->used = chunk->used - old_size + size;
+            alloc->last_size = new_size;
+            return ptr;
+        }
+
+        size_t copy_size = MIN(alloc->last_size, new_size);
+        void* new_ptr = region_malloc(alloc, new_size);
+        memcpy(new_ptr, ptr, copy_size);
+        return new_ptr;
+    }
+
     LAZY_INIT(alloc->pointers);
 
     for(size_t i = 0; i < alloc->pointers->size; i++) {
@@ -66,4 +169,35 @@ void* allocator_push(Allocator_T* alloc, void* elem)
     return elem;
 }
 
+void allocator_adopt(Allocator_T* alloc, Allocator_T* other)
+{
+    assert(alloc->free_func == other->free_func);
+
+    // keep the current chunk in front, so that `alloc->last` can still be resized
+    AllocatorChunk_T* tail = other->chunks;
+    if(tail)
+    {
+        while(tail->next)
+            tail = tail->next;
 
+        if(alloc->chunks)
+        {
+            tail->next = alloc->chunks->next;
+            alloc->chunks->next = other->chunks;
+        }
+        else
+            alloc->chunks = other->chunks;
+    }
+
+    if(other->pointers)
+    {
+        for(size_t i = 0; i < other->pointers->size; i++)
+            allocator_push(alloc, other->pointers->items[i]);
+        free_list(other->pointers);
+    }
+
+    other->chunks = NULL;
+    other->pointers = NULL;
+    other->last = NULL;
+    other->last_size = 0;
+}
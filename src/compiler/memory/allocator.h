@@ -2,19 +2,31 @@
 #define CSPYDR_MEMORY_ALLOCATOR_H
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include "list.h"
 
+typedef struct CSPYDR_ALLOCATOR_CHUNK_STRUCT AllocatorChunk_T;
+
 typedef struct CSPYDR_ALLOCATOR_STRUCT {
     List_T* pointers;
     void (*free_func)(void*);
+
+    // region allocators bump-allocate from chunks and free them all at once
+    bool region;
+    AllocatorChunk_T* chunks;
+    void* last;
+    size_t last_size;
 } Allocator_T;
 
 void init_allocator(Allocator_T* alloc, void (*free_func)(void*));
+void init_region_allocator(Allocator_T* alloc);
 void free_allocator(Allocator_T* alloc);
 
 void* allocator_malloc(Allocator_T* alloc, size_t malloc_size);
+// region allocators can only resize their latest allocation and exit otherwise
 void* allocator_realloc(Allocator_T* alloc, void* ptr, size_t new_size);
 void* allocator_push(Allocator_T* alloc, void* elem);
+// moves all memory owned by `other` into `alloc`, leaving `other` empty
+void allocator_adopt(Allocator_T* alloc, Allocator_T* other);
 
 #endif
-
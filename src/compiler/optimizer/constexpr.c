@@ -84,7 +84,7 @@ static u64 const_u64_infix(Context_T* context, ASTNode_T* node)
         case ND_BIT_AND:
             return a & b;
         default:
-            throw_error(context, ERR_CONSTEXPR, node->tok, "`%s` is not a compile type constant", node->tok->value);
+            throw_error(context, ERR_CONSTEXPR, node->tok, "`%.*s` is not a compile type constant", TOKEN_VALUE(node->tok));
             return 0;
     }
 }
@@ -102,7 +102,7 @@ static i64 const_i64_prefix(Context_T* context, ASTNode_T* node)
         case ND_BIT_NEG:
             return ~a;
         default:
-            throw_error(context, ERR_CONSTEXPR, node->tok, "`%s` is not a compile type constant", node->tok->value);
+            throw_error(context, ERR_CONSTEXPR, node->tok, "`%.*s` is not a compile type constant", TOKEN_VALUE(node->tok));
             return 0;
     }
 }
@@ -146,7 +146,7 @@ u64 const_u64(Context_T* context, ASTNode_T* node)
                 return const_u64(context, node->referenced_obj->value);
             // fall through
         default:
-            throw_error(context, ERR_CONSTEXPR, node->tok, "`%s` is not a compile-time constant", node->tok->value);
+            throw_error(context, ERR_CONSTEXPR, node->tok, "`%.*s` is not a compile-time constant", TOKEN_VALUE(node->tok));
             return 0;
     }
 }
@@ -195,7 +195,7 @@ static i64 const_i64_infix(Context_T* context, ASTNode_T* node)
         case ND_BIT_AND:
             return a & b;
         default:
-            throw_error(context, ERR_CONSTEXPR, node->tok, "`%s` is not a compile type constant", node->tok->value);
+            throw_error(context, ERR_CONSTEXPR, node->tok, "`%.*s` is not a compile type constant", TOKEN_VALUE(node->tok));
             return 0;
     }
 }
@@ -236,7 +236,7 @@ i64 const_i64(Context_T* context, ASTNode_T* node)
         case ND_ID:
             if(!node->referenced_obj)
             {
-                throw_error(context, ERR_CONSTEXPR, node->tok, "`%s` is not a compile-time constant", node->tok->value);
+                throw_error(context, ERR_CONSTEXPR, node->tok, "`%.*s` is not a compile-time constant", TOKEN_VALUE(node->tok));
                 return 0;
             }
             if(node->referenced_obj->kind == OBJ_GLOBAL && node->referenced_obj->is_constant)
@@ -245,12 +245,12 @@ i64 const_i64(Context_T* context, ASTNode_T* node)
                 return const_i64(context, node->referenced_obj->value);
             // fall through
         default:
-            throw_error(context, ERR_CONSTEXPR, node->tok, "`%s` is not a compile-time constant", node->tok->value);
+            throw_error(context, ERR_CONSTEXPR, node->tok, "`%.*s` is not a compile-time constant", TOKEN_VALUE(node->tok));
             return 0;
     }
 }
 
-void evaluate_const_exprs(ASTProg_T* ast)
+void evaluate_const_exprs(Context_T* context, ASTProg_T* ast)
 {
     
 }
@@ -15,6 +15,6 @@ ASTNode_T* eval_constexpr(ConstexprResolver_T* resolver, ASTNode_T* expr);
 
 u64 const_u64(Context_T* context, ASTNode_T* node);
 i64 const_i64(Context_T* context, ASTNode_T* node);
-void evaluate_const_exprs(ASTProg_T* ast);
+void evaluate_const_exprs(Context_T* context, ASTProg_T* ast);
 
 #endif
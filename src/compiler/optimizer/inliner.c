@@ -0,0 +1,489 @@
+#include "inliner.h"
+#include "ast/ast.h"
+#include "ast/ast_iterator.h"
+#include "codegen/codegen_utils.h"
+#include "config.h"
+#include "context.h"
+#include "error/error.h"
+#include "io/log.h"
+#include "list.h"
+#include "optimizer.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define throw_error(...)              \
+    do {                              \
+        fprintf(OUTPUT_STREAM, "\n"); \
+        throw_error(__VA_ARGS__);     \
+    } while(0)
+
+// argument registers of the System V ABI
+#define MAX_GP_ARGS 6
+#define MAX_FP_ARGS 8
+
+// maximum number of AST nodes of an inlined function body
+#define INLINE_MAX_SIZE 16
+// functions referenced only once may be bigger, since no copy of them is needed
+#define INLINE_SINGLE_REF_MAX_SIZE 64
+
+typedef struct INLINER_STRUCT
+{
+    Context_T* context;
+    ASTObj_T* current_fn;
+    u32 lambda_depth;
+} Inliner_T;
+
+typedef struct INLINE_PARAM_STRUCT
+{
+    u32 uses;
+    bool written;
+    ASTNode_T* replacement; // literal argument or temporary local
+} InlineParam_T;
+
+static bool is_literal(ASTNode_T* node)
+{
+    switch(node->kind)
+    {
+        case ND_INT:
+        case ND_LONG:
+        case ND_ULONG:
+        case ND_FLOAT:
+        case ND_DOUBLE:
+        case ND_BOOL:
+        case ND_CHAR:
+        case ND_NIL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// the expression a function consists of, NULL if there is none
+static ASTNode_T* inline_body(ASTObj_T* fn)
+{
+    if(fn->is_extern || fn->no_inline || !fn->body || is_variadic(fn->data_type))
+        return NULL;
+
+    ASTType_T* return_type = unpack(fn->return_type);
+    if(return_type->kind != TY_VOID && !is_scalar_type(return_type))
+        return NULL;
+
+    for(size_t i = 0; i < fn->args->size; i++)
+    {
+        ASTType_T* arg_type = ((ASTObj_T*) fn->args->items[i])->data_type;
+        if(!is_scalar_type(arg_type) || arg_type->is_constant)
+            return NULL;
+    }
+
+    ASTNode_T* body = fn->body;
+    if(body->kind == ND_BLOCK && body->stmts->size == 1 && !body->locals->size)
+        body = body->stmts->items[0];
+
+    switch(body->kind)
+    {
+        case ND_RETURN:
+            return body->return_val;
+        case ND_EXPR_STMT:
+            return return_type->kind == TY_VOID ? body->expr : NULL;
+        default:
+            return NULL;
+    }
+}
+
+static void mark_written(ASTObj_T* fn, ASTNode_T* target, InlineParam_T* params)
+{
+    if(target->kind == ND_ID && target->referenced_obj && target->referenced_obj->kind == OBJ_FN_ARG)
+    {
+        size_t index = list_contains(fn->args, target->referenced_obj);
+        if(index)
+            params[index - 1].written = true;
+    }
+}
+
+// checks if `node` can be copied into the caller and counts its size and the uses of the parameters
+static bool check_expr(ASTObj_T* fn, ASTNode_T* node, InlineParam_T* params, u32* size)
+{
+    (*size)++;
+    switch(node->kind)
+    {
+        case ND_INT:
+        case ND_LONG:
+        case ND_ULONG:
+        case ND_FLOAT:
+        case ND_DOUBLE:
+        case ND_BOOL:
+        case ND_CHAR:
+        case ND_NIL:
+        case ND_SIZEOF:
+        case ND_ALIGNOF:
+            return true;
+
+        case ND_STR:
+            // writable string literals must not get duplicated
+            return node->is_constant;
+
+        case ND_ID:
+        {
+            ASTObj_T* obj = node->referenced_obj;
+            if(!obj || obj->kind == OBJ_LOCAL)
+                return false;
+            if(obj->kind != OBJ_FN_ARG)
+                return true;
+
+            size_t index = list_contains(fn->args, obj);
+            if(index)
+                params[index - 1].uses++;
+            return index != 0;
+        }
+
+        case ND_ASSIGN:
+            mark_written(fn, node->left, params);
+            // fall through
+        case ND_ADD:
+        case ND_SUB:
+        case ND_MUL:
+        case ND_DIV:
+        case ND_MOD:
+        case ND_EQ:
+        case ND_NE:
+        case ND_GT:
+        case ND_GE:
+        case ND_LT:
+        case ND_LE:
+        case ND_AND:
+        case ND_OR:
+        case ND_LSHIFT:
+        case ND_RSHIFT:
+        case ND_XOR:
+        case ND_BIT_OR:
+        case ND_BIT_AND:
+            return check_expr(fn, node->left, params, size) && check_expr(fn, node->right, params, size);
+
+        case ND_REF:
+            mark_written(fn, node->right, params);
+            // fall through
+        case ND_NEG:
+        case ND_BIT_NEG:
+        case ND_NOT:
+        case ND_DEREF:
+            return check_expr(fn, node->right, params, size);
+
+        case ND_INC:
+        case ND_DEC:
+            mark_written(fn, node->left, params);
+            // fall through
+        case ND_CAST:
+        case ND_MEMBER:
+            return check_expr(fn, node->left, params, size);
+
+        case ND_LEN:
+            return check_expr(fn, node->expr, params, size);
+
+        case ND_INDEX:
+            return check_expr(fn, node->left, params, size) && check_expr(fn, node->expr, params, size);
+
+        case ND_TERNARY:
+            return check_expr(fn, node->condition, params, size)
+                && check_expr(fn, node->if_branch, params, size)
+                && check_expr(fn, node->else_branch, params, size);
+
+        case ND_CALL:
+            if(node->return_buffer || !check_expr(fn, node->expr, params, size))
+                return false;
+            for(size_t i = 0; i < node->args->size; i++)
+            {
+                ASTNode_T* arg = node->args->items[i];
+                if(arg->unpack_mode || !check_expr(fn, arg, params, size))
+                    return false;
+            }
+            return true;
+
+        case ND_CLOSURE:
+            for(size_t i = 0; i < node->exprs->size; i++)
+                if(!check_expr(fn, node->exprs->items[i], params, size))
+                    return false;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static List_T* clone_list(Context_T* context, ASTObj_T* fn, InlineParam_T* params, List_T* list);
+
+// copies an expression accepted by `check_expr()`, replacing the parameters
+static ASTNode_T* clone_expr(Context_T* context, ASTObj_T* fn, InlineParam_T* params, ASTNode_T* node)
+{
+    if(node->kind == ND_ID && node->referenced_obj->kind == OBJ_FN_ARG)
+    {
+        ASTNode_T* copy = copy_node(context, params[list_contains(fn->args, node->referenced_obj) - 1].replacement);
+        copy->tok = node->tok;
+        return copy;
+    }
+
+    ASTNode_T* copy = copy_node(context, node);
+    switch(node->kind)
+    {
+        case ND_ASSIGN:
+        case ND_ADD:
+        case ND_SUB:
+        case ND_MUL:
+        case ND_DIV:
+        case ND_MOD:
+        case ND_EQ:
+        case ND_NE:
+        case ND_GT:
+        case ND_GE:
+        case ND_LT:
+        case ND_LE:
+        case ND_AND:
+        case ND_OR:
+        case ND_LSHIFT:
+        case ND_RSHIFT:
+        case ND_XOR:
+        case ND_BIT_OR:
+        case ND_BIT_AND:
+            copy->left = clone_expr(context, fn, params, node->left);
+            // fall through
+        case ND_REF:
+        case ND_NEG:
+        case ND_BIT_NEG:
+        case ND_NOT:
+        case ND_DEREF:
+            copy->right = clone_expr(context, fn, params, node->right);
+            break;
+
+        case ND_INC:
+        case ND_DEC:
+        case ND_CAST:
+        case ND_MEMBER:
+            copy->left = clone_expr(context, fn, params, node->left);
+            break;
+
+        case ND_LEN:
+            copy->expr = clone_expr(context, fn, params, node->expr);
+            break;
+
+        case ND_INDEX:
+            copy->left = clone_expr(context, fn, params, node->left);
+            copy->expr = clone_expr(context, fn, params, node->expr);
+            break;
+
+        case ND_TERNARY:
+            copy->condition = clone_expr(context, fn, params, node->condition);
+            copy->if_branch = clone_expr(context, fn, params, node->if_branch);
+            copy->else_branch = clone_expr(context, fn, params, node->else_branch);
+            break;
+
+        case ND_CALL:
+            copy->expr = clone_expr(context, fn, params, node->expr);
+            copy->args = clone_list(context, fn, params, node->args);
+            if(copy->expr->kind == ND_ID)
+                copy->expr->call = copy;
+            break;
+
+        case ND_CLOSURE:
+            copy->exprs = clone_list(context, fn, params, node->exprs);
+            break;
+
+        default:
+            break;
+    }
+
+    return copy;
+}
+
+static List_T* clone_list(Context_T* context, ASTObj_T* fn, InlineParam_T* params, List_T* list)
+{
+    List_T* copy = init_list_sized(list->size);
+    CONTEXT_ALLOC_REGISTER(context, copy);
+    for(size_t i = 0; i < list->size; i++)
+        list_push(copy, clone_expr(context, fn, params, list->items[i]));
+    return copy;
+}
+
+// The assembly backend evaluates the arguments passed on the stack first, then the ones passed in
+// registers, both from right to left. Inlined calls evaluate them in the same order, so that side
+// effects of the arguments don't depend on whether a call gets inlined.
+static void argument_order(ASTNode_T* call, size_t* order)
+{
+    size_t n = call->args->size, k = 0;
+    bool* by_stack = calloc(n, sizeof(bool));
+    u32 gp = 0, fp = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        ASTType_T* ty = unpack(((ASTNode_T*) call->args->items[i])->data_type);
+        if(ty->kind == TY_F80)
+            by_stack[i] = true;
+        else if(is_flonum(ty))
+            by_stack[i] = fp++ >= MAX_FP_ARGS;
+        else
+            by_stack[i] = gp++ >= MAX_GP_ARGS;
+    }
+
+    for(i32 pass = 1; pass >= 0; pass--)
+        for(size_t i = n; i-- > 0;)
+            if(by_stack[i] == pass)
+                order[k++] = i;
+    free(by_stack);
+}
+
+static void inline_call(ASTNode_T* call, va_list args)
+{
+    Inliner_T* inl = va_arg(args, Inliner_T*);
+    if(!inl->current_fn || inl->lambda_depth || call->expr->kind != ND_ID)
+        return;
+
+    ASTObj_T* fn = call->expr->referenced_obj;
+    if(!fn || fn->kind != OBJ_FUNCTION || fn == inl->current_fn || call->args->size != fn->args->size)
+        return;
+
+    ASTNode_T* body = inline_body(fn);
+    if(!body && !fn->force_inline)
+        return;
+
+    InlineParam_T* params = calloc(fn->args->size + 1, sizeof(InlineParam_T));
+    u32 size = 0;
+    if(!body || !check_expr(fn, body, params, &size))
+    {
+        if(!fn->force_inline)
+            goto finish;
+
+        char buf[BUFSIZ] = {'\0'};
+        throw_error(inl->context, ERR_CODEGEN_WARN, call->tok, "function `%s` marked as `[inline]` cannot be inlined", ast_id_to_str(buf, fn->id, LEN(buf)));
+        fn->force_inline = false;
+        goto finish;
+    }
+
+    if(!fn->force_inline && size > (fn->num_refs == 1 ? INLINE_SINGLE_REF_MAX_SIZE : INLINE_MAX_SIZE))
+        goto finish;
+
+    // literals get substituted, all other arguments are evaluated once, see argument_order()
+    bool needs_temps = false;
+    for(size_t i = 0; i < fn->args->size; i++)
+    {
+        ASTObj_T* param = fn->args->items[i];
+        ASTNode_T* arg = call->args->items[i];
+        if(is_literal(arg) && !params[i].written && unpack(arg->data_type) == unpack(param->data_type))
+            params[i].replacement = arg;
+        else if(params[i].uses || params[i].written)
+            needs_temps = true;
+    }
+
+    if(needs_temps && inl->current_fn->body->kind != ND_BLOCK)
+        goto finish;
+
+    size_t* order = calloc(fn->args->size + 1, sizeof(size_t));
+    argument_order(call, order);
+
+    List_T* exprs = init_list();
+    CONTEXT_ALLOC_REGISTER(inl->context, exprs);
+    for(size_t k = 0; k < fn->args->size; k++)
+    {
+        size_t i = order[k];
+        ASTNode_T* arg = call->args->items[i];
+        if(params[i].replacement)
+            continue;
+
+        if(!params[i].uses && !params[i].written)
+        {
+            // only evaluated for its side effects
+            if(!is_literal(arg) && arg->kind != ND_ID)
+                list_push(exprs, arg);
+            continue;
+        }
+
+        ASTObj_T* param = fn->args->items[i];
+        params[i].replacement = new_temp(inl->context, inl->current_fn, inl->current_fn->body->locals, param->data_type, arg->tok);
+        list_push(exprs, init_temp_assign(inl->context, params[i].replacement, arg));
+    }
+    free(order);
+
+    ASTNode_T* inlined = clone_expr(inl->context, fn, params, body);
+    // returning converts the value, which also truncates results of narrow integer arithmetic
+    if(unpack(fn->return_type)->kind != TY_VOID)
+    {
+        ASTNode_T* cast = init_ast_node(&inl->context->raw_allocator, ND_CAST, inlined->tok);
+        cast->left = inlined;
+        cast->data_type = fn->return_type;
+        inlined = cast;
+    }
+    list_push(exprs, inlined);
+
+    if(exprs->size == 1)
+        *call = *inlined;
+    else
+    {
+        ASTNode_T closure = {
+            .kind = ND_CLOSURE,
+            .tok = call->tok,
+            .data_type = call->data_type,
+            .exprs = exprs
+        };
+        *call = closure;
+    }
+
+finish:
+    free(params);
+}
+
+static void count_reference(ASTNode_T* id, va_list args)
+{
+    if(id->referenced_obj && id->referenced_obj->kind == OBJ_FUNCTION)
+        id->referenced_obj->num_refs++;
+}
+
+static void enter_fn(ASTObj_T* fn, va_list args)
+{
+    va_arg(args, Inliner_T*)->current_fn = fn;
+}
+
+static void leave_fn(ASTObj_T* fn, va_list args)
+{
+    va_arg(args, Inliner_T*)->current_fn = NULL;
+}
+
+static void enter_lambda(ASTNode_T* lambda, va_list args)
+{
+    va_arg(args, Inliner_T*)->lambda_depth++;
+}
+
+static void leave_lambda(ASTNode_T* lambda, va_list args)
+{
+    va_arg(args, Inliner_T*)->lambda_depth--;
+}
+
+void inline_functions(Context_T* context, ASTProg_T* ast)
+{
+    static const ASTIteratorList_T count_iter = {
+        .node_start_fns = {
+            [ND_ID] = count_reference
+        }
+    };
+
+    // calls get replaced after their arguments were visited, so inlined code is not visited again
+    static const ASTIteratorList_T inline_iter = {
+        .obj_start_fns = {
+            [OBJ_FUNCTION] = enter_fn
+        },
+        .obj_end_fns = {
+            [OBJ_FUNCTION] = leave_fn
+        },
+        .node_start_fns = {
+            [ND_LAMBDA] = enter_lambda
+        },
+        .node_end_fns = {
+            [ND_CALL] = inline_call,
+            [ND_LAMBDA] = leave_lambda
+        }
+    };
+
+    Inliner_T inliner = {
+        .context = context
+    };
+
+    ast_iterate(&count_iter, ast);
+    ast_iterate(&inline_iter, ast, &inliner);
+}
@@ -0,0 +1,11 @@
+#ifndef CSPYDR_INLINER_H
+#define CSPYDR_INLINER_H
+
+#include "ast/ast.h"
+
+// Replaces calls to small functions by their body. Only functions consisting of
+// a single expression (`fn x(): T = expr;`, `{ <- expr; }` or `{ expr; }`) get
+// inlined; their arguments are evaluated into temporary locals of the caller.
+void inline_functions(Context_T* context, ASTProg_T* ast);
+
+#endif
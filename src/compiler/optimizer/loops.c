@@ -0,0 +1,844 @@
+#include "loops.h"
+#include "optimizer.h"
+#include "ast/ast.h"
+#include "ast/ast_iterator.h"
+#include "ast/types.h"
+#include "codegen/codegen_utils.h"
+#include "context.h"
+#include "list.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+
+typedef struct LOOP_OPTIMIZER_STRUCT LoopOptimizer_T;
+typedef void (*LoopOptimizerFn_T)(LoopOptimizer_T* lo, ASTNode_T* loop);
+
+struct LOOP_OPTIMIZER_STRUCT
+{
+    Context_T* context;
+    LoopOptimizerFn_T optimize;
+
+    ASTObj_T* fn;
+    List_T* escaped;      // variables of `fn` having their address taken
+    bool skip_fn;         // lambdas and inline assembly access variables behind our back
+    ASTNode_T* preheader; // block replacing the current loop, NULL until needed
+};
+
+// effects of the code executed in each iteration of a loop
+typedef struct LOOP_INFO_STRUCT
+{
+    LoopOptimizer_T* lo;
+    List_T* assigned;   // variables getting written
+    bool writes_memory; // stores through pointers, to globals or calls
+} LoopInfo_T;
+
+static ASTNode_T* strip(ASTNode_T* node)
+{
+    while(node && (node->kind == ND_CAST || node->kind == ND_CLOSURE))
+        node = node->kind == ND_CAST ? node->left : (node->exprs->size ? node->exprs->items[node->exprs->size - 1] : NULL);
+    return node;
+}
+
+static bool in_register(LoopOptimizer_T* lo, ASTObj_T* var)
+{
+    return (var->kind == OBJ_LOCAL || var->kind == OBJ_FN_ARG) && is_scalar_type(var->data_type) && !list_contains(lo->escaped, var);
+}
+
+static void add_assigned(LoopInfo_T* info, ASTObj_T* var)
+{
+    if(!list_contains(info->assigned, var))
+        list_push(info->assigned, var);
+}
+
+static void info_write(ASTNode_T* node, va_list args)
+{
+    LoopInfo_T* info = va_arg(args, LoopInfo_T*);
+    ASTNode_T* target = strip(node->left);
+    if(target && target->kind == ND_ID && target->referenced_obj)
+    {
+        add_assigned(info, target->referenced_obj);
+        if(in_register(info->lo, target->referenced_obj))
+            return;
+    }
+    info->writes_memory = true;
+}
+
+static void info_ref(ASTNode_T* ref, va_list args)
+{
+    LoopInfo_T* info = va_arg(args, LoopInfo_T*);
+    ASTNode_T* target = strip(ref->right);
+    if(target && target->kind == ND_ID && target->referenced_obj)
+        add_assigned(info, target->referenced_obj);
+}
+
+static void info_call(ASTNode_T* call, va_list args)
+{
+    va_arg(args, LoopInfo_T*)->writes_memory = true;
+}
+
+// variables declared in the loop get (re)initialized in each iteration
+static void info_locals(ASTNode_T* node, va_list args)
+{
+    LoopInfo_T* info = va_arg(args, LoopInfo_T*);
+    for(size_t i = 0; i < node->locals->size; i++)
+        add_assigned(info, node->locals->items[i]);
+}
+
+static void info_with(ASTNode_T* with, va_list args)
+{
+    add_assigned(va_arg(args, LoopInfo_T*), with->obj);
+}
+
+static void analyze(LoopInfo_T* info, ASTNode_T* node)
+{
+    static const ASTIteratorList_T info_iter = {
+        .node_start_fns = {
+            [ND_ASSIGN] = info_write,
+            [ND_INC] = info_write,
+            [ND_DEC] = info_write,
+            [ND_REF] = info_ref,
+            [ND_CALL] = info_call,
+            [ND_BLOCK] = info_locals,
+            [ND_FOR] = info_locals,
+            [ND_WITH] = info_with,
+        }
+    };
+
+    if(node)
+        ast_iterate_stmt(&info_iter, node, info);
+}
+
+static bool is_trivial(ASTNode_T* node)
+{
+    switch(node->kind)
+    {
+        case ND_INT:
+        case ND_LONG:
+        case ND_ULONG:
+        case ND_FLOAT:
+        case ND_DOUBLE:
+        case ND_BOOL:
+        case ND_CHAR:
+        case ND_NIL:
+        case ND_STR:
+        case ND_ID:
+        case ND_SIZEOF:
+        case ND_ALIGNOF:
+            return true;
+        case ND_CAST:
+            return is_trivial(node->left);
+        case ND_REF:
+        case ND_NEG:
+            return is_trivial(node->right);
+        default:
+            return false;
+    }
+}
+
+// checks if `node` evaluates to the same value in every iteration; `traps` gets set
+// if evaluating it might crash the program, like reading memory or dividing
+static bool is_invariant(LoopInfo_T* info, ASTNode_T* node, bool* traps)
+{
+    switch(node->kind)
+    {
+        case ND_INT:
+        case ND_LONG:
+        case ND_ULONG:
+        case ND_FLOAT:
+        case ND_DOUBLE:
+        case ND_BOOL:
+        case ND_CHAR:
+        case ND_NIL:
+        case ND_STR:
+        case ND_SIZEOF:
+        case ND_ALIGNOF:
+            return true;
+
+        case ND_ID:
+        {
+            ASTObj_T* var = node->referenced_obj;
+            if(!var)
+                return false;
+
+            switch(var->kind)
+            {
+                case OBJ_FUNCTION:
+                case OBJ_ENUM_MEMBER:
+                    return true;
+                case OBJ_LOCAL:
+                case OBJ_FN_ARG:
+                case OBJ_GLOBAL:
+                    // variables in memory might get written through pointers
+                    return !list_contains(info->assigned, var) && (in_register(info->lo, var) || !info->writes_memory);
+                default:
+                    return false;
+            }
+        }
+
+        case ND_DIV:
+        case ND_MOD:
+            *traps = true;
+            // fall through
+        case ND_ADD:
+        case ND_SUB:
+        case ND_MUL:
+        case ND_EQ:
+        case ND_NE:
+        case ND_GT:
+        case ND_GE:
+        case ND_LT:
+        case ND_LE:
+        case ND_AND:
+        case ND_OR:
+        case ND_LSHIFT:
+        case ND_RSHIFT:
+        case ND_XOR:
+        case ND_BIT_OR:
+        case ND_BIT_AND:
+            return is_invariant(info, node->left, traps) && is_invariant(info, node->right, traps);
+
+        case ND_NEG:
+        case ND_BIT_NEG:
+        case ND_NOT:
+            return is_invariant(info, node->right, traps);
+
+        case ND_REF:
+            return node->right->kind == ND_ID && is_invariant(info, node->right, traps);
+
+        case ND_CAST:
+            return is_invariant(info, node->left, traps);
+
+        case ND_TERNARY:
+            return is_invariant(info, node->condition, traps)
+                && is_invariant(info, node->if_branch, traps)
+                && is_invariant(info, node->else_branch, traps);
+
+        case ND_DEREF:
+            *traps = true;
+            return !info->writes_memory && is_invariant(info, node->right, traps);
+
+        case ND_INDEX:
+            *traps = true;
+            return !info->writes_memory && is_invariant(info, node->left, traps) && is_invariant(info, node->expr, traps);
+
+        case ND_MEMBER:
+            if(!node->left->data_type)
+                return false;
+            *traps |= ptr_type(node->left->data_type);
+            return !info->writes_memory && is_invariant(info, node->left, traps);
+
+        case ND_LEN:
+            *traps = true;
+            return !info->writes_memory && is_invariant(info, node->expr, traps);
+
+        default:
+            return false;
+    }
+}
+
+static ASTNode_T* get_preheader(LoopOptimizer_T* lo, ASTNode_T* loop)
+{
+    if(lo->preheader)
+        return lo->preheader;
+
+    ASTNode_T* block = init_ast_node(&lo->context->raw_allocator, ND_BLOCK, loop->tok);
+    block->stmts = init_list();
+    block->locals = init_list();
+    CONTEXT_ALLOC_REGISTER(lo->context, block->stmts);
+    CONTEXT_ALLOC_REGISTER(lo->context, block->locals);
+
+    // the initializer of `for` loops has to run before the hoisted code
+    if(loop->kind == ND_FOR)
+    {
+        if(loop->init_stmt)
+            list_push(block->stmts, loop->init_stmt);
+        loop->init_stmt = NULL;
+
+        for(size_t i = 0; i < loop->locals->size; i++)
+            list_push(block->locals, loop->locals->items[i]);
+        list_clear(loop->locals);
+    }
+
+    return lo->preheader = block;
+}
+
+// evaluates `value` once in the preheader, returns the temporary holding it
+static ASTNode_T* evaluate_before(LoopOptimizer_T* lo, ASTNode_T* loop, ASTNode_T* value, ASTType_T* type)
+{
+    ASTNode_T* preheader = get_preheader(lo, loop);
+    ASTNode_T* temp = new_temp(lo->context, lo->fn, preheader->locals, type, value->tok);
+
+    ASTNode_T* stmt = init_ast_node(&lo->context->raw_allocator, ND_EXPR_STMT, value->tok);
+    stmt->expr = init_temp_assign(lo->context, temp, value);
+    list_push(preheader->stmts, stmt);
+    return temp;
+}
+
+static void hoist_lvalue(LoopOptimizer_T* lo, LoopInfo_T* info, ASTNode_T* loop, ASTNode_T* node);
+
+// hoists the largest invariant subexpressions of `node`, trapping ones only if `node` is evaluated when entering the loop
+static void hoist_expr(LoopOptimizer_T* lo, LoopInfo_T* info, ASTNode_T* loop, ASTNode_T* node, bool may_trap)
+{
+    if(!node)
+        return;
+
+    bool traps = false;
+    if(node->data_type && is_scalar_type(node->data_type) && !is_trivial(node) && is_invariant(info, node, &traps) && (!traps || may_trap))
+    {
+        ASTNode_T* temp = evaluate_before(lo, loop, copy_node(lo->context, node), node->data_type);
+        *node = *temp;
+        return;
+    }
+
+    switch(node->kind)
+    {
+        case ND_ADD:
+        case ND_SUB:
+        case ND_MUL:
+        case ND_DIV:
+        case ND_MOD:
+        case ND_EQ:
+        case ND_NE:
+        case ND_GT:
+        case ND_GE:
+        case ND_LT:
+        case ND_LE:
+        case ND_LSHIFT:
+        case ND_RSHIFT:
+        case ND_XOR:
+        case ND_BIT_OR:
+        case ND_BIT_AND:
+            hoist_expr(lo, info, loop, node->left, may_trap);
+            hoist_expr(lo, info, loop, node->right, may_trap);
+            break;
+
+        case ND_AND:
+        case ND_OR:
+            hoist_expr(lo, info, loop, node->left, may_trap);
+            hoist_expr(lo, info, loop, node->right, false);
+            break;
+
+        case ND_ASSIGN:
+            hoist_expr(lo, info, loop, node->right, may_trap);
+            hoist_lvalue(lo, info, loop, node->left);
+            break;
+
+        case ND_INC:
+        case ND_DEC:
+            hoist_lvalue(lo, info, loop, node->left);
+            break;
+
+        case ND_REF:
+            hoist_lvalue(lo, info, loop, node->right);
+            break;
+
+        case ND_NEG:
+        case ND_BIT_NEG:
+        case ND_NOT:
+        case ND_DEREF:
+            hoist_expr(lo, info, loop, node->right, may_trap);
+            break;
+
+        case ND_CAST:
+        case ND_MEMBER:
+            hoist_expr(lo, info, loop, node->left, may_trap);
+            break;
+
+        case ND_INDEX:
+            hoist_expr(lo, info, loop, node->left, may_trap);
+            hoist_expr(lo, info, loop, node->expr, may_trap);
+            break;
+
+        case ND_LEN:
+            hoist_expr(lo, info, loop, node->expr, may_trap);
+            break;
+
+        case ND_TERNARY:
+            hoist_expr(lo, info, loop, node->condition, may_trap);
+            hoist_expr(lo, info, loop, node->if_branch, false);
+            hoist_expr(lo, info, loop, node->else_branch, false);
+            break;
+
+        case ND_CALL:
+            for(size_t i = 0; i < node->args->size; i++)
+                hoist_expr(lo, info, loop, node->args->items[i], may_trap);
+            break;
+
+        case ND_CLOSURE:
+            for(size_t i = 0; i < node->exprs->size; i++)
+                hoist_expr(lo, info, loop, node->exprs->items[i], may_trap);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// only the computations inside of an assigned location may move, not the location itself
+static void hoist_lvalue(LoopOptimizer_T* lo, LoopInfo_T* info, ASTNode_T* loop, ASTNode_T* node)
+{
+    switch(node->kind)
+    {
+        case ND_DEREF:
+            hoist_expr(lo, info, loop, node->right, false);
+            break;
+
+        case ND_INDEX:
+            if(ptr_type(node->left->data_type))
+                hoist_expr(lo, info, loop, node->left, false);
+            else
+                hoist_lvalue(lo, info, loop, node->left);
+            hoist_expr(lo, info, loop, node->expr, false);
+            break;
+
+        case ND_MEMBER:
+            if(node->left->data_type && ptr_type(node->left->data_type))
+                hoist_expr(lo, info, loop, node->left, false);
+            else
+                hoist_lvalue(lo, info, loop, node->left);
+            break;
+
+        case ND_CAST:
+            hoist_lvalue(lo, info, loop, node->left);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void hoist_stmt(ASTNode_T* stmt, va_list args)
+{
+    LoopOptimizer_T* lo = va_arg(args, LoopOptimizer_T*);
+    LoopInfo_T* info = va_arg(args, LoopInfo_T*);
+    ASTNode_T* loop = va_arg(args, ASTNode_T*);
+
+    switch(stmt->kind)
+    {
+        case ND_EXPR_STMT:
+            hoist_expr(lo, info, loop, stmt->expr, false);
+            break;
+        case ND_RETURN:
+            hoist_expr(lo, info, loop, stmt->return_val, false);
+            break;
+        case ND_IF:
+        case ND_WHILE:
+        case ND_DO_WHILE:
+        case ND_MATCH:
+            hoist_expr(lo, info, loop, stmt->condition, false);
+            break;
+        case ND_FOR:
+            hoist_expr(lo, info, loop, stmt->condition, false);
+            hoist_expr(lo, info, loop, stmt->expr, false);
+            break;
+        case ND_FOR_RANGE:
+            hoist_expr(lo, info, loop, stmt->left, false);
+            hoist_expr(lo, info, loop, stmt->right, false);
+            break;
+        default:
+            break;
+    }
+}
+
+static void hoist_invariants(LoopOptimizer_T* lo, ASTNode_T* loop)
+{
+    static const ASTIteratorList_T hoist_iter = {
+        .node_start_fns = {
+            [ND_EXPR_STMT] = hoist_stmt,
+            [ND_RETURN] = hoist_stmt,
+            [ND_IF] = hoist_stmt,
+            [ND_WHILE] = hoist_stmt,
+            [ND_DO_WHILE] = hoist_stmt,
+            [ND_MATCH] = hoist_stmt,
+            [ND_FOR] = hoist_stmt,
+            [ND_FOR_RANGE] = hoist_stmt,
+        }
+    };
+
+    LoopInfo_T info = {
+        .lo = lo,
+        .assigned = init_list()
+    };
+
+    analyze(&info, loop->body);
+    if(loop->kind == ND_FOR)
+        analyze(&info, loop->expr);
+    if(loop->kind != ND_FOR_RANGE)
+        analyze(&info, loop->condition);
+
+    switch(loop->kind)
+    {
+        case ND_WHILE:
+        case ND_FOR:
+            // the condition gets evaluated at least once when entering the loop, so
+            // `len` and other memory accesses may move out of it
+            hoist_expr(lo, &info, loop, loop->condition, !info.writes_memory);
+            if(loop->kind == ND_FOR)
+                hoist_expr(lo, &info, loop, loop->expr, false);
+            break;
+        case ND_DO_WHILE:
+            hoist_expr(lo, &info, loop, loop->condition, false);
+            break;
+        default:
+            break;
+    }
+
+    ast_iterate_stmt(&hoist_iter, loop->body, lo, &info, loop);
+    free_list(info.assigned);
+}
+
+static bool is_induction_step(ASTNode_T* step, ASTObj_T** var)
+{
+    ASTNode_T* target;
+    switch(step->kind)
+    {
+        case ND_INC:
+        case ND_DEC:
+            target = step->left;
+            break;
+
+        case ND_ASSIGN:
+            target = step->left;
+            if((step->right->kind != ND_ADD && step->right->kind != ND_SUB)
+                || step->right->left->kind != ND_ID || step->right->left->referenced_obj != target->referenced_obj
+                || (step->right->right->kind != ND_INT && step->right->right->kind != ND_LONG && step->right->right->kind != ND_ULONG))
+                return false;
+            break;
+
+        default:
+            return false;
+    }
+
+    if(target->kind != ND_ID || !target->referenced_obj)
+        return false;
+    *var = target->referenced_obj;
+    return true;
+}
+
+// matches `i` and widening casts of it
+static bool is_induction_var(ASTNode_T* node, ASTObj_T* var)
+{
+    if(node->kind == ND_CAST)
+        return is_integer(unpack(node->data_type)) && unpack(node->data_type)->size >= unpack(node->left->data_type)->size
+            && is_induction_var(node->left, var);
+    return node->kind == ND_ID && node->referenced_obj == var;
+}
+
+typedef struct INDUCTION_STRUCT
+{
+    LoopInfo_T* info;
+    ASTObj_T* var;
+    List_T* accesses; // `a[i]` nodes
+} Induction_T;
+
+static void collect_access(ASTNode_T* index, va_list args)
+{
+    Induction_T* ind = va_arg(args, Induction_T*);
+    ASTNode_T* base = index->left;
+    bool traps = false;
+
+    if(unpack(base->data_type)->kind == TY_PTR && base->kind == ND_ID && is_invariant(ind->info, base, &traps)
+        && is_induction_var(index->expr, ind->var) && !list_contains(ind->accesses, index))
+        list_push(ind->accesses, index);
+}
+
+static i64 literal_value(ASTNode_T* lit)
+{
+    switch(lit->kind)
+    {
+        case ND_INT:
+            return lit->int_val;
+        case ND_LONG:
+            return lit->long_val;
+        default:
+            return (i64) lit->ulong_val;
+    }
+}
+
+static i64 step_delta(ASTNode_T* step)
+{
+    switch(step->kind)
+    {
+        case ND_INC:
+            return 1;
+        case ND_DEC:
+            return -1;
+        default:
+            return step->right->kind == ND_SUB ? -literal_value(step->right->right) : literal_value(step->right->right);
+    }
+}
+
+// the values of the integer types narrower than pointers
+static bool narrow_range(ASTType_T* ty, i64* min, i64* max)
+{
+    switch(ty ? ty->kind : TY_UNDEF)
+    {
+        case TY_I8:
+            *min = INT8_MIN; *max = INT8_MAX;
+            return true;
+        case TY_U8:
+            *min = 0; *max = UINT8_MAX;
+            return true;
+        case TY_I16:
+            *min = INT16_MIN; *max = INT16_MAX;
+            return true;
+        case TY_U16:
+            *min = 0; *max = UINT16_MAX;
+            return true;
+        case TY_I32:
+            *min = INT32_MIN; *max = INT32_MAX;
+            return true;
+        case TY_U32:
+            *min = 0; *max = UINT32_MAX;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_literal(ASTNode_T* node)
+{
+    return node->kind == ND_INT || node->kind == ND_LONG || (node->kind == ND_ULONG && node->ulong_val <= INT64_MAX);
+}
+
+// The pointers replacing `a[i]` keep going where `i` wraps around, so narrow induction variables
+// need a condition `i <op> bound`, which holds before each step and keeps the step from wrapping.
+// The bound's values have to fit into the variable's type, so that comparing them is exact.
+static bool cannot_wrap(ASTNode_T* loop, ASTObj_T* var)
+{
+    i64 min, max, lo, hi;
+    if(unpack(var->data_type)->size == PTR_S)
+        return true;
+    if(!loop->condition || !narrow_range(unpack(var->data_type), &min, &max))
+        return false;
+
+    ASTNode_T* cond = loop->condition;
+    ASTNodeKind_T op = cond->kind;
+    ASTNode_T* bound;
+    if(op != ND_LT && op != ND_LE && op != ND_GT && op != ND_GE)
+        return false;
+    if(is_induction_var(cond->left, var))
+        bound = cond->right;
+    else if(is_induction_var(cond->right, var))
+    {
+        bound = cond->left;
+        op = op == ND_LT ? ND_GT : op == ND_LE ? ND_GE : op == ND_GT ? ND_LT : ND_LE;
+    }
+    else
+        return false;
+
+    if(is_literal(bound))
+        lo = hi = literal_value(bound);
+    else if(!narrow_range(unpack(bound->data_type), &lo, &hi))
+        return false;
+    if(lo < min || hi > max)
+        return false;
+
+    i64 delta = step_delta(loop->expr);
+    switch(op)
+    {
+        case ND_LT:
+            return delta > 0 && hi - 1 + delta <= max;
+        case ND_LE:
+            return delta > 0 && hi + delta <= max;
+        case ND_GT:
+            return delta < 0 && lo + 1 + delta >= min;
+        default:
+            return delta < 0 && lo + delta >= min;
+    }
+}
+
+// a pointer advancing with the induction variable, `p = p + <step>`
+static ASTNode_T* step_pointer(LoopOptimizer_T* lo, ASTNode_T* step, ASTNode_T* ptr)
+{
+    i64 delta = step_delta(step);
+
+    ASTNode_T* offset = init_ast_node(&lo->context->raw_allocator, ND_LONG, step->tok);
+    offset->long_val = delta;
+    offset->data_type = (ASTType_T*) primitives[TY_I64];
+
+    ASTNode_T* add = init_ast_node(&lo->context->raw_allocator, ND_ADD, step->tok);
+    add->left = copy_node(lo->context, ptr);
+    add->right = offset;
+    add->data_type = ptr->data_type;
+
+    ASTNode_T* assign = init_ast_node(&lo->context->raw_allocator, ND_ASSIGN, step->tok);
+    assign->left = copy_node(lo->context, ptr);
+    assign->right = add;
+    assign->data_type = ptr->data_type;
+    return assign;
+}
+
+static void reduce_strength(LoopOptimizer_T* lo, ASTNode_T* loop)
+{
+    static const ASTIteratorList_T access_iter = {
+        .node_start_fns = {
+            [ND_INDEX] = collect_access
+        }
+    };
+
+    ASTObj_T* var;
+    if(loop->kind != ND_FOR || !loop->expr || !is_induction_step(loop->expr, &var) || !in_register(lo, var)
+        || !is_integer(unpack(var->data_type)) || !cannot_wrap(loop, var))
+        return;
+
+    LoopInfo_T info = {
+        .lo = lo,
+        .assigned = init_list()
+    };
+    Induction_T ind = {
+        .info = &info,
+        .var = var,
+        .accesses = init_list()
+    };
+
+    // the induction variable may only change in the step
+    analyze(&info, loop->body);
+    analyze(&info, loop->condition);
+    if(list_contains(info.assigned, var))
+        goto finish;
+    analyze(&info, loop->expr);
+
+    if(loop->condition)
+        ast_iterate_expr(&access_iter, loop->condition, &ind);
+    ast_iterate_stmt(&access_iter, loop->body, &ind);
+    if(!ind.accesses->size)
+        goto finish;
+
+    List_T* steps = init_list();
+    CONTEXT_ALLOC_REGISTER(lo->context, steps);
+    list_push(steps, loop->expr);
+
+    // one pointer per array, accesses of the same array share it
+    for(size_t i = 0; i < ind.accesses->size; i++)
+    {
+        ASTNode_T* access = ind.accesses->items[i];
+        if(!access)
+            continue;
+
+        ASTObj_T* base = access->left->referenced_obj;
+        ASTNode_T* ref = init_ast_node(&lo->context->raw_allocator, ND_REF, access->tok);
+        ref->right = copy_node(lo->context, access);
+        ref->data_type = access->left->data_type;
+        ASTNode_T* ptr = evaluate_before(lo, loop, ref, access->left->data_type);
+        list_push(steps, step_pointer(lo, loop->expr, ptr));
+
+        for(size_t j = i; j < ind.accesses->size; j++)
+        {
+            ASTNode_T* other = ind.accesses->items[j];
+            if(!other || other->left->referenced_obj != base)
+                continue;
+
+            ASTNode_T deref = {
+                .kind = ND_DEREF,
+                .tok = other->tok,
+                .data_type = other->data_type,
+                .right = copy_node(lo->context, ptr)
+            };
+            *other = deref;
+            ind.accesses->items[j] = NULL;
+        }
+    }
+
+    ASTNode_T* step = init_ast_node(&lo->context->raw_allocator, ND_CLOSURE, loop->expr->tok);
+    step->exprs = steps;
+    step->data_type = loop->expr->data_type;
+    loop->expr = step;
+
+finish:
+    free_list(info.assigned);
+    free_list(ind.accesses);
+}
+
+static void escape_ref(ASTNode_T* ref, va_list args)
+{
+    LoopOptimizer_T* lo = va_arg(args, LoopOptimizer_T*);
+    ASTNode_T* target = strip(ref->right);
+    if(target && target->kind == ND_ID && target->referenced_obj && !list_contains(lo->escaped, target->referenced_obj))
+        list_push(lo->escaped, target->referenced_obj);
+}
+
+static void escape_all(ASTNode_T* node, va_list args)
+{
+    va_arg(args, LoopOptimizer_T*)->skip_fn = true;
+}
+
+static void enter_fn(ASTObj_T* fn, va_list args)
+{
+    static const ASTIteratorList_T escape_iter = {
+        .node_start_fns = {
+            [ND_REF] = escape_ref,
+            [ND_LAMBDA] = escape_all,
+            [ND_ASM] = escape_all,
+        }
+    };
+
+    LoopOptimizer_T* lo = va_arg(args, LoopOptimizer_T*);
+    lo->fn = fn;
+    lo->skip_fn = false;
+    list_clear(lo->escaped);
+    if(fn->body)
+        ast_iterate_stmt(&escape_iter, fn->body, lo);
+}
+
+static void leave_fn(ASTObj_T* fn, va_list args)
+{
+    va_arg(args, LoopOptimizer_T*)->fn = NULL;
+}
+
+// loops get optimized innermost first, code moved out of an inner loop may move further
+static void leave_loop(ASTNode_T* loop, va_list args)
+{
+    LoopOptimizer_T* lo = va_arg(args, LoopOptimizer_T*);
+    if(!lo->fn || lo->skip_fn)
+        return;
+
+    lo->preheader = NULL;
+    lo->optimize(lo, loop);
+    if(!lo->preheader)
+        return;
+
+    list_push(lo->preheader->stmts, copy_node(lo->context, loop));
+    *loop = *lo->preheader;
+}
+
+static void optimize_loops(Context_T* context, ASTProg_T* ast, LoopOptimizerFn_T optimize)
+{
+    if(context->no_loop_opt)
+        return;
+
+    static const ASTIteratorList_T loop_iter = {
+        .obj_start_fns = {
+            [OBJ_FUNCTION] = enter_fn
+        },
+        .obj_end_fns = {
+            [OBJ_FUNCTION] = leave_fn
+        },
+        .node_end_fns = {
+            [ND_WHILE] = leave_loop,
+            [ND_DO_WHILE] = leave_loop,
+            [ND_FOR] = leave_loop,
+            [ND_FOR_RANGE] = leave_loop,
+            [ND_LOOP] = leave_loop,
+        }
+    };
+
+    LoopOptimizer_T lo = {
+        .context = context,
+        .optimize = optimize,
+        .escaped = init_list()
+    };
+
+    ast_iterate(&loop_iter, ast, &lo);
+    free_list(lo.escaped);
+}
+
+void hoist_loop_invariants(Context_T* context, ASTProg_T* ast)
+{
+    optimize_loops(context, ast, hoist_invariants);
+}
+
+void reduce_induction_vars(Context_T* context, ASTProg_T* ast)
+{
+    optimize_loops(context, ast, reduce_strength);
+}
@@ -0,0 +1,17 @@
+#ifndef CSPYDR_LOOPS_H
+#define CSPYDR_LOOPS_H
+
+#include "ast/ast.h"
+
+// Moves loop-invariant expressions (including `len` of strings in loop conditions)
+// into temporaries computed once before the loop.
+void hoist_loop_invariants(Context_T* context, ASTProg_T* ast);
+
+// Replaces `a[i]` in `for` loops stepping `i` by a constant with a pointer
+// advanced alongside `i`. `i` has to be pointer-sized, or the loop condition
+// has to keep it from wrapping around.
+//
+// Both passes get skipped with `--no-loop-opt`, see tests/bench/loops.sh.
+void reduce_induction_vars(Context_T* context, ASTProg_T* ast);
+
+#endif
@@ -1,12 +1,17 @@
 #include "optimizer.h"
 #include "ast/ast.h"
 #include "ast/ast_iterator.h"
+#include "codegen/codegen_utils.h"
 #include "config.h"
+#include "context.h"
 #include "constexpr.h"
+#include "inliner.h"
+#include "loops.h"
 #include "io/log.h"
 #include "list.h"
 #include "timer/timer.h"
 #include <stdarg.h>
+#include <stdio.h>
 
 #define throw_error(...)              \
     do {                              \
@@ -14,17 +19,19 @@
         throw_error(__VA_ARGS__);     \
     } while(0)
 
-static void remove_dead_code(ASTProg_T* ast);
-void evaluate_const_exprs(ASTProg_T* ast);
+static void remove_dead_code(Context_T* context, ASTProg_T* ast);
 
 i32 optimizer_pass(Context_T* context, ASTProg_T *ast)
 {
     timer_start(context, "code optimization");
 
     static struct {
-        void (*fn)(ASTProg_T*);
+        void (*fn)(Context_T*, ASTProg_T*);
         const char* description;
     } passes[] = {
+        {inline_functions, "inline functions"},
+        {reduce_induction_vars, "reduce induction variables"},
+        {hoist_loop_invariants, "hoist loop invariants"},
         {remove_dead_code, "remove dead code"},
         {evaluate_const_exprs, "evaluate constant expressions"}
     };
@@ -38,7 +45,7 @@ i32 optimizer_pass(Context_T* context, ASTProg_T *ast)
             LOG_OK_F("%s" COLOR_BOLD_GREEN "  Optimizing" COLOR_RESET " (%d/%d) %s", i ? "\33[2K\r" : "", i + 1, count, passes[i].description);
             fflush(OUTPUT_STREAM);
         }
-        passes[i].fn(ast);
+        passes[i].fn(context, ast);
     }
 
     if(count && !context->flags.silent)
@@ -56,7 +63,7 @@ static void add_func_to_node_stack(ASTObj_T* function, va_list ap) {
     }
 }
 
-static void remove_dead_code(ASTProg_T* ast)
+static void remove_dead_code(Context_T* context, ASTProg_T* ast)
 {
     static const ASTIteratorList_T referenced_iter_list = {
         .iterate_only_objs = true,
@@ -261,3 +268,47 @@ static void remove_dead_code(ASTProg_T* ast)
 
     free_list(node_stack);
 }
+
+bool is_scalar_type(ASTType_T* type)
+{
+    type = unpack(type);
+    return type && (is_integer(type) || is_pointer(type) || type->kind == TY_F32 || type->kind == TY_F64);
+}
+
+ASTNode_T* copy_node(Context_T* context, ASTNode_T* node)
+{
+    ASTNode_T* copy = allocator_malloc(&context->raw_allocator, sizeof(ASTNode_T));
+    *copy = *node;
+    return copy;
+}
+
+// creates a local variable of `fn`, declared in `locals`, and returns a reference to it
+ASTNode_T* new_temp(Context_T* context, ASTObj_T* fn, List_T* locals, ASTType_T* type, Token_T* tok)
+{
+    static u64 num_temps = 0;
+    char name[64];
+    sprintf(name, "__csp_tmp_%lu", num_temps++);
+
+    ASTObj_T* temp = init_ast_obj(&context->raw_allocator, OBJ_LOCAL, tok);
+    temp->id = init_ast_identifier(&context->raw_allocator, tok, intern(&context->interner, name));
+    temp->data_type = type;
+    temp->referenced = true;
+    list_push(fn->objs, temp);
+    list_push(locals, temp);
+
+    ASTNode_T* id = init_ast_node(&context->raw_allocator, ND_ID, tok);
+    id->id = temp->id;
+    id->referenced_obj = temp;
+    id->data_type = type;
+    return id;
+}
+
+ASTNode_T* init_temp_assign(Context_T* context, ASTNode_T* temp, ASTNode_T* value)
+{
+    ASTNode_T* assign = init_ast_node(&context->raw_allocator, ND_ASSIGN, value->tok);
+    assign->left = copy_node(context, temp);
+    assign->right = value;
+    assign->data_type = temp->data_type;
+    assign->is_initializing = true;
+    return assign;
+}
@@ -5,4 +5,10 @@
 
 i32 optimizer_pass(Context_T* context, ASTProg_T* ast);
 
+// helpers for passes introducing new variables
+bool is_scalar_type(ASTType_T* type);
+ASTNode_T* copy_node(Context_T* context, ASTNode_T* node);
+ASTNode_T* new_temp(Context_T* context, ASTObj_T* fn, List_T* locals, ASTType_T* type, Token_T* tok);
+ASTNode_T* init_temp_assign(Context_T* context, ASTNode_T* temp, ASTNode_T* value);
+
 #endif
\ No newline at end of file
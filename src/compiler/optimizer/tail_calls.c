@@ -0,0 +1,248 @@
+#include "passes.h"
+#include "ast/ast.h"
+#include "ast/ast_iterator.h"
+#include "codegen/codegen_utils.h"
+#include "context.h"
+#include "error/error.h"
+#include "list.h"
+#include "timer/timer.h"
+#include "util.h"
+
+#include <stdarg.h>
+
+// Marks `<- f(x)` statements, which the backends may compile to a jump to `f` reusing
+// the current stack frame, as `tail_call`. This happens in every function when
+// optimizing and always in `[tailcall]` functions, where each call in return position
+// that cannot be a tail call is an error.
+
+// argument registers of the System V ABI
+#define MAX_GP_ARGS 6
+#define MAX_FP_ARGS 8
+
+#define GET_TAIL_CALLS(va) TailCalls_T* tc = va_arg(va, TailCalls_T*)
+
+typedef struct TAIL_CALLS_STRUCT
+{
+    List_T* returns;       // returns of calls, which may be converted
+    const char* frame_use; // why the frame has to outlive the function's calls, NULL if it doesn't
+} TailCalls_T;
+
+static ASTNode_T* strip_closure(ASTNode_T* node)
+{
+    while(node->kind == ND_CLOSURE && node->exprs->size == 1)
+        node = node->exprs->items[0];
+    return node;
+}
+
+// ids don't always carry their type
+static bool is_array(ASTNode_T* node)
+{
+    ASTType_T* ty = unpack(node->kind == ND_ID && node->referenced_obj ? node->referenced_obj->data_type : node->data_type);
+    return ty && (ty->kind == TY_C_ARRAY || ty->kind == TY_ARRAY || ty->kind == TY_VLA);
+}
+
+// whether `node` designates memory inside the current stack frame
+static bool in_frame(ASTNode_T* node)
+{
+    switch(node->kind)
+    {
+        case ND_CLOSURE:
+            return node->exprs->size && in_frame(node->exprs->items[node->exprs->size - 1]);
+        case ND_CAST:
+            return in_frame(node->left);
+        case ND_MEMBER:
+        case ND_INDEX:
+        {
+            ASTType_T* ty = unpack(node->left->data_type);
+            return !(ty && ty->kind == TY_PTR) && in_frame(node->left);
+        }
+        case ND_ID:
+            return node->referenced_obj && (node->referenced_obj->kind == OBJ_LOCAL || node->referenced_obj->kind == OBJ_FN_ARG);
+        case ND_DEREF:
+        case ND_STR:
+            return false;
+        default:
+            // temporaries
+            return true;
+    }
+}
+
+static void use_frame(TailCalls_T* tc, const char* reason)
+{
+    if(!tc->frame_use)
+        tc->frame_use = reason;
+}
+
+// arrays decay to their address
+static void check_decay(TailCalls_T* tc, ASTNode_T* node)
+{
+    if(is_array(node) && in_frame(node))
+        use_frame(tc, "the function passes the address of a local array");
+}
+
+static void tail_calls_return(ASTNode_T* ret, va_list args)
+{
+    GET_TAIL_CALLS(args);
+    if(!ret->return_val)
+        return;
+
+    ASTNode_T* value = strip_closure(ret->return_val);
+    if(value->kind == ND_CALL || (value->kind == ND_CAST && strip_closure(value->left)->kind == ND_CALL))
+        list_push(tc->returns, ret);
+}
+
+static void tail_calls_ref(ASTNode_T* ref, va_list args)
+{
+    GET_TAIL_CALLS(args);
+    if(in_frame(ref->right))
+        use_frame(tc, "the function takes the address of a local variable");
+}
+
+static void tail_calls_call(ASTNode_T* call, va_list args)
+{
+    GET_TAIL_CALLS(args);
+    for(size_t i = 0; i < call->args->size; i++)
+        check_decay(tc, call->args->items[i]);
+}
+
+static void tail_calls_assign(ASTNode_T* assign, va_list args)
+{
+    GET_TAIL_CALLS(args);
+    // initializing arrays copies
+    if(!is_array(assign->left))
+        check_decay(tc, assign->right);
+}
+
+static void tail_calls_cast(ASTNode_T* cast, va_list args)
+{
+    GET_TAIL_CALLS(args);
+    check_decay(tc, cast->left);
+}
+
+static void tail_calls_lambda(ASTNode_T* lambda, va_list args)
+{
+    GET_TAIL_CALLS(args);
+    use_frame(tc, "lambdas share the stack frame of their function");
+}
+
+static void tail_calls_defer(ASTNode_T* defer, va_list args)
+{
+    GET_TAIL_CALLS(args);
+    use_frame(tc, "deferred statements run after the return value is computed");
+}
+
+static void tail_calls_inline_asm(ASTNode_T* inline_asm, va_list args)
+{
+    GET_TAIL_CALLS(args);
+    use_frame(tc, "inline assembly may access the stack frame");
+}
+
+static const ASTIteratorList_T tail_calls_iter = {
+    .node_start_fns = {
+        [ND_RETURN] = tail_calls_return,
+        [ND_REF] = tail_calls_ref,
+        [ND_CALL] = tail_calls_call,
+        [ND_ASSIGN] = tail_calls_assign,
+        [ND_CAST] = tail_calls_cast,
+        [ND_LAMBDA] = tail_calls_lambda,
+        [ND_DEFER] = tail_calls_defer,
+        [ND_ASM] = tail_calls_inline_asm,
+    }
+};
+
+// values the ABI passes in a single register
+static bool in_register(ASTType_T* ty)
+{
+    ty = unpack(ty);
+    return ty && (is_integer(ty) || ty->kind == TY_PTR || ty->kind == TY_FN || ty->kind == TY_F32 || ty->kind == TY_F64);
+}
+
+// why `call` in return position of `fn` cannot be a tail call, NULL if it can
+static const char* call_blocker(ASTObj_T* fn, ASTNode_T* call)
+{
+    ASTType_T* expected = unpack(fn->return_type);
+    ASTType_T* result = unpack(call->data_type);
+    if(!expected || !result)
+        return "the return type is unknown";
+    if(expected->kind != TY_VOID || result->kind != TY_VOID)
+    {
+        if(!in_register(expected) || call->return_buffer)
+            return "the result is not returned in a register";
+        if(expected->kind != result->kind || expected->size != result->size)
+            return "the called function returns a different type";
+    }
+
+    u32 gp = 0, fp = 0;
+    for(size_t i = 0; i < call->args->size; i++)
+    {
+        ASTNode_T* arg = call->args->items[i];
+        if(arg->unpack_mode || !in_register(arg->data_type))
+            return "some arguments are passed on the stack";
+        if(is_flonum(unpack(arg->data_type)))
+            fp++;
+        else
+            gp++;
+    }
+    if(gp > MAX_GP_ARGS || fp > MAX_FP_ARGS)
+        return "some arguments are passed on the stack";
+
+    return NULL;
+}
+
+static void mark_tail_calls(Context_T* context, ASTObj_T* fn)
+{
+    TailCalls_T tc = {
+        .returns = init_list(),
+        .frame_use = is_variadic(fn->data_type) ? "variadic arguments live in the stack frame" : NULL
+    };
+    ast_iterate_stmt(&tail_calls_iter, fn->body, &tc);
+
+    ASTObj_T** prev_obj = context->current_obj;
+    context->current_obj = &fn;
+
+    for(size_t i = 0; i < tc.returns->size; i++)
+    {
+        ASTNode_T* ret = tc.returns->items[i];
+        ASTNode_T* call = strip_closure(ret->return_val);
+        const char* blocker = call->kind != ND_CALL ? "the result gets converted" : EITHER(tc.frame_use, call_blocker(fn, call));
+
+        if(!blocker)
+        {
+            ret->return_val = call;
+            ret->tail_call = true;
+        }
+        else if(fn->tail_call)
+            throw_error(context, ERR_CALL_ERROR_UNCR, ret->tok, "cannot compile this call as a tail call: %s", blocker);
+    }
+
+    context->current_obj = prev_obj;
+    free_list(tc.returns);
+}
+
+static void tail_calls_in(Context_T* context, List_T* objs)
+{
+    for(size_t i = 0; i < objs->size; i++)
+    {
+        ASTObj_T* obj = objs->items[i];
+        switch(obj->kind)
+        {
+            case OBJ_NAMESPACE:
+                tail_calls_in(context, obj->objs);
+                break;
+            case OBJ_FUNCTION:
+                if(obj->body && (obj->tail_call || context->flags.optimize))
+                    mark_tail_calls(context, obj);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+i32 tail_call_pass(Context_T* context, ASTProg_T* ast)
+{
+    timer_start(context, "tail call analysis");
+    tail_calls_in(context, ast->objs);
+    timer_stop(context);
+    return context->emitted_errors;
+}
@@ -11,6 +11,7 @@
 #include "platform/platform_bindings.h"
 #include "context.h"
 #include "io/log.h"
+#include "interner.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -47,11 +48,14 @@ EVAL_FN(flag);
 EVAL_FN(immutable);
 EVAL_FN(include_c);
 EVAL_FN(include_c_dir);
+EVAL_FN(inline_directive);
 EVAL_FN(link_dir);
 EVAL_FN(link_obj);
 EVAL_FN(link);
+EVAL_FN(no_inline);
 EVAL_FN(no_return);
 EVAL_FN(private);
+EVAL_FN(tailcall);
 
 static const Directive_T DIRECTIVES[] = {
     {
@@ -150,6 +154,12 @@ static const Directive_T DIRECTIVES[] = {
         0,
         eval_include_c_dir
     },
+    {
+        "inline",
+        0,
+        OBJ_FUNCTION,
+        eval_inline_directive
+    },
     {
         "link_dir",
         ANY,
@@ -168,17 +178,35 @@ static const Directive_T DIRECTIVES[] = {
         0,
         eval_link,
     },
+    {
+        "no_inline",
+        0,
+        OBJ_FUNCTION,
+        eval_no_inline,
+    },
     {
         "no_return",
         0,
         OBJ_FUNCTION,
         eval_no_return,
     },
+    {
+        "noinline", // alias of `no_inline`
+        0,
+        OBJ_FUNCTION,
+        eval_no_inline,
+    },
     {
         "private",
         0,
         OBJ_ANY,
         eval_private
+    },
+    {
+        "tailcall",
+        0,
+        OBJ_FUNCTION,
+        eval_tailcall
     }
 };
 
@@ -292,7 +320,8 @@ DirectiveData_T* parse_directive(Parser_T* p)
 
         while(!tok_is(p, TOKEN_RPAREN))
         {
-            list_push(args, parser_peek(p, 0)->value);
+            Token_T* arg = parser_peek(p, 0);
+            list_push(args, (void*) intern_n(&parser_context(p)->interner, arg->value, arg->length));
             parser_consume(p, TOKEN_STRING, "expect string literal as directive argument");
             if(!tok_is(p, TOKEN_RPAREN))
                 parser_consume(p, TOKEN_COMMA, "expect `,` between directive arguments");
@@ -652,6 +681,13 @@ EVAL_FN(include_c_dir)
     return false;
 }
 
+EVAL_FN(inline_directive)
+{
+    obj->force_inline = true;
+    obj->no_inline = false;
+    return false;
+}
+
 EVAL_FN(link_dir)
 {
     for(size_t i = 0; i < data->arguments->size; i++)
@@ -688,6 +724,13 @@ EVAL_FN(link)
     return false;
 }
 
+EVAL_FN(no_inline)
+{
+    obj->no_inline = true;
+    obj->force_inline = false;
+    return false;
+}
+
 EVAL_FN(no_return)
 {
     obj->data_type->no_return = true;
@@ -699,3 +742,9 @@ EVAL_FN(private)
     obj->private = true;
     return false;
 }
+
+EVAL_FN(tailcall)
+{
+    obj->tail_call = true;
+    return false;
+}
@@ -3,6 +3,7 @@
 #include "ast/ast.h"
 #include "c_parser/c_parser.h"
 #include "hashmap.h"
+#include "interner.h"
 #include "io/file.h"
 #include "util.h"
 #include "config.h"
@@ -407,7 +408,7 @@ static inline bool tok_is_operator(Parser_T* p, const char* op)
 Token_T* parser_consume(Parser_T* p, TokenType_T type, const char* msg)
 {
     if(!tok_is(p, type))
-        throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%s`, %s", p->tok->value,  msg);
+        throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%.*s`, %s", TOKEN_VALUE(p->tok),  msg);
 
     return parser_advance(p);
 }
@@ -415,7 +416,7 @@ Token_T* parser_consume(Parser_T* p, TokenType_T type, const char* msg)
 static Token_T* parser_consume_operator(Parser_T* p, const char* op, const char* msg)
 {
     if(!tok_is_operator(p, op))
-        throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%s`, %s", p->tok->value,  msg);
+        throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%.*s`, %s", TOKEN_VALUE(p->tok),  msg);
 
     return parser_advance(p);
 }
@@ -674,7 +675,9 @@ static ASTType_T* parse_lambda_type(Parser_T* p)
     }
     else if(p->tok->value[0] == '<')
     {
-        trim_first_char(p->tok->value);
+        // operators are interned, so skip the `<` instead of cutting it off
+        p->tok->value++;
+        p->tok->length--;
         lambda->base = parse_type(p);
         parser_consume_operator(p, ">", "expect `>` after lambda return type");
     }
@@ -743,11 +746,10 @@ static ASTObj_T* parser_generate_tuple_type(Parser_T* p, ASTType_T* tuple)
         tydef->data_type = allocator_malloc(&p->context->raw_allocator, sizeof(struct AST_TYPE_STRUCT));
         *tydef->data_type = *tuple;
 
-        char* id = calloc(35, sizeof(char));
+        char id[35] = {'\0'};
         sprintf(id, "__csp_tuple_%lu__", p->cur_tuple_id++);
-        CONTEXT_ALLOC_REGISTER(p->context, (void*) id);
 
-        tydef->id = init_ast_identifier(&p->context->raw_allocator, tuple->tok, id);
+        tydef->id = init_ast_identifier(&p->context->raw_allocator, tuple->tok, intern(&p->context->interner, id));
 
         list_push(p->ast->objs, tydef);
         tuple->kind = TY_UNDEF;
@@ -820,11 +822,10 @@ static ASTType_T* parse_type(Parser_T* p)
                     ASTNode_T* member = init_ast_node(&p->context->raw_allocator, ND_STRUCT_MEMBER, p->tok);
                     member->data_type = parse_type(p);
 
-                    char* id = calloc(22, sizeof(char));
-                    CONTEXT_ALLOC_REGISTER(p->context, (void*) id);
+                    char id[22] = {'\0'};
                     sprintf(id, "_%lu", i);
 
-                    member->id = init_ast_identifier(&p->context->raw_allocator, p->tok, id);
+                    member->id = init_ast_identifier(&p->context->raw_allocator, p->tok, intern(&p->context->interner, id));
 
                     list_push(type->members, member);
                     if(!tok_is(p, TOKEN_RBRACE))
@@ -963,11 +964,11 @@ static void parse_extern(Parser_T* p, List_T* objs)
 {
     parser_advance(p);
 
-    bool extern_c = tok_is(p, TOKEN_STRING) && (streq(p->tok->value, "C") || streq(p->tok->value, "c"));
+    bool extern_c = tok_is(p, TOKEN_STRING) && (token_value_is(p->tok, "C") || token_value_is(p->tok, "c"));
     if(extern_c)
         parser_advance(p);
     else if(tok_is(p, TOKEN_STRING))
-        throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "invalid `extern` parameter `\"%s\"`, expect `\"C\"` or `{`", p->tok->value);
+        throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "invalid `extern` parameter `\"%.*s\"`, expect `\"C\"` or `{`", TOKEN_VALUE(p->tok));
 
     if(tok_is(p, TOKEN_LBRACE)) {
         parser_advance(p);
@@ -1027,7 +1028,7 @@ static ASTObj_T* parse_fn_def(Parser_T* p)
     if(tok_is(p, TOKEN_OPERATOR_KW))
     {  
         parser_advance(p);
-        fn->id = init_ast_identifier(&p->context->raw_allocator, p->tok, p->tok->value);
+        fn->id = init_ast_identifier(&p->context->raw_allocator, p->tok, intern(&p->context->interner, p->tok->value));
         if(p->tok->type != TOKEN_OPERATOR)
             throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "expect operator after `operator`");
         if(hashmap_get(p->operator_context, p->tok->value))
@@ -1079,7 +1080,7 @@ static ASTObj_T* parse_fn_def(Parser_T* p)
     fn->data_type->is_variadic = fn->va_area != NULL;
 
     if(p->context->ct == CT_ASM)
-        fn->alloca_bottom = &alloca_bottom;
+        fn->alloca_bottom = init_alloca_bottom(p->context, fn->tok);
 
     return fn;
 }
@@ -1144,7 +1145,7 @@ static ASTObj_T* find_namespace(List_T* objs, char* callee)
     for(size_t i = 0; i < objs->size; i++)
     {
         ASTObj_T* obj = objs->items[i];
-        if(obj->kind == OBJ_NAMESPACE && strcmp(obj->id->callee, callee) == 0)
+        if(obj->kind == OBJ_NAMESPACE && obj->id->callee == callee)
             return obj;
     }
     return NULL;
@@ -1217,7 +1218,7 @@ void parse_obj(Parser_T* p, List_T* obj_list)
             parse_directives(p, obj_list, false, false);
             break;
         default:
-            throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%s`, expect [import, type, let, const, fn]", p->tok->value);
+            throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%.*s`, expect [import, type, let, const, fn]", TOKEN_VALUE(p->tok));
     }
 
     
@@ -1507,7 +1508,7 @@ static ASTNode_T* parse_expr_stmt(Parser_T* p, bool needs_semicolon)
     stmt->expr = parse_expr(p, PREC_LOWEST, TOKEN_SEMICOLON);
 
     if(!is_executable(stmt->expr))
-        throw_error(p->context, ERR_SYNTAX_ERROR_UNCR, stmt->expr->tok, "cannot treat `%s` as a statement, expect function call, assignment or similar", stmt->expr->tok->value);
+        throw_error(p->context, ERR_SYNTAX_ERROR_UNCR, stmt->expr->tok, "cannot treat `%.*s` as a statement, expect function call, assignment or similar", TOKEN_VALUE(stmt->expr->tok));
     if(needs_semicolon)
         parser_consume(p, TOKEN_SEMICOLON, "expect `;` after expression statement");
     return stmt;
@@ -1704,9 +1705,9 @@ static ASTNode_T* parse_extern_c_block(Parser_T* p, bool needs_semicolon)
     parser_advance(p);
 
     if(!tok_is(p, TOKEN_STRING))
-        throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%s`, expect string literal", p->tok->value);
-    if(!streq(p->tok->value, "c") && !streq(p->tok->value, "C"))
-        throw_error(p->context, ERR_UNDEFINED, p->tok, "undefined `extern` mode `\"%s\"`, expect`\"C\"`", p->tok->value);
+        throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%.*s`, expect string literal", TOKEN_VALUE(p->tok));
+    if(!token_value_is(p->tok, "c") && !token_value_is(p->tok, "C"))
+        throw_error(p->context, ERR_UNDEFINED, p->tok, "undefined `extern` mode `\"%.*s\"`, expect`\"C\"`", TOKEN_VALUE(p->tok));
     parser_advance(p);
 
     parser_consume(p, TOKEN_LPAREN, "expect `(` after `extern \"C\"`");
@@ -1753,7 +1754,7 @@ static ASTNode_T* parse_inline_asm(Parser_T* p, bool needs_semicolon)
                 }
                 // fall through
             default:
-                throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%s` in `asm` statement", p->tok->value);
+                throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%.*s` in `asm` statement", TOKEN_VALUE(p->tok));
         }
     }
 
@@ -1843,7 +1844,7 @@ static ASTNode_T* parse_expr(Parser_T* p, Precedence_T prec, TokenType_T end_tok
     PrefixParseFn_T prefix = get_PrefixParseFn_T(p, p->tok);
 
     if(!prefix)
-        throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%s`, expect expression", p->tok->value);
+        throw_error(p->context, ERR_SYNTAX_ERROR, p->tok, "unexpected token `%.*s`, expect expression", TOKEN_VALUE(p->tok));
 
     ASTNode_T* left_expr = prefix(p);
 
@@ -1998,15 +1999,19 @@ static ASTNode_T* parse_char_lit(Parser_T* p)
 static ASTNode_T* parse_str_lit(Parser_T* p)
 {
     ASTNode_T* node = init_ast_node(&p->context->raw_allocator, ND_STR, p->tok);
-    node->str_val =  strdup(p->tok->value);
+    // string literals are slices of the source, which are not '\0'-terminated
+    size_t length = p->tok->length;
+    node->str_val = strndup(p->tok->value, length);
     node->data_type = (ASTType_T*) char_ptr_type;
 
     parser_consume(p, TOKEN_STRING, "expect string literal (\"abc\", \"wxyz\", ...)");
 
     while(tok_is(p, TOKEN_STRING)) // expressions like `"h" "e" "l" "l" "o"` get grouped together to `"hello"`
     {
-        node->str_val = realloc(node->str_val, (strlen(node->str_val) + strlen(p->tok->value) + 1) * sizeof(char));
-        strcat(node->str_val, p->tok->value);
+        node->str_val = realloc(node->str_val, (length + p->tok->length + 1) * sizeof(char));
+        memcpy(node->str_val + length, p->tok->value, p->tok->length);
+        length += p->tok->length;
+        node->str_val[length] = '\0';
         parser_advance(p);
     }
     
@@ -2115,21 +2120,13 @@ static ASTNode_T* parse_const_lambda(Parser_T* p)
     CONTEXT_ALLOC_REGISTER(p->context, lambda_fn->data_type->arg_types);
     CONTEXT_ALLOC_REGISTER(p->context, lambda_fn->objs);
 
-    char* id;
-
+    char id[42] = {'\0'};
     if(p->context->ct == CT_ASM)
-    {
-        id = calloc(34, sizeof(char));
         sprintf(id, "const.lambda.%ld", count++);
-    }
     else
-    {
-        id = calloc(42, sizeof(char));
         sprintf(id, "__csp_const_lambda_%ld__", count++);
-    }
 
-    CONTEXT_ALLOC_REGISTER(p->context, (void*) id);
-    lambda_fn->id = init_ast_identifier(&p->context->raw_allocator, p->tok, id);
+    lambda_fn->id = init_ast_identifier(&p->context->raw_allocator, p->tok, intern(&p->context->interner, id));
 
     if(tok_is_operator(p, "||"))
         parser_advance(p);
@@ -2173,7 +2170,7 @@ static ASTNode_T* parse_const_lambda(Parser_T* p)
 
     collect_locals(lambda_fn->body, lambda_fn->objs);
     if(p->context->ct == CT_ASM)
-        lambda_fn->alloca_bottom = &alloca_bottom;
+        lambda_fn->alloca_bottom = init_alloca_bottom(p->context, lambda_fn->tok);
     list_push(p->ast->objs, lambda_fn);
 
     ASTNode_T* lambda_id = init_ast_node(&p->context->raw_allocator, ND_ID, lambda_fn->tok);
@@ -2272,7 +2269,7 @@ static ASTNode_T* parse_assignment(Parser_T* p, ASTNode_T* left)
     else
     {
         Token_T* assign_op_tok = duplicate_token(&p->context->raw_allocator, op);
-        assign_op_tok->value[strlen(op->value) - 1] = '\0'; // cut the `=` from the operator
+        assign_op_tok->value[--assign_op_tok->length] = '\0'; // cut the `=` from the operator
         ASTNode_T* assign_op = init_ast_node(&p->context->raw_allocator, get_infix_op(assign_op_tok->value), assign_op_tok);
         assign_op->left = left;
         assign_op->right = right;
@@ -2311,7 +2308,7 @@ static ASTNode_T* parse_custom_prefix_operator(Parser_T* p)
 {
     ASTNode_T* call = init_ast_node(&p->context->raw_allocator, ND_CALL, p->tok);
     call->expr = init_ast_node(&p->context->raw_allocator, ND_ID, p->tok);
-    call->expr->id = init_ast_identifier(&p->context->raw_allocator, p->tok, p->tok->value);
+    call->expr->id = init_ast_identifier(&p->context->raw_allocator, p->tok, intern(&p->context->interner, p->tok->value));
 
     parser_consume(p, TOKEN_OPERATOR, "expect operator");
 
@@ -2327,7 +2324,7 @@ static ASTNode_T* parse_custom_infix_operator(Parser_T* p, ASTNode_T* left)
 {
     ASTNode_T* call = init_ast_node(&p->context->raw_allocator, ND_CALL, p->tok);
     call->expr = init_ast_node(&p->context->raw_allocator, ND_ID, p->tok);
-    call->expr->id = init_ast_identifier(&p->context->raw_allocator, p->tok, p->tok->value);
+    call->expr->id = init_ast_identifier(&p->context->raw_allocator, p->tok, intern(&p->context->interner, p->tok->value));
 
     parser_consume(p, TOKEN_OPERATOR, "expect operator");
 
@@ -2639,9 +2636,7 @@ static ASTNode_T* parse_pow_3(Parser_T* p, ASTNode_T* left)
 
 static ASTNode_T* parse_current_fn_token(Parser_T* p)
 {
-    p->tok->type = TOKEN_STRING;
-    p->tok = allocator_realloc(&p->context->raw_allocator, p->tok, sizeof(Token_T) + strlen(p->cur_obj->id->callee) + 1);
-    strcpy(p->tok->value, p->cur_obj->id->callee);
+    p->tok = init_token(&p->context->raw_allocator, p->cur_obj->id->callee, p->tok->line, p->tok->pos, TOKEN_STRING, p->tok->source);
 
     return parse_str_lit(p);
 }
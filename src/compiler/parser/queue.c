@@ -5,6 +5,7 @@
 #include "list.h"
 #include "parser/validator.h"
 #include <string.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <assert.h>
@@ -13,61 +14,84 @@
     Validator_T* v = va_arg(va, Validator_T*);          \
     ResolveQueue_T* queue = va_arg(va, ResolveQueue_T*)
 
-ResolveQueueNode_T* resolve_queue_node_init(ResolveMethod_T method, ASTObj_T* obj)
+#define RESOLVE_QUEUE_INIT_SIZE 64
+
+void resolve_queue_init(ResolveQueue_T* queue)
 {
-    ResolveQueueNode_T* node = calloc(1, sizeof(struct RESOLVE_QUEUE_NODE_STRUCT));
-    node->method = method;
-    node->obj = obj;
-    return node;
+    memset(queue, 0, sizeof(ResolveQueue_T));
 }
 
-void resolve_queue_node_free(ResolveQueueNode_T* node)
+void resolve_queue_free(ResolveQueue_T* queue)
 {
-    if(!node)
-        return;
+    free(queue->nodes);
+    free(queue->index);
+    resolve_queue_init(queue);
+}
 
-    resolve_queue_node_free(node->next);
-    free(node);
+ResolveQueueNode_T* resolve_queue_last(ResolveQueue_T* queue)
+{
+    return queue->size ? &queue->nodes[queue->size - 1] : NULL;
 }
 
-void resolve_queue_init(ResolveQueue_T* queue)
+static inline size_t resolve_queue_hash(const ResolveQueue_T* queue, const ASTObj_T* obj)
 {
-    queue->head = NULL;    
+    // fibonacci hashing of the object's address
+    return (((uintptr_t) obj >> 4) * 11400714819323198485llu) & (queue->index_allocated - 1);
 }
 
-void resolve_queue_free(ResolveQueue_T* queue)
+static ResolveQueueIndexEntry_T* resolve_queue_find(const ResolveQueue_T* queue, const ASTObj_T* obj)
 {
-    resolve_queue_node_free(queue->head);
+    if(!queue->index_allocated)
+        return NULL;
+
+    // linear probing, the index is never full
+    size_t i = resolve_queue_hash(queue, obj);
+    while(queue->index[i].obj && queue->index[i].obj != obj)
+        i = (i + 1) & (queue->index_allocated - 1);
+    return &queue->index[i];
 }
 
-ResolveQueueNode_T* resolve_queue_last(ResolveQueue_T* queue)
+static void resolve_queue_grow_index(ResolveQueue_T* queue)
 {
-    ResolveQueueNode_T* node = queue->head;
-    while(node && node->next)
-        node = node->next;
-    return node;
+    ResolveQueueIndexEntry_T* old_index = queue->index;
+    size_t old_allocated = queue->index_allocated;
+
+    queue->index_allocated = old_allocated ? old_allocated * 2 : RESOLVE_QUEUE_INIT_SIZE;
+    queue->index = calloc(queue->index_allocated, sizeof(ResolveQueueIndexEntry_T));
+
+    for(size_t i = 0; i < old_allocated; i++)
+        if(old_index[i].obj)
+            *resolve_queue_find(queue, old_index[i].obj) = old_index[i];
+
+    free(old_index);
 }
 
 bool resolve_queue_contains(ResolveQueue_T* queue, ASTObj_T* obj, ResolveMethod_T method)
 {
-    ResolveQueueNode_T* node = queue->head;
-    while(node)
-    {
-        if(node->obj == obj && node->method & method)
-            return true;
-        node = node->next;
-    }
-    return false;
+    ResolveQueueIndexEntry_T* entry = resolve_queue_find(queue, obj);
+    return entry && entry->obj && entry->methods & method;
 }
 
-static void enqueue_obj(ResolveQueue_T* queue, ASTObj_T* obj, ResolveMethod_T method)
+void resolve_queue_push(ResolveQueue_T* queue, ASTObj_T* obj, ResolveMethod_T method)
 {
-    ResolveQueueNode_T* new = resolve_queue_node_init(method, obj);
-    ResolveQueueNode_T* tail = resolve_queue_last(queue);
-    if(!tail)
-        queue->head = new;
-    else
-        tail->next = new;
+    if(queue->size >= queue->allocated)
+    {
+        queue->allocated = queue->allocated ? queue->allocated * 2 : RESOLVE_QUEUE_INIT_SIZE;
+        queue->nodes = realloc(queue->nodes, queue->allocated * sizeof(ResolveQueueNode_T));
+    }
+    queue->nodes[queue->size++] = (ResolveQueueNode_T){.method = method, .obj = obj};
+
+    // keep the load factor of the index below 1/2
+    if((queue->index_size + 1) * 2 > queue->index_allocated)
+        resolve_queue_grow_index(queue);
+
+    ResolveQueueIndexEntry_T* entry = resolve_queue_find(queue, obj);
+    if(!entry->obj)
+    {
+        entry->obj = obj;
+        queue->index_size++;
+    }
+    entry->methods |= method;
 }
 
 static void resolve_id_enqueue(ASTNode_T* ident, va_list args);
@@ -174,7 +198,7 @@ static void resolve_obj_enqueue(Validator_T* v, ResolveQueue_T* queue, ASTObj_T*
     if(resolve_queue_contains(queue, obj, method == RESOLVE_SHALLOW ? RESOLVE_ANYHOW : method))
             goto finish;
 
-    enqueue_obj(queue, obj, method);
+    resolve_queue_push(queue, obj, method);
 
 finish:
     validator_pop_obj(v);
@@ -248,14 +272,13 @@ void dbg_print_resolve_queue(ResolveQueue_T *queue)
         [RESOLVE_ANYHOW] = "anyhow"
     };
 
-    ResolveQueueNode_T* node = queue->head;
     char* buf = malloc(BUFSIZ * sizeof(char));
     printf("Queued objects:\n");
-    for(size_t i = 1; node; i++) {
+    for(size_t i = 0; i < queue->size; i++) {
+        ResolveQueueNode_T* node = &queue->nodes[i];
         *buf = '\0';
         ast_id_to_str(buf, node->obj->id, BUFSIZ);
-        printf("[%8zu] %s (%s)\n", i, buf, METHOD_STRINGS[node->method]);
-        node = node->next;
+        printf("[%8zu] %s (%s)\n", i + 1, buf, METHOD_STRINGS[node->method]);
     }
+    free(buf);
 }
-
@@ -13,17 +13,27 @@ typedef enum RESOLVE_METHOD
 
 typedef struct RESOLVE_QUEUE_NODE_STRUCT
 {
-    struct RESOLVE_QUEUE_NODE_STRUCT* next;
     ResolveMethod_T method;
     ASTObj_T* obj;
 } ResolveQueueNode_T;
 
-ResolveQueueNode_T* resolve_queue_node_init(ResolveMethod_T method, ASTObj_T* obj);
-void resolve_queue_node_free(ResolveQueueNode_T* node);
+typedef struct RESOLVE_QUEUE_INDEX_ENTRY_STRUCT
+{
+    ASTObj_T* obj;
+    ResolveMethod_T methods; // all methods `obj` got enqueued with
+} ResolveQueueIndexEntry_T;
 
 typedef struct RESOLVE_QUEUE_STRUCT
 {
-    ResolveQueueNode_T* head;
+    // objects in resolve order
+    ResolveQueueNode_T* nodes;
+    size_t size;
+    size_t allocated;
+
+    // open addressing hash set of all enqueued objects
+    ResolveQueueIndexEntry_T* index;
+    size_t index_size;
+    size_t index_allocated;
 } ResolveQueue_T;
 
 void resolve_queue_init(ResolveQueue_T* queue);
@@ -31,6 +41,7 @@ void resolve_queue_free(ResolveQueue_T* queue);
 
 ResolveQueueNode_T* resolve_queue_last(ResolveQueue_T* queue);
 bool resolve_queue_contains(ResolveQueue_T* queue, ASTObj_T* obj, ResolveMethod_T method);
+void resolve_queue_push(ResolveQueue_T* queue, ASTObj_T* obj, ResolveMethod_T method);
 
 void build_resolve_queue(Validator_T* v, ResolveQueue_T* queue);
 
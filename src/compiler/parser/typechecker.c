@@ -198,6 +198,10 @@ static ASTNode_T* typecheck_arg_pass(TypeChecker_T* t, ASTType_T* expected, ASTN
         return received;
     }
 
+    // string literals passed as `&const char` are never written to, so they can share their memory
+    if(received->kind == ND_STR && unpack(expected)->kind == TY_PTR && unpack(expected)->base->is_constant)
+        received->is_constant = true;
+
     if(types_equal(t->context, expected, received->data_type))
         return received;
     
@@ -476,7 +480,7 @@ bool types_equal_strict(Context_T* context, ASTType_T* a, ASTType_T* b)
             {
                 ASTNode_T* am = a->members->items[i];
                 ASTNode_T* bm = b->members->items[i];
-                if(strcmp(am->id->callee, bm->id->callee) != 0)
+                if(am->id->callee != bm->id->callee)
                     return false;
             }
             break;
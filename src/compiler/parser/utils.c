@@ -3,22 +3,23 @@
 #include "ast/ast.h"
 #include "ast/ast_iterator.h"
 #include "ast/types.h"
+#include "context.h"
+#include "interner.h"
 #include "list.h"
 
 #include <stdarg.h>
 #include <string.h>
 
-ASTObj_T alloca_bottom = {
-    .kind = OBJ_LOCAL,
-    .id = &(ASTIdentifier_T) {
-        .callee = "__alloca_size__"
-    },
-    .data_type = &(ASTType_T){
-        .size = PTR_S,
-        .align = PTR_S
-    },
-    .offset = 0
-};
+// local holding %rsp at function entry, for the assembly backend's `alloca`
+ASTObj_T* init_alloca_bottom(Context_T* context, Token_T* tok)
+{
+    ASTObj_T* bottom = init_ast_obj(&context->raw_allocator, OBJ_LOCAL, tok);
+    bottom->id = init_ast_identifier(&context->raw_allocator, tok, intern(&context->interner, "__alloca_size__"));
+    bottom->data_type = init_ast_type(&context->raw_allocator, TY_PTR, tok);
+    bottom->data_type->size = PTR_S;
+    bottom->data_type->align = PTR_S;
+    return bottom;
+}
 
 #define GET_LIST(va) List_T* l = va_arg(va, List_T*)
 
@@ -67,7 +68,7 @@ void collect_locals(ASTNode_T* stmt, List_T* locals)
 
 bool identifiers_equal(ASTIdentifier_T* a, ASTIdentifier_T* b)
 {
-    if(!a->outer != !b->outer || strcmp(a->callee, b->callee) != 0)
+    if(!a->outer != !b->outer || a->callee != b->callee)
         return false;
     else if(a->outer)
         return identifiers_equal(a->outer, b->outer);
@@ -2,8 +2,9 @@
 #define CSPYDR_PARSER_UTILS_H
 
 #include "ast/ast.h"
+#include "context.h"
 
-extern ASTObj_T alloca_bottom;
+ASTObj_T* init_alloca_bottom(Context_T* context, Token_T* tok);
 void collect_locals(ASTNode_T* stmt, List_T* locals);
 bool identifiers_equal(ASTIdentifier_T* a, ASTIdentifier_T* b);
 ASTNode_T* unpack_closure_and_casts(ASTNode_T* node);
@@ -5,6 +5,7 @@
 #include "context.h"
 #include "error/error.h"
 #include "hashmap.h"
+#include "interner.h"
 #include "lexer/token.h"
 #include "list.h"
 #include "optimizer/constexpr.h"
@@ -70,6 +71,15 @@ static void free_validator(Validator_T* v)
     typechecker_free(&v->typechecker);
     free_list(v->obj_stack);
     free_list(v->exact_type_info_stack);
+
+    while(v->current_scope)
+        end_scope(v);
+    
+    for(Scope_T* scope = v->free_scopes, *outer; scope; scope = outer)
+    {
+        outer = scope->outer;
+        free(scope);
+    }
 }
 
 void validator_push_obj(Validator_T* v, ASTObj_T* obj)
@@ -166,6 +176,7 @@ i32 validator_pass(Context_T* context, ASTProg_T* ast)
 
 finish:
     free_validator(&v);
+    context->current_obj = NULL;
     timer_stop(context);
 
     return context->emitted_errors;
@@ -253,8 +264,14 @@ static ASTType_T* expand_typedef(Validator_T* v, ASTType_T* type)
 
 static void begin_scope(Validator_T* v, List_T* objs)
 {
-    Scope_T* scope = malloc(sizeof(Scope_T));
-    scope->objs = hashmap_init();
+    Scope_T* scope = v->free_scopes;
+    if(scope)
+        v->free_scopes = scope->outer;
+    else
+        scope = malloc(sizeof(Scope_T));
+    
+    scope->num_inline_objs = 0;
+    scope->objs = NULL;
     scope->outer = v->current_scope;
     v->current_scope = scope;
     v->scope_depth++;
@@ -274,16 +291,53 @@ static void end_scope(Validator_T* v)
     v->current_scope = scope->outer;
     v->scope_depth--;
     
-    hashmap_free(scope->objs);
-    free(scope);
+    if(scope->objs)
+        hashmap_free(scope->objs);
+    scope->outer = v->free_scopes;
+    v->free_scopes = scope;
+}
+
+// scope ids are interned, so they are compared by address
+static int scope_put(Scope_T* scope, const char* id, void* obj)
+{
+    if(scope->objs)
+        return hashmap_put(scope->objs, (char*) id, obj);
+
+    for(u32 i = 0; i < scope->num_inline_objs; i++)
+        if(scope->inline_objs[i].id == id)
+            return EEXIST;
+
+    if(scope->num_inline_objs < SCOPE_INLINE_OBJS)
+    {
+        scope->inline_objs[scope->num_inline_objs].id = id;
+        scope->inline_objs[scope->num_inline_objs++].obj = obj;
+        return 0;
+    }
+
+    // promote the scope to a hashmap
+    scope->objs = hashmap_init_interned();
+    for(u32 i = 0; i < scope->num_inline_objs; i++)
+        hashmap_put(scope->objs, (char*) scope->inline_objs[i].id, scope->inline_objs[i].obj);
+    return hashmap_put(scope->objs, (char*) id, obj);
+}
+
+static void* scope_get(Scope_T* scope, const char* id)
+{
+    if(scope->objs)
+        return hashmap_get(scope->objs, id);
+
+    for(u32 i = 0; i < scope->num_inline_objs; i++)
+        if(scope->inline_objs[i].id == id)
+            return scope->inline_objs[i].obj;
+    return NULL;
 }
 
 static void scope_register_obj(Validator_T* v, ASTObj_T* obj)
 {
     assert(v->scope_depth > 0);
-    if(hashmap_put(v->current_scope->objs, obj->id->callee, obj) == EEXIST)
+    if(scope_put(v->current_scope, obj->id->callee, obj) == EEXIST)
     {
-        ASTObj_T* existing = hashmap_get(v->current_scope->objs, obj->id->callee);
+        ASTObj_T* existing = scope_get(v->current_scope, obj->id->callee);
         assert(existing != NULL);
 
         throw_error(
@@ -303,9 +357,9 @@ static void scope_register_obj(Validator_T* v, ASTObj_T* obj)
 static void scope_register_node(Validator_T* v, ASTNode_T* node)
 {
     assert(v->scope_depth > 0);
-    if(hashmap_put(v->current_scope->objs, node->id->callee, node) == EEXIST)
+    if(scope_put(v->current_scope, node->id->callee, node) == EEXIST)
     {
-        ASTNode_T* existing = hashmap_get(v->current_scope->objs, node->id->callee);
+        ASTNode_T* existing = scope_get(v->current_scope, node->id->callee);
         assert(existing != NULL);
 
         throw_error(
@@ -322,7 +376,36 @@ static void scope_register_node(Validator_T* v, ASTNode_T* node)
 
 static ASTObj_T* scope_contains(Scope_T* scope, const char* id)
 {
-    return hashmap_get(scope->objs, id);
+    return scope_get(scope, id);
+}
+
+// namespaces and enums with more members than this get a hashed member index
+#define MEMBER_INDEX_THRESHOLD SCOPE_INLINE_OBJS
+
+static ASTObj_T* find_member(Validator_T* v, List_T* members, HashMap_T** index, const char* callee)
+{
+    if(members->size <= MEMBER_INDEX_THRESHOLD)
+    {
+        for(size_t i = 0; i < members->size; i++)
+        {
+            ASTObj_T* member = members->items[i];
+            if(member->id->callee == callee)
+                return member;
+        }
+        return NULL;
+    }
+
+    if(!*index)
+    {
+        CONTEXT_ALLOC_REGISTER(v->context, *index = hashmap_init_interned());
+        for(size_t i = 0; i < members->size; i++)
+        {
+            ASTObj_T* member = members->items[i];
+            hashmap_put(*index, member->id->callee, member); // keeps the first member on duplicates
+        }
+    }
+
+    return hashmap_get(*index, callee);
 }
 
 static IdentResolveResult_T scope_resolve_ident(Validator_T* v, Scope_T* scope, ASTIdentifier_T* ident)
@@ -343,23 +426,17 @@ static IdentResolveResult_T scope_resolve_ident(Validator_T* v, Scope_T* scope,
         case OBJ_TYPEDEF:
             {
                 ASTType_T* expanded = expand_typedef(v, outer_result.obj->data_type);
-                if(expanded->kind == TY_ENUM)
-                    for(size_t i = 0; i < expanded->members->size; i++)
-                    {
-                        ASTObj_T* member = expanded->members->items[i];
-                        if(strcmp(member->id->callee, ident->callee) == 0)
-                            return IDENT_FOUND(check_is_deprecated(v, member, ident->tok));
-                    }
+                ASTObj_T* member;
+                if(expanded->kind == TY_ENUM && (member = find_member(v, expanded->members, &expanded->member_index, ident->callee)))
+                    return IDENT_FOUND(check_is_deprecated(v, member, ident->tok));
                 throw_error(v->context, ERR_UNDEFINED_UNCR, ident->outer->tok, "type `%s` has no member called `%s`", outer_result.obj->id->callee, ident->callee);
             } break;
         case OBJ_NAMESPACE:
-            for(size_t i = 0; i < outer_result.obj->objs->size; i++)
             {
-                ASTObj_T* obj = outer_result.obj->objs->items[i];
-                if(strcmp(obj->id->callee, ident->callee) == 0)
+                ASTObj_T* obj = find_member(v, outer_result.obj->objs, &outer_result.obj->member_index, ident->callee);
+                if(obj)
                     return IDENT_FOUND(check_is_deprecated(v, obj, ident->tok));
-            }
-            break;
+            } break;
         default:
             break;
         }
@@ -512,7 +589,7 @@ static void enter_using_scope(ASTNode_T* using, va_list args)
         for(size_t i = 0; i < namespace->objs->size; i++)
         {
             ASTObj_T* obj = namespace->objs->items[i];
-            if(hashmap_put(v->current_scope->objs, obj->id->callee, obj) == EEXIST)
+            if(scope_put(v->current_scope, obj->id->callee, obj) == EEXIST)
                 throw_error(
                     v->context,
                     ERR_REDEFINITION_UNCR,
@@ -1322,7 +1399,7 @@ static ASTNode_T* find_member_in_struct(Validator_T* v, ASTType_T* type, ASTNode
     for(size_t i = 0; i < type->members->size; i++)
     {
         ASTNode_T* member = type->members->items[i];
-        if(strcmp(member->id->callee, id->id->callee) == 0)
+        if(member->id->callee == id->id->callee)
             return member;
     }
 
@@ -1601,7 +1678,7 @@ static void iter_leave_assignment(ASTNode_T* assign, va_list args)
         } break;
 
         default:
-            throw_error(v->context, ERR_MISC, assign->left->tok, "cannot assign value to `%s`", assign->left->tok->value);
+            throw_error(v->context, ERR_MISC, assign->left->tok, "cannot assign value to `%.*s`", TOKEN_VALUE(assign->left->tok));
     }
 
     assign->data_type = assign->left->data_type;
@@ -1629,9 +1706,7 @@ static void validate_anon_struct_lit(Validator_T* v, ASTNode_T* struct_lit)
             ASTNode_T* member = init_ast_node(&v->context->raw_allocator, ND_STRUCT_MEMBER, arg->tok);
             char buffer[100] = {0};
             sprintf(buffer, "_%ld", i);
-            char* buf_ptr = strdup(buffer);
-            CONTEXT_ALLOC_REGISTER(v->context, (void*) buf_ptr);
-            member->id = init_ast_identifier(&v->context->raw_allocator, arg->tok, buf_ptr);
+            member->id = init_ast_identifier(&v->context->raw_allocator, arg->tok, intern(&v->context->interner, buffer));
             member->data_type = arg->data_type;
 
             list_push(type->members, member);
@@ -1793,11 +1868,10 @@ static void iter_leave_lambda(ASTNode_T* lambda, va_list args)
     ASTObj_T* lambda_stack_ptr = init_ast_obj(&v->context->raw_allocator, OBJ_GLOBAL, lambda->tok);
     lambda_stack_ptr->data_type = (ASTType_T*) void_ptr_type;
 
-    char* id = calloc(64, sizeof(char));
-    CONTEXT_ALLOC_REGISTER(v->context, (void*) id);
+    char id[64] = {'\0'};
     sprintf(id, "lambda.stackptr.%ld", lambda->long_val);
 
-    lambda_stack_ptr->id = init_ast_identifier(&v->context->raw_allocator, lambda->tok, id);
+    lambda_stack_ptr->id = init_ast_identifier(&v->context->raw_allocator, lambda->tok, intern(&v->context->interner, id));
 
     list_push(v->ast->objs, lambda_stack_ptr);
     lambda->stack_ptr = lambda_stack_ptr;
@@ -2096,15 +2170,13 @@ static void validate_obj_deep(Validator_T* v, ASTObj_T* obj)
 
 static void validate_semantics(Validator_T* v, ResolveQueue_T* queue)
 {
-    ResolveQueueNode_T* node = queue->head;
-    while(node)
+    for(size_t i = 0; i < queue->size; i++)
     {
+        ResolveQueueNode_T* node = &queue->nodes[i];
         validate_obj_shallow(v, node->obj);
 
         if(node->method & RESOLVE_DEEP)
             validate_obj_deep(v, node->obj);
-
-        node = node->next;
     }
 }
 
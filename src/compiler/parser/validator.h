@@ -8,11 +8,22 @@
 #include "optimizer/constexpr.h"
 #include "parser/typechecker.h"
 
+#define SCOPE_INLINE_OBJS 8
+
 // validator structs
 typedef struct SCOPE_STRUCT Scope_T;
 struct SCOPE_STRUCT
 {
     Scope_T* outer;
+
+    // most scopes only hold a few objects, these get searched linearly
+    // before the scope gets promoted to a hashmap
+    u32 num_inline_objs;
+    struct {
+        const char* id;
+        void* obj;
+    } inline_objs[SCOPE_INLINE_OBJS];
+
     HashMap_T* objs;
 };
 
@@ -25,6 +36,7 @@ typedef struct VALIDATOR_STRUCT
 
     Scope_T* current_scope;
     Scope_T* global_scope;
+    Scope_T* free_scopes; // ended scopes, kept for reuse
 
     ASTObj_T* current_obj;
     List_T* obj_stack;
@@ -14,6 +14,8 @@ PASS_FN_DECL(preprocessor);
 PASS_FN_DECL(parser);
 PASS_FN_DECL(validator);
 PASS_FN_DECL(optimizer);
+PASS_FN_DECL(tail_call);
+PASS_FN_DECL(ir);
 PASS_FN_DECL(transpiler);
 PASS_FN_DECL(asm_codegen);
 PASS_FN_DECL(serializer);
@@ -5,12 +5,14 @@
 #include "stdmacros.h"
 #include "lexer/lexer.h"
 #include "lexer/token.h"
+#include "lexer/token_cache.h"
 #include "error/error.h"
 #include "platform/platform_bindings.h"
 #include "timer/timer.h"
 #include "io/log.h"
 #include "io/io.h"
 #include "util.h"
+#include "thread_pool.h"
 
 #include <dirent.h>
 #include <stdbool.h>
@@ -39,6 +41,12 @@ typedef struct PREPROCESSOR_STRUCT
     List_T* macros;
     List_T* imports;
 
+    HashMap_T* macro_index;  // interned macro name -> macros with that name
+    HashMap_T* import_index; // canonical import path -> import
+    size_t next_import;      // first import whose tokens were not added yet
+
+    ThreadPool_T* pool; // lexes imports in parallel, NULL with -j 1
+
     bool is_silent;
 
     u64 macro_call_depth;
@@ -57,7 +65,15 @@ typedef struct IMPORT_STRUCT
 {
     Token_T* tok;
     char* import_path;
-} __attribute__((packed)) Import_T;
+
+    // lexing state when using the thread pool
+    Context_T* context;
+    ThreadPoolJob_T job;
+    File_T* file;
+    List_T* tokens;
+    Allocator_T allocator;
+    bool failed;
+} Import_T;
 
 //
 // Base functions
@@ -70,11 +86,13 @@ Macro_T* init_macro(Token_T* tok)
     mac->replacing_tokens = init_list();
     mac->argc = 0;
     mac->used = false;
+    mac->next_overload = NULL;
 
     return mac;
 }
 
 static Macro_T* find_macro(Preprocessor_T* pp, char* callee, u8 argc);
+static void register_macro(Preprocessor_T* pp, Macro_T* macro);
 
 static void init_macro_call(MacroCall_T* call, Token_T* tok)
 {
@@ -95,39 +113,65 @@ static void free_macro(Macro_T* mac)
 static bool macro_has_arg(Macro_T* macro, char* callee)
 {
     for(u8 i = 0; i < macro->argc; i++)
-        if(strcmp(callee, macro->args[i]->value) == 0)
+        if(callee == macro->args[i]->value)
             return true;
     return false;
 }
 
-static Import_T* init_import(Token_T* tok)
+static Import_T* init_import(Context_T* context, Token_T* tok)
 {
-    Import_T* imp = malloc(sizeof(struct IMPORT_STRUCT));
+    Import_T* imp = calloc(1, sizeof(struct IMPORT_STRUCT));
     imp->tok = tok;
+    imp->context = context;
 
     return imp;
 }
 
 static void free_import(Import_T* imp)
 {
+    if(imp->tokens)
+        free_list(imp->tokens);
+    free_allocator(&imp->allocator);
     free(imp->import_path);
     free(imp);
 }
  
 void init_preprocessor(Context_T* context, Preprocessor_T* pp, ASTProg_T* ast)
 {
+    memset(pp, 0, sizeof(Preprocessor_T));
     pp->context = context;
     pp->macros = init_list();
     pp->imports = init_list();
+    pp->macro_index = hashmap_init_interned();
+    pp->import_index = hashmap_init();
     pp->tokens = ast->tokens;
     pp->files = ast->files;
     pp->is_silent = context->flags.silent;
 
-    define_std_macros(context, pp->macros);
+    if(context->num_threads > 1)
+    {
+        pp->pool = malloc(sizeof(ThreadPool_T));
+        init_thread_pool(pp->pool, context->num_threads);
+    }
+
+    List_T* std_macros = init_list();
+    define_std_macros(context, std_macros);
+    for(size_t i = 0; i < std_macros->size; i++)
+        register_macro(pp, std_macros->items[i]);
+    free_list(std_macros);
 }
 
 static void free_preprocessor(Preprocessor_T* pp)
 {
+    if(pp->pool)
+    {
+        free_thread_pool(pp->pool);
+        free(pp->pool);
+    }
+
+    hashmap_free(pp->macro_index);
+    hashmap_free(pp->import_index);
+
     for(size_t i = 0; i < pp->macros->size; i++)
         free_macro(pp->macros->items[i]);
     free_list(pp->macros);
@@ -153,9 +197,9 @@ static char* get_full_import_path(Context_T* context, char* origin, Token_T* imp
     char* full_path = get_path_from_file(abs_path);
 
     // construct the imported file onto it
-    const char* template = "%s" DIRECTORY_DELIMS "%s";
-    char* full_import_path = calloc(strlen(full_path) + strlen(import_file->value) + 2, sizeof(char));
-    sprintf(full_import_path, template, full_path, import_file->value);
+    const char* template = "%s" DIRECTORY_DELIMS "%.*s";
+    char* full_import_path = calloc(strlen(full_path) + import_file->length + 2, sizeof(char));
+    sprintf(full_import_path, template, full_path, TOKEN_VALUE(import_file));
 
     free(abs_path);
 
@@ -164,12 +208,12 @@ static char* get_full_import_path(Context_T* context, char* origin, Token_T* imp
         free(full_import_path);
         // if the file does not exist locally, search for it in the STD path
 
-        const char* std_tmp = "%s" DIRECTORY_DELIMS "%s";
-        char* std_path = calloc(strlen(context->paths.std_path) + strlen(import_file->value) + 2, sizeof(char));
-        sprintf(std_path, std_tmp, context->paths.std_path, import_file->value);
+        const char* std_tmp = "%s" DIRECTORY_DELIMS "%.*s";
+        char* std_path = calloc(strlen(context->paths.std_path) + import_file->length + 2, sizeof(char));
+        sprintf(std_path, std_tmp, context->paths.std_path, TOKEN_VALUE(import_file));
         
         if(!file_exists(std_path))
-            throw_error(context, ERR_SYNTAX_ERROR, import_file, "Error reading imported file \"%s\", no such file or directory", import_file->value);
+            throw_error(context, ERR_SYNTAX_ERROR, import_file, "Error reading imported file \"%.*s\", no such file or directory", TOKEN_VALUE(import_file));
         return std_path;
     }
 
@@ -178,30 +222,43 @@ static char* get_full_import_path(Context_T* context, char* origin, Token_T* imp
 
 static Import_T* find_import(Preprocessor_T* pp, Import_T* imp)
 {
-    for(size_t i = 0; i < pp->imports->size; i++)
-    {
-        Import_T* b_imp = pp->imports->items[i];
-        if(strcmp(b_imp->import_path, imp->import_path) == 0)
-            return b_imp;
-    }
-    return NULL;
+    return hashmap_get(pp->import_index, imp->import_path);
+}
+
+static void lex_import(void* arg);
+
+// lexes a whole file (without EOF), using the token cache if possible
+static void lex_tokens(Lexer_T* lexer, List_T* tokens)
+{
+    if(load_cached_tokens(lexer, tokens))
+        return;
+
+    size_t start = tokens->size;
+    Token_T* tok;
+    for(tok = lexer_next_token(lexer); tok->type != TOKEN_EOF; tok = lexer_next_token(lexer))
+        list_push(tokens, tok);
+
+    cache_tokens(lexer->file, (Token_T**) &tokens->items[start], tokens->size - start);
 }
 
 static void parse_import_def(Preprocessor_T* pp, List_T* token_list, size_t* i)
 {
-    static u32 file_no = 0;
     // parse the import struct from the source code
     (*i)++;
 
     Token_T* next = token_list->items[(*i)++];
     if(next->type != TOKEN_STRING)
-        throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%s`, expect `\"<import file>\"` as a string", next->value);
-    Import_T* imp = init_import(next);
+        throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%.*s`, expect `\"<import file>\"` as a string", TOKEN_VALUE(next));
+    Import_T* imp = init_import(pp->context, next);
 
     next = token_list->items[(*i)];
 
-    // generate the full path to the import
-    imp->import_path = get_full_import_path(pp->context, (char*) imp->tok->source->path, imp->tok);
+    // generate the full path to the import, canonical so that every file gets imported only once
+    char* full_path = get_full_import_path(pp->context, (char*) imp->tok->source->path, imp->tok);
+    if((imp->import_path = get_absolute_path(full_path)))
+        free(full_path);
+    else
+        imp->import_path = full_path;
 
     // check if the file was already included
     if(find_import(pp, imp))
@@ -212,28 +269,86 @@ static void parse_import_def(Preprocessor_T* pp, List_T* token_list, size_t* i)
     }
 
     list_push(pp->imports, imp);
+    hashmap_put(pp->import_index, imp->import_path, imp);
+
+    // start lexing right away, the tokens get added in order by add_next_import()
+    if(pp->pool)
+    {
+        init_thread_pool_job(&imp->job, lex_import, imp);
+        thread_pool_submit(pp->pool, &imp->job);
+    }
+}
+
+// runs on a worker thread, so it must not touch anything shared
+static void lex_import(void* arg)
+{
+    Import_T* imp = arg;
+    imp->file = read_file(imp->import_path);
+    imp->tokens = init_list();
+    init_region_allocator(&imp->allocator);
+
+    Exception_T bail;
+    Lexer_T import_lexer;
+    init_lexer(&import_lexer, imp->context, imp->file);
+    import_lexer.allocator = &imp->allocator;
+    import_lexer.detached = &bail;
+
+    try(bail)
+        lex_tokens(&import_lexer, imp->tokens);
+    catch
+        imp->failed = true;
+
+    free_lexer(&import_lexer);
+}
 
-    // get the tokens from the file
-    File_T* import_file = read_file(imp->import_path);
-    import_file->short_path = strdup(imp->tok->value);
+// add the tokens of the next import in the order they were found, returns false if there are none left
+static bool add_next_import(Preprocessor_T* pp)
+{
+    static u32 file_no = 0;
+
+    if(pp->next_import >= pp->imports->size)
+        return false;
+
+    Import_T* imp = pp->imports->items[pp->next_import++];
+    if(pp->pool)
+        thread_pool_await(pp->pool, &imp->job);
+
+    if(!imp->file)
+        imp->file = read_file(imp->import_path);
+
+    File_T* import_file = imp->file;
+    import_file->short_path = strndup(imp->tok->value, imp->tok->length);
     import_file->file_no = ++file_no;
     import_file->path = strdup(imp->import_path);
     CONTEXT_ALLOC_REGISTER(pp->context, (void*) import_file->path);
 
-    Lexer_T import_lexer;
-    init_lexer(&import_lexer, pp->context, import_file);
-    
     if(!pp->is_silent) {
-        LOG_OK_F("\33[2k\r" COLOR_BOLD_GREEN "  Compiling " COLOR_RESET " %s", imp->tok->value);
+        LOG_OK_F("\33[2k\r" COLOR_BOLD_GREEN "  Compiling " COLOR_RESET " %.*s", TOKEN_VALUE(imp->tok));
         fflush(OUTPUT_STREAM);
     }
 
-    // add the tokens
-    Token_T* tok;
-    for(tok = lexer_next_token(&import_lexer); tok->type != TOKEN_EOF; tok = lexer_next_token(&import_lexer))  
-        push_tok(pp, tok);
-    
+    if(imp->tokens && !imp->failed)
+    {
+        allocator_adopt(&pp->context->raw_allocator, &imp->allocator);
+        for(size_t i = 0; i < imp->tokens->size; i++)
+        {
+            Token_T* tok = imp->tokens->items[i];
+            if(token_is_interned(tok->type))
+                lexer_intern(pp->context, tok);
+            push_tok(pp, tok);
+        }
+    }
+    else
+    {
+        // lex on the main thread, this reports the errors a detached lexer bailed out on
+        Lexer_T import_lexer;
+        init_lexer(&import_lexer, pp->context, import_file);
+        lex_tokens(&import_lexer, pp->tokens);
+        free_lexer(&import_lexer);
+    }
+
     list_push(pp->files, import_file);
+    return true;
 }
 
 //
@@ -246,7 +361,7 @@ static Macro_T* parse_macro_def(Preprocessor_T* pp, size_t* i)
 
     Token_T* next = pp->tokens->items[(*i)++];
     if(next->type != TOKEN_ID)
-        throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%s`, expect macro name", next->value);
+        throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%.*s`, expect macro name", TOKEN_VALUE(next));
     Macro_T* macro = init_macro(next);
 
      next = pp->tokens->items[(*i)++];    
@@ -255,7 +370,7 @@ static Macro_T* parse_macro_def(Preprocessor_T* pp, size_t* i)
         for(next = pp->tokens->items[(*i)++]; next->type != TOKEN_EOF && next->type != TOKEN_RPAREN; next = pp->tokens->items[(*i)++]) 
         {
             if(next->type != TOKEN_ID)
-                throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%s`, expect macro argument name", next->value);
+                throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%.*s`, expect macro argument name", TOKEN_VALUE(next));
             if(macro_has_arg(macro, next->value))
                 throw_error(pp->context, ERR_REDEFINITION, next, "duplicate macro argument `%s`", next->value);
             if(macro->argc >= __CSP_MAX_FN_NUM_ARGS)
@@ -268,17 +383,17 @@ static Macro_T* parse_macro_def(Preprocessor_T* pp, size_t* i)
                 break;
 
             if(next->type != TOKEN_COMMA)
-                throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%s`, expect `,` between macro arguments", next->value);
+                throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%.*s`, expect `,` between macro arguments", TOKEN_VALUE(next));
         }
 
         if(next->type != TOKEN_RPAREN)
-            throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%s`, expect `)` after macro arguments", next->value);
+            throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%.*s`, expect `)` after macro arguments", TOKEN_VALUE(next));
 
         next = pp->tokens->items[(*i)++];
     }
 
     if(next->type != TOKEN_LBRACE)
-        throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%s`, expect `{` to begin the macro body", next->value);
+        throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%.*s`, expect `{` to begin the macro body", TOKEN_VALUE(next));
 
     size_t depth = 0;
     for(next = pp->tokens->items[(*i)++]; next->type != TOKEN_EOF; next = pp->tokens->items[(*i)++])
@@ -296,7 +411,7 @@ static Macro_T* parse_macro_def(Preprocessor_T* pp, size_t* i)
     }
 
     if(next->type != TOKEN_RBRACE)
-        throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%s`, expect `}` to end the macro body", next->value);
+        throw_error(pp->context, ERR_SYNTAX_ERROR, next, "unexpected token `%.*s`, expect `}` to end the macro body", TOKEN_VALUE(next));
 
     Macro_T* found = find_macro(pp, macro->tok->value, macro->argc);
     if(found && found->tok)
@@ -309,21 +424,32 @@ static Macro_T* parse_macro_def(Preprocessor_T* pp, size_t* i)
 
 static Macro_T* find_macro(Preprocessor_T* pp, char* callee, u8 argc)
 {
-    for(size_t i = 0; i < pp->macros->size; i++)
-    {
-        Macro_T* mac = (Macro_T*) pp->macros->items[i];
-        if(strcmp(mac->tok->value, callee) == 0 && mac->argc == argc)
+    for(Macro_T* mac = hashmap_get(pp->macro_index, callee); mac; mac = mac->next_overload)
+        if(mac->argc == argc)
             return mac;
-    }
     return NULL;
 }
 
+static void register_macro(Preprocessor_T* pp, Macro_T* macro)
+{
+    list_push(pp->macros, macro);
+
+    Macro_T* overloads = hashmap_get(pp->macro_index, macro->tok->value);
+    if(overloads)
+    {
+        macro->next_overload = overloads->next_overload;
+        overloads->next_overload = macro;
+    }
+    else
+        hashmap_put(pp->macro_index, macro->tok->value, macro);
+}
+
 static int find_macro_arg(Macro_T* mac, char* callee)
 {
     for(uint8_t i = 0; i < mac->argc; i++)
     {
         Token_T* tok = mac->args[i];
-        if(tok && strcmp(tok->value, callee) == 0)
+        if(tok && tok->value == callee)
             return i;
     }
     return -1;
@@ -479,16 +605,21 @@ static void expand_macro_call(Preprocessor_T* pp, MacroCall_T call, List_T* src_
         ){
             Token_T* current = dest_list->items[dest_list->size - 1];
             if(!concatenateable(current)) {
-                throw_error(pp->context, ERR_SYNTAX_ERROR, current, "cannot concatenate token `%s` to identifier using `@`", current->value);
+                throw_error(pp->context, ERR_SYNTAX_ERROR, current, "cannot concatenate token `%.*s` to identifier using `@`", TOKEN_VALUE(current));
                 continue;
             }
 
             list_pop(dest_list);
             list_pop(dest_list);
 
-            u64 prev_size = sizeof(Token_T) + strlen(id->value) * sizeof(char);
-            dest_list->items[dest_list->size - 1] = id = allocator_realloc(&pp->context->raw_allocator, id, prev_size + (strlen(current->value) + 1) * sizeof(char));
-            strcat(id->value, current->value);
+            // build a new token, `id` may still be referenced by the macro body
+            char* value = calloc(strlen(id->value) + strlen(current->value) + 1, sizeof(char));
+            strcat(strcpy(value, id->value), current->value);
+
+            Token_T* concatenated = init_id_token(pp->context, value, id->line, id->pos, id->source);
+            concatenated->in_macro_expansion = id->in_macro_expansion;
+            dest_list->items[dest_list->size - 1] = concatenated;
+            free(value);
         }
     }
 }
@@ -511,17 +642,22 @@ i32 preprocessor_pass(Context_T* context, ASTProg_T* ast)
     Token_T* eof = list_pop(ast->tokens);
     Token_T* tok;
 
-    for(size_t i = 0; i < pp.tokens->size; i++)
-    {
-        tok = pp.tokens->items[i];
-        if(tok->type == TOKEN_IMPORT)
-            parse_import_def(&pp, pp.tokens, &i);
-    }
+    // imported files are added to the end as soon as all tokens before were scanned,
+    // which keeps their order independent of how many threads are used
+    size_t i = 0;
+    do {
+        for(; i < pp.tokens->size; i++)
+        {
+            tok = pp.tokens->items[i];
+            if(tok->type == TOKEN_IMPORT)
+                parse_import_def(&pp, pp.tokens, &i);
+        }
+    } while(add_next_import(&pp));
 
     push_tok(&pp, eof);
 
     timer_stop(context);
-    timer_start(context, "preprocessing");
+    timer_start(context, "parsing macros");
 
     /***************************************
     * Stage 2: parse macro definitions     *
@@ -533,13 +669,16 @@ i32 preprocessor_pass(Context_T* context, ASTProg_T* ast)
         tok = pp.tokens->items[i];
         if(tok->type == TOKEN_MACRO)
         {
-            list_push(pp.macros, parse_macro_def(&pp, &i));
+            register_macro(&pp, parse_macro_def(&pp, &i));
             continue;
         }
         list_push(token_stage_2, tok);
         i++;
     }
 
+    timer_stop(context);
+    timer_start(context, "expanding macros");
+
     /**************************************
     * Stage 3: expand all macro calls     *
     **************************************/
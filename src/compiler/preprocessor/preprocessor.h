@@ -14,6 +14,8 @@ typedef struct MACRO_STRUCT
     u8 argc;
     Token_T* args[__CSP_MAX_FN_NUM_ARGS];
     bool used : 1;
+
+    struct MACRO_STRUCT* next_overload; // next macro with the same name, but a different argc
 } __attribute__((packed)) Macro_T;
 
 i32 preprocessor_pass(Context_T* context, ASTProg_T* ast);
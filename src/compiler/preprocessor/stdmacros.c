@@ -65,7 +65,7 @@ void define_std_macros(Context_T* context, List_T *macro_list)
 {
     for(i32 i = 0; macros[i].id; i++)
     {
-        Token_T* main_token = init_token(&context->raw_allocator, (char*) macros[i].id, 0, 0, TOKEN_ID, NULL);
+        Token_T* main_token = init_id_token(context, macros[i].id, 0, 0, NULL);
         Macro_T* macro = init_macro(main_token);
 
         Token_T* replacement_token;
@@ -75,7 +75,7 @@ void define_std_macros(Context_T* context, List_T *macro_list)
                 replacement_token = init_token(&context->raw_allocator, (char*) macros[i].value, 0, 0, TOKEN_INT, NULL);
                 break;
             case ID:
-                replacement_token = init_token(&context->raw_allocator, (char*) macros[i].value, 0, 0, TOKEN_ID, NULL);
+                replacement_token = init_id_token(context, macros[i].value, 0, 0, NULL);
                 break;
             case STRING:
                 replacement_token = init_token(&context->raw_allocator, (char*) macros[i].value, 0, 0, TOKEN_STRING, NULL);
@@ -0,0 +1,103 @@
+#include "thread_pool.h"
+#include "config.h"
+#include "io/log.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+static void* thread_pool_worker(void* arg)
+{
+    ThreadPool_T* pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for(;;)
+    {
+        while(!pool->first && !pool->shutdown)
+            pthread_cond_wait(&pool->job_available, &pool->lock);
+
+        // finish the queue before shutting down
+        if(!pool->first)
+            break;
+
+        ThreadPoolJob_T* job = pool->first;
+        if(!(pool->first = job->next))
+            pool->last = NULL;
+
+        pthread_mutex_unlock(&pool->lock);
+        job->func(job->arg);
+        pthread_mutex_lock(&pool->lock);
+
+        job->done = true;
+        pthread_cond_broadcast(&pool->job_done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+void init_thread_pool(ThreadPool_T* pool, size_t num_threads)
+{
+    memset(pool, 0, sizeof(ThreadPool_T));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->job_available, NULL);
+    pthread_cond_init(&pool->job_done, NULL);
+
+    pool->threads = calloc(num_threads, sizeof(pthread_t));
+    for(; pool->num_threads < num_threads; pool->num_threads++)
+    {
+        if(pthread_create(&pool->threads[pool->num_threads], NULL, thread_pool_worker, pool))
+        {
+            LOG_ERROR_F(COLOR_BOLD_RED "[Error]" COLOR_RESET COLOR_RED " could not create worker thread: %s\n", strerror(errno));
+            exit(1);
+        }
+    }
+}
+
+void free_thread_pool(ThreadPool_T* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->job_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(size_t i = 0; i < pool->num_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+    free(pool->threads);
+
+    pthread_cond_destroy(&pool->job_done);
+    pthread_cond_destroy(&pool->job_available);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+void init_thread_pool_job(ThreadPoolJob_T* job, void (*func)(void*), void* arg)
+{
+    job->func = func;
+    job->arg = arg;
+    job->next = NULL;
+    job->done = false;
+}
+
+void thread_pool_submit(ThreadPool_T* pool, ThreadPoolJob_T* job)
+{
+    pthread_mutex_lock(&pool->lock);
+    job->next = NULL;
+    job->done = false;
+
+    if(pool->last)
+        pool->last->next = job;
+    else
+        pool->first = job;
+    pool->last = job;
+
+    pthread_cond_signal(&pool->job_available);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_await(ThreadPool_T* pool, ThreadPoolJob_T* job)
+{
+    pthread_mutex_lock(&pool->lock);
+    while(!job->done)
+        pthread_cond_wait(&pool->job_done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
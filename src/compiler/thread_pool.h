@@ -0,0 +1,40 @@
+#ifndef CSPYDR_THREAD_POOL_H
+#define CSPYDR_THREAD_POOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// Jobs are owned by the caller and have to stay alive until they were awaited.
+// Jobs run in submission order, but may finish in any order.
+
+typedef struct THREAD_POOL_JOB_STRUCT {
+    void (*func)(void*);
+    void* arg;
+
+    struct THREAD_POOL_JOB_STRUCT* next;
+    bool done;
+} ThreadPoolJob_T;
+
+typedef struct THREAD_POOL_STRUCT {
+    pthread_t* threads;
+    size_t num_threads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t job_available;
+    pthread_cond_t job_done;
+
+    ThreadPoolJob_T* first;
+    ThreadPoolJob_T* last;
+
+    bool shutdown;
+} ThreadPool_T;
+
+void init_thread_pool(ThreadPool_T* pool, size_t num_threads);
+void free_thread_pool(ThreadPool_T* pool);
+
+void init_thread_pool_job(ThreadPoolJob_T* job, void (*func)(void*), void* arg);
+void thread_pool_submit(ThreadPool_T* pool, ThreadPoolJob_T* job);
+void thread_pool_await(ThreadPool_T* pool, ThreadPoolJob_T* job);
+
+#endif
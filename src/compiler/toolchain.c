@@ -34,6 +34,7 @@ static i32 construct_passes(Context_T* context, Pass_T passes[])
 
     if(context->flags.optimize)
         push_pass(optimizer_pass);
+    push_pass(tail_call_pass);
     
     switch(context->ct)
     {
@@ -41,6 +42,8 @@ static i32 construct_passes(Context_T* context, Pass_T passes[])
             push_pass(transpiler_pass);
             break;
         case CT_ASM:
+            if(context->flags.optimize)
+                push_pass(ir_pass);
             push_pass(asm_codegen_pass);
             break;
         case CT_TO_JSON:
@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+
+# compares the runtime of loops.csp with and without the loop optimizations
+# usage: ./loops.sh [cspc] [runs] [cspc flags...]
+
+SCRIPT_DIR=$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )
+
+set -e
+
+CSPC="${1:-cspc}"
+RUNS="${2:-5}"
+shift 2 || shift $#
+
+BUILD_DIR=$(mktemp -d)
+trap 'rm -rf "$BUILD_DIR"' EXIT
+
+"$CSPC" build "$SCRIPT_DIR/loops.csp" --silent -o "$BUILD_DIR/optimized" "$@"
+"$CSPC" build "$SCRIPT_DIR/loops.csp" --silent -o "$BUILD_DIR/unoptimized" --no-loop-opt "$@"
+
+if [ ! -x "$BUILD_DIR/optimized" ] || [ ! -x "$BUILD_DIR/unoptimized" ];
+then
+    echo "Could not build the benchmark."
+    exit 1
+fi
+
+if [ "$("$BUILD_DIR/optimized")" != "$("$BUILD_DIR/unoptimized")" ];
+then
+    echo "Outputs of the optimized and unoptimized benchmark differ."
+    exit 1
+fi
+
+# prints the fastest of $RUNS runs in milliseconds
+measure() {
+    local best=""
+    for ((i = 0; i < RUNS; i++));
+    do
+        local start=$(date +%s%N)
+        "$1" > /dev/null
+        local time=$(( ($(date +%s%N) - start) / 1000000 ))
+        if [ -z "$best" ] || [ "$time" -lt "$best" ];
+        then
+            best=$time
+        fi
+    done
+    echo "$best"
+}
+
+OPTIMIZED=$(measure "$BUILD_DIR/optimized")
+UNOPTIMIZED=$(measure "$BUILD_DIR/unoptimized")
+
+echo "with loop optimizations:    $OPTIMIZED ms"
+echo "without loop optimizations: $UNOPTIMIZED ms"
@@ -0,0 +1,120 @@
+#define ALLOCATOR_TESTS                                  \
+    {"region allocation", test_region_malloc},           \
+    {"region reallocation", test_region_realloc},        \
+    {"region adoption", test_region_adopt}
+
+#include <memory/allocator.h>
+#include <config.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+static bool is_zeroed(const char* ptr, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+        if(ptr[i])
+            return false;
+    return true;
+}
+
+void test_region_malloc(void)
+{
+    Allocator_T alloc;
+    init_region_allocator(&alloc);
+
+    char* a = allocator_malloc(&alloc, 3);
+    char* b = allocator_malloc(&alloc, 17);
+    TEST_ASSERT(a != NULL && b != NULL);
+    TEST_CHECK(a != b);
+    TEST_CHECK((uintptr_t) a % _Alignof(max_align_t) == 0);
+    TEST_CHECK((uintptr_t) b % _Alignof(max_align_t) == 0);
+    TEST_CHECK(is_zeroed(a, 3) && is_zeroed(b, 17));
+
+    // allocations larger than a chunk get one of their own
+    char* huge = allocator_malloc(&alloc, ALLOCATOR_CHUNK_SIZE * 2);
+    TEST_ASSERT(huge != NULL);
+    TEST_CHECK(is_zeroed(huge, ALLOCATOR_CHUNK_SIZE * 2));
+    memset(huge, 1, ALLOCATOR_CHUNK_SIZE * 2);
+
+    // ...and the current chunk stays in use
+    char* c = allocator_malloc(&alloc, 8);
+    TEST_CHECK(c > b && c < b + ALLOCATOR_CHUNK_SIZE);
+
+    // pushed pointers get freed together with the region
+    allocator_push(&alloc, malloc(16));
+
+    free_allocator(&alloc);
+    TEST_CHECK(alloc.chunks == NULL && alloc.pointers == NULL);
+}
+
+void test_region_realloc(void)
+{
+    Allocator_T alloc;
+    init_region_allocator(&alloc);
+
+    // realloc(NULL) allocates
+    char* a = allocator_realloc(&alloc, NULL, 4);
+    TEST_ASSERT(a != NULL);
+    memcpy(a, "abc", 4);
+
+    // the latest allocation grows in place
+    char* grown = allocator_realloc(&alloc, a, 64);
+    TEST_CHECK(grown == a);
+    TEST_CHECK(strcmp(grown, "abc") == 0);
+    TEST_CHECK(is_zeroed(grown + 4, 60));
+
+    // shrinking clears the released memory for the next allocation
+    memset(grown, 'x', 64);
+    char* shrunk = allocator_realloc(&alloc, grown, 2);
+    TEST_CHECK(shrunk == a);
+    char* b = allocator_malloc(&alloc, 32);
+    TEST_CHECK(b < a + 64);
+    TEST_CHECK(is_zeroed(b, 32));
+
+    // if the chunk is full, the allocation moves
+    memcpy(b, "hello", 6);
+    char* moved = allocator_realloc(&alloc, b, ALLOCATOR_CHUNK_SIZE);
+    TEST_ASSERT(moved != NULL);
+    TEST_CHECK(moved != b);
+    TEST_CHECK(strcmp(moved, "hello") == 0);
+    TEST_CHECK(is_zeroed(moved + 6, ALLOCATOR_CHUNK_SIZE - 6));
+    TEST_CHECK(strncmp(a, "xx", 2) == 0);
+
+    free_allocator(&alloc);
+}
+
+void test_region_adopt(void)
+{
+    Allocator_T alloc, other;
+    init_region_allocator(&alloc);
+    init_region_allocator(&other);
+
+    char* a = allocator_malloc(&alloc, 8);
+    memcpy(a, "alloc", 6);
+
+    char* b = allocator_malloc(&other, 8);
+    memcpy(b, "other", 6);
+    char* huge = allocator_malloc(&other, ALLOCATOR_CHUNK_SIZE * 2);
+    allocator_push(&other, malloc(16));
+
+    allocator_adopt(&alloc, &other);
+    TEST_CHECK(other.chunks == NULL && other.pointers == NULL && other.last == NULL);
+    TEST_CHECK(alloc.pointers != NULL && alloc.pointers->size == 1);
+    TEST_CHECK(strcmp(a, "alloc") == 0 && strcmp(b, "other") == 0);
+    memset(huge, 1, ALLOCATOR_CHUNK_SIZE * 2);
+
+    // the latest allocation of `alloc` can still be resized in place
+    TEST_CHECK(allocator_realloc(&alloc, a, 32) == a);
+    TEST_CHECK(strcmp(a, "alloc") == 0);
+
+    // adopting into an empty region takes over all chunks
+    Allocator_T empty;
+    init_region_allocator(&empty);
+    allocator_adopt(&empty, &alloc);
+    TEST_CHECK(alloc.chunks == NULL && alloc.pointers == NULL);
+    TEST_CHECK(strcmp(a, "alloc") == 0 && strcmp(b, "other") == 0);
+
+    free_allocator(&alloc);
+    free_allocator(&other);
+    free_allocator(&empty);
+}
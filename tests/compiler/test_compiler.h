@@ -69,26 +69,33 @@ static void test_file(const char* filename)
     char buf[BUFSIZ] = {};
     sprintf(buf, COMPILER_TEST_DIR "/%s", filename);
 
+    char first_line[BUFSIZ] = {};
+    char flags[BUFSIZ] = {};
+    i32 exit_code = 255;
+
+    FILE* fptr = fopen(buf, "r");
+    if(!fptr) 
+        goto error;
+    fscanf(fptr, "%[^\n]\n# flags: %[^\n]", first_line, flags);
+    fclose(fptr);
+
+    bool test_expected = strcmp(first_line, "# failure") == 0 ? 1 : 0;
+
     const char output_name[] = "a.out"; 
 
-    char* const args[] = {
+    char* args[BUFSIZ / 2] = {
         COMPILER_EXECUTABLE,
         "build",
         buf,
         "--silent",
         "-o",
         (char*) output_name,
-        NULL
     };
-    i32 exit_code = subprocess(COMPILER_EXECUTABLE, args, false);
-
-    FILE* fptr = fopen(buf, "r");
-    if(!fptr) 
-        goto error;
-    fscanf(fptr, "%[^\n]", buf);
-    fclose(fptr);
+    size_t num_args = 6;
+    for(char* flag = strtok(flags, " "); flag; flag = strtok(NULL, " "))
+        args[num_args++] = flag;
 
-    bool test_expected = strcmp(buf, "# failure") == 0 ? 1 : 0;
+    exit_code = subprocess(COMPILER_EXECUTABLE, args, false);
 
     if(exit_code && !test_expected)
     {
@@ -0,0 +1,91 @@
+#define INTERNER_TESTS                         \
+    {"intern()", test_intern},                 \
+    {"intern_n()", test_intern_n},             \
+    {"interner_grow()", test_interner_grow},   \
+    {"hashmap_init_interned()", test_hashmap_interned}
+
+#include <interner.h>
+#include <hashmap.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+void test_intern(void)
+{
+    Interner_T interner;
+    init_interner(&interner);
+
+    char buffer[] = "hello";
+    char* a = intern(&interner, "hello");
+    char* b = intern(&interner, buffer);
+    char* c = intern(&interner, "world");
+
+    TEST_ASSERT(a != NULL);
+    TEST_CHECK(a == b);
+    TEST_CHECK(a != c);
+    TEST_CHECK(a != buffer);
+    TEST_CHECK(strcmp(a, "hello") == 0);
+    TEST_CHECK(interned_length(a) == strlen("hello"));
+    TEST_CHECK(interned_hash(a) == interned_hash(b));
+
+    free_interner(&interner);
+}
+
+void test_intern_n(void)
+{
+    Interner_T interner;
+    init_interner(&interner);
+
+    char* a = intern_n(&interner, "hello world", 5);
+    TEST_ASSERT(a != NULL);
+    TEST_CHECK(strcmp(a, "hello") == 0);
+    TEST_CHECK(a == intern(&interner, "hello"));
+    TEST_CHECK(intern_n(&interner, "", 0) != a);
+
+    free_interner(&interner);
+}
+
+void test_interner_grow(void)
+{
+    Interner_T interner;
+    init_interner(&interner);
+
+    char* interned[4096];
+    for(int i = 0; i < 4096; i++)
+    {
+        char str[16];
+        sprintf(str, "id_%d", i);
+        interned[i] = intern(&interner, str);
+    }
+
+    for(int i = 0; i < 4096; i++)
+    {
+        char str[16];
+        sprintf(str, "id_%d", i);
+        TEST_CHECK(intern(&interner, str) == interned[i]);
+    }
+
+    free_interner(&interner);
+}
+
+void test_hashmap_interned(void)
+{
+    Interner_T interner;
+    init_interner(&interner);
+
+    HashMap_T* map = hashmap_init_interned();
+    TEST_ASSERT(map != NULL);
+
+    TEST_CHECK(hashmap_put(map, intern(&interner, "1"), "one") == 0);
+    TEST_CHECK(hashmap_put(map, intern(&interner, "2"), "two") == 0);
+    TEST_CHECK(hashmap_put(map, intern(&interner, "1"), "uno") == EEXIST);
+
+    char* val = hashmap_get(map, intern(&interner, "2"));
+    TEST_ASSERT(val != NULL);
+    TEST_CHECK(strcmp(val, "two") == 0);
+    TEST_CHECK(hashmap_get(map, intern(&interner, "3")) == NULL);
+
+    hashmap_free(map);
+    free_interner(&interner);
+}
@@ -5,18 +5,26 @@
     {"lexing strings", test_lexer_strings},     \
     {"lexing numbers", test_lexer_numbers},     \
     {"lexing ids", test_lexer_ids},             \
-    {"lexing keywords", test_lexer_keywords}
+    {"lexing keywords", test_lexer_keywords},   \
+    {"detached lexing", test_lexer_detached},   \
+    {"token cache", test_token_cache}
 
 #include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 #include "lexer/token.h"
 #include "lexer/lexer.h"
+#include "lexer/token_cache.h"
+#include "io/io.h"
+#include "platform/platform_bindings.h"
 
 #ifndef LEN
 #define LEN(arr) (sizeof(arr) / sizeof(*arr))
 #endif
 
-void check_tokens_str(char** expected_tokens, File_T* file, int num_tokens, bool heap_value)
+// `in_source`: the values point into the source buffer instead of being copied
+void check_tokens_str(char** expected_tokens, File_T* file, int num_tokens, bool in_source)
 {
     Context_T context;
     init_context(&context);
@@ -27,15 +35,12 @@ void check_tokens_str(char** expected_tokens, File_T* file, int num_tokens, bool
     {
         Token_T* token =  lexer_next_token(&lexer);
 
-        if(heap_value)
+        if(in_source)
         {
             TEST_CHECK(token->value != NULL);
-            TEST_CHECK(strcmp(token->value, expected_tokens[i]) == 0);
-        }
-        else
-        {
-            TEST_CHECK(strcmp(token->value, expected_tokens[i]) == 0);
+            TEST_CHECK(token->value > file->buffer && token->value < file->buffer + file->size);
         }
+        TEST_CHECK(token_value_is(token, expected_tokens[i]));
     }
 }
 
@@ -130,6 +135,8 @@ void test_lexer_strings(void)
     };
 
     check_tokens_str(expected_tokens, file, LEN(expected_tokens), true);
+    // the values are slices, the source stays untouched
+    TEST_CHECK(strcmp(file->buffer, "\"hello\"\n\"\nworld\n\"\n") == 0);
 }
 
 void test_lexer_numbers(void)
@@ -158,7 +165,7 @@ void test_lexer_ids(void)
 
 void test_lexer_keywords(void)
 {
-    File_T* file = get_file(1, "true false nil let fn loop while for if else ret match type struct union enum import const extern macro namespace sizeof typeof alignof break continue noop len asm using with");
+    File_T* file = get_file(1, "true false nil let fn loop while for if else ret match type struct union enum import const extern macro namespace sizeof typeof alignof break continue noop len asm using with defer do embed interface operator unless types iff tru withs");
     TEST_ASSERT(file != NULL);
 
     TokenType_T expected_tokens[] = {
@@ -192,8 +199,140 @@ void test_lexer_keywords(void)
         TOKEN_LEN,
         TOKEN_ASM,
         TOKEN_USING,
-        TOKEN_WITH
+        TOKEN_WITH,
+        TOKEN_DEFER,
+        TOKEN_DO,
+        TOKEN_EMBED,
+        TOKEN_INTERFACE,
+        TOKEN_OPERATOR_KW,
+        TOKEN_UNLESS,
+        TOKEN_ID, // identifiers close to keywords
+        TOKEN_ID,
+        TOKEN_ID,
+        TOKEN_ID
     };
 
     check_tokens(expected_tokens, file, LEN(expected_tokens));
 }
+
+
+void test_lexer_detached(void)
+{
+    Context_T context;
+    init_context(&context);
+    Allocator_T allocator;
+    init_region_allocator(&allocator);
+    Exception_T bail;
+
+    File_T* file = get_file(1, "foo bar! foo");
+    Lexer_T lexer;
+    init_lexer(&lexer, &context, file);
+    lexer.allocator = &allocator;
+    lexer.detached = &bail;
+
+    Token_T* tokens[3];
+    for(int i = 0; i < 3; i++)
+        tokens[i] = lexer_next_token(&lexer);
+    free_lexer(&lexer);
+
+    // identifiers get interned later on
+    TEST_CHECK(tokens[0]->value == file->buffer && tokens[0]->length == 3);
+    for(int i = 0; i < 3; i++)
+        lexer_intern(&context, tokens[i]);
+    TEST_CHECK(tokens[0]->type == TOKEN_ID && strcmp(tokens[0]->value, "foo") == 0);
+    TEST_CHECK(tokens[1]->type == TOKEN_MACRO_CALL && strcmp(tokens[1]->value, "bar") == 0);
+    TEST_CHECK(tokens[0]->value == tokens[2]->value);
+    TEST_CHECK(init_id_token(&context, "foo", 0, 0, NULL)->value == tokens[0]->value);
+
+    // errors jump back instead of being reported
+    bool bailed = false;
+    init_lexer(&lexer, &context, get_file(1, "\"unterminated"));
+    lexer.allocator = &allocator;
+    lexer.detached = &bail;
+    try(bail)
+        lexer_next_token(&lexer);
+    catch
+        bailed = true;
+    free_lexer(&lexer);
+
+    TEST_CHECK(bailed);
+    TEST_CHECK(context.emitted_errors == 0);
+
+    free_allocator(&allocator);
+}
+
+void test_token_cache(void)
+{
+    // the cache lives in $HOME, keep it away from the real one
+    char home[] = "/tmp/cspydr-token-cache-XXXXXX";
+    TEST_ASSERT(mkdtemp(home) != NULL);
+    char* real_home = getenv("HOME");
+    if(real_home)
+        real_home = strdup(real_home);
+    setenv("HOME", home, 1);
+    char cache_parent[BUFSIZ];
+    sprintf(cache_parent, "%s/.cache", home);
+    TEST_CHECK(make_dir(cache_parent) == 0);
+
+    Context_T context;
+    init_context(&context);
+
+    File_T* file = get_file(1, "fn foo(): i32 { <- 0x10 + bar!(\"str\"); } # comment");
+    Lexer_T lexer;
+    init_lexer(&lexer, &context, file);
+
+    List_T* lexed = init_list();
+    Token_T* tok;
+    for(tok = lexer_next_token(&lexer); tok->type != TOKEN_EOF; tok = lexer_next_token(&lexer))
+        list_push(lexed, tok);
+    cache_tokens(file, (Token_T**) lexed->items, lexed->size);
+
+    List_T* cached = init_list();
+    TEST_ASSERT(load_cached_tokens(&lexer, cached));
+    TEST_ASSERT(cached->size == lexed->size);
+    for(size_t i = 0; i < lexed->size; i++)
+    {
+        Token_T* a = lexed->items[i];
+        Token_T* b = cached->items[i];
+        TEST_CHECK(a->type == b->type && a->line == b->line && a->pos == b->pos);
+        TEST_CHECK(a->length == b->length && strncmp(a->value, b->value, a->length) == 0);
+        if(token_is_interned(a->type))
+            TEST_CHECK(a->value == b->value);
+    }
+
+    // a still valid entry does not get rewritten
+    char cache_dir[BUFSIZ];
+    strcat(get_cache_dir(cache_dir), DIRECTORY_DELIMS TOKEN_CACHE_DIR);
+    DIR* dir = opendir(cache_dir);
+    TEST_ASSERT(dir != NULL);
+    struct dirent* entry;
+    while((entry = readdir(dir)) && entry->d_name[0] == '.');
+    TEST_ASSERT(entry != NULL);
+    char entry_path[BUFSIZ * 2];
+    sprintf(entry_path, "%s" DIRECTORY_DELIMS "%s", cache_dir, entry->d_name);
+    closedir(dir);
+
+    struct stat before, after;
+    TEST_ASSERT(stat(entry_path, &before) == 0);
+    cache_tokens(file, (Token_T**) lexed->items, lexed->size);
+    TEST_ASSERT(stat(entry_path, &after) == 0);
+    TEST_CHECK(before.st_ino == after.st_ino);
+
+    // a different content must not hit the cache
+    File_T* changed = get_file(1, "fn foo(): i32 { <- 0x11 + bar!(\"str\"); } # comment");
+    changed->path = file->path;
+    free_lexer(&lexer);
+    init_lexer(&lexer, &context, changed);
+    TEST_CHECK(!load_cached_tokens(&lexer, cached));
+
+    free_lexer(&lexer);
+    free_list(lexed);
+    free_list(cached);
+
+    if(real_home)
+        setenv("HOME", real_home, 1);
+    else
+        unsetenv("HOME");
+    free(real_home);
+    TEST_CHECK(remove_directory(home) == 0);
+}
\ No newline at end of file
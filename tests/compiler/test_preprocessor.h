@@ -1,7 +1,8 @@
 #include "context.h"
 #define PREPROCESSOR_TESTS  {"preprocessing simple file", test_preprocessing_simple_file}, \
                             {"preprocessing simple macro", test_processing_simple_macro},  \
-                            {"preprocessing two macros", test_preprocessing_two_macros}
+                            {"preprocessing two macros", test_preprocessing_two_macros}, \
+                            {"preprocessing macro overloads", test_preprocessing_macro_overloads}
 
 #include "lexer/token.h"
 #include "parser/parser.h"
@@ -49,3 +50,13 @@ PREPROCESSOR_TEST_FUNC(test_preprocessing_two_macros, "macro foo { bar } \nmacro
     TEST_ASSERT(((Token_T*) tokens->items[1])->type == TOKEN_ID);
     TEST_ASSERT(((Token_T*) tokens->items[2])->type == TOKEN_EOF);
 )
+
+
+PREPROCESSOR_TEST_FUNC(test_preprocessing_macro_overloads, "macro foo { 1 } macro foo(a) { a a } foo!(x) foo!",
+    TEST_ASSERT(tokens->size == 4);
+
+    TEST_ASSERT(((Token_T*) tokens->items[0])->type == TOKEN_ID);
+    TEST_ASSERT(((Token_T*) tokens->items[1])->type == TOKEN_ID);
+    TEST_ASSERT(((Token_T*) tokens->items[2])->type == TOKEN_INT);
+    TEST_ASSERT(((Token_T*) tokens->items[3])->type == TOKEN_EOF);
+)
\ No newline at end of file
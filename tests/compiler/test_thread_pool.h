@@ -0,0 +1,36 @@
+#define THREAD_POOL_TESTS \
+    {"thread pool jobs", test_thread_pool_jobs}
+
+#include <thread_pool.h>
+
+#define TEST_NUM_JOBS 64
+
+static void test_thread_pool_job(void* arg)
+{
+    int* value = arg;
+    *value = *value * 2 + 1;
+}
+
+void test_thread_pool_jobs(void)
+{
+    ThreadPool_T pool;
+    init_thread_pool(&pool, 4);
+
+    ThreadPoolJob_T jobs[TEST_NUM_JOBS];
+    int values[TEST_NUM_JOBS];
+    for(int i = 0; i < TEST_NUM_JOBS; i++)
+    {
+        values[i] = i;
+        init_thread_pool_job(&jobs[i], test_thread_pool_job, &values[i]);
+        thread_pool_submit(&pool, &jobs[i]);
+    }
+
+    // await in reverse order, jobs may finish in any order
+    for(int i = TEST_NUM_JOBS - 1; i >= 0; i--)
+    {
+        thread_pool_await(&pool, &jobs[i]);
+        TEST_CHECK(values[i] == i * 2 + 1);
+    }
+
+    free_thread_pool(&pool);
+}
@@ -0,0 +1,103 @@
+#include "ast/ast.h"
+#include "context.h"
+#include "passes.h"
+#include "parser/queue.h"
+#define VALIDATOR_TESTS                                                            \
+    {"resolve queue", test_resolve_queue},                                         \
+    {"resolving namespace and enum members", test_resolve_members},                \
+    {"resolve queue with 50k objects", test_resolve_queue_many_objects}
+
+#include <stdio.h>
+#include <string.h>
+
+#define RESOLVE_QUEUE_MANY_OBJS 50000
+
+void test_resolve_queue(void)
+{
+    ASTObj_T objs[1000];
+    memset(objs, 0, sizeof(objs));
+
+    ResolveQueue_T queue;
+    resolve_queue_init(&queue);
+    TEST_CHECK(resolve_queue_last(&queue) == NULL);
+
+    for(size_t i = 0; i < LEN(objs); i++)
+        resolve_queue_push(&queue, &objs[i], i % 2 ? RESOLVE_DEEP : RESOLVE_SHALLOW);
+    resolve_queue_push(&queue, &objs[0], RESOLVE_DEEP);
+
+    TEST_ASSERT(queue.size == LEN(objs) + 1);
+    for(size_t i = 0; i < LEN(objs); i++)
+        TEST_CHECK(queue.nodes[i].obj == &objs[i]);
+
+    TEST_CHECK(resolve_queue_last(&queue)->obj == &objs[0]);
+    TEST_CHECK(resolve_queue_last(&queue)->method == RESOLVE_DEEP);
+
+    TEST_CHECK(resolve_queue_contains(&queue, &objs[0], RESOLVE_DEEP));
+    TEST_CHECK(resolve_queue_contains(&queue, &objs[1], RESOLVE_DEEP));
+    TEST_CHECK(!resolve_queue_contains(&queue, &objs[2], RESOLVE_DEEP));
+    TEST_CHECK(resolve_queue_contains(&queue, &objs[2], RESOLVE_ANYHOW));
+
+    ASTObj_T other = {0};
+    TEST_CHECK(!resolve_queue_contains(&queue, &other, RESOLVE_ANYHOW));
+
+    resolve_queue_free(&queue);
+}
+
+// both the namespace and the enum are large enough to get a member index
+void test_resolve_members(void)
+{
+    Context_T context;
+    init_context(&context);
+    context.flags.silent = true;
+
+    ASTProg_T prog = {0};
+    initialization_pass(&context, &prog);
+    list_push(prog.files, get_file(6,
+        "namespace ns { fn a(): i32 { <- 1; } fn b(): i32 { <- 2; } fn c(): i32 { <- 3; } fn d(): i32 { <- 4; } fn e(): i32 { <- 5; }\n",
+        "fn f(): i32 { <- 6; } fn g(): i32 { <- 7; } fn h(): i32 { <- 8; } fn i(): i32 { <- 9; } fn j(): i32 { <- 10; } }\n",
+        "type E: enum { A, B, C, D, E, F, G, H, I, J };\n",
+        "fn main(): i32 {\n",
+        "    <- ns::j() + ns::a() + (E::J: i32) + (E::A: i32);\n",
+        "}\n"
+    ));
+    lexer_pass(&context, &prog);
+    preprocessor_pass(&context, &prog);
+    parser_pass(&context, &prog);
+    TEST_CHECK(validator_pass(&context, &prog) == 0);
+    TEST_CHECK(context.emitted_errors == 0);
+
+    ASTObj_T* ns = prog.objs->items[0];
+    TEST_ASSERT(ns->kind == OBJ_NAMESPACE);
+    TEST_CHECK(ns->member_index != NULL);
+    TEST_CHECK(hashmap_get(ns->member_index, intern(&context.interner, "j")) == ns->objs->items[9]);
+    TEST_CHECK(hashmap_get(ns->member_index, intern(&context.interner, "k")) == NULL);
+}
+
+// every function depends on the previous one and on a global, so the
+// resolve queue holds one entry per object; the quadratic queue took tens of seconds here
+void test_resolve_queue_many_objects(void)
+{
+    size_t size = 0, allocated = RESOLVE_QUEUE_MANY_OBJS * 64;
+    char* buffer = malloc(allocated * sizeof(char));
+
+    size += sprintf(buffer, "let g_0: i32 = 0;\nfn f_0(): i32 { <- g_0; }\n");
+    for(size_t i = 1; i < RESOLVE_QUEUE_MANY_OBJS / 2; i++)
+        size += sprintf(buffer + size, "let g_%zu: i32 = %zu;\nfn f_%zu(): i32 { <- f_%zu() + g_%zu; }\n", i, i, i, i - 1, i);
+    size += sprintf(buffer + size, "fn main(): i32 { <- f_%d(); }\n", RESOLVE_QUEUE_MANY_OBJS / 2 - 1);
+    TEST_ASSERT(size < allocated);
+
+    Context_T context;
+    init_context(&context);
+    context.flags.silent = true;
+
+    ASTProg_T prog = {0};
+    initialization_pass(&context, &prog);
+    list_push(prog.files, init_file(buffer, size, "generated"));
+    lexer_pass(&context, &prog);
+    preprocessor_pass(&context, &prog);
+    parser_pass(&context, &prog);
+    TEST_ASSERT(prog.objs->size == RESOLVE_QUEUE_MANY_OBJS + 1);
+
+    TEST_CHECK(validator_pass(&context, &prog) == 0);
+    TEST_CHECK(context.emitted_errors == 0);
+}
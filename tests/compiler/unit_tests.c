@@ -5,48 +5,69 @@
 #include "parser/parser.h"
 #include "passes.h"
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 
 static File_T* get_file(int num_lines, ...) 
 {
-    List_T* lines = init_list();
+    size_t size = 0;
+    char* buffer = calloc(1, sizeof(char));
     va_list va;
 
     va_start(va, num_lines);
     for(int i = 0; i < num_lines; i++)
-        list_push(lines, va_arg(va, char*));
+    {
+        char* line = va_arg(va, char*);
+        buffer = realloc(buffer, (size + strlen(line) + 1) * sizeof(char));
+        strcpy(buffer + size, line);
+        size += strlen(line);
+    }
     va_end(va);
 
-    return init_file(lines, "generated");
+    return init_file(buffer, size, "generated");
 }
 
 void test_file_generation(void)
 {
-    File_T* file = get_file(2, "hello", "world");
+    File_T* file = get_file(2, "hello\n", "world");
     TEST_ASSERT(file != NULL);
 
     TEST_ASSERT(file->path != NULL);
     TEST_CHECK(strcmp(file->path, "generated") == 0);
 
-    TEST_ASSERT(file->num_lines = 2);
-    TEST_ASSERT(file->lines != NULL);
+    TEST_ASSERT(file->num_lines == 2);
+    TEST_ASSERT(file->buffer != NULL);
     
-    TEST_CHECK(strcmp(file->lines->items[0], "hello") == 0);
-    TEST_CHECK(strcmp(file->lines->items[1], "world") == 0);
+    TEST_CHECK(get_line_len(file, 0) == strlen("hello\n"));
+    TEST_CHECK(strncmp(get_line(file, 0), "hello\n", get_line_len(file, 0)) == 0);
+    TEST_CHECK(get_line_len(file, 1) == strlen("world"));
+    TEST_CHECK(strncmp(get_line(file, 1), "world", get_line_len(file, 1)) == 0);
+
+    TEST_CHECK(get_char(file, 1, 0) == 'w');
+    TEST_CHECK(get_char(file, 1, 5) == -1);
+    TEST_CHECK(get_line(file, 2) == NULL);
 }
 
+#include "test_allocator.h"
 #include "test_hashmap.h"
+#include "test_interner.h"
+#include "test_thread_pool.h"
 #include "test_lexer.h"
 #include "test_preprocessor.h"
 #include "test_parser.h"
+#include "test_validator.h"
 #include "test_compiler.h"
 
 TEST_LIST = {
    {"file generation", test_file_generation},
+   ALLOCATOR_TESTS,
    HASHMAP_TESTS,
+   INTERNER_TESTS,
+   THREAD_POOL_TESTS,
    LEXER_TESTS,        // all lexer tests included from "test_lexer.h"
    PREPROCESSOR_TESTS, // all preprocessor tests included from "test_preprocessor.h"
    PARSER_TESTS,       // all parser tests included from "test_parser.h"
+   VALIDATOR_TESTS,    // all validator tests included from "test_validator.h"
    COMPILER_TESTS,     // all compiler tests
    {NULL, NULL}        // end of the tests
 };
\ No newline at end of file